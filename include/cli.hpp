@@ -4,9 +4,6 @@
 #include <Arduino.h>
 #include "main.hpp"
 
-// update CLI_COMMAND_CNT if adding new commands to table in cli.cpp
-#define CLI_COMMAND_CNT           11
-
 #define CMD_NAME_MAX              12
 
 // possible CLI errors
@@ -14,8 +11,118 @@
 #define CLI_ERR_CMD_NOT_FOUND     1
 #define CLI_ERR_TOO_FEW_ARGS      2
 #define CLI_ERR_TOO_MANY_ARGS     3
-#define MAX_TOKENS                8
+#define CLI_ERR_AMBIGUOUS         4
+#define MAX_TOKENS                (MAX_LINE_SZ / 2 + 1)  // every token a full line can hold
+
+// cli_Lookup() results other than a table index
+#define CLI_LOOKUP_NONE           -1
+#define CLI_LOOKUP_AMBIGUOUS      -2
+
+// cli_RunSubCmd() result when no subcommand function was run
+#define CLI_SUBCMD_ERR            -1
+
+// terminal output ring, must be a power of 2
+#define TERM_TX_BFR_SIZE          2048
+#define TERM_TX_STALL_MSEC        250     // no USB progress, discard output
+#define TERM_HOLD_BFR_SIZE        512     // task output held while a command waits
+
+// terminal output counters, see 'xdebug txbench'
+typedef struct {
+  uint32_t        queued;                 // bytes passed to term_Write()
+  uint32_t        sent;                   // bytes taken by SerialUSB
+  uint32_t        dropped;                // bytes discarded, host not reading
+  uint32_t        lines;                  // terminalOut() calls
+  uint32_t        stalls;
+  uint16_t        highWater;              // most bytes queued at once
+  uint32_t        holdDropped;            // held task output that did not fit
+} term_stats_t;
+
+// subcommand table entry for cli_RunSubCmd(); a command with
+// subcommands keeps them in a table sorted by name, checked at compile
+// time with CLI_SUBCMDS_SORTED(), and a subcommand with its own
+// subcommands calls cli_RunSubCmd() again on the next token
+typedef struct {
+  const char      *name;
+  int             (*func) (int argCnt);   // gets the command's arg count
+  int8_t          minArgs;                // arguments after the subcommand
+  int8_t          maxArgs;
+} cli_subcmd_t;
+
+/**
+  * @name   cli_NameLess
+  * @brief  compile time strcmp(a, b) < 0
+  */
+constexpr bool cli_NameLess(const char *a, const char *b)
+{
+    return((*a != *b) ? ((unsigned char) *a < (unsigned char) *b) : (*a != 0 && cli_NameLess(a + 1, b + 1)));
+}
+
+/**
+  * @name   cli_SubCmdsSorted
+  * @brief  compile time check that names are in strictly increasing order
+  */
+constexpr bool cli_SubCmdsSorted(const cli_subcmd_t *table, int count)
+{
+    return((count < 2) ? true : (cli_NameLess(table[0].name, table[1].name) && cli_SubCmdsSorted(table + 1, count - 1)));
+}
+
+#define CLI_TABLE_COUNT(t)        ((int) (sizeof(t) / sizeof(t[0])))
+#define CLI_SUBCMDS_SORTED(t)     static_assert(cli_SubCmdsSorted(t, CLI_TABLE_COUNT(t)), #t " must be sorted by name")
+
+/**
+  * @name   cli_Lookup
+  * @brief  binary search of a sorted command table with prefix matching
+  * @param  table   entries sorted by name
+  * @param  count   number of entries
+  * @param  name    member of an entry that holds its name
+  * @param  word    exact name or unique prefix of one
+  * @retval index, CLI_LOOKUP_NONE or CLI_LOOKUP_AMBIGUOUS
+  * @note   an exact match wins over longer names it is a prefix of
+  */
+template <typename T, typename N>
+int cli_Lookup(const T *table, int count, N T::*name, const char *word)
+{
+    int             lo = 0;
+    int             hi = count;
+    int             mid;
+    int             len = strlen(word);
+
+    if ( len == 0 )
+        return(CLI_LOOKUP_NONE);
+
+    // first name >= word
+    while ( lo < hi )
+    {
+        mid = (lo + hi) / 2;
+
+        if ( strcmp(table[mid].*name, word) < 0 )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ( lo == count || strncmp(table[lo].*name, word, len) != 0 )
+        return(CLI_LOOKUP_NONE);
+
+    if ( (table[lo].*name)[len] == 0 )
+        return(lo);
+
+    // sorted, so a second match can only be the next entry
+    if ( lo + 1 < count && strncmp(table[lo + 1].*name, word, len) == 0 )
+        return(CLI_LOOKUP_AMBIGUOUS);
+
+    return(lo);
+}
 
+int cli_RunSubCmd(const cli_subcmd_t *table, int count, int tokNo, int argCnt);
+int cli_SelfTest(int count);
+int term_Poll(void);
+void term_Flush(void);
+void term_Write(const char *data, int len);
+int term_TxFree(void);
+bool term_Hold(bool on);
+const term_stats_t *term_GetStats(void);
+void term_ClearStats(void);
 void CURSOR(uint8_t r,uint8_t c);
 void terminalOut(char *msg);
 void displayLine(char *m);
@@ -23,6 +130,10 @@ void doPrompt(void);
 void doHello(void);
 int waitAnyKey(void);
 bool cli(char *raw);
+const char *cli_GetArgText(int tokNo);
+const char *cli_CommandName(int cmd);
+bool cli_RunBatch(char *line, bool stopOnKey);
+void cli_RunLine(char *line);
 int help(int);
 void showCommandHelp(char *cmd);
 
@@ -6,15 +6,27 @@
 //===================================================================
 #include <stdint-gcc.h>
 
+// status display refresh period, 'set speriod <msec>' changes it, 0 = once
+#define STATUS_DEFAULT_PERIOD_MSEC  1000
+#define STATUS_MIN_PERIOD_MSEC      100
+
 void monitorsInit(void);
 const char *getPinName(int pinNo);
 int8_t getPinIndex(uint8_t pinNo);
 int statusCmd(int arg);
 char *padBuffer(int pos);
 void configureIOPins(void);
+int verifyPinTables(void);
 void readAllPins(void);
+const pin_snapshot_t *getPinSnapshot(void);
+void takePinSnapshot(pin_snapshot_t *snap);
+bool snapshotPin(const pin_snapshot_t *snap, uint8_t pinNo);
+uint32_t snapshotPinBits(const pin_snapshot_t *snap);
+bool getPinState(uint8_t pinNo);
 bool readPin(uint8_t pinNo);
 void writePin(uint8_t pinNo, uint8_t value);
 bool isCardPresent(void);
+bool isCardPresentIn(const pin_snapshot_t *snap);
+uint32_t queryScanChain(bool displayResults);
 
 #endif // _COMMANDS_H_
\ No newline at end of file
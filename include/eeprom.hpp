@@ -9,11 +9,16 @@
 
 #define MAX_EEPROM_ADDR       (8 * 1024 - 1)
 
+// simulated EEPROM: EEPROM_data_t is at 0, other users (macros) start
+// here so settings can grow without moving them
+#define EEPROM_USER_ADDR      64
+
 // EEPROM data storage struct
 typedef struct {
     uint32_t        sig;                  // unique EEPROMP signature (see #define)
-    uint16_t        status_delay_secs;    // time in secs to delay updating status display
+    uint16_t        status_period_msec;   // status display refresh period, 0 = once
     uint16_t        pwr_seq_delay_msec;   // time between MAIN and AUX pwr enables
+    uint16_t        meter_period_msec;    // INA219 sample period, 0 = off
     
     // TODO add more data
 
@@ -67,6 +72,9 @@ void EEPROM_Save(void);
 void EEPROM_Read(void);
 void EEPROM_Defaults(void);
 bool EEPROM_InitLocal(void);
+void EEPROM_ReadBytes(uint16_t eepromAddr, uint8_t *dest, uint16_t length);
+void EEPROM_WriteBytes(uint16_t eepromAddr, const uint8_t *src, uint16_t length);
+void EEPROM_Commit(void);
 void readEEPROM(uint8_t i2cAddr, uint32_t eeaddress, uint8_t *dest, uint16_t length);
 void writeEEPROMPage(uint8_t i2cAddr, long eeAddress, uint8_t *buffer);
 
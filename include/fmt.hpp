@@ -0,0 +1,39 @@
+#ifndef _FMT_H_
+#define _FMT_H_
+//===================================================================
+// fmt.hpp
+// Small formatter for hot output paths (see fmt.cpp).
+//
+// A line is built left to right with one call per field; there is no
+// format string and no varargs, so argument types are checked by the
+// compiler.  The buffer always holds a terminated string, and output
+// that would overflow it is cut off.
+//
+//   fmt_t   f;
+//
+//   fmt_Start(&f, outBfr, OUTBFR_SIZE);
+//   fmt_Str(&f, "12V ");
+//   fmt_Int(&f, mv, 6);                 // "%6ld"
+//   fmt_Hex(&f, word, 8);               // "%08lx"
+//   fmt_Fixed(&f, uWh, 6, 11);          // "%4lu.%06lu"
+//   SHOW();
+//===================================================================
+#include <stdint-gcc.h>
+
+typedef struct {
+  char            *bfr;
+  char            *s;                     // next char, always holds the 0
+  char            *end;                   // last char, kept for the 0
+} fmt_t;
+
+char *fmt_Start(fmt_t *f, char *bfr, int size);
+void fmt_Char(fmt_t *f, char c);
+void fmt_Str(fmt_t *f, const char *str, int width = 0);
+void fmt_Uint(fmt_t *f, uint32_t v, int width = 0, char pad = ' ');
+void fmt_Int(fmt_t *f, int32_t v, int width = 0);
+void fmt_Hex(fmt_t *f, uint32_t v, int digits, bool upper = false);
+void fmt_Fixed(fmt_t *f, uint32_t v, int decimals, int width = 0);
+void fmt_PadTo(fmt_t *f, int col);
+int fmt_Len(const fmt_t *f);
+
+#endif // _FMT_H_
@@ -0,0 +1,84 @@
+#ifndef _HAL_H_
+#define _HAL_H_
+//===================================================================
+// hal.hpp
+// Hardware access used by the application modules.
+//
+// Pins, time, interrupt masking, I2C, the USB serial port, the FLASH
+// simulated EEPROM and reset all go through these calls; no module
+// other than the drivers listed below uses the Arduino hardware API
+// or a SAMD21 register.  hal_samd21.cpp implements them for the board.
+// The native build ([env:native], -D HAL_NATIVE) implements them in
+// lib/ttfsim on top of a simulated fixture: NIC card, scan chain, FRU
+// EEPROM and INA219s (see sim.hpp).
+//
+// Drivers: hal_scan.cpp (SERCOM0/DMAC scan chain engine), timers.cpp
+// (TC5 scan clock), mem.cpp (SRAM layout) and USBCore.cpp (the CDC IN
+// endpoint under usbtx.cpp) are board only; lib/ttfsim has the host
+// versions.
+//===================================================================
+#include <stdint-gcc.h>
+
+// bytes of FLASH simulated EEPROM, EEPROM_EMULATION_SIZE on the board
+#define HAL_NVM_SIZE              1024
+
+// hal_PinExtInt() of a pin with no EXTINT line
+#define HAL_EXTINT_NONE           -1
+
+typedef void (*hal_isr_t)(void);
+
+// pins, Arduino numbering
+void hal_PinMode(uint8_t pinNo, uint8_t mode);
+void hal_PinWrite(uint8_t pinNo, uint8_t level);
+uint8_t hal_PinRead(uint8_t pinNo);
+uint32_t hal_PortIn(uint8_t group);
+void hal_PinHighDrive(uint8_t pinNo);
+void hal_PinPort(uint8_t pinNo, uint8_t *group, uint8_t *bit);
+int hal_PinExtInt(uint8_t pinNo);
+void hal_PinAttach(uint8_t pinNo, hal_isr_t isr);
+
+// time
+uint32_t hal_Millis(void);
+uint32_t hal_Micros(void);
+uint64_t hal_Cycles(void);
+void hal_Delay(uint32_t msecs);
+void hal_DelayUsecs(uint32_t usecs);
+
+// interrupt masking
+void hal_IrqOff(void);
+void hal_IrqOn(void);
+uint32_t hal_IrqSave(void);
+void hal_IrqRestore(uint32_t state);
+void hal_Barrier(void);
+
+// I2C master, one transaction per call
+void hal_I2cBegin(void);
+void hal_I2cSetClock(uint32_t hz);
+bool hal_I2cWrite(uint8_t i2cAddr, const uint8_t *data, uint16_t len);
+uint16_t hal_I2cRead(uint8_t i2cAddr, uint8_t *data, uint16_t len);
+
+// USB serial port; output goes through usbtx.hpp
+void hal_SerialBegin(void);
+bool hal_SerialConnected(void);
+bool hal_SerialDtr(void);
+int hal_SerialAvailable(void);
+int hal_SerialRead(void);
+uint32_t hal_SerialWrite(const uint8_t *data, uint32_t len);
+
+// FLASH simulated EEPROM; writes are buffered until hal_NvmCommit()
+uint8_t hal_NvmRead(uint16_t addr);
+void hal_NvmWrite(uint16_t addr, uint8_t value);
+void hal_NvmCommit(void);
+
+// system
+uint8_t hal_ResetCause(void);
+uint32_t hal_FreeRam(void);
+void hal_Reset(void);
+
+// scan chain drivers
+void hal_ScanInit(void);
+uint32_t hal_ScanShift(const uint8_t *tx, uint8_t *rx, uint16_t len, bool useDMA);
+void timers_Init(void);
+void timers_scanChainCapture(uint16_t bits);
+
+#endif // _HAL_H_
@@ -0,0 +1,31 @@
+#ifndef _MACRO_H_
+#define _MACRO_H_
+//===================================================================
+// macro.hpp
+// Definitions for command macros stored in FLASH (see macro.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+#include "main.hpp"
+#include "eeprom.hpp"
+
+// macro area in simulated EEPROM, after the settings
+#define MACRO_EEPROM_ADDR         EEPROM_USER_ADDR
+#define MACRO_SIGNATURE           0x4D414331      // "MAC1"
+#define MACRO_COUNT               8
+#define MACRO_NAME_SZ             12
+#define MACRO_BODY_SZ             MAX_LINE_SZ
+
+// nested 'macro run' limit
+#define MACRO_MAX_DEPTH           3
+
+// one stored macro; an empty name is a free slot
+typedef struct {
+  char            name[MACRO_NAME_SZ];
+  char            body[MACRO_BODY_SZ];        // ';' separated commands
+} macro_t;
+
+int macroCmd(int argCnt);
+bool macro_IsDefine(const char *word);
+int sleepCmd(int argCnt);
+
+#endif // _MACRO_H_
@@ -68,6 +68,9 @@
 #define CLR_LINE()                  terminalOut((char *) "\x1b[0K")
 #define SHOW()                      terminalOut(outBfr)
 
+// formatting buffer shared by all modules, defined in cli.cpp
+extern char             outBfr[OUTBFR_SIZE];
+
 typedef enum {
   ACT_UNDEF = 0,
   ACT_LO,
@@ -82,7 +85,18 @@ typedef struct {
   char              name[20];
 } pin_mgt_t;
 
+// the pins the CLI knows about, defined in commands.cpp
+extern const pin_mgt_t  staticPins[];
+extern uint16_t         static_pin_count;
+
+// one coherent sample of all inputs, see readAllPins()
+typedef struct {
+  uint32_t          usecs;              // micros() when taken
+  uint32_t          in[2];              // PORT->Group[0 = PA, 1 = PB].IN
+} pin_snapshot_t;
+
 // misc functions
+void backgroundPoll(void);
 void dumpMem(unsigned char *s, int len);
 const char *getPinName(int pinNo);
 int8_t getPinIndex(uint8_t pinNo);
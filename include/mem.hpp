@@ -0,0 +1,32 @@
+#ifndef _MEM_H_
+#define _MEM_H_
+//===================================================================
+// mem.hpp
+// Definitions for SRAM use instrumentation (see mem.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+#define MEM_PAINT                 0xA5A5A5A5
+#define MEM_GUARD_WORDS           8       // painted words kept above the heap
+#define MEM_CHECK_MSEC            100     // mem_Check() task period
+
+// SRAM use in bytes
+typedef struct {
+  uint32_t        data;
+  uint32_t        bss;
+  uint32_t        noinit;                 // not cleared at startup
+  uint32_t        heap;                   // sbrk() break above .noinit, its peak
+  uint32_t        heapFree;               // freed blocks inside the heap
+  uint32_t        stackNow;
+  uint32_t        stackPeak;              // deepest since boot
+  uint32_t        largestFree;            // between heap and deepest stack
+  uint32_t        total;                  // SRAM size
+} mem_usage_t;
+
+void mem_PaintStack(void);
+void mem_GetUsage(mem_usage_t *usage);
+void mem_Check(void);
+uint32_t mem_GetOverflows(void);
+void mem_Show(void);
+
+#endif // _MEM_H_
@@ -0,0 +1,110 @@
+#ifndef _METER_H_
+#define _METER_H_
+//===================================================================
+// meter.hpp
+// Definitions for INA219 power telemetry of the NIC rails (see meter.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+// INA219 I2C addresses, see 'xdebug scan'
+#define METER_12V_I2C_ADDR          0x40    // U2
+#define METER_3V3_I2C_ADDR          0x41    // U3
+
+// shunt resistor on each rail in milliohms; with PGA /8 (320 mV full
+// scale) 10 mohms reads up to 32 A at 1 mA resolution
+#define METER_12V_SHUNT_MOHMS       10
+#define METER_3V3_SHUNT_MOHMS       10
+
+// INA219 registers
+#define INA219_REG_CONFIG           0x00
+#define INA219_REG_SHUNT            0x01    // signed, 10 uV/LSB
+#define INA219_REG_BUS              0x02    // bits 15..3, 4 mV/LSB
+#define INA219_REG_POWER            0x03
+#define INA219_REG_CURRENT          0x04
+#define INA219_REG_CALIBRATION      0x05
+
+// 32V bus range, PGA /8, 12-bit bus and shunt ADC (532 usecs each),
+// continuous shunt and bus conversions
+#define INA219_CONFIG_CONTINUOUS    0x399F
+#define INA219_CONFIG_RESET         0x8000
+
+// as above with 9-bit ADCs (84 usecs each) for burst capture
+#define INA219_CONFIG_FAST          0x3807
+#define INA219_BUS_MV(raw)          (((raw) >> 3) * 4)
+#define INA219_BUS_CNVR             0x0002  // conversion ready, reading POWER clears it
+
+// default sample period, 'set mperiod <msec>' changes it, 0 = off
+#define METER_DEFAULT_PERIOD_MSEC   100
+
+// burst capture: I2C runs at METER_BURST_I2C_HZ while armed; the
+// buffer takes all free RAM but METER_BURST_RAM_RESERVE, up to
+// METER_BURST_MAX_SAMPLES
+#define METER_BURST_I2C_HZ          400000
+#define METER_NORMAL_I2C_HZ         100000
+#define METER_BURST_RAM_RESERVE     4096
+#define METER_BURST_MAX_SAMPLES     2048
+
+// burst sample period, longer than the worst sample: a conversion
+// wait (168 usecs of INA219_CONFIG_FAST) plus five register reads at
+// METER_BURST_I2C_HZ; samples wait METER_BURST_CNVR_USECS at most
+#define METER_BURST_PERIOD_USECS    1000
+#define METER_BURST_CNVR_USECS      500
+
+// meter_FormatRail() output size
+#define METER_LINE_SZ               64
+
+typedef enum {
+  METER_RAIL_12V = 0,
+  METER_RAIL_3V3_AUX,
+  METER_RAIL_COUNT
+} METER_RAIL;
+
+// one rail; mW statistics since the last 'power meter clear'
+typedef struct {
+  const char      *name;
+  uint8_t         i2cAddr;
+  uint16_t        shuntMohms;
+  bool            present;                    // INA219 answered at init
+  uint16_t        busMv;                      // last sample
+  int32_t         currentMa;
+  int32_t         powerMw;
+  int32_t         minMw;
+  int32_t         maxMw;
+  int64_t         sumMw;
+  uint32_t        samples;
+  uint32_t        errors;                     // I2C failures
+  uint32_t        lastMsecs;                  // millis() of last sample
+  int64_t         energyUj;                   // sum of mW * msecs
+} meter_rail_t;
+
+// one burst sample of both rails, raw INA219 register values
+typedef struct {
+  uint32_t        usecs;                      // since trigger
+  int16_t         shunt[METER_RAIL_COUNT];
+  uint16_t        bus[METER_RAIL_COUNT];
+} meter_burst_t;
+
+typedef enum {
+  METER_BURST_IDLE = 0,
+  METER_BURST_ARMED,                          // waiting for MAIN_EN/AUX_EN write
+  METER_BURST_RUNNING,
+  METER_BURST_DONE
+} METER_BURST;
+
+void meter_Init(void);
+void meter_Poll(void);
+bool meter_Sample(METER_RAIL rail);
+const meter_rail_t *meter_GetRail(METER_RAIL rail);
+void meter_Clear(void);
+void meter_FormatRail(METER_RAIL rail, char *bfr);
+void meter_Show(void);
+bool meter_BurstArm(void);
+void meter_BurstDisarm(void);
+void meter_BurstTrigger(void);
+void meter_BurstShow(void);
+void meter_BurstDump(void);
+uint32_t meter_FreeRam(void);
+bool ina219_ReadReg(uint8_t i2cAddr, uint8_t reg, uint16_t *value);
+bool ina219_WriteReg(uint8_t i2cAddr, uint8_t reg, uint16_t value);
+
+#endif // _METER_H_
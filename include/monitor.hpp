@@ -0,0 +1,27 @@
+#ifndef _MONITOR_H_
+#define _MONITOR_H_
+//===================================================================
+// monitor.hpp
+// Definitions for the input pin edge monitor (see monitor.cpp).
+// monitorsInit() is declared in commands.hpp.
+//===================================================================
+#include <stdint-gcc.h>
+
+#define MONITOR_MAX_PINS          24
+#define MONITOR_LOG_SIZE          128     // must be a power of 2, at most 256
+#define MONITOR_EXTINT_LINES      16
+
+// one edge; 'polled' if seen by monitor_Poll() rather than the EIC
+typedef struct {
+  uint32_t        usecs;                  // micros() of the edge
+  uint8_t         pinNo;
+  uint8_t         level;                  // pin level read after the edge
+  bool            polled;
+} monitor_edge_t;
+
+void monitor_Poll(void);
+bool monitor_GetEdge(monitor_edge_t *edge);
+void monitor_ShowLog(void);
+void monitor_Clear(void);
+
+#endif // _MONITOR_H_
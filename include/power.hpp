@@ -0,0 +1,104 @@
+#ifndef _POWER_H_
+#define _POWER_H_
+//===================================================================
+// power.hpp
+// Definitions for the NIC 3.0 card power sequencer (see power.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+// per-state timeouts and delays (msecs); MAIN_EN -> AUX_EN delay is
+// the 'pdelay' FLASH parameter
+#define PWR_PWRGOOD_TIMEOUT_MSEC    50
+#define PWR_SCAN_DELAY_MSEC         2000
+#define PWR_DOWN_TIMEOUT_MSEC       100
+
+// scan chain is sampled this often in the SCAN state to timestamp the
+// first valid (not all 0s or all 1s) sample
+#define PWR_SCAN_POLL_MSEC          10
+
+// power up timing history, see 'power timing'
+#define PWR_TIMING_HISTORY          16
+#define PWR_DELTA_NONE              0xFFFFFFFF
+
+// 'power cycle' stress test log of most recent cycles
+#define PWR_CYCLE_LOG_SIZE          32
+
+// sequencer states; keep in sync with pwrStateNames[] in power.cpp
+typedef enum {
+  PWR_STATE_OFF = 0,
+  PWR_STATE_MAIN_EN,              // MAIN_EN asserted, waiting pdelay
+  PWR_STATE_AUX_EN,               // AUX_EN asserted
+  PWR_STATE_WAIT_PWRGOOD,         // waiting for NIC_PWR_GOOD
+  PWR_STATE_SCAN,                 // waiting for scan chain data to settle
+  PWR_STATE_ON,
+  PWR_STATE_POWER_DOWN,           // enables removed, waiting for NIC_PWR_GOOD low
+  PWR_STATE_FAULT,                // enables removed after a fault
+  PWR_STATE_COUNT
+} PWR_STATE;
+
+// fault reasons; keep in sync with pwrFaultNames[] in power.cpp
+typedef enum {
+  PWR_FAULT_NONE = 0,
+  PWR_FAULT_PWRGOOD_TIMEOUT,      // NIC_PWR_GOOD never asserted
+  PWR_FAULT_PWRGOOD_LOST,         // NIC_PWR_GOOD dropped while powered
+  PWR_FAULT_TEMP_CRIT,            // TEMP_CRIT asserted while powered
+  PWR_FAULT_POWER_DOWN,           // NIC_PWR_GOOD stayed high after power down
+  PWR_FAULT_CARD_REMOVED,         // PRSNTB[3:0] all high while powered
+  PWR_FAULT_COUNT
+} PWR_FAULT;
+
+// measured intervals per cycle; keep in sync with pwrDeltaNames[] in power.cpp
+typedef enum {
+  PWR_DELTA_MAIN_AUX = 0,         // MAIN_EN -> AUX_EN
+  PWR_DELTA_MAIN_PWRGOOD,         // MAIN_EN -> NIC_PWR_GOOD rising
+  PWR_DELTA_AUX_PWRGOOD,          // AUX_EN -> NIC_PWR_GOOD rising
+  PWR_DELTA_MAIN_PRSNT,           // MAIN_EN -> first PRSNTB edge
+  PWR_DELTA_MAIN_SCAN,            // MAIN_EN -> first valid scan chain sample
+  PWR_DELTA_OFF_PWRGOOD,          // enables removed -> NIC_PWR_GOOD falling
+  PWR_DELTA_COUNT
+} PWR_DELTA;
+
+// one power cycle; PWR_DELTA_NONE if the event was not seen
+typedef struct {
+  uint32_t        delta[PWR_DELTA_COUNT];     // usecs
+} power_timing_t;
+
+// one 'power cycle' test cycle
+typedef struct {
+  uint32_t        cycle;                      // 1..count
+  uint32_t        pwrGoodUsecs;               // MAIN_EN -> NIC_PWR_GOOD, PWR_DELTA_NONE if never
+  uint32_t        scanWord;                   // first 32 scan chain bits once powered up
+  uint8_t         fault;                      // PWR_FAULT
+  bool            scanMismatch;               // scanWord differs from first good cycle
+} power_cycle_log_t;
+
+// 'power cycle' totals since the last start
+typedef struct {
+  uint32_t        count;                      // cycles requested
+  uint32_t        done;
+  uint32_t        pass;
+  uint32_t        mismatches;
+  uint32_t        faults[PWR_FAULT_COUNT];    // cycles ending in each fault
+  uint32_t        pwrGoodMin;                 // MAIN_EN -> NIC_PWR_GOOD usecs
+  uint32_t        pwrGoodMax;
+  uint64_t        pwrGoodSum;
+  uint32_t        pwrGoodCount;               // cycles NIC_PWR_GOOD was seen in
+} power_cycle_stats_t;
+
+bool power_Up(void);
+void power_Down(void);
+void power_Poll(void);
+PWR_STATE power_GetState(void);
+uint32_t power_GetStateMsecs(void);
+const char *power_GetStateName(PWR_STATE state);
+PWR_FAULT power_GetFault(void);
+const char *power_GetFaultName(PWR_FAULT fault);
+void power_ShowTiming(void);
+void power_ClearTiming(void);
+bool power_StartCycle(uint32_t count, uint32_t onMsecs, uint32_t offMsecs);
+bool power_AbortCycle(void);
+const power_cycle_stats_t *power_GetCycleStats(void);
+void power_ShowCycle(void);
+void power_PinEdge(uint8_t pinNo, bool level, uint32_t usecs);
+
+#endif // _POWER_H_
@@ -0,0 +1,46 @@
+#ifndef _PROF_H_
+#define _PROF_H_
+//===================================================================
+// prof.hpp
+// Definitions for cycle-resolution profiling (see prof.cpp).
+//
+//   uint64_t    start = prof_Now();
+//   ...
+//   prof_Record(PROF_I2C_INA219, start);
+//===================================================================
+#include <stdint-gcc.h>
+#include "cli.hpp"
+
+// histogram bucket n counts times of 4^n .. 4^(n+1)-1 cycles, the
+// last one everything longer
+#define PROF_BUCKETS              16
+
+// room for cmdTable[] dispatch sites, cli.cpp checks the table fits
+#define PROF_CMD_MAX              24
+
+// profiled sites
+typedef enum {
+  PROF_ISR_TC5 = 0,                       // scan clock bit-bang
+  PROF_ISR_USB,                           // UDD_Handler
+  PROF_ISR_DMAC,
+  PROF_ISR_EIC,                           // pin monitor EXTINT callbacks
+  PROF_I2C_INA219,                        // one register read or write
+  PROF_I2C_FRU,                           // one FRU EEPROM read or page write
+  PROF_CMD_FIRST,                         // cmdTable[] dispatches, in table order
+  PROF_SITE_COUNT = PROF_CMD_FIRST + PROF_CMD_MAX
+} PROF_SITE;
+
+typedef struct {
+  uint32_t        count;
+  uint32_t        minCycles;
+  uint32_t        maxCycles;
+  uint64_t        totalCycles;
+  uint32_t        buckets[PROF_BUCKETS];
+} prof_site_t;
+
+uint64_t prof_Now(void);
+void prof_Record(PROF_SITE site, uint64_t start);
+void prof_Show(void);
+void prof_Clear(void);
+
+#endif // _PROF_H_
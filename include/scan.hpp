@@ -0,0 +1,64 @@
+#ifndef _SCAN_H_
+#define _SCAN_H_
+//===================================================================
+// scan.hpp
+// Definitions for the NIC 3.0 scan chain capture engine (see scan.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+// scan chain clock when clocked by SERCOM0 in SPI master mode
+#define SCAN_SPI_CLOCK_HZ         1000000
+
+// SCAN_LD_N low pulse width before shifting starts (usecs)
+#define SCAN_LD_PULSE_USECS       200
+
+// scan chain length: bytes 0..3 are always present, cards with more
+// ports extend the chain; the length need not be whole bytes
+#define SCAN_DEFAULT_BITS         32
+#define SCAN_MAX_BITS             256
+#define SCAN_MAX_BYTES            (SCAN_MAX_BITS / 8)
+#define SCAN_MAX_WORDS            (SCAN_MAX_BITS / 32)
+#define SCAN_BIT_NAME_SZ          20
+
+// background sampling: ring buffer of changed samples, see 'scan watch'
+#define SCAN_LOG_SIZE             128
+#define SCAN_MIN_SAMPLE_MSECS     10
+
+// capture engine modes, see 'scan mode' command
+typedef enum {
+  SCAN_MODE_SPI = 0,            // SERCOM0 SPI master, CPU polls each byte
+  SCAN_MODE_DMA,                // SERCOM0 SPI master, DMAC moves the bytes
+  SCAN_MODE_TC5,                // legacy TC5 ISR bit-bang (fallback)
+  SCAN_MODE_COUNT
+} SCAN_MODE;
+
+// capture time measurements, one set per mode
+typedef struct {
+  uint32_t        captures;     // number of captures taken in this mode
+  uint32_t        captureUsecs; // last capture: SCAN_LD_N low to last bit in
+  uint32_t        cpuUsecs;     // last capture: time the CPU was busy
+  uint32_t        maxCaptureUsecs;
+  uint32_t        maxCpuUsecs;
+} scan_stats_t;
+
+void scan_Init(void);
+uint32_t scan_Capture(void);
+bool scan_SetMode(SCAN_MODE mode);
+SCAN_MODE scan_GetMode(void);
+const char *scan_GetModeName(SCAN_MODE mode);
+const scan_stats_t *scan_GetStats(SCAN_MODE mode);
+void scan_ClearStats(void);
+bool scan_SetLength(uint16_t bits);
+uint16_t scan_GetLength(void);
+uint16_t scan_DetectLength(void);
+bool scan_GetBit(uint16_t bitNo);
+uint32_t scan_GetWord(uint8_t wordNo);
+void scan_GetBitName(uint16_t bitNo, char *name);
+bool scan_SetSamplePeriod(uint32_t msecs, bool stream);
+uint32_t scan_GetSamplePeriod(void);
+void scan_Poll(void);
+void scan_ShowLog(void);
+void scan_ClearLog(void);
+void scan_ShowSampling(void);
+
+#endif // _SCAN_H_
@@ -0,0 +1,41 @@
+#ifndef _SCHED_H_
+#define _SCHED_H_
+//===================================================================
+// sched.hpp
+// Definitions for the cooperative task scheduler (see sched.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+#define SCHED_MAX_TASKS           12
+
+// clock source, hal_Millis()/hal_Micros(); a test can pass its own
+// clock to sched_Init()
+typedef struct {
+  uint32_t        (*msecs) (void);
+  uint32_t        (*usecs) (void);
+} sched_clock_t;
+
+// task table entry, the table is kept by the caller
+typedef struct {
+  const char      *name;
+  void            (*func) (void);
+  uint16_t        periodMsec;             // 0 = every pass
+} sched_task_t;
+
+// run time of a task since the last sched_ClearStats()
+typedef struct {
+  uint32_t        runs;
+  uint32_t        totalUsecs;             // includes tasks it ran while waiting
+  uint32_t        maxUsecs;
+  uint32_t        late;                   // runs started a period or more late
+} sched_stats_t;
+
+void sched_Init(const sched_task_t *tasks, uint8_t count, const sched_clock_t *clock);
+void sched_Run(void);
+uint8_t sched_TaskCount(void);
+const sched_task_t *sched_GetTask(uint8_t task);
+const sched_stats_t *sched_GetStats(uint8_t task);
+uint32_t sched_StatsUsecs(void);
+void sched_ClearStats(void);
+
+#endif // _SCHED_H_
@@ -0,0 +1,69 @@
+#ifndef _STREAM_H_
+#define _STREAM_H_
+//===================================================================
+// stream.hpp
+// Definitions for the telemetry stream (see stream.cpp).
+//
+// Binary records are COBS encoded and end with a 0x00 byte.  The
+// decoded record is STREAM_RECORD_SIZE bytes, all little endian:
+//
+//   0  u8   STREAM_RECORD_TYPE
+//   1  u8   power sequencer state (PWR_STATE)
+//   2  u8   last power fault (PWR_FAULT)
+//   3  u8   0
+//   4  u32  sequence number
+//   8  u32  millis()
+//  12  u32  micros() of the pin sample
+//  16  u32  PORTA IN
+//  20  u32  PORTB IN
+//  24  u32  bit n = level of 'pins' entry n
+//  28  u32  scan chain bytes 0..3 of the last capture, 0 if no card
+//  32  u16  scan chain length in bits
+//  34  i32  12V rail mW
+//  38  i32  3.3V_AUX rail mW
+//  42  u16  CRC-16/CCITT-FALSE of bytes 0..41
+//
+// JSON records carry the same fields, one object per line.
+//===================================================================
+#include <stdint-gcc.h>
+
+#define STREAM_RECORD_TYPE          0x01
+#define STREAM_RECORD_SIZE          44
+#define STREAM_CRC_OFFSET           42
+#define STREAM_FRAME_MAX            (STREAM_RECORD_SIZE + 2)    // COBS overhead + 0x00
+#define STREAM_JSON_MAX             220
+
+#define STREAM_MIN_PERIOD_MSEC      10
+
+typedef enum {
+  STREAM_OFF = 0,
+  STREAM_BINARY,
+  STREAM_JSON
+} STREAM_FORMAT;
+
+// a decoded record
+typedef struct {
+  uint8_t         pwrState;
+  uint8_t         pwrFault;
+  uint32_t        seq;
+  uint32_t        msecs;
+  uint32_t        usecs;
+  uint32_t        portIn[2];
+  uint32_t        pins;
+  uint32_t        scanWord;
+  uint16_t        scanBits;
+  int32_t         mw12v;
+  int32_t         mw3v3;
+} stream_record_t;
+
+void stream_Poll(void);
+bool stream_Start(STREAM_FORMAT format, uint32_t msecs);
+void stream_Stop(void);
+uint16_t stream_Crc16(const uint8_t *data, int len);
+int stream_CobsEncode(const uint8_t *src, int len, uint8_t *dst);
+int stream_CobsDecode(const uint8_t *src, int len, uint8_t *dst);
+void stream_Pack(const stream_record_t *rec, uint8_t *raw);
+bool stream_Unpack(const uint8_t *raw, int len, stream_record_t *rec);
+int streamCmd(int argCnt);
+
+#endif // _STREAM_H_
@@ -0,0 +1,41 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+//===================================================================
+// trace.hpp
+// Definitions for the post-mortem event trace (see trace.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+#define TRACE_RECORDS             128     // must be a power of 2
+#define TRACE_MAGIC               0x54524331      // "TRC1"
+
+// events, keep traceNames[] in trace.cpp in step
+typedef enum {
+  TRACE_BOOT = 0,                         // PM->RCAUSE, boot number
+  TRACE_USB_ISR,                          // INTFLAG, EPINTSMRY; SOF-only interrupts skipped
+  TRACE_USB_SEND,                         // ep, bytes
+  TRACE_USB_TX_TIMEOUT,                   // ep, bytes dropped; host stopped reading
+  TRACE_USB_TX_DROP,                      // ep, bytes dropped while still timed out
+  TRACE_USB_RECV,                         // ep, bytes
+  TRACE_CMD_START,                        // cmdTable[] index, arg count
+  TRACE_CMD_END,                          // cmdTable[] index, msecs
+  TRACE_TC5_START,                        // first scan clock edge, no args
+  TRACE_TC5_END,                          // bits captured, clock pulses
+  TRACE_EVENT_COUNT
+} TRACE_EVENT;
+
+typedef struct {
+  uint32_t        usecs;
+  uint16_t        event;                  // TRACE_EVENT
+  uint16_t        arg1;
+  uint32_t        arg2;
+} trace_rec_t;
+
+void trace_Init(void);
+void trace_Event(TRACE_EVENT event, uint16_t arg1, uint32_t arg2);
+bool trace_IsHeld(void);
+void trace_Enable(bool on);
+void trace_Clear(void);
+void trace_Dump(void);
+
+#endif // _TRACE_H_
@@ -0,0 +1,79 @@
+#ifndef _USBTX_H_
+#define _USBTX_H_
+//===================================================================
+// usbtx.hpp
+// Definitions for the CDC IN transmit banks (see usbtx.cpp).
+//
+// Asynchronous writes: the caller owns a usbtx_req_t and its data
+// until status leaves USBTX_PENDING.
+//
+//   static usbtx_req_t   req;
+//
+//   req.data = bfr;
+//   req.len = len;
+//   if ( usbtx_Write(&req) == false )
+//       ...queue full, try again later
+//   ...
+//   if ( req.status != USBTX_PENDING )
+//       ...bfr can be reused
+//===================================================================
+#include <stdint-gcc.h>
+
+// bytes per bank, a multiple of the 64 byte packet size and at most
+// 16383 (the multi-packet BYTE_COUNT field)
+#define USBTX_BANK_SIZE           512
+#define USBTX_QUEUE_LEN           8       // requests, must be a power of 2
+#define USBTX_PACKET_SIZE         64      // EPX_SIZE, full speed bulk
+#define USBTX_TIMEOUT_MSEC        70      // host not reading, drop the queue
+
+typedef enum {
+  USBTX_DONE = 0,                         // sent to the host
+  USBTX_PENDING,                          // queued or on the bus
+  USBTX_TIMEOUT,                          // host stopped reading, not sent
+  USBTX_DROPPED                           // not sent, host had already stopped or USB reset
+} USBTX_STATUS;
+
+struct usbtx_req_s;
+typedef void (*usbtx_done_t)(struct usbtx_req_s *req);
+
+typedef struct usbtx_req_s {
+  const uint8_t   *data;
+  uint16_t        len;
+  uint16_t        copied;                 // bytes in the banks, usbtx.cpp use
+  volatile uint8_t status;                // USBTX_STATUS
+  usbtx_done_t    done;                   // optional, runs with interrupts off,
+                                          //  must not call usbtx_Write()
+  void            *ctx;                   // for done()
+} usbtx_req_t;
+
+// CDC IN transmit counters, see 'xdebug usbbench' and 'stream'
+typedef struct {
+  uint32_t        queued;                 // bytes copied into the banks
+  uint32_t        transfers;              // multi-packet transfers started
+  uint32_t        waits;                  // send() found both banks full
+  uint32_t        timeouts;               // host stopped reading
+  uint32_t        dropped;                // bytes discarded
+  uint32_t        requests;               // usbtx_Write() requests accepted
+  uint32_t        completed;              // requests sent to the host
+  uint32_t        rejected;               // usbtx_Write() found the queue full
+  uint8_t         queueHighWater;         // most requests queued at once
+} usbtx_stats_t;
+
+bool usbtx_Write(usbtx_req_t *req);
+void usbtx_Poll(void);
+uint32_t usbtx_Pending(void);
+const usbtx_stats_t *usbtx_GetStats(void);
+
+// USBCore.cpp: send() for CDC IN, endpoint configured or bus reset,
+// transfer complete interrupt; the last two with interrupts off
+uint32_t usbtx_Send(const uint8_t *data, uint32_t len);
+void usbtx_Reset(uint8_t ep);
+void usbtx_Done(void);
+
+// the CDC IN endpoint, USBCore.cpp on the board or the sim
+bool usbtx_EpConfigured(void);
+void usbtx_EpArm(const uint8_t *data, uint16_t len);
+bool usbtx_EpTransferComplete(void);
+void usbtx_EpAckComplete(void);
+
+#endif // _USBTX_H_
@@ -0,0 +1,47 @@
+#ifndef _TTFSIM_ARDUINO_H_
+#define _TTFSIM_ARDUINO_H_
+//===================================================================
+// Arduino.h
+// Native build stand-in for the Arduino SAMD core header: the types,
+// constants and libc headers the application modules use.  It
+// deliberately has no pinMode(), digitalRead(), millis() etc; those
+// go through hal.hpp, which sim_hal.cpp implements.
+//===================================================================
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#define HIGH                      1
+#define LOW                       0
+
+#define INPUT                     0
+#define OUTPUT                    1
+#define INPUT_PULLUP              2
+#define INPUT_PULLDOWN            3
+
+// g_APinDescription[] entries in variant_pins.h, see sim_hal.cpp
+#define PINS_COUNT                36
+#define F_CPU                     48000000L
+
+typedef uint8_t                   byte;
+typedef bool                      boolean;
+typedef uint8_t                   pin_size_t;
+
+// sketch entry points, main.cpp
+void setup(void);
+void loop(void);
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+
+// uint32_t is unsigned long on the SAMD21 but unsigned int here, so
+// the modules cast to (unsigned) long for %lu and %ld; sprintf() is the
+// C library's, and its format checking covers them on this build too.
+
+#endif // _TTFSIM_ARDUINO_H_
@@ -0,0 +1,124 @@
+#ifndef _TTFSIM_WVARIANT_H_
+#define _TTFSIM_WVARIANT_H_
+//===================================================================
+// WVariant.h
+// Native build stand-in for the SAMD core's WVariant.h: the
+// PinDescription type and the names platformio/variants/ttf/
+// variant_pins.h uses, with the core's values, so the native build
+// compiles the board's own g_APinDescription[] rows (sim_hal.cpp).
+// Only the names those rows use are here.
+//===================================================================
+#include <stdint.h>
+
+typedef enum _EPortType
+{
+  NOT_A_PORT = -1,
+  PORTA = 0,
+  PORTB = 1,
+  PORTC = 2
+} EPortType;
+
+typedef enum _EPioType
+{
+  PIO_NOT_A_PIN = -1,
+  PIO_EXTINT = 0,
+  PIO_ANALOG,
+  PIO_SERCOM,
+  PIO_SERCOM_ALT,
+  PIO_TIMER,
+  PIO_TIMER_ALT,
+  PIO_COM,
+  PIO_AC_CLK,
+  PIO_DIGITAL,
+  PIO_INPUT,
+  PIO_INPUT_PULLUP,
+  PIO_OUTPUT
+} EPioType;
+
+#define PIN_ATTR_NONE             (0UL << 0)
+#define PIN_ATTR_COMBO            (1UL << 0)
+#define PIN_ATTR_ANALOG           (1UL << 1)
+#define PIN_ATTR_DIGITAL          (1UL << 2)
+#define PIN_ATTR_PWM              (1UL << 3)
+#define PIN_ATTR_TIMER            (1UL << 4)
+#define PIN_ATTR_TIMER_ALT        (1UL << 5)
+#define PIN_ATTR_EXTINT           (1UL << 6)
+
+typedef enum _EAnalogChannel
+{
+  No_ADC_Channel = -1
+} EAnalogChannel;
+
+// timer number << 8 | channel, as the core encodes them
+#define GCLK_CCL(tc, ch)          (((tc) << 8) | (ch))
+
+typedef enum _ETCChannel
+{
+  NOT_ON_TIMER = -1,
+  TCC0_CH1 = GCLK_CCL(0, 1),
+  TCC0_CH6 = GCLK_CCL(0, 6),
+  TCC0_CH7 = GCLK_CCL(0, 7),
+  TCC1_CH0 = GCLK_CCL(1, 0),
+  TCC2_CH0 = GCLK_CCL(2, 0),
+  TC3_CH1 = GCLK_CCL(3, 1),
+  TC4_CH0 = GCLK_CCL(4, 0),
+  TC4_CH1 = GCLK_CCL(4, 1),
+  TC5_CH0 = GCLK_CCL(5, 0),
+  TC5_CH1 = GCLK_CCL(5, 1)
+} ETCChannel;
+
+typedef enum _EPWMChannel
+{
+  NOT_ON_PWM = -1,
+  PWM0_CH1 = TCC0_CH1,
+  PWM0_CH6 = TCC0_CH6,
+  PWM0_CH7 = TCC0_CH7,
+  PWM1_CH0 = TCC1_CH0,
+  PWM2_CH0 = TCC2_CH0,
+  PWM3_CH1 = TC3_CH1,
+  PWM4_CH0 = TC4_CH0,
+  PWM4_CH1 = TC4_CH1,
+  PWM5_CH0 = TC5_CH0,
+  PWM5_CH1 = TC5_CH1
+} EPWMChannel;
+
+typedef enum _EExt_Interrupts
+{
+  EXTERNAL_INT_0 = 0,
+  EXTERNAL_INT_1,
+  EXTERNAL_INT_2,
+  EXTERNAL_INT_3,
+  EXTERNAL_INT_4,
+  EXTERNAL_INT_5,
+  EXTERNAL_INT_6,
+  EXTERNAL_INT_7,
+  EXTERNAL_INT_8,
+  EXTERNAL_INT_9,
+  EXTERNAL_INT_10,
+  EXTERNAL_INT_11,
+  EXTERNAL_INT_12,
+  EXTERNAL_INT_13,
+  EXTERNAL_INT_14,
+  EXTERNAL_INT_15,
+  EXTERNAL_INT_NMI,
+  EXTERNAL_NUM_INTERRUPTS,
+  NOT_AN_INTERRUPT = -1,
+  EXTERNAL_INT_NONE = NOT_AN_INTERRUPT
+} EExt_Interrupts;
+
+typedef struct _PinDescription
+{
+  EPortType       ulPort;
+  uint32_t        ulPin;
+  EPioType        ulPinType;
+  uint32_t        ulPinAttribute;
+  EAnalogChannel  ulADCChannelNumber;
+  EPWMChannel     ulPWMChannel;
+  ETCChannel      ulTCChannel;
+  EExt_Interrupts ulExtInt;
+} PinDescription;
+
+// variant_pins.h rows, defined in sim_hal.cpp
+extern const PinDescription g_APinDescription[];
+
+#endif // _TTFSIM_WVARIANT_H_
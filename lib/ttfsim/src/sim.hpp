@@ -0,0 +1,112 @@
+#ifndef _SIM_H_
+#define _SIM_H_
+//===================================================================
+// sim.hpp
+// Simulated TTF fixture behind the native hal.hpp (see sim_hal.cpp,
+// sim_card.cpp, sim_i2c.cpp and sim_run.cpp).
+//
+// Time is virtual: it moves when the firmware waits (hal_Delay(), I2C
+// transfers, scan shifts), by SIM_READ_USECS on every clock read so
+// busy loops end, and when a test calls sim_Advance().  Fixture
+// events (PWR_GOOD edges etc) happen at their exact time; pins with
+// an ISR from hal_PinAttach() run it then, or at hal_IrqOn() if
+// interrupts are off.  sim_SetRealtime() makes the clock follow the
+// host clock instead, for the interactive program.
+//
+// The NIC card model: PRSNTB[3:0] low while inserted, NIC_PWR_GOOD
+// high a set latency after MAIN_EN and AUX_EN are both asserted and
+// low a set time after either is removed, TEMP_CRIT, a scan chain of
+// 0..SIM_SCAN_MAX_BITS bits that reads 0s until PWR_GOOD and the card
+// data after it, and the FRU EEPROM.  The INA219s at 0x40 (12V) and
+// 0x41 (3.3V_AUX) see the card's rail currents.
+//
+// USB serial: usbtx.cpp runs on a CDC IN endpoint model whose host
+// reads each transfer as soon as interrupts allow while the port is
+// open; sim_SetDtr(false) stops it reading, so transfers time out.
+//===================================================================
+#include <stdint.h>
+
+#define SIM_READ_USECS            1       // clock read cost
+#define SIM_SCAN_MAX_BITS         512
+#define SIM_FRU_SIZE              8192    // 24C64
+#define SIM_FREE_RAM              20000   // hal_FreeRam()
+
+// default card, see sim_Reset()
+#define SIM_PWRGOOD_USECS         1500    // AUX_EN and MAIN_EN -> NIC_PWR_GOOD
+#define SIM_PWRGOOD_FALL_USECS    400     // enable removed -> NIC_PWR_GOOD low
+#define SIM_SCAN_VALID_USECS      5000    // NIC_PWR_GOOD -> scan chain data
+#define SIM_12V_MA                1800
+#define SIM_3V3_MA                350
+
+// called when MAIN_EN is asserted, 'n' counts from 1; a test sets up
+// the card for that power up, e.g. sim_CardSetPwrGood()
+typedef void (*sim_powerup_t)(uint32_t n);
+
+// fixture
+void sim_Reset(void);
+void sim_Advance(uint32_t usecs);
+uint64_t sim_Now(void);
+void sim_SetRealtime(bool on);
+
+// pins, Arduino numbering
+uint8_t sim_PinLevel(uint8_t pinNo);
+void sim_PinSet(uint8_t pinNo, uint8_t level);
+uint32_t sim_PinWrites(uint8_t pinNo);
+
+// NIC card
+void sim_CardInsert(uint8_t prsnt);
+void sim_CardRemove(void);
+bool sim_CardIsPresent(void);
+void sim_CardSetPwrGood(bool asserts, uint32_t latencyUsecs);
+void sim_CardDropPwrGood(uint32_t afterUsecs);
+void sim_CardSetTempCrit(bool on);
+void sim_CardOnPowerUp(sim_powerup_t fn);
+void sim_CardSetRailMa(uint8_t i2cAddr, int32_t ma);
+
+// scan chain; 0 bits is an open chain that reads all 1s
+void sim_ScanSetChain(uint16_t bits, const uint8_t *data);
+uint32_t sim_ScanLoads(void);
+
+// I2C devices
+void sim_Ina219Set(uint8_t i2cAddr, int32_t ma, uint32_t busMv);
+void sim_Ina219Unset(uint8_t i2cAddr);
+uint16_t sim_Ina219Reg(uint8_t i2cAddr, uint8_t reg);
+uint32_t sim_Ina219Conversions(uint8_t i2cAddr);
+void sim_I2cSetPresent(uint8_t i2cAddr, bool present);
+uint8_t *sim_FruImage(void);
+uint32_t sim_I2cTransfers(void);
+
+// USB serial
+void sim_Input(const char *text);
+const char *sim_Output(void);
+uint32_t sim_OutputLength(void);
+uint32_t sim_OutputBytes(void);
+void sim_OutputClear(void);
+void sim_SetDtr(bool on);
+
+// FLASH simulated EEPROM
+uint32_t sim_NvmCommits(void);
+
+// running the firmware, see sim_run.cpp
+#define SIM_PROMPT                "\n\rttf> "
+#define SIM_LOOP_USECS            100     // sim_Command() step
+
+void sim_Setup(void);
+void sim_Run(uint32_t usecs, uint32_t stepUsecs);
+const char *sim_Command(const char *line, uint32_t timeoutUsecs);
+
+// sim_card.cpp and sim_i2c.cpp use these; a test uses sim_At() to act
+// while a command that waits has loop() busy
+void sim_At(uint64_t usecs, void (*fn)(uint32_t arg), uint32_t arg);
+void sim_CancelAt(void (*fn)(uint32_t arg));
+void sim_Drive(uint8_t pinNo, uint8_t level);
+void sim_CardPinWrite(uint8_t pinNo, uint8_t level);
+void sim_CardReset(void);
+bool sim_CardPwrGood(void);
+int32_t sim_CardRailMa(uint8_t i2cAddr);
+void sim_ScanShift(const uint8_t *tx, uint8_t *rx, uint32_t bits);
+bool sim_I2cDevWrite(uint8_t i2cAddr, const uint8_t *data, uint16_t len);
+uint16_t sim_I2cDevRead(uint8_t i2cAddr, uint8_t *data, uint16_t len);
+void sim_I2cReset(void);
+
+#endif // _SIM_H_
@@ -0,0 +1,321 @@
+//===================================================================
+// sim_card.cpp
+//
+// NIC 3.0 card and baseboard model of the simulated fixture, see
+// sim.hpp.  Reacts to the enables written by the firmware and drives
+// PRSNTB[3:0], NIC_PWR_GOOD and TEMP_CRIT; sim_ScanShift() is the scan
+// chain behind SCAN_LD_N, SCAN_CLK and the two data pins.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "meter.hpp"
+#include "sim.hpp"
+
+// baseboard pull-ups on the active low inputs the card does not drive
+static const uint8_t        simIdleHighPins[] = {
+    ATX_PWR_OK, P1_LINKA_N, P3_LINKA_N, P1_LED_ACT_N, P3_LED_ACT_N, OCP_WAKE_N, OCP_PWRBRK_N
+};
+
+// PRSNTB0_N first
+static const uint8_t        simPrsntPins[4] = {OCP_PRSNTB0_N, OCP_PRSNTB1_N, OCP_PRSNTB2_N, OCP_PRSNTB3_N};
+
+// idle card: FAN_ON_AUX, TEMP_CRIT_N, TEMP_WARN_N, WAKE_N high and
+// PRSNTB[3:0] low in byte 0, port 0 link up in byte 1
+static const uint8_t        simDefaultChain[4] = {0xF0, 0xFE, 0xFF, 0xFF};
+
+static bool                 simPresent;
+static uint8_t              simPrsnt;               // PRSNTB[3:0] levels while inserted
+static bool                 simPwrGoodAsserts;
+static uint32_t             simPwrGoodUsecs;
+static uint32_t             simPwrGoodFallUsecs;
+static uint32_t             simPwrGoodDropUsecs;    // 0 = stays up
+static bool                 simPwrGood;
+static bool                 simScanValid;
+static uint32_t             simPowerUps;
+static sim_powerup_t        simOnPowerUp;
+static int32_t              simRailMa[2];
+
+static uint16_t             simChainBits;
+static uint8_t              simChainData[SIM_SCAN_MAX_BITS / 8];
+static uint8_t              simChain[SIM_SCAN_MAX_BITS];        // one bit per entry, [0] comes out first
+static uint32_t             simScanLoads;
+
+static void sim_PwrGoodEvent(uint32_t level);
+
+/**
+  * @name   sim_ScanValidEvent
+  * @brief  scan chain parallel inputs become valid after NIC_PWR_GOOD
+  */
+static void sim_ScanValidEvent(uint32_t arg)
+{
+    simScanValid = true;
+}
+
+/**
+  * @name   sim_PwrGoodEvent
+  * @brief  NIC_PWR_GOOD changes
+  * @param  level   new level
+  * @retval None
+  */
+static void sim_PwrGoodEvent(uint32_t level)
+{
+    simPwrGood = (level != 0);
+    sim_Drive(NIC_PWR_GOOD_JMP, simPwrGood);
+    sim_CancelAt(sim_ScanValidEvent);
+
+    if ( simPwrGood )
+    {
+        sim_At(sim_Now() + SIM_SCAN_VALID_USECS, sim_ScanValidEvent, 0);
+
+        if ( simPwrGoodDropUsecs )
+            sim_At(sim_Now() + simPwrGoodDropUsecs, sim_PwrGoodEvent, 0);
+    }
+    else
+    {
+        simScanValid = false;
+    }
+}
+
+/**
+  * @name   sim_CardPower
+  * @brief  start or stop NIC_PWR_GOOD after an enable or presence change
+  */
+static void sim_CardPower(void)
+{
+    bool            on = simPresent && sim_PinLevel(OCP_MAIN_PWR_EN) && sim_PinLevel(OCP_AUX_PWR_EN);
+
+    sim_CancelAt(sim_PwrGoodEvent);
+
+    if ( on && simPwrGood == false && simPwrGoodAsserts )
+        sim_At(sim_Now() + simPwrGoodUsecs, sim_PwrGoodEvent, 1);
+    else if ( on == false && simPwrGood )
+        sim_At(sim_Now() + ((simPresent) ? simPwrGoodFallUsecs : 0), sim_PwrGoodEvent, 0);
+}
+
+/**
+  * @name   sim_CardReset
+  * @brief  baseboard idle levels and the default card, inserted
+  */
+void sim_CardReset(void)
+{
+    for ( unsigned i = 0; i < sizeof(simIdleHighPins); i++ )
+        sim_Drive(simIdleHighPins[i], 1);
+
+    sim_Drive(NIC_PWR_GOOD_JMP, 0);
+    sim_Drive(TEMP_CRIT, 0);
+    sim_Drive(TEMP_WARN, 0);
+    sim_Drive(OCP_SCAN_DATA_IN, 0);
+
+    simPwrGoodAsserts = true;
+    simPwrGoodUsecs = SIM_PWRGOOD_USECS;
+    simPwrGoodFallUsecs = SIM_PWRGOOD_FALL_USECS;
+    simPwrGoodDropUsecs = 0;
+    simPwrGood = false;
+    simScanValid = false;
+    simPowerUps = 0;
+    simOnPowerUp = NULL;
+    simRailMa[0] = SIM_12V_MA;
+    simRailMa[1] = SIM_3V3_MA;
+    simScanLoads = 0;
+
+    sim_ScanSetChain(sizeof(simDefaultChain) * 8, simDefaultChain);
+    sim_CardInsert(0x0);
+}
+
+/**
+  * @name   sim_CardInsert
+  * @brief  insert the card
+  * @param  prsnt   PRSNTB[3:0] levels, not 0xF
+  * @retval None
+  */
+void sim_CardInsert(uint8_t prsnt)
+{
+    simPresent = true;
+    simPrsnt = prsnt & 0xF;
+
+    for ( int i = 0; i < 4; i++ )
+        sim_Drive(simPrsntPins[i], (simPrsnt >> i) & 1);
+
+    sim_CardPower();
+}
+
+/**
+  * @name   sim_CardRemove
+  * @brief  pull the card out, powered or not
+  * @note   NIC_PWR_GOOD goes low at once
+  */
+void sim_CardRemove(void)
+{
+    simPresent = false;
+
+    for ( int i = 0; i < 4; i++ )
+        sim_Drive(simPrsntPins[i], 1);
+
+    sim_Drive(TEMP_CRIT, 0);
+    sim_CardPower();
+    sim_Advance(0);
+}
+
+bool sim_CardIsPresent(void)
+{
+    return(simPresent);
+}
+
+bool sim_CardPwrGood(void)
+{
+    return(simPwrGood);
+}
+
+/**
+  * @name   sim_CardSetPwrGood
+  * @brief  set how the card answers the next power up
+  * @param  asserts       false = NIC_PWR_GOOD never comes up
+  * @param  latencyUsecs  both enables -> NIC_PWR_GOOD
+  * @retval None
+  */
+void sim_CardSetPwrGood(bool asserts, uint32_t latencyUsecs)
+{
+    simPwrGoodAsserts = asserts;
+    simPwrGoodUsecs = latencyUsecs;
+    simPwrGoodDropUsecs = 0;
+}
+
+/**
+  * @name   sim_CardDropPwrGood
+  * @brief  make NIC_PWR_GOOD fall this long after it next rises
+  * @param  afterUsecs  0 = stays up
+  */
+void sim_CardDropPwrGood(uint32_t afterUsecs)
+{
+    simPwrGoodDropUsecs = afterUsecs;
+}
+
+void sim_CardSetTempCrit(bool on)
+{
+    sim_Drive(TEMP_CRIT, on && simPresent);
+}
+
+void sim_CardOnPowerUp(sim_powerup_t fn)
+{
+    simOnPowerUp = fn;
+}
+
+/**
+  * @name   sim_CardSetRailMa
+  * @brief  set the current the card draws from a rail while enabled
+  * @param  i2cAddr   INA219 of the rail
+  * @param  ma
+  */
+void sim_CardSetRailMa(uint8_t i2cAddr, int32_t ma)
+{
+    simRailMa[(i2cAddr == METER_12V_I2C_ADDR) ? 0 : 1] = ma;
+}
+
+/**
+  * @name   sim_CardRailMa
+  * @brief  current the card draws now from a rail
+  * @param  i2cAddr   INA219 of the rail
+  * @retval mA
+  */
+int32_t sim_CardRailMa(uint8_t i2cAddr)
+{
+    if ( simPresent == false )
+        return(0);
+
+    if ( i2cAddr == METER_12V_I2C_ADDR )
+        return(sim_PinLevel(OCP_MAIN_PWR_EN) ? simRailMa[0] : 0);
+
+    return(sim_PinLevel(OCP_AUX_PWR_EN) ? simRailMa[1] : 0);
+}
+
+/**
+  * @name   sim_CardPinWrite
+  * @brief  firmware changed an output
+  * @param  pinNo   Arduino pin number
+  * @param  level   new level
+  * @retval None
+  */
+void sim_CardPinWrite(uint8_t pinNo, uint8_t level)
+{
+    switch ( pinNo )
+    {
+        case OCP_MAIN_PWR_EN:
+            if ( level && simOnPowerUp )
+                simOnPowerUp(++simPowerUps);
+            else if ( level )
+                simPowerUps++;
+            sim_CardPower();
+            break;
+
+        case OCP_AUX_PWR_EN:
+            sim_CardPower();
+            break;
+
+        default:
+            break;
+    }
+}
+
+//===================================================================
+//                           SCAN CHAIN
+//===================================================================
+
+/**
+  * @name   sim_ScanSetChain
+  * @brief  set the card's scan chain
+  * @param  bits    length, 0 = open chain
+  * @param  data    parallel inputs, first bit out is MSB of data[0]
+  * @retval None
+  */
+void sim_ScanSetChain(uint16_t bits, const uint8_t *data)
+{
+    if ( bits > SIM_SCAN_MAX_BITS )
+        bits = SIM_SCAN_MAX_BITS;
+
+    simChainBits = bits;
+    memset(simChainData, 0, sizeof(simChainData));
+
+    if ( data )
+        memcpy(simChainData, data, (bits + 7) / 8);
+}
+
+uint32_t sim_ScanLoads(void)
+{
+    return(simScanLoads);
+}
+
+/**
+  * @name   sim_ScanShift
+  * @brief  SCAN_LD_N pulse, then clock the chain
+  * @param  tx      bits into SCAN_DATA_OUT, MSB of tx[0] first
+  * @param  rx      bits out of SCAN_DATA_IN, MSB of rx[0] first
+  * @param  bits    number of clocks
+  * @retval None
+  * @note   the chain loads 0s until the card data is valid; no card or
+  *         an open chain reads the SCAN_DATA_IN pull-up
+  */
+void sim_ScanShift(const uint8_t *tx, uint8_t *rx, uint32_t bits)
+{
+    uint16_t        n = simChainBits;
+
+    simScanLoads++;
+    memset(rx, 0, (bits + 7) / 8);
+
+    if ( simPresent == false || n == 0 )
+    {
+        memset(rx, 0xFF, (bits + 7) / 8);
+        return;
+    }
+
+    for ( uint16_t i = 0; i < n; i++ )
+        simChain[i] = simScanValid ? (simChainData[i >> 3] >> (7 - (i & 7))) & 1 : 0;
+
+    for ( uint32_t k = 0; k < bits; k++ )
+    {
+        if ( simChain[0] )
+            rx[k >> 3] |= 0x80 >> (k & 7);
+
+        memmove(&simChain[0], &simChain[1], n - 1);
+        simChain[n - 1] = (tx[k >> 3] >> (7 - (k & 7))) & 1;
+    }
+}
@@ -0,0 +1,857 @@
+//===================================================================
+// sim_hal.cpp
+//
+// Native implementation of hal.hpp, the usbtx.hpp CDC IN endpoint,
+// mem.hpp and the scan chain drivers on the simulated fixture, see
+// sim.hpp.  Pins read the
+// level an output was last written, or what the fixture drives, or the
+// pull; PORT IN registers are built from the PORT group/bit of the
+// board's g_APinDescription[], compiled here from variant_pins.h, so
+// verifyPinTables() checks TTF_PINS against variant.cpp natively too.
+//===================================================================
+#include <Arduino.h>
+#include <WVariant.h>
+#include <time.h>
+#include <string>
+#include <deque>
+#include "hal.hpp"
+#include "usbtx.hpp"
+#include "mem.hpp"
+#include "cli.hpp"
+#include "scan.hpp"
+#include "sim.hpp"
+
+#define SIM_EVENTS                32
+#define SIM_I2C_SETUP_BITS        2       // start and stop
+#define SIM_TC5_BIT_USECS         8       // TC5 bit-bang, two ISRs per bit
+#define SIM_PIN_UNDRIVEN          0xFF
+#define SIM_CDC_EP                3       // CDC_ENDPOINT_IN, trace records
+
+// the board's g_APinDescription[], the rows variant.cpp compiles
+const PinDescription            g_APinDescription[] = {
+#include "variant_pins.h"
+};
+
+static_assert(sizeof(g_APinDescription) / sizeof(g_APinDescription[0]) == PINS_COUNT,
+              "variant_pins.h must have PINS_COUNT rows");
+static_assert(HAL_EXTINT_NONE == EXTERNAL_INT_NONE, "HAL_EXTINT_NONE must match variant.cpp");
+
+typedef struct {
+  uint64_t        usecs;
+  void            (*fn)(uint32_t arg);
+  uint32_t        arg;
+} sim_event_t;
+
+// time
+static uint64_t             simUsecs;
+static bool                 simRealtime;
+static uint64_t             simHostBase;
+static sim_event_t          simEvents[SIM_EVENTS];      // sorted by time
+static int                  simEventCount;
+
+// pins and interrupts
+static uint8_t              simPinMode[PINS_COUNT];
+static uint8_t              simPinOut[PINS_COUNT];
+static uint8_t              simPinDriven[PINS_COUNT];
+static uint32_t             simPinWriteCount[PINS_COUNT];
+static hal_isr_t            simPinIsr[PINS_COUNT];
+static uint64_t             simIsrPending;
+static bool                 simIrqEnabled;
+static bool                 simInIsr;
+
+// I2C
+static uint32_t             simI2cHz;
+static uint32_t             simI2cTransfers;
+
+// USB serial
+static std::deque<uint8_t>  simRxQueue;
+static std::string          simTx;
+static uint32_t             simTxBytes;
+static bool                 simDtr;
+
+// CDC IN endpoint: an armed transfer goes to the host from the USB
+// ISR while the port is open
+static const uint8_t        *simEpData;
+static uint16_t             simEpLen;
+static bool                 simEpArmed;
+static bool                 simEpComplete;
+static bool                 simUsbIsrPending;
+
+// FLASH simulated EEPROM
+static uint8_t              simNvm[HAL_NVM_SIZE];
+static uint32_t             simNvmCommits;
+
+// last capture, see scan.cpp
+extern volatile uint32_t    scanShiftRegister[SCAN_MAX_WORDS];
+
+static void sim_RunIsrs(void);
+
+//===================================================================
+//                         FIXTURE CONTROL
+//===================================================================
+
+/**
+  * @name   sim_HostUsecs
+  * @brief  host monotonic clock
+  */
+static uint64_t sim_HostUsecs(void)
+{
+    struct timespec     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+/**
+  * @name   sim_RunTo
+  * @brief  run fixture events up to a time, then move the clock there
+  * @param  usecs   new time, not before the current one
+  * @retval None
+  */
+static void sim_RunTo(uint64_t usecs)
+{
+    sim_event_t     evt;
+
+    while ( simEventCount && simEvents[0].usecs <= usecs )
+    {
+        evt = simEvents[0];
+        memmove(&simEvents[0], &simEvents[1], --simEventCount * sizeof(sim_event_t));
+
+        if ( evt.usecs > simUsecs )
+            simUsecs = evt.usecs;
+
+        evt.fn(evt.arg);
+    }
+
+    if ( usecs > simUsecs )
+        simUsecs = usecs;
+}
+
+/**
+  * @name   sim_Tick
+  * @brief  clock read: the cost of the read, or the host clock
+  */
+static void sim_Tick(void)
+{
+    uint64_t        host;
+
+    if ( simRealtime )
+    {
+        host = sim_HostUsecs() - simHostBase;
+        sim_RunTo((host > simUsecs) ? host : simUsecs);
+    }
+    else
+    {
+        sim_RunTo(simUsecs + SIM_READ_USECS);
+    }
+}
+
+/**
+  * @name   sim_Wait
+  * @brief  let time pass while the firmware waits
+  * @param  usecs
+  * @retval None
+  */
+static void sim_Wait(uint32_t usecs)
+{
+    struct timespec     ts;
+
+    if ( simRealtime )
+    {
+        ts.tv_sec = usecs / 1000000;
+        ts.tv_nsec = (usecs % 1000000) * 1000;
+        nanosleep(&ts, NULL);
+        sim_Tick();
+    }
+    else
+    {
+        sim_RunTo(simUsecs + usecs);
+    }
+}
+
+/**
+  * @name   sim_Reset
+  * @brief  power on the fixture: time 0, pins, card, I2C, serial, NVM
+  * @param  None
+  * @retval None
+  * @note   firmware statics are not reset; each test program starts
+  *         with one setup()
+  */
+void sim_Reset(void)
+{
+    simUsecs = 0;
+    simRealtime = false;
+    simEventCount = 0;
+
+    memset(simPinMode, INPUT, sizeof(simPinMode));
+    memset(simPinOut, 0, sizeof(simPinOut));
+    memset(simPinDriven, SIM_PIN_UNDRIVEN, sizeof(simPinDriven));
+    memset(simPinWriteCount, 0, sizeof(simPinWriteCount));
+    memset(simPinIsr, 0, sizeof(simPinIsr));
+    simIsrPending = 0;
+    simIrqEnabled = true;
+    simInIsr = false;
+
+    simI2cHz = 100000;
+    simI2cTransfers = 0;
+
+    simRxQueue.clear();
+    simTx.clear();
+    simTxBytes = 0;
+    simDtr = true;
+
+    // the host enumerates the port
+    simEpArmed = false;
+    simEpComplete = false;
+    simUsbIsrPending = false;
+    simIrqEnabled = false;
+    usbtx_Reset(SIM_CDC_EP);
+    simIrqEnabled = true;
+
+    // erased FLASH
+    memset(simNvm, 0xFF, sizeof(simNvm));
+    simNvmCommits = 0;
+
+    sim_CardReset();
+    sim_I2cReset();
+}
+
+// fixture state before any test code or setup() runs
+static struct sim_init_s {
+    sim_init_s() { sim_Reset(); }
+} simInit;
+
+/**
+  * @name   sim_Advance
+  * @brief  let time pass outside the firmware, e.g. between polls
+  * @param  usecs
+  * @retval None
+  */
+void sim_Advance(uint32_t usecs)
+{
+    sim_RunTo(simUsecs + usecs);
+}
+
+/**
+  * @name   sim_Now
+  * @brief  get fixture time without the cost of a clock read
+  */
+uint64_t sim_Now(void)
+{
+    return(simUsecs);
+}
+
+/**
+  * @name   sim_SetRealtime
+  * @brief  follow the host clock instead of virtual time
+  * @param  on
+  * @retval None
+  */
+void sim_SetRealtime(bool on)
+{
+    simRealtime = on;
+    simHostBase = sim_HostUsecs() - simUsecs;
+}
+
+/**
+  * @name   sim_At
+  * @brief  schedule a fixture event
+  * @param  usecs   fixture time it happens
+  * @param  fn      called then with 'arg'
+  * @param  arg
+  * @retval None
+  */
+void sim_At(uint64_t usecs, void (*fn)(uint32_t arg), uint32_t arg)
+{
+    int             i = simEventCount;
+
+    if ( simEventCount == SIM_EVENTS )
+    {
+        fprintf(stderr, "ttfsim: event queue full\n");
+        abort();
+    }
+
+    // events at the same time keep their order
+    while ( i > 0 && simEvents[i - 1].usecs > usecs )
+    {
+        simEvents[i] = simEvents[i - 1];
+        i--;
+    }
+
+    simEvents[i].usecs = usecs;
+    simEvents[i].fn = fn;
+    simEvents[i].arg = arg;
+    simEventCount++;
+}
+
+/**
+  * @name   sim_CancelAt
+  * @brief  remove all scheduled events of a function
+  */
+void sim_CancelAt(void (*fn)(uint32_t arg))
+{
+    int             j = 0;
+
+    for ( int i = 0; i < simEventCount; i++ )
+    {
+        if ( simEvents[i].fn != fn )
+            simEvents[j++] = simEvents[i];
+    }
+
+    simEventCount = j;
+}
+
+//===================================================================
+//                              PINS
+//===================================================================
+
+/**
+  * @name   sim_PinLevel
+  * @brief  level on a pin: output latch, fixture drive or pull
+  */
+uint8_t sim_PinLevel(uint8_t pinNo)
+{
+    if ( simPinMode[pinNo] == OUTPUT )
+        return(simPinOut[pinNo]);
+
+    if ( simPinDriven[pinNo] != SIM_PIN_UNDRIVEN )
+        return(simPinDriven[pinNo]);
+
+    return((simPinMode[pinNo] == INPUT_PULLUP) ? 1 : 0);
+}
+
+/**
+  * @name   sim_Drive
+  * @brief  fixture drives an input, running its ISR on a change
+  * @param  pinNo   Arduino pin number
+  * @param  level   0 or 1
+  * @retval None
+  */
+void sim_Drive(uint8_t pinNo, uint8_t level)
+{
+    uint8_t         was = sim_PinLevel(pinNo);
+
+    simPinDriven[pinNo] = level ? 1 : 0;
+
+    if ( simPinIsr[pinNo] && sim_PinLevel(pinNo) != was )
+    {
+        simIsrPending |= (1ULL << pinNo);
+        sim_RunIsrs();
+    }
+}
+
+/**
+  * @name   sim_PinSet
+  * @brief  test drives an input, see sim_Drive()
+  */
+void sim_PinSet(uint8_t pinNo, uint8_t level)
+{
+    sim_Drive(pinNo, level);
+}
+
+/**
+  * @name   sim_PinWrites
+  * @brief  number of hal_PinWrite() calls on a pin
+  */
+uint32_t sim_PinWrites(uint8_t pinNo)
+{
+    return(simPinWriteCount[pinNo]);
+}
+
+/**
+  * @name   sim_UsbIsr
+  * @brief  the host reads an armed CDC IN transfer if the port is open,
+  *         then the transfer complete interrupt as in USBCore.cpp
+  */
+static void sim_UsbIsr(void)
+{
+    if ( simEpArmed && simDtr )
+    {
+        simTx.append((const char *) simEpData, simEpLen);
+        simTxBytes += simEpLen;
+        simEpArmed = false;
+        simEpComplete = true;
+    }
+
+    if ( usbtx_EpTransferComplete() )
+        usbtx_Done();
+}
+
+/**
+  * @name   sim_RunIsrs
+  * @brief  run pending pin and USB ISRs if interrupts are on
+  */
+static void sim_RunIsrs(void)
+{
+    while ( (simIsrPending || simUsbIsrPending) && simIrqEnabled && simInIsr == false )
+    {
+        for ( int i = 0; i < PINS_COUNT; i++ )
+        {
+            if ( (simIsrPending & (1ULL << i)) == 0 )
+                continue;
+
+            simIsrPending &= ~(1ULL << i);
+            simInIsr = true;
+            simPinIsr[i]();
+            simInIsr = false;
+        }
+
+        if ( simUsbIsrPending )
+        {
+            simUsbIsrPending = false;
+            simInIsr = true;
+            sim_UsbIsr();
+            simInIsr = false;
+        }
+    }
+}
+
+void hal_PinMode(uint8_t pinNo, uint8_t mode)
+{
+    simPinMode[pinNo] = mode;
+}
+
+void hal_PinWrite(uint8_t pinNo, uint8_t level)
+{
+    level = level ? 1 : 0;
+    simPinWriteCount[pinNo]++;
+
+    if ( simPinOut[pinNo] == level )
+        return;
+
+    simPinOut[pinNo] = level;
+    sim_CardPinWrite(pinNo, level);
+}
+
+uint8_t hal_PinRead(uint8_t pinNo)
+{
+    return(sim_PinLevel(pinNo));
+}
+
+uint32_t hal_PortIn(uint8_t group)
+{
+    uint32_t        in = 0;
+
+    for ( int i = 0; i < PINS_COUNT; i++ )
+    {
+        if ( g_APinDescription[i].ulPort == group && sim_PinLevel(i) )
+            in |= (1UL << g_APinDescription[i].ulPin);
+    }
+
+    return(in);
+}
+
+void hal_PinHighDrive(uint8_t pinNo)
+{
+}
+
+void hal_PinPort(uint8_t pinNo, uint8_t *group, uint8_t *bit)
+{
+    *group = g_APinDescription[pinNo].ulPort;
+    *bit = g_APinDescription[pinNo].ulPin;
+}
+
+int hal_PinExtInt(uint8_t pinNo)
+{
+    return(g_APinDescription[pinNo].ulExtInt);
+}
+
+void hal_PinAttach(uint8_t pinNo, hal_isr_t isr)
+{
+    simPinIsr[pinNo] = isr;
+}
+
+//===================================================================
+//                              TIME
+//===================================================================
+
+uint32_t hal_Millis(void)
+{
+    sim_Tick();
+    return((uint32_t) (simUsecs / 1000));
+}
+
+uint32_t hal_Micros(void)
+{
+    sim_Tick();
+    return((uint32_t) simUsecs);
+}
+
+uint64_t hal_Cycles(void)
+{
+    return(simUsecs * (F_CPU / 1000000));
+}
+
+void hal_Delay(uint32_t msecs)
+{
+    sim_Wait(msecs * 1000);
+}
+
+void hal_DelayUsecs(uint32_t usecs)
+{
+    sim_Wait(usecs);
+}
+
+//===================================================================
+//                        INTERRUPT MASKING
+//===================================================================
+
+void hal_IrqOff(void)
+{
+    simIrqEnabled = false;
+}
+
+void hal_IrqOn(void)
+{
+    simIrqEnabled = true;
+    sim_RunIsrs();
+}
+
+uint32_t hal_IrqSave(void)
+{
+    uint32_t        state = simIrqEnabled ? 0 : 1;
+
+    simIrqEnabled = false;
+    return(state);
+}
+
+void hal_IrqRestore(uint32_t state)
+{
+    if ( state == 0 )
+        hal_IrqOn();
+}
+
+void hal_Barrier(void)
+{
+}
+
+//===================================================================
+//                               I2C
+//===================================================================
+
+/**
+  * @name   sim_I2cTime
+  * @brief  bus time of a transfer, 9 clocks per byte plus start/stop
+  */
+static void sim_I2cTime(uint16_t bytes)
+{
+    sim_Wait((uint32_t) (((uint64_t) bytes * 9 + SIM_I2C_SETUP_BITS) * 1000000 / simI2cHz));
+}
+
+void hal_I2cBegin(void)
+{
+    simI2cHz = 100000;
+}
+
+void hal_I2cSetClock(uint32_t hz)
+{
+    simI2cHz = hz;
+}
+
+bool hal_I2cWrite(uint8_t i2cAddr, const uint8_t *data, uint16_t len)
+{
+    bool            ack = sim_I2cDevWrite(i2cAddr, data, len);
+
+    simI2cTransfers++;
+    sim_I2cTime(ack ? len + 1 : 1);
+    return(ack);
+}
+
+uint16_t hal_I2cRead(uint8_t i2cAddr, uint8_t *data, uint16_t len)
+{
+    uint16_t        count = sim_I2cDevRead(i2cAddr, data, len);
+
+    simI2cTransfers++;
+    sim_I2cTime(count + 1);
+    return(count);
+}
+
+/**
+  * @name   sim_I2cTransfers
+  * @brief  number of hal_I2cWrite() and hal_I2cRead() calls
+  */
+uint32_t sim_I2cTransfers(void)
+{
+    return(simI2cTransfers);
+}
+
+//===================================================================
+//                           USB SERIAL
+//===================================================================
+
+void hal_SerialBegin(void)
+{
+}
+
+bool hal_SerialConnected(void)
+{
+    return(true);
+}
+
+bool hal_SerialDtr(void)
+{
+    return(simDtr);
+}
+
+int hal_SerialAvailable(void)
+{
+    return((int) simRxQueue.size());
+}
+
+int hal_SerialRead(void)
+{
+    int             byteIn;
+
+    if ( simRxQueue.empty() )
+        return(-1);
+
+    byteIn = simRxQueue.front();
+    simRxQueue.pop_front();
+    return(byteIn);
+}
+
+uint32_t hal_SerialWrite(const uint8_t *data, uint32_t len)
+{
+    uint32_t        sent;
+
+    if ( simDtr == false )
+        return(0);
+
+    // SerialUSB.write(), send() for CDC IN
+    sent = usbtx_Send(data, len);
+    return((sent == (uint32_t) -1) ? 0 : sent);
+}
+
+/**
+  * @name   sim_Input
+  * @brief  queue characters as if typed on the terminal
+  */
+void sim_Input(const char *text)
+{
+    while ( *text )
+        simRxQueue.push_back((uint8_t) *text++);
+}
+
+/**
+  * @name   sim_Output
+  * @brief  everything sent to the host since sim_OutputClear()
+  */
+const char *sim_Output(void)
+{
+    return(simTx.c_str());
+}
+
+/**
+  * @name   sim_OutputLength
+  * @brief  bytes in sim_Output(), which holds 0x00s of 'stream bin'
+  */
+uint32_t sim_OutputLength(void)
+{
+    return((uint32_t) simTx.size());
+}
+
+/**
+  * @name   sim_OutputBytes
+  * @brief  bytes sent to the host since sim_Reset()
+  */
+uint32_t sim_OutputBytes(void)
+{
+    return(simTxBytes);
+}
+
+void sim_OutputClear(void)
+{
+    simTx.clear();
+}
+
+/**
+  * @name   sim_SetDtr
+  * @brief  open (on) or close the host's port
+  * @note   a closed port stops the host reading CDC IN; a transfer
+  *         armed meanwhile goes when it opens again
+  */
+void sim_SetDtr(bool on)
+{
+    simDtr = on;
+
+    if ( on && simEpArmed )
+    {
+        simUsbIsrPending = true;
+        sim_RunIsrs();
+    }
+}
+
+// usbtx.hpp CDC IN endpoint under usbtx.cpp
+
+bool usbtx_EpConfigured(void)
+{
+    return(true);
+}
+
+void usbtx_EpArm(const uint8_t *data, uint16_t len)
+{
+    simEpData = data;
+    simEpLen = len;
+    simEpArmed = true;
+    simEpComplete = false;
+    simUsbIsrPending = true;
+    sim_RunIsrs();
+}
+
+bool usbtx_EpTransferComplete(void)
+{
+    return(simEpComplete);
+}
+
+void usbtx_EpAckComplete(void)
+{
+    simEpComplete = false;
+}
+
+//===================================================================
+//                      FLASH SIMULATED EEPROM
+//===================================================================
+
+uint8_t hal_NvmRead(uint16_t addr)
+{
+    return(simNvm[addr]);
+}
+
+void hal_NvmWrite(uint16_t addr, uint8_t value)
+{
+    simNvm[addr] = value;
+}
+
+void hal_NvmCommit(void)
+{
+    simNvmCommits++;
+}
+
+/**
+  * @name   sim_NvmCommits
+  * @brief  number of FLASH row writes, hal_NvmCommit() calls
+  */
+uint32_t sim_NvmCommits(void)
+{
+    return(simNvmCommits);
+}
+
+//===================================================================
+//                             SYSTEM
+//===================================================================
+
+uint8_t hal_ResetCause(void)
+{
+    return(0x01);                           // PM_RCAUSE_POR
+}
+
+uint32_t hal_FreeRam(void)
+{
+    return(SIM_FREE_RAM);
+}
+
+void hal_Reset(void)
+{
+    fflush(stdout);
+    exit(0);
+}
+
+//===================================================================
+//                         SCAN CHAIN DRIVERS
+//===================================================================
+
+void hal_ScanInit(void)
+{
+}
+
+/**
+  * @name   hal_ScanShift
+  * @brief  the chain shifted at SCAN_SPI_CLOCK_HZ, a timing model of
+  *         src/hal_scan.cpp, not hal_scan.cpp run on modelled registers
+  * @retval the whole shift as DMAC idle time, 0 polled
+  * @note   hal_scan.cpp stays out of [env:native]: it hands the DMAC
+  *         descriptor and buffer addresses as (uint32_t) register
+  *         values, which lose the upper half of a host pointer, and
+  *         waits on SERCOM0/DMAC bitfields read in place, which a
+  *         model could only see by replacing the CMSIS register types
+  *         with hand-kept proxies.  'scan bench' capture time and CPU
+  *         occupancy here are this model's; on the board they are the
+  *         measurement.
+  */
+uint32_t hal_ScanShift(const uint8_t *tx, uint8_t *rx, uint16_t len, bool useDMA)
+{
+    uint32_t        shiftUsecs = (uint32_t) len * 8 * 1000000 / SCAN_SPI_CLOCK_HZ;
+
+    sim_Wait(SCAN_LD_PULSE_USECS);
+    sim_ScanShift(tx, rx, len * 8);
+    sim_Wait(shiftUsecs);
+
+    return(useDMA ? shiftUsecs : 0);
+}
+
+void timers_Init(void)
+{
+}
+
+void timers_scanChainCapture(uint16_t bits)
+{
+    uint8_t         tx[SCAN_MAX_BYTES] = {0};
+    uint8_t         rx[SCAN_MAX_BYTES];
+
+    if ( bits > SCAN_MAX_BITS )
+        bits = SCAN_MAX_BITS;
+
+    sim_Wait(SCAN_LD_PULSE_USECS);
+    sim_ScanShift(tx, rx, bits);
+    sim_Wait(bits * SIM_TC5_BIT_USECS);
+
+    // 1st bit in is bit 31 of word 0, bits past 'bits' stay 0
+    memset((void *) scanShiftRegister, 0, SCAN_MAX_BYTES);
+
+    for ( uint16_t i = 0; i < bits; i++ )
+    {
+        if ( rx[i >> 3] & (0x80 >> (i & 7)) )
+            scanShiftRegister[i >> 5] |= 1UL << (31 - (i & 31));
+    }
+}
+
+//===================================================================
+//                      SRAM USE, see mem.hpp
+//===================================================================
+
+void mem_PaintStack(void)
+{
+}
+
+void mem_GetUsage(mem_usage_t *usage)
+{
+    memset(usage, 0, sizeof(mem_usage_t));
+}
+
+void mem_Check(void)
+{
+}
+
+uint32_t mem_GetOverflows(void)
+{
+    return(0);
+}
+
+void mem_Show(void)
+{
+    terminalOut((char *) "SRAM use is not measured on the host");
+}
+
+//===================================================================
+//                        ARDUINO RUNTIME
+//===================================================================
+
+long random(long howBig)
+{
+    return((howBig > 0) ? rand() % howBig : 0);
+}
+
+long random(long howSmall, long howBig)
+{
+    return((howSmall < howBig) ? howSmall + random(howBig - howSmall) : howSmall);
+}
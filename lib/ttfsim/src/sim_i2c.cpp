@@ -0,0 +1,498 @@
+//===================================================================
+// sim_i2c.cpp
+//
+// I2C devices of the simulated fixture, see sim.hpp.
+//
+// INA219 (U2 at 0x40 on 12V, U3 at 0x41 on 3.3V_AUX): register map,
+// pointer register, reset, PGA clamp of the signed shunt register, bus
+// register with CNVR/OVF, CURRENT and POWER from CALIBRATION per the
+// datasheet, and conversions that complete every SADC + BADC time
+// after a CONFIG write.  CNVR is cleared by reading POWER or writing
+// CONFIG.
+//
+// FRU EEPROM: a 24C64 with 2-byte addressing at 0x50 (slot 0) while
+// the card is inserted, holding an IPMI FRU image with a board area.
+//===================================================================
+#include <Arduino.h>
+#include "meter.hpp"
+#include "sim.hpp"
+
+#define INA219_POR_CONFIG         0x399F
+#define INA219_CNVR               0x0002
+#define INA219_OVF                0x0001
+#define INA219_MODE_SHUNT         0x0001
+#define INA219_MODE_BUS           0x0002
+#define INA219_MODE_CONTINUOUS    0x0004
+
+#define SIM_FRU_I2C_ADDR          0x50
+#define SIM_FRU_PAGE              32
+
+typedef struct {
+  uint8_t         i2cAddr;
+  uint16_t        shuntMohms;
+  uint32_t        railMv;                 // supply the card is on
+  bool            present;
+  uint8_t         pointer;
+  uint16_t        config;
+  uint16_t        cal;
+  uint64_t        convStart;              // sim_Now() of the CONFIG write
+  uint32_t        convRead;               // conversions done when CNVR was cleared
+  bool            fixed;                  // sim_Ina219Set() values, not the card's
+  int32_t         fixedMa;
+  uint32_t        fixedMv;
+} sim_ina219_t;
+
+static sim_ina219_t         simIna219[METER_RAIL_COUNT];
+
+static bool                 simFruPresent;
+static uint16_t             simFruAddr;
+static uint8_t              simFru[SIM_FRU_SIZE];
+
+//===================================================================
+//                             INA219
+//===================================================================
+
+/**
+  * @name   sim_Ina219Find
+  * @brief  INA219 model at an address
+  * @retval NULL if none
+  */
+static sim_ina219_t *sim_Ina219Find(uint8_t i2cAddr)
+{
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+    {
+        if ( simIna219[i].i2cAddr == i2cAddr )
+            return(&simIna219[i]);
+    }
+
+    return(NULL);
+}
+
+/**
+  * @name   sim_Ina219AdcUsecs
+  * @brief  conversion time of a BADC/SADC setting
+  * @param  adc     4-bit field
+  * @retval usecs
+  */
+static uint32_t sim_Ina219AdcUsecs(uint16_t adc)
+{
+    static const uint32_t   bits[4] = {84, 148, 276, 532};
+    static const uint32_t   averaged[8] = {532, 1060, 2130, 4260, 8510, 17020, 34050, 68100};
+
+    return((adc & 0x8) ? averaged[adc & 0x7] : bits[adc & 0x3]);
+}
+
+/**
+  * @name   sim_Ina219Period
+  * @brief  time for one shunt plus bus conversion in the CONFIG mode
+  * @retval usecs, 0 if the ADC is off
+  */
+static uint32_t sim_Ina219Period(const sim_ina219_t *d)
+{
+    uint32_t        usecs = 0;
+
+    if ( d->config & INA219_MODE_SHUNT )
+        usecs += sim_Ina219AdcUsecs((d->config >> 3) & 0xF);
+
+    if ( d->config & INA219_MODE_BUS )
+        usecs += sim_Ina219AdcUsecs((d->config >> 7) & 0xF);
+
+    return(usecs);
+}
+
+/**
+  * @name   sim_Ina219Done
+  * @brief  conversions completed since the CONFIG write
+  * @note   triggered modes convert once
+  */
+static uint32_t sim_Ina219Done(const sim_ina219_t *d)
+{
+    uint32_t        period = sim_Ina219Period(d);
+    uint64_t        elapsed = sim_Now() - d->convStart;
+
+    if ( period == 0 )
+        return(0);
+
+    if ( (d->config & INA219_MODE_CONTINUOUS) == 0 )
+        return((elapsed >= period) ? 1 : 0);
+
+    return((uint32_t) (elapsed / period));
+}
+
+/**
+  * @name   sim_Ina219Shunt
+  * @brief  shunt register: 10 uV LSB, clamped to the PGA range
+  */
+static int16_t sim_Ina219Shunt(const sim_ina219_t *d)
+{
+    int32_t         ma = d->fixed ? d->fixedMa : sim_CardRailMa(d->i2cAddr);
+    int32_t         limit = 4000 << ((d->config >> 11) & 0x3);
+    int32_t         uv = ma * d->shuntMohms;
+    int32_t         raw = (uv >= 0) ? (uv + 5) / 10 : (uv - 5) / 10;
+
+    if ( sim_Ina219Done(d) == 0 )
+        return(0);
+
+    if ( raw > limit )
+        raw = limit;
+    else if ( raw < -limit )
+        raw = -limit;
+
+    return((int16_t) raw);
+}
+
+/**
+  * @name   sim_Ina219BusMv
+  * @brief  bus voltage in 4 mV steps, clamped to the BRNG range
+  */
+static uint32_t sim_Ina219BusMv(const sim_ina219_t *d)
+{
+    uint32_t        mv = d->fixed ? d->fixedMv : d->railMv;
+    uint32_t        limit = (d->config & 0x2000) ? 32000 : 16000;
+
+    if ( sim_Ina219Done(d) == 0 )
+        return(0);
+
+    return(((mv > limit) ? limit : mv) / 4 * 4);
+}
+
+/**
+  * @name   sim_Ina219Current
+  * @brief  CURRENT register, shunt * CALIBRATION / 4096
+  * @param  d
+  * @param  ovf     set if it does not fit in 16 bits
+  * @retval register value
+  */
+static int16_t sim_Ina219Current(const sim_ina219_t *d, bool *ovf)
+{
+    int32_t         current = ((int32_t) sim_Ina219Shunt(d) * d->cal) / 4096;
+
+    *ovf = (current > 32767 || current < -32768);
+
+    if ( current > 32767 )
+        current = 32767;
+    else if ( current < -32768 )
+        current = -32768;
+
+    return((int16_t) current);
+}
+
+/**
+  * @name   sim_Ina219Reg
+  * @brief  value a register read returns now, no side effects
+  */
+uint16_t sim_Ina219Reg(uint8_t i2cAddr, uint8_t reg)
+{
+    sim_ina219_t    *d = sim_Ina219Find(i2cAddr);
+    bool            ovf;
+    int32_t         current;
+    uint32_t        power;
+
+    if ( d == NULL )
+        return(0);
+
+    current = sim_Ina219Current(d, &ovf);
+
+    switch ( reg )
+    {
+        case INA219_REG_CONFIG:
+            return(d->config);
+
+        case INA219_REG_SHUNT:
+            return((uint16_t) sim_Ina219Shunt(d));
+
+        case INA219_REG_BUS:
+            power = (uint32_t) abs(current) * (sim_Ina219BusMv(d) / 4) / 5000;
+            return((uint16_t) (((sim_Ina219BusMv(d) / 4) << 3) |
+                               ((sim_Ina219Done(d) > d->convRead) ? INA219_CNVR : 0) |
+                               ((ovf || power > 0xFFFF) ? INA219_OVF : 0)));
+
+        case INA219_REG_POWER:
+            power = (uint32_t) abs(current) * (sim_Ina219BusMv(d) / 4) / 5000;
+            return((uint16_t) ((power > 0xFFFF) ? 0xFFFF : power));
+
+        case INA219_REG_CURRENT:
+            return((uint16_t) (int16_t) current);
+
+        case INA219_REG_CALIBRATION:
+            return(d->cal);
+
+        default:
+            return(0);
+    }
+}
+
+/**
+  * @name   sim_Ina219Conversions
+  * @brief  conversions completed since the last CONFIG write
+  */
+uint32_t sim_Ina219Conversions(uint8_t i2cAddr)
+{
+    sim_ina219_t    *d = sim_Ina219Find(i2cAddr);
+
+    return((d) ? sim_Ina219Done(d) : 0);
+}
+
+/**
+  * @name   sim_Ina219Set
+  * @brief  measure these values instead of the card's rail
+  * @param  i2cAddr
+  * @param  ma      current through the shunt, may be negative
+  * @param  busMv   bus voltage
+  * @retval None
+  */
+void sim_Ina219Set(uint8_t i2cAddr, int32_t ma, uint32_t busMv)
+{
+    sim_ina219_t    *d = sim_Ina219Find(i2cAddr);
+
+    if ( d == NULL )
+        return;
+
+    d->fixed = true;
+    d->fixedMa = ma;
+    d->fixedMv = busMv;
+}
+
+void sim_Ina219Unset(uint8_t i2cAddr)
+{
+    sim_ina219_t    *d = sim_Ina219Find(i2cAddr);
+
+    if ( d )
+        d->fixed = false;
+}
+
+/**
+  * @name   sim_Ina219Write
+  * @brief  pointer byte, then optionally a register MSB first
+  */
+static void sim_Ina219Write(sim_ina219_t *d, const uint8_t *data, uint16_t len)
+{
+    uint16_t        value;
+
+    if ( len == 0 )
+        return;
+
+    d->pointer = data[0] & 0x7;
+
+    if ( len < 3 )
+        return;
+
+    value = (data[1] << 8) | data[2];
+
+    if ( d->pointer == INA219_REG_CONFIG )
+    {
+        if ( value & INA219_CONFIG_RESET )
+        {
+            d->config = INA219_POR_CONFIG;
+            d->cal = 0;
+        }
+        else
+        {
+            d->config = value;
+        }
+
+        d->convStart = sim_Now();
+        d->convRead = 0;
+    }
+    else if ( d->pointer == INA219_REG_CALIBRATION )
+    {
+        // bit 0 is not used
+        d->cal = value & 0xFFFE;
+    }
+}
+
+//===================================================================
+//                            FRU EEPROM
+//===================================================================
+
+/**
+  * @name   sim_FruField
+  * @brief  add an 8-bit ASCII type/length field
+  * @retval offset after it
+  */
+static uint16_t sim_FruField(uint16_t offset, const char *text)
+{
+    uint8_t         len = strlen(text);
+
+    simFru[offset++] = 0xC0 | len;
+    memcpy(&simFru[offset], text, len);
+    return(offset + len);
+}
+
+/**
+  * @name   sim_FruChecksum
+  * @brief  zero checksum in the last byte of an area
+  */
+static void sim_FruChecksum(uint16_t offset, uint16_t len)
+{
+    uint8_t         sum = 0;
+
+    for ( uint16_t i = 0; i < len - 1; i++ )
+        sum += simFru[offset + i];
+
+    simFru[offset + len - 1] = (uint8_t) -sum;
+}
+
+/**
+  * @name   sim_FruDefault
+  * @brief  common header and board area, the rest erased
+  */
+static void sim_FruDefault(void)
+{
+    uint16_t        offset;
+    uint16_t        len;
+
+    memset(simFru, 0xFF, sizeof(simFru));
+
+    // common header: format 1, board area at 8
+    memset(simFru, 0, 8);
+    simFru[0] = 0x01;
+    simFru[3] = 1;
+    sim_FruChecksum(0, 8);
+
+    // board area: format, length, language, mfg time (mins since 1996)
+    simFru[8] = 0x01;
+    simFru[10] = 0x00;
+    simFru[11] = 0x60;
+    simFru[12] = 0x5B;
+    simFru[13] = 0x0E;
+    offset = sim_FruField(14, "Dell");
+    offset = sim_FruField(offset, "NIC 3.0 SIM");
+    offset = sim_FruField(offset, "SIM0001");
+    offset = sim_FruField(offset, "TTF-SIM-01");
+    offset = sim_FruField(offset, "ttfsim");
+    simFru[offset++] = 0xC1;
+
+    len = (offset - 8 + 1 + 7) & ~7;
+    memset(&simFru[offset], 0, len - (offset - 8));
+    simFru[9] = len / 8;
+    sim_FruChecksum(8, len);
+}
+
+uint8_t *sim_FruImage(void)
+{
+    return(simFru);
+}
+
+//===================================================================
+//                              BUS
+//===================================================================
+
+/**
+  * @name   sim_I2cReset
+  * @brief  power on state of all devices
+  */
+void sim_I2cReset(void)
+{
+    static const uint8_t    addrs[METER_RAIL_COUNT] = {METER_12V_I2C_ADDR, METER_3V3_I2C_ADDR};
+    static const uint16_t   mohms[METER_RAIL_COUNT] = {METER_12V_SHUNT_MOHMS, METER_3V3_SHUNT_MOHMS};
+    static const uint32_t   railMv[METER_RAIL_COUNT] = {12000, 3300};
+
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+    {
+        memset(&simIna219[i], 0, sizeof(sim_ina219_t));
+        simIna219[i].i2cAddr = addrs[i];
+        simIna219[i].shuntMohms = mohms[i];
+        simIna219[i].railMv = railMv[i];
+        simIna219[i].present = true;
+        simIna219[i].config = INA219_POR_CONFIG;
+    }
+
+    simFruPresent = true;
+    simFruAddr = 0;
+    sim_FruDefault();
+}
+
+/**
+  * @name   sim_I2cSetPresent
+  * @brief  fit or remove a device; the FRU EEPROM also needs the card
+  */
+void sim_I2cSetPresent(uint8_t i2cAddr, bool present)
+{
+    sim_ina219_t    *d = sim_Ina219Find(i2cAddr);
+
+    if ( d )
+        d->present = present;
+    else if ( i2cAddr == SIM_FRU_I2C_ADDR )
+        simFruPresent = present;
+}
+
+/**
+  * @name   sim_FruAcks
+  * @brief  FRU EEPROM answers at this address
+  */
+static bool sim_FruAcks(uint8_t i2cAddr)
+{
+    return(i2cAddr == SIM_FRU_I2C_ADDR && simFruPresent && sim_CardIsPresent());
+}
+
+/**
+  * @name   sim_I2cDevWrite
+  * @brief  master write transaction
+  * @retval true if a device ACKed
+  */
+bool sim_I2cDevWrite(uint8_t i2cAddr, const uint8_t *data, uint16_t len)
+{
+    sim_ina219_t    *d = sim_Ina219Find(i2cAddr);
+
+    if ( d && d->present )
+    {
+        sim_Ina219Write(d, data, len);
+        return(true);
+    }
+
+    if ( sim_FruAcks(i2cAddr) )
+    {
+        if ( len >= 2 )
+            simFruAddr = ((data[0] << 8) | data[1]) & (SIM_FRU_SIZE - 1);
+
+        // data wraps within the page
+        for ( uint16_t i = 2; i < len; i++ )
+        {
+            simFru[simFruAddr] = data[i];
+            simFruAddr = (simFruAddr & ~(SIM_FRU_PAGE - 1)) | ((simFruAddr + 1) & (SIM_FRU_PAGE - 1));
+        }
+
+        return(true);
+    }
+
+    return(false);
+}
+
+/**
+  * @name   sim_I2cDevRead
+  * @brief  master read transaction
+  * @retval bytes read, 0 if no device ACKed
+  */
+uint16_t sim_I2cDevRead(uint8_t i2cAddr, uint8_t *data, uint16_t len)
+{
+    sim_ina219_t    *d = sim_Ina219Find(i2cAddr);
+    uint16_t        value;
+
+    if ( d && d->present )
+    {
+        value = sim_Ina219Reg(i2cAddr, d->pointer);
+
+        if ( d->pointer == INA219_REG_POWER )
+            d->convRead = sim_Ina219Done(d);
+
+        // register repeats MSB, LSB
+        for ( uint16_t i = 0; i < len; i++ )
+            data[i] = (i & 1) ? (value & 0xFF) : (value >> 8);
+
+        return(len);
+    }
+
+    if ( sim_FruAcks(i2cAddr) )
+    {
+        for ( uint16_t i = 0; i < len; i++ )
+        {
+            data[i] = simFru[simFruAddr];
+            simFruAddr = (simFruAddr + 1) & (SIM_FRU_SIZE - 1);
+        }
+
+        return(len);
+    }
+
+    return(0);
+}
@@ -0,0 +1,148 @@
+//===================================================================
+// sim_main.cpp
+//
+// Host program of the native build: runs setup() and loop() against
+// the simulated fixture in real time with stdin/stdout as the USB
+// serial port, so the CLI can be used from a terminal or driven over
+// a pty (see test/pty_bench.py).  Ctrl-] quits.
+//
+// Unit tests supply their own main(), so this one is left out of
+// them.
+//===================================================================
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "hal.hpp"
+#include "sim.hpp"
+
+#define SIM_QUIT_CHAR             0x1D    // Ctrl-]
+#define SIM_EOF_QUIET_USECS       3000000 // no output this long after stdin closes
+#define SIM_IDLE_USECS            200
+
+static struct termios       simTermSaved;
+static bool                 simTermRaw;
+
+/**
+  * @name   sim_TermRestore
+  * @brief  put the terminal back at exit
+  */
+static void sim_TermRestore(void)
+{
+    if ( simTermRaw )
+        tcsetattr(STDIN_FILENO, TCSANOW, &simTermSaved);
+}
+
+/**
+  * @name   sim_TermRaw
+  * @brief  character at a time input with no echo, the CLI echoes
+  */
+static void sim_TermRaw(void)
+{
+    struct termios      t;
+
+    if ( isatty(STDIN_FILENO) == 0 || tcgetattr(STDIN_FILENO, &simTermSaved) != 0 )
+        return;
+
+    t = simTermSaved;
+    cfmakeraw(&t);
+    simTermRaw = (tcsetattr(STDIN_FILENO, TCSANOW, &t) == 0);
+    atexit(sim_TermRestore);
+}
+
+/**
+  * @name   sim_Flush
+  * @brief  copy what the firmware sent to stdout
+  */
+static void sim_Flush(void)
+{
+    const char      *out = sim_Output();
+    size_t          len = sim_OutputLength();
+    ssize_t         n;
+
+    while ( len )
+    {
+        n = write(STDOUT_FILENO, out, len);
+
+        if ( n <= 0 )
+            break;
+
+        out += n;
+        len -= n;
+    }
+
+    sim_OutputClear();
+}
+
+/**
+  * @name   sim_ReadInput
+  * @brief  pass waiting stdin characters to the serial port
+  * @retval false when stdin is closed or Ctrl-] was typed
+  */
+static bool sim_ReadInput(void)
+{
+    struct pollfd   pfd = {STDIN_FILENO, POLLIN, 0};
+    char            bfr[64];
+    char            text[2] = {0, 0};
+    ssize_t         n;
+
+    if ( poll(&pfd, 1, 0) <= 0 )
+        return(true);
+
+    n = read(STDIN_FILENO, bfr, sizeof(bfr));
+
+    if ( n <= 0 )
+        return(false);
+
+    for ( ssize_t i = 0; i < n; i++ )
+    {
+        if ( bfr[i] == SIM_QUIT_CHAR )
+            return(false);
+
+        text[0] = bfr[i];
+        sim_Input(text);
+    }
+
+    return(true);
+}
+
+int main(int argc, char *argv[])
+{
+    bool            eof = false;
+    uint64_t        lastOut = 0;
+
+    fprintf(stderr, "ttfsim: simulated TTF fixture, Ctrl-] quits\r\n");
+    sim_TermRaw();
+    sim_SetRealtime(true);
+    setup();
+
+    while ( 1 )
+    {
+        if ( eof == false && sim_ReadInput() == false )
+        {
+            if ( simTermRaw )
+                break;
+
+            // piped input: let the last commands finish
+            eof = true;
+        }
+
+        if ( eof && hal_SerialAvailable() == 0 && sim_Now() - lastOut > SIM_EOF_QUIET_USECS )
+            break;
+
+        loop();
+
+        if ( sim_Output()[0] )
+            lastOut = sim_Now();
+
+        sim_Flush();
+        usleep(SIM_IDLE_USECS);
+    }
+
+    sim_Flush();
+    return(0);
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,93 @@
+//===================================================================
+// sim_run.cpp
+//
+// Runs the firmware on the simulated fixture for the host tests:
+// setup() once, loop() passes with time stepped between them, and
+// CLI commands typed in with the output up to the next prompt.
+//===================================================================
+#include <Arduino.h>
+#include "sim.hpp"
+
+/**
+  * @name   sim_Setup
+  * @brief  run setup() and loop() until the first prompt
+  * @param  None
+  * @retval None
+  * @note   firmware statics are only initialized once, so a test
+  *         program calls this once, before its first test
+  */
+void sim_Setup(void)
+{
+    static bool     done = false;
+
+    if ( done )
+        return;
+
+    done = true;
+    setup();
+    (void) sim_Command("", 1000000);
+}
+
+/**
+  * @name   sim_Run
+  * @brief  run loop() for a while
+  * @param  usecs       fixture time to run for
+  * @param  stepUsecs   time between loop() passes
+  * @retval None
+  * @note   a pass takes little fixture time of its own, so the step
+  *         sets how often the scheduler sees its tasks due
+  */
+void sim_Run(uint32_t usecs, uint32_t stepUsecs)
+{
+    uint64_t        end = sim_Now() + usecs;
+
+    while ( sim_Now() < end )
+    {
+        loop();
+        sim_Advance(stepUsecs);
+    }
+}
+
+/**
+  * @name   sim_Command
+  * @brief  type a command line and run until the prompt comes back
+  * @param  line            command, without the ENTER
+  * @param  timeoutUsecs    give up after this much fixture time
+  * @retval everything sent to the host from the echo to the prompt
+  *         inclusive, valid until the next sim_Command() or
+  *         sim_OutputClear()
+  */
+const char *sim_Command(const char *line, uint32_t timeoutUsecs)
+{
+    uint64_t        end = sim_Now() + timeoutUsecs;
+    const char      *out;
+    size_t          len;
+    size_t          promptLen = strlen(SIM_PROMPT);
+    uint32_t        sent;
+
+    // let output still queued from before go out first
+    do
+    {
+        sent = sim_OutputBytes();
+        loop();
+        sim_Advance(SIM_LOOP_USECS);
+    } while ( sim_OutputBytes() != sent );
+
+    sim_OutputClear();
+    sim_Input(line);
+    sim_Input("\r");
+
+    while ( sim_Now() < end )
+    {
+        loop();
+        sim_Advance(SIM_LOOP_USECS);
+
+        out = sim_Output();
+        len = strlen(out);
+
+        if ( len >= promptLen && strcmp(out + len - promptLen, SIM_PROMPT) == 0 )
+            break;
+    }
+
+    return(sim_Output());
+}
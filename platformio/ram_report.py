@@ -0,0 +1,98 @@
+#
+# PlatformIO extra script for the TTF project
+#
+# Adds a linker map to the build and a 'ramreport' target that lists
+# SRAM use (.data + .bss) per object file from it:
+#
+#   pio run -t ramreport
+#
+# .data also takes the same amount of FLASH for its initial values.
+#
+Import("env")
+
+import os
+import re
+
+MAP_FILE = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")
+SRAM_BYTES = 32 * 1024
+
+env.Append(LINKFLAGS=["-Wl,-Map," + MAP_FILE])
+
+# input section line in the memory map; long section names put the
+# address/size/object on the following line
+SECTION_RE = re.compile(r"^ (\.data\S*|\.bss\S*|COMMON)(?:\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S+))?\s*$")
+WRAPPED_RE = re.compile(r"^\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S+)\s*$")
+
+
+def module_name(obj):
+    # src/cli.cpp.o -> cli.cpp, libFoo.a(bar.o) -> libFoo.a(bar.o)
+    name = os.path.basename(obj)
+    return name[:-2] if name.endswith(".o") else name
+
+
+def parse_map(path):
+    usage = {}
+    pending = None
+    in_map = False
+
+    with open(path) as f:
+        for line in f:
+            # sections discarded by --gc-sections are listed before this
+            if line.startswith("Linker script and memory map"):
+                in_map = True
+                continue
+
+            if not in_map:
+                continue
+
+            if pending:
+                m = WRAPPED_RE.match(line)
+                section, pending = pending, None
+                if m:
+                    addr, size, obj = m.groups()
+                else:
+                    continue
+            else:
+                m = SECTION_RE.match(line)
+                if not m:
+                    continue
+                section, addr, size, obj = m.groups()
+                if addr is None:
+                    pending = section
+                    continue
+
+            size = int(size, 16)
+            if size == 0 or int(addr, 16) == 0:
+                continue
+
+            kind = "bss" if section.startswith(".bss") or section == "COMMON" else "data"
+            entry = usage.setdefault(module_name(obj), {"data": 0, "bss": 0})
+            entry[kind] += size
+
+    return usage
+
+
+def ram_report(source, target, env):
+    if not os.path.isfile(MAP_FILE):
+        print("No linker map at %s; build first" % MAP_FILE)
+        return
+
+    usage = parse_map(MAP_FILE)
+    rows = sorted(usage.items(), key=lambda kv: kv[1]["data"] + kv[1]["bss"], reverse=True)
+    data = sum(u["data"] for u in usage.values())
+    bss = sum(u["bss"] for u in usage.values())
+
+    print("%-40s %8s %8s %8s" % ("Module", ".data", ".bss", "Total"))
+    for name, u in rows:
+        print("%-40s %8d %8d %8d" % (name[:40], u["data"], u["bss"], u["data"] + u["bss"]))
+    print("%-40s %8d %8d %8d" % ("TOTAL", data, bss, data + bss))
+    print("Static SRAM %d of %d bytes, %d left for stack and heap" % (data + bss, SRAM_BYTES,
+                                                                       SRAM_BYTES - data - bss))
+
+
+env.AddCustomTarget(
+    name="ramreport",
+    dependencies="$BUILD_DIR/${PROGNAME}.elf",
+    actions=ram_report,
+    title="RAM Report",
+    description="SRAM use per module from the linker map")
@@ -32,6 +32,13 @@
 #warning Using expected USBCore.cpp with OCP modifications
 // end modification
 
+// OCP: UDD_Handler() time goes to 'xdebug prof'
+#include "prof.hpp"
+// OCP: ISR, send and recv events go to 'xdebug trace'
+#include "trace.hpp"
+// OCP: CDC IN goes through two banks of multi-packet transfers
+#include "usbtx.hpp"
+
 #include "api/PluggableUSB.h"
 
 #include <stdlib.h>
@@ -64,7 +71,10 @@ extern void (*gpf_isr)(void);
 
 // USB_Handler ISR
 extern "C" void UDD_Handler(void) {
+	uint64_t start = prof_Now();
+
 	USBDevice.ISRHandler();
+	prof_Record(PROF_ISR_USB, start);
 }
 
 const uint16_t STRING_LANGUAGE[2] = {
@@ -436,6 +446,12 @@ void USBDeviceClass::initEP(uint32_t ep, uint32_t config)
 		usbd.epBank1SetSize(ep, 64);
 		usbd.epBank1SetAddress(ep, &udd_ep_in_cache_buffer[ep]);
 		usbd.epBank1SetType(ep, 3); // BULK IN
+
+		// OCP: CDC IN refills from the transfer complete interrupt
+		if (ep == CDC_ENDPOINT_IN) {
+			usbtx_Reset(ep);
+			usbd.epBank1EnableTransferComplete(ep);
+		}
 	}
 	else if (config == USB_ENDPOINT_TYPE_CONTROL)
 	{
@@ -456,6 +472,10 @@ void USBDeviceClass::initEP(uint32_t ep, uint32_t config)
 
 void USBDeviceClass::flush(uint32_t ep)
 {
+	// OCP: CDC IN banks are armed as soon as the endpoint is free
+	if (ep == CDC_ENDPOINT_IN)
+		return;
+
 	if (available(ep)) {
 		// RAM buffer is full, we can send data (IN)
 		usbd.epBank1SetReady(ep);
@@ -552,6 +572,9 @@ uint32_t USBDeviceClass::recv(uint32_t ep, void *_data, uint32_t len)
 
 	memcpy(_data, udd_ep_out_cache_buffer[ep], len);
 
+	if (len)
+		trace_Event(TRACE_USB_RECV, ep, len);
+
 	// release empty buffer
 	if (len && !available(ep)) {
 		// The RAM Buffer is empty: we can receive data
@@ -616,6 +639,37 @@ static char LastTransmitTimedOut[7] = {
 	0
 };
 
+// OCP: the CDC IN endpoint under usbtx.cpp's transmit banks
+bool usbtx_EpConfigured(void)
+{
+	return _usbConfiguration != 0;
+}
+
+// one multi-packet transfer of a bank; BYTE_COUNT is the whole
+// transfer, a ZLP follows one that ends on a full packet so the host
+// read completes
+void usbtx_EpArm(const uint8_t *data, uint16_t len)
+{
+	uint32_t ep = CDC_ENDPOINT_IN;
+
+	usbd.epBank1SetAddress(ep, (void *)data);
+	usbd.epBank1SetMultiPacketSize(ep, 0);
+	usbd.epBank1SetByteCount(ep, len);
+	usbd.epBank1EnableAutoZLP(ep);
+	usbd.epBank1AckTransferComplete(ep);
+	usbd.epBank1SetReady(ep);
+}
+
+bool usbtx_EpTransferComplete(void)
+{
+	return usbd.epBank1IsTransferComplete(CDC_ENDPOINT_IN);
+}
+
+void usbtx_EpAckComplete(void)
+{
+	usbd.epBank1AckTransferComplete(CDC_ENDPOINT_IN);
+}
+
 // Blocking Send of data to an endpoint
 uint32_t USBDeviceClass::send(uint32_t ep, const void *data, uint32_t len)
 {
@@ -627,6 +681,8 @@ uint32_t USBDeviceClass::send(uint32_t ep, const void *data, uint32_t len)
 	if (len > 16384)
 		return -1;
 
+	trace_Event(TRACE_USB_SEND, ep, len);
+
 #ifdef PIN_LED_TXL
 	if (txLEDPulse == 0)
 		digitalWrite(PIN_LED_TXL, LOW);
@@ -634,6 +690,10 @@ uint32_t USBDeviceClass::send(uint32_t ep, const void *data, uint32_t len)
 	txLEDPulse = TX_RX_LED_PULSE_MS;
 #endif
 
+	// OCP: CDC IN is queued, see usbtx.cpp
+	if (ep == CDC_ENDPOINT_IN)
+		return usbtx_Send((const uint8_t *)data, len);
+
 	// Flash area
 	while (len != 0)
 	{
@@ -648,6 +708,7 @@ uint32_t USBDeviceClass::send(uint32_t ep, const void *data, uint32_t len)
 			// inspired by Paul Stoffregen's work on Teensy
 			while (!usbd.epBank1IsTransferComplete(ep)) {
 				if (LastTransmitTimedOut[ep] || timeout-- == 0) {
+					trace_Event(LastTransmitTimedOut[ep] ? TRACE_USB_TX_DROP : TRACE_USB_TX_TIMEOUT, ep, len);
 					LastTransmitTimedOut[ep] = 1;
 
 					// set byte count to zero, so that ZLP is sent
@@ -843,6 +904,12 @@ void USBDeviceClass::ISRHandler()
 		return;
 	}
 
+	// every 1 ms SOF on its own would flood the trace
+	uint16_t intflag = USB->DEVICE.INTFLAG.reg;
+	uint16_t epintsmry = USB->DEVICE.EPINTSMRY.reg;
+	if (intflag != USB_DEVICE_INTFLAG_SOF || epintsmry != 0)
+		trace_Event(TRACE_USB_ISR, intflag, epintsmry);
+
 	// End-Of-Reset
 	if (usbd.isEndOfResetInterrupt())
 	{
@@ -927,7 +994,14 @@ void USBDeviceClass::ISRHandler()
 	for (int ep = 1; ep < USB_EPT_NUM; ep++) {
 		// Endpoint Transfer Complete (0/1) Interrupt
 		if (usbd.epHasPendingInterrupts(ep)) {
-			if (epHandlers[ep]) {
+			if (ep == CDC_ENDPOINT_IN) {
+				// OCP: arm the next transmit bank; SerialUSB.handleEndpoint()
+				// would NAK it
+				bool done = usbd.epBank1IsTransferComplete(ep);
+				usbd.epAckPendingInterrupts(ep);
+				if (done)
+					usbtx_Done();
+			} else if (epHandlers[ep]) {
 				epHandlers[ep]->handleEndpoint();
 			} else {
 				#if defined(PLUGGABLE_USB_ENABLED)
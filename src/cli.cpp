@@ -7,6 +7,11 @@
 #include "main.hpp"
 #include "cli.hpp"
 #include "commands.hpp"
+#include "macro.hpp"
+#include "prof.hpp"
+#include "trace.hpp"
+#include "usbtx.hpp"
+#include "hal.hpp"
 
 extern uint8_t  boardIDReal;
 
@@ -15,18 +20,24 @@ const char      cliPrompt[] = "ttf> ";
 const int       promptLen = sizeof(cliPrompt);
 const char      hello[] = "OCP NIC 3.0 Thermal Test Fixture V";
 
-// CLI token stack and formatting buffer
+// CLI token stack and formatting buffer; outBfr[] is shared by all
+// modules, so fill it and output it before calling anything else
+// that might print
 char            *tokens[MAX_TOKENS];
-static char     outBfr[OUTBFR_SIZE];
+char            outBfr[OUTBFR_SIZE];
 
-// CLI Command Table structure
+// line being run by cli() and its tokenized copy, see cli_GetArgText()
+static const char   *cliLine = NULL;
+static const char   *cliInput = NULL;
+
+// CLI Command Table structure; pointers to string literals so the
+// table and its text stay in FLASH instead of being copied to SRAM
 typedef struct {
-    char        cmd[CMD_NAME_MAX];
+    const char  *cmd;
     int         (*func) (int x);
     int         argCount;
-    char        help1[MAX_LINE_SZ];
-    char        help2[MAX_LINE_SZ];
-
+    const char  *help1;
+    const char  *help2;
 } cli_entry;
 
 // command functions
@@ -41,27 +52,284 @@ int eepromCmd(int arg);
 int pwrCmd(int arg);
 int versCmd(int arg);
 int scanCmd(int arg);
+int streamCmd(int arg);
+int macroCmd(int arg);
+int sleepCmd(int arg);
 
 // CLI command table
-// CLI_COMMAND_CNT is defined in cli.hpp
 // format is "command", function, required arg count, "help line 1", "help line 2" 
 // NOTE: -1 as arg count means "don't check number of arguments, cmd function will"
 // NOTE: " " (space) on 2nd line of help doesn't display anything (for short helps)
-// NOTE: These are in alphabetical order for presentation (except help) FYI...
-cli_entry     cmdTable[CLI_COMMAND_CNT] = {
+// NOTE: These MUST be in strcmp() order, cli() does a binary search; help skips 'help'
+static constexpr cli_entry  cmdTable[] = {
     {"eeprom", eepromCmd,  -1, "'eeprom show' displays FRU EEPROM info areas.",  "'eeprom dump <addr> <length>' dumps <length> bytes @ <addr>"},
-    {"pins",      pinCmd,   0, "Displays pin names and numbers.",                "TTF uses Arduino-style pin numbering shown in this display."},
-    {"power",     pwrCmd,  -1, "Control power to NIC 3.0 card.",                 "'power <up|down> <main|aux|card>' or 'power status' "},
+    {"help",        help,   0, "NOTE: THIS DOES NOT DISPLAY ON PURPOSE",         " "},    
+    {"macro",   macroCmd,  -1, "Store and run command macros in FLASH.",         "'macro def <name> <cmds>', 'macro run <name> [count]'; 'macro help'"},
+    {"pins",      pinCmd,  -1, "Displays pin names and numbers.",                "'pins log [clear]' shows input pin edges and counters."},
+    {"power",     pwrCmd,  -1, "Control power to NIC 3.0 card.",                 "'power <up|down> <main|aux|card>' or 'power status|timing|cycle|meter|burst'"},
     {"read",     readCmd,   1, "Read input pin (Arduino numbering).",            "'read <pin_number>'"},
+    {"scan",     scanCmd,  -1, "Scan chain query of NIC 3.0 card.",              "'scan mode|length|watch|log|bench'; 'scan help' for more"},
     {"set",       setCmd,  -1, "Set FLASH parameter to a value.",                "'set <param> <value>' sets value; or 'set' with no args for help."},
-    {"scan",     scanCmd,   0, "Scan chain query of NIC 3.0 card.",              " "},
+    {"sleep",   sleepCmd,   1, "Wait, for use in macros and ';' batches.",       "'sleep <msecs>'; any key ends it early"},
     {"status", statusCmd,   0, "Displays status of I/O pins etc.",               " "},
+    {"stream", streamCmd,  -1, "Stream telemetry records for host automation.",  "'stream bin|json [<msecs>]', 'stream off' or 'stream test [<count>]'"},
     {"vers",     versCmd,   0, "Shows firmware version information.",            " "},
     {"write",   writeCmd,   2, "Write output pin (Arduino numbering).",          "'write <pin_number> <0|1>'"},
     {"xdebug",     debug,  -1, "Debug functions mostly for developer use.",      "Enter 'xdebug' with no arguments for more info."},
-    {"help",        help,   0, "NOTE: THIS DOES NOT DISPLAY ON PURPOSE",         " "},    
 };
 
+#define CLI_COMMAND_CNT           CLI_TABLE_COUNT(cmdTable)
+
+/**
+  * @name   cmdTableSorted
+  * @brief  compile time check of cmdTable[] order from entry 'i' on
+  */
+static constexpr bool cmdTableSorted(int i)
+{
+    return((i + 1 >= CLI_COMMAND_CNT) ? true : (cli_NameLess(cmdTable[i].cmd, cmdTable[i + 1].cmd) && cmdTableSorted(i + 1)));
+}
+
+static_assert(cmdTableSorted(0), "cmdTable[] must be sorted by command name");
+static_assert(CLI_COMMAND_CNT <= PROF_CMD_MAX, "raise PROF_CMD_MAX for the cmdTable[] dispatch sites");
+
+//===================================================================
+//                    TERMINAL OUTPUT
+//
+// All terminal output is queued in txBfr[] and sent by term_Poll()
+// from loop() as usbtx_Write() requests, one contiguous run of the ring
+// at a time, so neither commands nor term_Poll() wait on the host.
+// The run stays in the ring until the request is done.  A full ring is
+// drained in place; if the host stops reading for TERM_TX_STALL_MSEC
+// or closes the port (DTR low) output is discarded rather than
+// hanging the firmware.
+//
+// While a command waits (status screen, 'sleep', 'Hit any key') the
+// background tasks it runs write to holdBfr[] instead, and their
+// messages come out together at the next prompt rather than in the
+// middle of the command's output.
+//===================================================================
+static char             txBfr[TERM_TX_BFR_SIZE];
+static uint16_t         txHead = 0;                 // next byte written
+static uint16_t         txTail = 0;                 // next byte sent
+static term_stats_t     txStats;
+static usbtx_req_t      txReq;                      // run on its way, from txTail
+static char             holdBfr[TERM_HOLD_BFR_SIZE];
+static uint16_t         holdLen = 0;
+static bool             holdOn = false;
+static uint32_t         holdReported = 0;           // holdDropped at the last prompt
+
+#define TX_USED()       ((uint16_t) (txHead - txTail) & (TERM_TX_BFR_SIZE - 1))
+#define TX_FREE()       (TERM_TX_BFR_SIZE - 1 - TX_USED())
+
+/**
+  * @name   term_Release
+  * @brief  free the run of a finished usbtx_Write() request
+  * @param  None
+  * @retval bytes freed
+  */
+static int term_Release(void)
+{
+    int             len = txReq.len;
+
+    if ( len == 0 || txReq.status == USBTX_PENDING )
+        return(0);
+
+    if ( txReq.status == USBTX_DONE )
+        txStats.sent += len;
+    else
+        txStats.dropped += len;
+
+    txTail = (txTail + len) & (TERM_TX_BFR_SIZE - 1);
+    txReq.len = 0;
+    return(len);
+}
+
+/**
+  * @name   term_Discard
+  * @brief  drop all queued output not already on its way
+  * @param  None
+  * @retval None
+  */
+static void term_Discard(void)
+{
+    term_Release();
+    txStats.dropped += TX_USED() - txReq.len;
+    txHead = (txTail + txReq.len) & (TERM_TX_BFR_SIZE - 1);
+}
+
+/**
+  * @name   term_Poll
+  * @brief  free sent output and start sending the next run
+  * @param  None
+  * @retval number of bytes sent since the last call
+  * @note   called from loop() and anywhere output is waited on;
+  *         never waits on the host
+  */
+int term_Poll(void)
+{
+    int             len;
+
+    // time out a request the host is not reading
+    usbtx_Poll();
+    len = term_Release();
+
+    if ( txHead == txTail || txReq.len != 0 )
+        return(len);
+
+    if ( hal_SerialDtr() == false )
+    {
+        term_Discard();
+        return(len);
+    }
+
+    // contiguous run up to the end of txBfr[], the rest goes next time;
+    // a full queue is retried on the next call
+    txReq.data = (const uint8_t *) &txBfr[txTail];
+    txReq.len = (txHead > txTail) ? (txHead - txTail) : (TERM_TX_BFR_SIZE - txTail);
+
+    if ( usbtx_Write(&txReq) == false )
+        txReq.len = 0;
+
+    return(len);
+}
+
+/**
+  * @name   term_Flush
+  * @brief  wait until all queued output has been sent
+  * @param  None
+  * @retval None
+  * @note   waits on USB flow control only; gives up after
+  *         TERM_TX_STALL_MSEC without progress
+  */
+void term_Flush(void)
+{
+    uint32_t        lastSent = hal_Millis();
+
+    while ( txHead != txTail )
+    {
+        if ( term_Poll() > 0 )
+            lastSent = hal_Millis();
+        else if ( hal_Millis() - lastSent >= TERM_TX_STALL_MSEC )
+        {
+            // the run on its way is freed by its usbtx timeout
+            txStats.stalls++;
+            term_Discard();
+            lastSent = hal_Millis();
+        }
+    }
+}
+
+/**
+  * @name   term_Write
+  * @brief  queue bytes for the terminal
+  * @param  data    bytes to send
+  * @param  len     number of bytes
+  * @retval None
+  * @note   drains the ring in place when it is full
+  */
+void term_Write(const char *data, int len)
+{
+    uint32_t        lastSent = hal_Millis();
+    int             chunk;
+
+    if ( holdOn )
+    {
+        chunk = (len > TERM_HOLD_BFR_SIZE - holdLen) ? (TERM_HOLD_BFR_SIZE - holdLen) : len;
+        memcpy(&holdBfr[holdLen], data, chunk);
+        holdLen += chunk;
+        txStats.holdDropped += len - chunk;
+        return;
+    }
+
+    txStats.queued += len;
+
+    while ( len > 0 )
+    {
+        if ( TX_FREE() == 0 )
+        {
+            if ( term_Poll() > 0 )
+                lastSent = hal_Millis();
+            else if ( hal_Millis() - lastSent >= TERM_TX_STALL_MSEC || hal_SerialDtr() == false )
+            {
+                txStats.stalls++;
+                txStats.dropped += len;
+                return;
+            }
+
+            continue;
+        }
+
+        // copy up to the end of txBfr[] or the free space
+        chunk = TERM_TX_BFR_SIZE - txHead;
+
+        if ( chunk > (int) TX_FREE() )
+            chunk = TX_FREE();
+
+        if ( chunk > len )
+            chunk = len;
+
+        memcpy(&txBfr[txHead], data, chunk);
+        txHead = (txHead + chunk) & (TERM_TX_BFR_SIZE - 1);
+        data += chunk;
+        len -= chunk;
+    }
+
+    if ( TX_USED() > txStats.highWater )
+        txStats.highWater = TX_USED();
+}
+
+/**
+  * @name   term_TxFree
+  * @brief  get free space in the output ring
+  * @param  None
+  * @retval bytes that can be queued without waiting
+  */
+int term_TxFree(void)
+{
+    if ( holdOn )
+        return(TERM_HOLD_BFR_SIZE - holdLen);
+
+    return(TX_FREE());
+}
+
+/**
+  * @name   term_Hold
+  * @brief  hold background task output until the next prompt
+  * @param  on    true while a command waits on the background tasks
+  * @retval previous setting, to restore
+  * @note   see backgroundPoll()
+  */
+bool term_Hold(bool on)
+{
+    bool            was = holdOn;
+
+    holdOn = on;
+    return(was);
+}
+
+/**
+  * @name   term_GetStats
+  * @brief  get terminal output counters
+  * @param  None
+  * @retval pointer to counters
+  */
+const term_stats_t *term_GetStats(void)
+{
+    return(&txStats);
+}
+
+/**
+  * @name   term_ClearStats
+  * @brief  zero terminal output counters
+  * @param  None
+  * @retval None
+  */
+void term_ClearStats(void)
+{
+    memset(&txStats, 0, sizeof(txStats));
+    holdReported = 0;
+}
+
 /**
   * @name   CURSOR
   * @brief  set terminal cursor
@@ -75,36 +343,31 @@ void CURSOR(uint8_t r,uint8_t c)
     char          bfr[12];
 
     sprintf(bfr, "\x1b[%d;%df", r, c);
-    SerialUSB.write(bfr);
-    SerialUSB.flush();
-    delay(5);
+    term_Write(bfr, strlen(bfr));
 }
 
 /**
   * @name   terminalOut
-  * @brief  wrapper to SerialUSB.print[ln]
+  * @brief  queue a line of output, see term_Write()
   * @param  msg to output
   * @retval None
-  * @note   needed to address missing chars
   */
 void terminalOut(char *msg)
 {
-    SerialUSB.println(msg);
-    SerialUSB.flush();
-    delay(50);
+    term_Write(msg, strlen(msg));
+    term_Write("\r\n", 2);
+    txStats.lines++;
 }
 
 /**
   * @name   displayLine
-  * @brief  wrapper to SerialUSB.write
+  * @brief  queue output without a line ending
   * @param  None
   * @retval None
   */
 void displayLine(char *m)
 {
-    SerialUSB.write(m);
-    SerialUSB.flush();
-    delay(10);
+    term_Write(m, strlen(m));
 }
 
 /**
@@ -115,11 +378,27 @@ void displayLine(char *m)
   */
 void doPrompt(void)
 {
-    SerialUSB.write(0x0a);
-    SerialUSB.write(0x0d);
-    SerialUSB.flush();
-    SerialUSB.print(cliPrompt);
-    SerialUSB.flush();
+    char            bfr[48];
+
+    // a task's prompt after its message is the command's to give
+    if ( holdOn )
+        return;
+
+    if ( holdLen )
+    {
+        term_Write(holdBfr, holdLen);
+        holdLen = 0;
+    }
+
+    if ( txStats.holdDropped != holdReported )
+    {
+        sprintf(bfr, "(%lu bytes of task output lost)\r\n", (unsigned long) (txStats.holdDropped - holdReported));
+        term_Write(bfr, strlen(bfr));
+        holdReported = txStats.holdDropped;
+    }
+
+    term_Write("\n\r", 2);
+    term_Write(cliPrompt, strlen(cliPrompt));
 }
 
 /**
@@ -139,46 +418,45 @@ void doHello(void)
   * @brief  wait for any keyboard hit 
   * @param  None
   * @retval None
-  * @note   WARNING! Blocking call!
+  * @note   blocks the caller; background tasks keep running
   */
 int waitAnyKey(void)
 {
     int             charIn;
 
-    while ( SerialUSB.available() == 0 )
-      ;
+    while ( hal_SerialAvailable() == 0 )
+        backgroundPoll();
 
-    charIn = SerialUSB.read();
+    charIn = hal_SerialRead();
     return(charIn);
 }
 
 /**
   * @name   cli
   * @brief  command line interpreter
-  * @param  raw = raw input line from terminal
-  * @retval None
+  * @param  raw = one command line, no ';'
+  * @retval true if the command was found and returned 0
+  * @note   the caller shows the prompt, see cli_RunLine()
   */
 bool cli(char *raw)
 {
     bool         rc = false;
-    int         len;
+    int         i;
     char        *token;
     const char  delim[] = " ";
     int         tokNdx = 0;
-    char        input[80];
+    char        input[MAX_LINE_SZ];
     int         error = CLI_ERR_CMD_NOT_FOUND;
     int         argCount;
 
-    strcpy(input, (char *) raw);
-    len = strlen(input);
+    // macro bodies and batches can be longer than a typed line
+    strncpy(input, raw, MAX_LINE_SZ - 1);
+    input[MAX_LINE_SZ - 1] = 0;
 
     // initial call, should get and save the command as 0th token
     token = strtok(input, delim);
     if ( token == NULL )
-    {
-      doPrompt();
-      return(true);
-    }
+        return(true);
 
     tokens[tokNdx++] = token;
 
@@ -193,45 +471,57 @@ bool cli(char *raw)
     if ( tokNdx >= MAX_TOKENS )
     {
         terminalOut((char *) "Too many arguments in command line!");
-        doPrompt();
         return(false);
     }
 
     // adjust arg count to not include the command itself (token[0]
     argCount = tokNdx - 1;
 
-    for ( int i = 0; i < (int) CLI_COMMAND_CNT; i++ )
+    i = cli_Lookup(cmdTable, CLI_COMMAND_CNT, &cli_entry::cmd, tokens[0]);
+
+    if ( i == CLI_LOOKUP_AMBIGUOUS )
     {
-        if ( strncmp(tokens[0], cmdTable[i].cmd, len) == 0 )
+        error = CLI_ERR_AMBIGUOUS;
+    }
+    else if ( i >= 0 )
+    {
+        if ( (cmdTable[i].argCount == argCount) || (cmdTable[i].argCount == -1) )
         {
-            if ( (cmdTable[i].argCount == argCount) || (cmdTable[i].argCount == -1) )
-            {
-                // command funcs are passed arg count, tokens are global
-                (cmdTable[i].func) (argCount);
-                SerialUSB.flush();
-                rc = true;
-                error = CLI_ERR_NO_ERROR;
-                break;
-            }
-            else if ( cmdTable[i].argCount > argCount )
-            {
-                error = CLI_ERR_TOO_FEW_ARGS;
-                rc = false;
-                break;
-            }
-            else
-            {
-                error = CLI_ERR_TOO_MANY_ARGS;
-                rc = false;
-                break;
-            }
+            // command funcs are passed arg count, tokens are global;
+            // save the line for cli_GetArgText(), macros nest cli()
+            const char  *prevLine = cliLine;
+            const char  *prevInput = cliInput;
+            uint64_t    start = prof_Now();
+
+            cliLine = raw;
+            cliInput = input;
+            trace_Event(TRACE_CMD_START, i, argCount);
+            rc = ((cmdTable[i].func) (argCount) == 0);
+            prof_Record((PROF_SITE) (PROF_CMD_FIRST + i), start);
+            trace_Event(TRACE_CMD_END, i, (uint32_t) ((prof_Now() - start) / (F_CPU / 1000)));
+            cliLine = prevLine;
+            cliInput = prevInput;
+            error = CLI_ERR_NO_ERROR;
+        }
+        else if ( cmdTable[i].argCount > argCount )
+        {
+            error = CLI_ERR_TOO_FEW_ARGS;
+            rc = false;
+        }
+        else
+        {
+            error = CLI_ERR_TOO_MANY_ARGS;
+            rc = false;
         }
     }
 
-    if ( rc == false )
+    // a command that failed has said why
+    if ( rc == false && error != CLI_ERR_NO_ERROR )
     {
         if ( error == CLI_ERR_CMD_NOT_FOUND )
          terminalOut((char *) "Invalid command");
+        else if ( error == CLI_ERR_AMBIGUOUS )
+          terminalOut((char *) "Ambiguous command, type more letters");
         else if ( error == CLI_ERR_TOO_FEW_ARGS )
           terminalOut((char *) "Not enough arguments for this command, check help.");
         else if ( error == CLI_ERR_TOO_MANY_ARGS )
@@ -240,11 +530,237 @@ bool cli(char *raw)
           terminalOut((char *) "Unknown parser s/w error");
     }
 
-    doPrompt();
     return(rc);
 
 } // cli()
 
+/**
+  * @name   cli_RunSubCmd
+  * @brief  look up tokens[tokNo] in a subcommand table and run it
+  * @param  table   subcommands sorted by name
+  * @param  count   number of entries
+  * @param  tokNo   token holding the subcommand
+  * @param  argCnt  command's arg count
+  * @retval subcommand's return value or CLI_SUBCMD_ERR
+  * @note   reports errors; the caller may add its own help
+  */
+int cli_RunSubCmd(const cli_subcmd_t *table, int count, int tokNo, int argCnt)
+{
+    int             args = argCnt - tokNo;
+    int             i;
+
+    if ( args < 0 )
+    {
+        terminalOut((char *) "Missing subcommand");
+        return(CLI_SUBCMD_ERR);
+    }
+
+    i = cli_Lookup(table, count, &cli_subcmd_t::name, tokens[tokNo]);
+
+    if ( i == CLI_LOOKUP_AMBIGUOUS )
+        sprintf(outBfr, "Ambiguous subcommand '%s', type more letters", tokens[tokNo]);
+    else if ( i == CLI_LOOKUP_NONE )
+        sprintf(outBfr, "Invalid subcommand '%s'", tokens[tokNo]);
+    else if ( args < table[i].minArgs || args > table[i].maxArgs )
+        sprintf(outBfr, "Incorrect number of arguments for '%s'", table[i].name);
+    else
+        return((table[i].func) (argCnt));
+
+    SHOW();
+    return(CLI_SUBCMD_ERR);
+}
+
+/**
+  * @name   cli_LinearLookup
+  * @brief  reference for cli_SelfTest(): unique prefix by linear scan
+  * @param  word
+  * @retval index, CLI_LOOKUP_NONE or CLI_LOOKUP_AMBIGUOUS
+  */
+static int cli_LinearLookup(const char *word)
+{
+    int             len = strlen(word);
+    int             found = CLI_LOOKUP_NONE;
+
+    for ( int i = 0; len && i < CLI_COMMAND_CNT; i++ )
+    {
+        if ( strcmp(cmdTable[i].cmd, word) == 0 )
+            return(i);
+
+        if ( strncmp(cmdTable[i].cmd, word, len) == 0 )
+            found = (found == CLI_LOOKUP_NONE) ? i : CLI_LOOKUP_AMBIGUOUS;
+    }
+
+    return(found);
+}
+
+/**
+  * @name   cli_SelfTest
+  * @brief  check cli_Lookup() against a linear scan
+  * @param  count   number of random words to try
+  * @retval number of mismatches
+  * @note   every prefix of every command is tried, then random words
+  *         built mostly from command name characters
+  */
+int cli_SelfTest(int count)
+{
+    char            word[CMD_NAME_MAX + 2];
+    int             len;
+    int             tried = 0;
+    int             failed = 0;
+    const char      *cmd;
+
+    for ( int i = 0; i < CLI_COMMAND_CNT; i++ )
+    {
+        cmd = cmdTable[i].cmd;
+
+        for ( len = 0; len <= (int) strlen(cmd) + 1; len++ )
+        {
+            strncpy(word, cmd, len);
+            word[len] = 0;
+
+            // one past the name: append a char that makes it no match
+            if ( len > (int) strlen(cmd) )
+                strcat(word, "~");
+
+            tried++;
+            if ( cli_Lookup(cmdTable, CLI_COMMAND_CNT, &cli_entry::cmd, word) != cli_LinearLookup(word) )
+            {
+                sprintf(outBfr, "Mismatch on '%s'", word);
+                SHOW();
+                failed++;
+            }
+        }
+    }
+
+    for ( int n = 0; n < count; n++ )
+    {
+        len = random(0, CMD_NAME_MAX + 1);
+        cmd = cmdTable[random(CLI_COMMAND_CNT)].cmd;
+
+        for ( int j = 0; j < len; j++ )
+            word[j] = (random(4) == 0) ? (char) random(' ', '~' + 1) : cmd[random(strlen(cmd))];
+
+        word[len] = 0;
+        tried++;
+
+        if ( cli_Lookup(cmdTable, CLI_COMMAND_CNT, &cli_entry::cmd, word) != cli_LinearLookup(word) )
+        {
+            sprintf(outBfr, "Mismatch on '%s'", word);
+            SHOW();
+            failed++;
+        }
+    }
+
+    sprintf(outBfr, "%d words checked, %d mismatches", tried, failed);
+    SHOW();
+    return(failed);
+}
+
+/**
+  * @name   cli_CommandName
+  * @brief  name of a cmdTable[] entry
+  * @param  cmd     0..CLI_COMMAND_CNT-1
+  * @retval name
+  */
+const char *cli_CommandName(int cmd)
+{
+    return(cmdTable[cmd].cmd);
+}
+
+/**
+  * @name   cli_GetArgText
+  * @brief  get the rest of the command line from a token on
+  * @param  tokNo   token index, 1 = first argument
+  * @retval text as typed, including spaces and ';'
+  * @note   only valid inside a command function
+  */
+const char *cli_GetArgText(int tokNo)
+{
+    return(cliLine + (tokens[tokNo] - cliInput));
+}
+
+/**
+  * @name   cli_RunBatch
+  * @brief  run ';' separated commands
+  * @param  line        commands, split in place
+  * @param  stopOnKey   true to stop if a key is hit between commands
+  * @retval false if a command failed or a key stopped the batch
+  */
+bool cli_RunBatch(char *line, bool stopOnKey)
+{
+    char            *cmd = line;
+    char            *end;
+    bool            last = false;
+
+    while ( last == false )
+    {
+        end = strchr(cmd, ';');
+
+        if ( end == NULL )
+            last = true;
+        else
+            *end = 0;
+
+        if ( stopOnKey && hal_SerialAvailable() )
+        {
+            while ( hal_SerialAvailable() )
+                (void) hal_SerialRead();
+
+            return(false);
+        }
+
+        if ( cli(cmd) == false )
+            return(false);
+
+        cmd = end + 1;
+    }
+
+    return(true);
+}
+
+/**
+  * @name   cli_IsMacroDef
+  * @brief  check for a 'macro def' line, abbreviated or not
+  * @param  line    as typed
+  * @retval true if the first two words select 'macro def'
+  */
+static bool cli_IsMacroDef(const char *line)
+{
+    char            input[MAX_LINE_SZ];
+    char            *cmd;
+    char            *sub;
+    int             i;
+
+    strncpy(input, line, MAX_LINE_SZ - 1);
+    input[MAX_LINE_SZ - 1] = 0;
+
+    cmd = strtok(input, " ;");
+    sub = strtok(NULL, " ;");
+
+    if ( cmd == NULL || sub == NULL )
+        return(false);
+
+    i = cli_Lookup(cmdTable, CLI_COMMAND_CNT, &cli_entry::cmd, cmd);
+    return(i >= 0 && cmdTable[i].func == macroCmd && macro_IsDefine(sub));
+}
+
+/**
+  * @name   cli_RunLine
+  * @brief  run a line typed at the prompt, then show the prompt
+  * @param  line    one or more ';' separated commands
+  * @retval None
+  * @note   'macro def' lines are not split, the ';'s are the macro
+  */
+void cli_RunLine(char *line)
+{
+    if ( cli_IsMacroDef(line) )
+        (void) cli(line);
+    else
+        (void) cli_RunBatch(line, false);
+
+    doPrompt();
+}
+
 /**
   * @name   help
   * @brief  CLI help feature
@@ -293,11 +809,11 @@ void showCommandHelp(char *cmd)
 
       if ( strcmp(cmd, cmdTable[i].cmd) == 0 )
       {
-        terminalOut(cmdTable[i].help1);
+        terminalOut((char *) cmdTable[i].help1);
 
         if ( cmdTable[i].help2[0] != ' ' )
         {
-          terminalOut(cmdTable[i].help2);
+          terminalOut((char *) cmdTable[i].help2);
         }          
       }
     }
@@ -10,14 +10,22 @@
 #include "main.hpp"
 #include "eeprom.hpp"
 #include "commands.hpp"
+#include "scan.hpp"
+#include "power.hpp"
+#include "meter.hpp"
+#include "monitor.hpp"
+#include "fmt.hpp"
+#include "hal.hpp"
 #include <math.h>
 
 extern char                 *tokens[];
 extern EEPROM_data_t        EEPROMData;
 extern volatile uint32_t    scanClockPulseCounter;
 extern volatile bool        enableScanClk;
-extern volatile uint32_t    scanShiftRegister_0;
 
+// Single definition of the pins the CLI knows about.  staticPins[], the
+// Arduino pin # -> index table and the PORT masks below are all generated
+// from this list, so they cannot disagree.
 // pin defs used for 1) pin init and 2) copied into volatile status structure
 // to maintain state of inputs pins that get written 3) pin names (nice, right?) ;-)
 // NOTE: Any I/O that is connected to the DIP switches HAS to be an input because those
@@ -26,106 +34,124 @@ extern volatile uint32_t    scanShiftRegister_0;
 // NOTE: The order of the entries in this table is the order they are displayed by the
 // 'pins' command. There is no other signficance to the order.  The first entry in a
 // pair is the left column while the second entry is the right column.
- const pin_mgt_t     staticPins[] = {
-  {               TEMP_WARN, INPUT,     ACT_HI, "TEMP_WARN"},
-  {         OCP_MAIN_PWR_EN, OUTPUT,    ACT_HI, "MAIN_EN"},
+// NOTE: PORT group/bit must match g_APinDescription[] in variant.cpp (variant_pins.h), see
+// verifyPinTables() and test/test_pins
+//             Arduino pin #   PORT bit  function        active  name
+#define TTF_PINS(X) \
+  X(               TEMP_WARN,  A,  0, INPUT,          ACT_HI, "TEMP_WARN")      \
+  X(         OCP_MAIN_PWR_EN,  A, 23, OUTPUT,         ACT_HI, "MAIN_EN")        \
+                                                                                \
+  X(               TEMP_CRIT,  A,  1, INPUT,          ACT_HI, "TEMP_CRIT")      \
+  X(          OCP_AUX_PWR_EN,  A,  9, OUTPUT,         ACT_HI, "AUX_EN")         \
+                                                                                \
+  X(              FAN_ON_AUX,  B,  8, INPUT,          ACT_HI, "FAN_ON_AUX")     \
+  X(              ATX_PWR_OK,  A,  7, INPUT,          ACT_LO, "ATX_PWR_OK")     \
+                                                                                \
+  X(           OCP_PRSNTB0_N,  A, 18, INPUT,          ACT_LO, "PRSNTB0_N")      \
+  X(              SCAN_VER_0,  A, 21, INPUT,          ACT_HI, "SCAN_VER_0")     \
+                                                                                \
+  X(           OCP_PRSNTB1_N,  B, 10, INPUT,          ACT_LO, "PRSNTB1_N")      \
+  X(              SCAN_VER_1,  A, 15, INPUT,          ACT_HI, "SCAN_VER_1")     \
+                                                                                \
+  X(           OCP_PRSNTB2_N,  A, 14, INPUT,          ACT_LO, "PRSNTB2_N")      \
+  X(              P1_LINKA_N,  B, 11, INPUT,          ACT_LO, "P1_LINKA_N")     \
+                                                                                \
+  X(           OCP_PRSNTB3_N,  B,  2, INPUT,          ACT_LO, "PRSNTB3_N")      \
+  X(            P1_LED_ACT_N,  B, 23, INPUT,          ACT_LO, "P1_LED_ACT_N")   \
+                                                                                \
+  X(              OCP_WAKE_N,  B,  3, INPUT,          ACT_LO, "WAKE_N")         \
+  X(            OCP_PWRBRK_N,  B, 22, INPUT,          ACT_LO, "PWRBRK_N")       \
+                                                                                \
+  X(              P3_LINKA_N,  B,  9, INPUT,          ACT_LO, "P3_LINKA_N")     \
+  X(            P3_LED_ACT_N,  A,  6, INPUT,          ACT_LO, "P3_LED_ACT_N")   \
+                                                                                \
+  X(              BOARD_ID_0,  A,  2, INPUT_PULLDOWN, ACT_HI, "BOARD_ID_0")     \
+  X(              NCSI_RST_N,  A, 28, OUTPUT,         ACT_LO, "NCSI_RST_N")     \
+                                                                                \
+  X(              BOARD_ID_1,  A,  5, INPUT_PULLDOWN, ACT_HI, "BOARD_ID_1")     \
+  X(       OCP_HEARTBEAT_LED,  A, 19, OUTPUT,         ACT_LO, "HEARTBEAT_LED")  /* HACK: temporary LED between UART pins 1 & 3 */ \
+                                                                                \
+  X(              BOARD_ID_2,  A,  3, INPUT_PULLDOWN, ACT_HI, "BOARD_ID_2")     \
+  X(        NIC_PWR_GOOD_JMP,  A, 20, INPUT,          ACT_HI, "NIC_PWR_GOOD")   /* HACK: PWR_GOOD_LED to UART connector pin 2 */ \
+                                                                                \
+  X(           OCP_SCAN_LD_N,  A, 22, OUTPUT,         ACT_LO, "SCAN_LD_N")      \
+  X(        OCP_SCAN_DATA_IN,  A, 10, INPUT,          ACT_HI, "SCAN_DATA_IN")   /* "in" from NIC 3.0 card (baseboard perspective) */ \
+                                                                                \
+  X(            OCP_SCAN_CLK,  A, 11, OUTPUT,         ACT_LO, "SCAN_CLK")       \
+  X(       OCP_SCAN_DATA_OUT,  A,  8, OUTPUT,         ACT_HI, "SCAN_DATA_OUT")  /* "out" to NIC 3.0 card */
+
+#define PIN_MGT_ENTRY(pin, grp, bit, func, act, name)     {pin, func, act, name},
+#define PIN_NO_ENTRY(pin, grp, bit, func, act, name)      pin,
+#define PIN_PORT_ENTRY(pin, grp, bit, func, act, name)    {PIN_GROUP_##grp, (1UL << (bit))},
+#define PIN_GROUP_A             0
+#define PIN_GROUP_B             1
+
+const pin_mgt_t         staticPins[] = { TTF_PINS(PIN_MGT_ENTRY) };
 
-  {               TEMP_CRIT, INPUT,     ACT_HI, "TEMP_CRIT"},
-  {          OCP_AUX_PWR_EN, OUTPUT,    ACT_HI, "AUX_EN"},
-
-  {              FAN_ON_AUX, INPUT,     ACT_HI, "FAN_ON_AUX"},
-  {              ATX_PWR_OK, INPUT,     ACT_LO, "ATX_PWR_OK"},
-
-  {           OCP_PRSNTB0_N, INPUT,     ACT_LO, "PRSNTB0_N"},
-  {              SCAN_VER_0, INPUT,     ACT_HI, "SCAN_VER_0"},
-
-  {           OCP_PRSNTB1_N, INPUT,     ACT_LO, "PRSNTB1_N"},
-  {              SCAN_VER_1, INPUT,     ACT_HI, "SCAN_VER_1"},
-
-  {           OCP_PRSNTB2_N, INPUT,     ACT_LO, "PRSNTB2_N"},
-  {              P1_LINKA_N, INPUT,     ACT_LO, "P1_LINKA_N"},
+uint16_t      static_pin_count = sizeof(staticPins) / sizeof(pin_mgt_t);
 
-  {           OCP_PRSNTB3_N, INPUT,     ACT_LO, "PRSNTB3_N"},
-  {            P1_LED_ACT_N, INPUT,     ACT_LO, "P1_LED_ACT_N"},
+// PORT group and bit mask of each staticPins[] entry; lets inputs be
+// decoded from one read of both PORT IN registers
+typedef struct {
+  uint8_t           group;              // 0 = PORTA, 1 = PORTB
+  uint32_t          mask;
+} pin_port_t;
 
-  {              OCP_WAKE_N, INPUT,     ACT_LO, "WAKE_N"},
-  {            OCP_PWRBRK_N, INPUT,     ACT_LO, "PWRBRK_N"},
+static constexpr uint8_t        staticPinNos[] = { TTF_PINS(PIN_NO_ENTRY) };
+static constexpr pin_port_t     pinPorts[] = { TTF_PINS(PIN_PORT_ENTRY) };
 
-  {              P3_LINKA_N, INPUT,     ACT_LO, "P3_LINKA_N"},
-  {            P3_LED_ACT_N, INPUT,     ACT_LO, "P3_LED_ACT_N"},
+#define STATIC_PIN_COUNT        (sizeof(staticPinNos) / sizeof(staticPinNos[0]))
 
-  {              BOARD_ID_0, INPUT_PULLDOWN, ACT_HI, "BOARD_ID_0"},
-  {              NCSI_RST_N, OUTPUT,    ACT_LO, "NCSI_RST_N"},
+/**
+  * @name   findPinIndex
+  * @brief  compile time search of staticPinNos[] from entry 'i' on
+  * @param  pinNo   Arduino pin #
+  * @param  i       first entry to check
+  * @retval index or -1 if not in the list
+  */
+static constexpr int8_t findPinIndex(uint8_t pinNo, uint8_t i)
+{
+    return((i >= STATIC_PIN_COUNT) ? -1 : (staticPinNos[i] == pinNo) ? (int8_t) i : findPinIndex(pinNo, i + 1));
+}
 
-  {              BOARD_ID_1, INPUT_PULLDOWN, ACT_HI, "BOARD_ID_1"},
-  {       OCP_HEARTBEAT_LED, OUTPUT,    ACT_LO, "HEARTBEAT_LED"},     // HACK: temporary LED between UART pins 1 & 3
+/**
+  * @name   pinListValid
+  * @brief  compile time check that every pin is in range and listed once
+  * @param  i   first entry to check
+  * @retval true if valid
+  */
+static constexpr bool pinListValid(uint8_t i)
+{
+    return((i >= STATIC_PIN_COUNT) ? true :
+           (staticPinNos[i] < PINS_COUNT && findPinIndex(staticPinNos[i], 0) == i && pinListValid(i + 1)));
+}
 
-  {              BOARD_ID_2, INPUT_PULLDOWN, ACT_HI, "BOARD_ID_2"},
-  {        NIC_PWR_GOOD_JMP, INPUT,     ACT_HI, "NIC_PWR_GOOD"},      // HACK: PWR_GOOD_LED to UART connector pin 2
+static_assert(pinListValid(0), "TTF_PINS has a duplicate or out of range pin number");
+static_assert(STATIC_PIN_COUNT <= 127, "pin index must fit in int8_t");
 
-  {           OCP_SCAN_LD_N, OUTPUT,    ACT_LO, "SCAN_LD_N"},
-  {        OCP_SCAN_DATA_IN, INPUT,     ACT_HI, "SCAN_DATA_IN"},      // "in" from NIC 3.0 card (baseboard perspective)
+// Arduino pin # -> staticPins[] index, -1 if the pin is not in TTF_PINS
+#define PIN_INDEX_4(n)  findPinIndex(n, 0), findPinIndex(n + 1, 0), findPinIndex(n + 2, 0), findPinIndex(n + 3, 0)
 
-  {            OCP_SCAN_CLK, OUTPUT,    ACT_LO, "SCAN_CLK"},
-  {       OCP_SCAN_DATA_OUT, OUTPUT,    ACT_HI, "SCAN_DATA_OUT"},     // "out" to NIC 3.0 card
+static constexpr int8_t         pinIndex[] = {
+  PIN_INDEX_4(0),  PIN_INDEX_4(4),  PIN_INDEX_4(8),  PIN_INDEX_4(12), PIN_INDEX_4(16),
+  PIN_INDEX_4(20), PIN_INDEX_4(24), PIN_INDEX_4(28), PIN_INDEX_4(32)
 };
 
-uint16_t      static_pin_count = sizeof(staticPins) / sizeof(pin_mgt_t);
+static_assert(sizeof(pinIndex) == PINS_COUNT, "pinIndex[] must have an entry per variant.cpp pin");
+static_assert(pinIndex[TEMP_WARN] == 0, "pinIndex[] generation is broken");
 
-typedef struct {
-    uint8_t     bitNo;
-    char        bitName[20];
-} scan_data_t;
-
-// NOTE: This table is processed aligning with bits 31..0
-// The bitNo entry is NOT used
-const scan_data_t     scanBitNames[] = {
-    // Byte 0
-    {7, "0.7 FAN_ON_AUX"},
-    {6, "0.6 TEMP_CRIT_N"},
-    {5, "0.5 TEMP_WARN_N"},
-    {4, "0.4 WAKE_N"},
-    {3, "0.3 PRSNTB[3]_P#"},
-    {2, "0.2 PRSNTB[2]_P#"},
-    {1, "0.1 PRSNTB[1]_P#"},
-    {0, "0.0 PRSNTB[0]_P#"},
-
-    // Byte 1
-    {15, "1.7 LINK_SPDB_P2#"},
-    {14, "1.6 LINK_SPDA_P2#"},
-    {13, "1.5 ACT_P1#"},
-    {12, "1.4 LINK_SPDB_P1#"},
-    {11, "1.3 LINK_SPDA_P1#"},
-    {10, "1.2 ACT_PO#"},
-    {9, "1.1 LINK_SPDB_PO#"},
-    {8, "1.0 LINK_SPDA_PO#"},
-
-    // Byte 2
-    {23, "2.7 LINK_SPDA_P5#"},
-    {22, "2.6 ACT_P4#"},
-    {21, "2.5 LINK_SPDB_P4#"},
-    {20, "2.4 LINK_SPDA_P4#"},
-    {19, "2.3 ACT_P3#"},
-    {18, "2.2 LINK_SPDB_P3#"},
-    {17, "2.1 LINK_SPDA_P3#"},
-    {16, "2.0 ACT_P2#"},
-
-    // Byte 3
-    {31, "3.7 ACT_P7#"},
-    {30, "3.6 LINK_SPDB_P7#"},
-    {29, "3.5 LINK_SPDA_P7#"},
-    {28, "3.4 ACT_P6#"},
-    {27, "3.3 LINK_SPDB_P6#"},
-    {26, "3.2 LINK_SPDA_P6#"},
-    {25, "3.1 ACT_P5#"},
-    {24, "3.0 LINK_SPDB_P5#"},
-};
+#undef PIN_INDEX_4
+#undef PIN_MGT_ENTRY
+#undef PIN_NO_ENTRY
+#undef PIN_PORT_ENTRY
+
+// number of captures per mode for 'scan bench'
+#define SCAN_BENCH_CAPTURES     10
 
-static char             outBfr[OUTBFR_SIZE];
 uint8_t                 pinStates[PINS_COUNT] = {0};
+static pin_snapshot_t   pinSnapshot;            // sample pinStates[] inputs came from
 
 // Prototypes
-void timers_scanChainCapture(void);
 void writePin(uint8_t pinNo, uint8_t value);
 void readAllPins(void);
 
@@ -142,14 +168,13 @@ void configureIOPins(void)
   for ( int i = 0; i < static_pin_count; i++ )
   {
       pinNo = staticPins[i].pinNo;
-      pinMode(pinNo, staticPins[i].pinFunc);
+      hal_PinMode(pinNo, staticPins[i].pinFunc);
 
       if ( staticPins[i].pinFunc == OUTPUT )
       {
           // increase drive strength on output pins
-          // see ttf/variants.cpp for the data in g_APinDescription[]
           // NOTE: this will source 7mA, sink 10mA
-          PORT->Group[g_APinDescription[pinNo].ulPort].PINCFG[g_APinDescription[pinNo].ulPin].bit.DRVSTR = 1;
+          hal_PinHighDrive(pinNo);
 
           // deassert pin
           writePin(pinNo, (staticPins[i].activeState == ACT_LO) ? 1 : 0);
@@ -169,16 +194,97 @@ void configureIOPins(void)
   */
 bool readPin(uint8_t pinNo)
 {
-    uint8_t         index = getPinIndex(pinNo);
+    int8_t          index = getPinIndex(pinNo);
+
+    if ( index < 0 )
+        return(false);
 
     // if requested pin is an input, read that pin; else the
     // latest value written will be in pinStates[]
-    if ( staticPins[index].pinFunc == INPUT )
-        pinStates[index] = digitalRead((pin_size_t) pinNo);
+    if ( staticPins[index].pinFunc != OUTPUT )
+        pinStates[index] = (hal_PortIn(pinPorts[index].group) & pinPorts[index].mask) ? 1 : 0;
 
     return(pinStates[index]);
 }
 
+/**
+  * @name   getPinState
+  * @brief  get pin state from pinStates[] without reading the pin
+  * @param  pinNo   Arduino pin #
+  * @retval bool    input state at last readAllPins(), or last value written
+  */
+bool getPinState(uint8_t pinNo)
+{
+    int8_t          index = getPinIndex(pinNo);
+
+    return((index < 0) ? false : pinStates[index]);
+}
+
+/**
+  * @name   takePinSnapshot
+  * @brief  read both PORT IN registers back to back
+  * @param  snap    where to put the sample
+  * @retval None
+  */
+void takePinSnapshot(pin_snapshot_t *snap)
+{
+    hal_IrqOff();
+    snap->in[0] = hal_PortIn(0);
+    snap->in[1] = hal_PortIn(1);
+    hal_IrqOn();
+
+    snap->usecs = hal_Micros();
+}
+
+/**
+  * @name   snapshotPin
+  * @brief  decode one pin from a snapshot
+  * @param  snap    sample from takePinSnapshot()
+  * @param  pinNo   Arduino pin #
+  * @retval bool    pin level in that sample
+  */
+bool snapshotPin(const pin_snapshot_t *snap, uint8_t pinNo)
+{
+    int8_t          index = getPinIndex(pinNo);
+
+    if ( index < 0 )
+        return(false);
+
+    return((snap->in[pinPorts[index].group] & pinPorts[index].mask) != 0);
+}
+
+/**
+  * @name   snapshotPinBits
+  * @brief  pin levels as a bit per staticPins[] entry, first 32 pins
+  * @param  snap    sample from takePinSnapshot()
+  * @retval bit i = level of staticPins[i]
+  * @note   outputs are the latest value written, as in pinStates[];
+  *         leaves pinStates[] and the readAllPins() snapshot alone
+  */
+uint32_t snapshotPinBits(const pin_snapshot_t *snap)
+{
+    uint32_t        bits = 0;
+
+    for ( int i = 0; i < static_pin_count && i < 32; i++ )
+    {
+        if ( (staticPins[i].pinFunc == OUTPUT) ? pinStates[i] : (snap->in[pinPorts[i].group] & pinPorts[i].mask) )
+            bits |= 1UL << i;
+    }
+
+    return(bits);
+}
+
+/**
+  * @name   getPinSnapshot
+  * @brief  get the sample taken by the last readAllPins()
+  * @param  None
+  * @retval pointer to sample
+  */
+const pin_snapshot_t *getPinSnapshot(void)
+{
+    return(&pinSnapshot);
+}
+
 /**
   * @name   writePin
   * @brief  wrapper to digitalWrite via pinStates[]
@@ -188,9 +294,39 @@ bool readPin(uint8_t pinNo)
   */
 void writePin(uint8_t pinNo, uint8_t value)
 {
+    int8_t          index = getPinIndex(pinNo);
+
+    if ( index < 0 )
+        return;
+
     value = (value == 0) ? 0 : 1;           // force value to boolean
-    digitalWrite(pinNo, value);
-    pinStates[getPinIndex(pinNo)] = value;
+    hal_PinWrite(pinNo, value);
+    pinStates[index] = value;
+
+    // an armed power meter burst captures inrush from here on
+    if ( value && (pinNo == OCP_MAIN_PWR_EN || pinNo == OCP_AUX_PWR_EN) )
+        meter_BurstTrigger();
+}
+
+/**
+  * @name   parseNumber
+  * @brief  parse a whole decimal argument and range check it
+  * @param  text    token
+  * @param  max     largest value allowed
+  * @param  value   output, set only if valid
+  * @retval true if text is a number 0..max
+  * @note   checked before it is narrowed, so '257' is not pin 1
+  */
+static bool parseNumber(const char *text, long max, long *value)
+{
+    char            *end;
+    long            n = strtol(text, &end, 10);
+
+    if ( end == text || *end != 0 || n < 0 || n > max )
+        return(false);
+
+    *value = n;
+    return(true);
 }
 
 /**
@@ -203,8 +339,9 @@ void writePin(uint8_t pinNo, uint8_t value)
   */
 int readCmd(int arg)
 {
-    uint8_t       pinNo = atoi(tokens[1]);
-    uint8_t       index = getPinIndex(pinNo);
+    long          n;
+    uint8_t       pinNo;
+    int8_t        index;
 
     if ( isCardPresent() == false )
     {
@@ -212,12 +349,14 @@ int readCmd(int arg)
         return(1);
     }
 
-    if ( pinNo > PINS_COUNT )
+    if ( parseNumber(tokens[1], PINS_COUNT - 1, &n) == false || getPinIndex(n) == -1 )
     {
         terminalOut((char *) "Invalid pin number; please use Arduino numbering");
         return(1);
     }
 
+    pinNo = n;
+    index = getPinIndex(pinNo);
     (void) readPin(pinNo);
     sprintf(outBfr, "%s Pin %d (%s) = %d", (staticPins[index].pinFunc == INPUT) ? "Input" : "Output", 
             pinNo, getPinName(pinNo), pinStates[index]);
@@ -234,9 +373,10 @@ int readCmd(int arg)
   */
 int writeCmd(int argCnt)
 {
-    uint8_t     pinNo = atoi(tokens[1]);
-    uint8_t     value = atoi(tokens[2]);
-    uint8_t     index = getPinIndex(pinNo);
+    long        n;
+    uint8_t     pinNo;
+    uint8_t     value;
+    int8_t      index;
 
     if ( isCardPresent() == false )
     {
@@ -244,24 +384,29 @@ int writeCmd(int argCnt)
         return(1);
     }
 
-    if ( pinNo > PINS_COUNT || index == -1 )
+    if ( parseNumber(tokens[1], PINS_COUNT - 1, &n) == false || getPinIndex(n) == -1 )
     {
         terminalOut((char *) "Invalid pin number; use 'pins' command for help.");
         return(1);
     }    
 
+    pinNo = n;
+    index = getPinIndex(pinNo);
+
     if ( staticPins[index].pinFunc == INPUT )
     {
         terminalOut((char *) "Cannot write to an input pin! Use 'pins' command for help.");
         return(1);
     }  
 
-    if ( value != 0 && value != 1 )
+    if ( parseNumber(tokens[2], 1, &n) == false )
     {
         terminalOut((char *) "Invalid pin value; please enter either 0 or 1");
         return(1);
     }
 
+    value = n;
+
     writePin(pinNo, value);
 
     sprintf(outBfr, "Wrote %d to pin # %d (%s)", value, pinNo, getPinName(pinNo));
@@ -285,17 +430,61 @@ char getPinChar(int index)
         return('=');
 }
 
+static int pinLogClear(int argCnt)
+{
+    monitor_Clear();
+    terminalOut((char *) "Pin edge log and counters cleared");
+    return(0);
+}
+
+static constexpr cli_subcmd_t   pinLogCmds[] = {
+    {"clear",   pinLogClear,    0, 0},
+};
+
+/**
+  * @name   pinLog
+  * @brief  'pins log [clear]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int pinLog(int argCnt)
+{
+    if ( argCnt == 1 )
+    {
+        monitor_ShowLog();
+        return(0);
+    }
+
+    return(cli_RunSubCmd(pinLogCmds, CLI_TABLE_COUNT(pinLogCmds), 2, argCnt));
+}
+
+static constexpr cli_subcmd_t   pinCmds[] = {
+    {"log",     pinLog,         0, 1},
+};
+
 /**
   * @name   pinCmd
   * @brief  display I/O pins
   * @param  argCnt = CLI arg count
-  * @retval None
+  * @param  tokens[1]  optional 'log'
+  * @param  tokens[2]  optional 'clear' after 'log'
+  * @retval 0 OK, 1 error
+  * @note   'pins log' shows input edges since the last 'pins log'
   */
-int pinCmd(int arg)
+int pinCmd(int argCnt)
 {
     int         count = static_pin_count;
     int         index = 0;
 
+    if ( argCnt >= 1 )
+    {
+        if ( cli_RunSubCmd(pinCmds, CLI_TABLE_COUNT(pinCmds), 1, argCnt) == 0 )
+            return(0);
+
+        terminalOut((char *) "Usage: pins [log [clear]]");
+        return(1);
+    }
+
     if ( isCardPresent() == false )
     {
         terminalOut((char *) "NIC card is not present; cannot display I/O pins");
@@ -306,14 +495,16 @@ int pinCmd(int arg)
     terminalOut((char *) " #           Pin Name   D/S              #        Pin Name      D/S ");
     terminalOut((char *) "-------------------------------------------------------------------- ");
 
-	readAllPins();
-	
+    readAllPins();
+    sprintf(outBfr, "Inputs sampled at %lu usecs", (unsigned long) getPinSnapshot()->usecs);
+    terminalOut(outBfr);
+
     while ( count > 0 )
     {
       if ( count == 1 )
       {
           sprintf(outBfr, "%2d %20s %c %d ", staticPins[index].pinNo, staticPins[index].name,
-                  getPinChar(index), readPin(staticPins[index].pinNo));
+                  getPinChar(index), getPinState(staticPins[index].pinNo));
           terminalOut(outBfr);
           break;
       }
@@ -321,9 +512,9 @@ int pinCmd(int arg)
       {
           sprintf(outBfr, "%2d %20s %c %d\t\t%2d %20s %c %d ", 
                   staticPins[index].pinNo, staticPins[index].name, 
-                  getPinChar(index), readPin(staticPins[index].pinNo),
+                  getPinChar(index), getPinState(staticPins[index].pinNo),
                   staticPins[index+1].pinNo, staticPins[index+1].name, 
-                  getPinChar(index+1), readPin(staticPins[index+1].pinNo));
+                  getPinChar(index+1), getPinState(staticPins[index+1].pinNo));
           terminalOut(outBfr);
           count -= 2;
           index += 2;
@@ -361,135 +552,300 @@ int pinCmd(int arg)
   * @brief  read all I/O pins into pinStates[]
   * @param  None
   * @retval None
+  * @note   all inputs come from one snapshot, see getPinSnapshot()
   */
 void readAllPins(void)
 {
+    takePinSnapshot(&pinSnapshot);
+
+    // outputs keep the latest value written
     for ( int i = 0; i < static_pin_count; i++ )
     {
-        (void) readPin(staticPins[i].pinNo);
+        if ( staticPins[i].pinFunc != OUTPUT )
+            pinStates[i] = (pinSnapshot.in[pinPorts[i].group] & pinPorts[i].mask) ? 1 : 0;
     }
 }
 
+//===================================================================
+//                    STATUS DISPLAY
+//
+// Each field on the status screen keeps the text it last drew in
+// statusShadow[]; a refresh sends only a cursor move plus the run of
+// characters between the first and last that changed, so an idle
+// screen costs nothing over USB.
+//===================================================================
+typedef enum {
+  SF_TEMP_WARN = 0,
+  SF_P1_LINKA_N,
+  SF_TEMP_CRIT,
+  SF_PRSNTB,
+  SF_FAN_ON_AUX,
+  SF_ATX_PWR_OK,
+  SF_SCAN_LD_N,
+  SF_SCAN_VERS,
+  SF_AUX_EN,
+  SF_PWRBRK_N,
+  SF_MAIN_EN,
+  SF_WAKE_N,
+  SF_P3_LED_ACT_N,
+  SF_P3_LINKA_N,
+  SF_P1_LED_ACT_N,
+  SF_NCSI_RST_N,
+  SF_METER_12V,
+  SF_METER_3V3_AUX,
+  SF_POWER_STATE,
+  SF_POWER_FAULT,
+  SF_SCAN_CHAIN,
+  SF_COUNT
+} STATUS_FIELD;
+
+#define STATUS_FIELD_SZ         64
+
+static char             statusShadow[SF_COUNT][STATUS_FIELD_SZ];
+
 /**
-  * @name   statusCmd
-  * @brief  display status screen
-  * @param  argCnt = number of CLI arguments
-  * @retval None
+  * @name   statusDraw
+  * @brief  draw the part of a status field that changed
+  * @param  field   STATUS_FIELD
+  * @param  r       row
+  * @param  c       column of first char
+  * @param  text    new field text
+  * @retval bytes queued for the terminal
+  * @note   a shorter text is blanked out to the old length
   */
-int statusCmd(int arg)
+static int statusDraw(STATUS_FIELD field, uint8_t r, uint8_t c, const char *text)
 {
-    uint16_t        count = EEPROMData.status_delay_secs;
-    bool            oneShot = (count == 0) ? true : false;
-
-    if ( isCardPresent() == false )
+    char            *shadow = statusShadow[field];
+    char            run[STATUS_FIELD_SZ];
+    char            out[STATUS_FIELD_SZ + 12];      // cursor move and the run
+    fmt_t           f;
+    int             newLen = strlen(text);
+    int             oldLen = strlen(shadow);
+    int             len;
+    int             first = -1;
+    int             last = -1;
+    char            ch;
+
+    if ( newLen > STATUS_FIELD_SZ - 1 )
+        newLen = STATUS_FIELD_SZ - 1;
+
+    len = (newLen > oldLen) ? newLen : oldLen;
+
+    for ( int i = 0; i < len; i++ )
     {
-        terminalOut((char *) "NIC card is not present; cannot display status");
-        return(1);
-    }
+        ch = (i < newLen) ? text[i] : ' ';
 
-    while ( 1 )
-    {
-        readAllPins();
+        if ( ch != ((i < oldLen) ? shadow[i] : ' ') )
+        {
+            if ( first == -1 )
+                first = i;
+
+            last = i;
+        }
 
-        CLR_SCREEN();
-        CURSOR(1, 29);
-        displayLine((char *) "TTF Status Display");
+        run[i] = ch;
+    }
 
-        CURSOR(3,1);
-        sprintf(outBfr, "TEMP WARN         %d", readPin(TEMP_WARN));
-        displayLine(outBfr);
+    if ( first == -1 )
+        return(0);
 
-        CURSOR(3,57);
-        sprintf(outBfr, "P1_LINK_A_N      %u", readPin(P1_LINKA_N));
-        displayLine(outBfr);
+    // same escape sequence as CURSOR(), written with the run
+    run[last + 1] = 0;
+    fmt_Start(&f, out, sizeof(out));
+    fmt_Str(&f, "\x1b[");
+    fmt_Uint(&f, r);
+    fmt_Char(&f, ';');
+    fmt_Uint(&f, c + first);
+    fmt_Char(&f, 'f');
+    fmt_Str(&f, &run[first]);
+    term_Write(out, fmt_Len(&f));
+
+    memcpy(shadow, text, newLen);
+    shadow[newLen] = 0;
+    return(fmt_Len(&f));
+}
 
-        CURSOR(4,1);
-        sprintf(outBfr, "TEMP CRIT         %u", readPin(TEMP_CRIT));
-        displayLine(outBfr);
+/**
+  * @name   statusPins
+  * @brief  draw a status field of a label and pin levels
+  * @param  field   STATUS_FIELD
+  * @param  r       row
+  * @param  c       column of first char
+  * @param  label   text before the levels, with its spacing
+  * @param  pins    Arduino pin numbers, most significant first
+  * @param  count   number of pins
+  * @retval bytes queued, see statusDraw()
+  */
+static int statusPins(STATUS_FIELD field, uint8_t r, uint8_t c, const char *label, const uint8_t *pins, int count)
+{
+    fmt_t           f;
 
-        CURSOR(4,56);
-        sprintf(outBfr, "PRSNTB [3:0]   %u%u%u%u %s", readPin(OCP_PRSNTB3_N), readPin(OCP_PRSNTB2_N), 
-                readPin(OCP_PRSNTB1_N), readPin(OCP_PRSNTB0_N), isCardPresent() ? "CARD" : "VOID");
-        displayLine(outBfr);
+    fmt_Start(&f, outBfr, OUTBFR_SIZE);
+    fmt_Str(&f, label);
 
-        CURSOR(5,1);
-        sprintf(outBfr, "FAN ON AUX        %u", readPin(FAN_ON_AUX));
-        displayLine(outBfr);
+    for ( int i = 0; i < count; i++ )
+        fmt_Char(&f, getPinState(pins[i]) ? '1' : '0');
 
-        CURSOR(5,58);
-        sprintf(outBfr, "ATX_PWR_OK      %u", readPin(ATX_PWR_OK));
-        displayLine(outBfr);
+    return(statusDraw(field, r, c, outBfr));
+}
 
-        CURSOR(6,1);
-        sprintf(outBfr, "SCAN_LD_N         %d", readPin(OCP_SCAN_LD_N));
-        displayLine(outBfr);
+/**
+  * @name   statusPin
+  * @brief  draw a status field of a label and one pin level
+  */
+static int statusPin(STATUS_FIELD field, uint8_t r, uint8_t c, const char *label, uint8_t pinNo)
+{
+    return(statusPins(field, r, c, label, &pinNo, 1));
+}
 
-        CURSOR(6,53);
-        sprintf(outBfr, "SCAN VERS [1:0]     %u%u", readPin(SCAN_VER_1), readPin(SCAN_VER_0));
-        displayLine(outBfr);
+/**
+  * @name   statusRefresh
+  * @brief  sample inputs and redraw changed status fields
+  * @param  None
+  * @retval bytes queued for the terminal
+  * @note   shows the last scan chain capture, see statusCmd()
+  */
+static uint32_t statusRefresh(void)
+{
+    static const uint8_t    prsntPins[] = {OCP_PRSNTB3_N, OCP_PRSNTB2_N, OCP_PRSNTB1_N, OCP_PRSNTB0_N};
+    static const uint8_t    versPins[] = {SCAN_VER_1, SCAN_VER_0};
+    PWR_STATE               state = power_GetState();
+    fmt_t                   f;
+    uint32_t                bytes = 0;
+
+    readAllPins();
+
+    bytes += statusPin(SF_TEMP_WARN, 3, 1, "TEMP WARN         ", TEMP_WARN);
+    bytes += statusPin(SF_P1_LINKA_N, 3, 57, "P1_LINK_A_N      ", P1_LINKA_N);
+    bytes += statusPin(SF_TEMP_CRIT, 4, 1, "TEMP CRIT         ", TEMP_CRIT);
+
+    fmt_Start(&f, outBfr, OUTBFR_SIZE);
+    fmt_Str(&f, "PRSNTB [3:0]   ");
+
+    for ( int i = 0; i < 4; i++ )
+        fmt_Char(&f, getPinState(prsntPins[i]) ? '1' : '0');
+
+    fmt_Str(&f, isCardPresentIn(getPinSnapshot()) ? " CARD" : " VOID");
+    bytes += statusDraw(SF_PRSNTB, 4, 56, outBfr);
+
+    bytes += statusPin(SF_FAN_ON_AUX, 5, 1, "FAN ON AUX        ", FAN_ON_AUX);
+    bytes += statusPin(SF_ATX_PWR_OK, 5, 58, "ATX_PWR_OK      ", ATX_PWR_OK);
+    bytes += statusPin(SF_SCAN_LD_N, 6, 1, "SCAN_LD_N         ", OCP_SCAN_LD_N);
+    bytes += statusPins(SF_SCAN_VERS, 6, 53, "SCAN VERS [1:0]     ", versPins, 2);
+    bytes += statusPin(SF_AUX_EN, 7, 1, "AUX_EN            ", OCP_AUX_PWR_EN);
+    bytes += statusPin(SF_PWRBRK_N, 7, 60, "PWRBRK_N      ", OCP_PWRBRK_N);
+    bytes += statusPin(SF_MAIN_EN, 8, 1, "MAIN_EN           ", OCP_MAIN_PWR_EN);
+    bytes += statusPin(SF_WAKE_N, 8, 62, "WAKE_N      ", OCP_WAKE_N);
+    bytes += statusPin(SF_P3_LED_ACT_N, 9, 1, "P3_LED_ACT_N      ", P3_LED_ACT_N);
+    bytes += statusPin(SF_P3_LINKA_N, 9, 58, "P3_LINKA_N      ", P3_LINKA_N);
+    bytes += statusPin(SF_P1_LED_ACT_N, 10, 1, "P1_LED_ACT_N      ", P1_LED_ACT_N);
+    bytes += statusPin(SF_NCSI_RST_N, 10, 58, "NCSI_RST_N      ", NCSI_RST_N);
+
+    meter_FormatRail(METER_RAIL_12V, outBfr);
+    bytes += statusDraw(SF_METER_12V, 12, 1, outBfr);
+
+    meter_FormatRail(METER_RAIL_3V3_AUX, outBfr);
+    bytes += statusDraw(SF_METER_3V3_AUX, 13, 1, outBfr);
+
+    fmt_Start(&f, outBfr, OUTBFR_SIZE);
+    fmt_Str(&f, "POWER STATE       ");
+    fmt_Str(&f, power_GetStateName(state));
+    bytes += statusDraw(SF_POWER_STATE, 15, 1, outBfr);
+
+    fmt_Start(&f, outBfr, OUTBFR_SIZE);
+    fmt_Str(&f, "LAST FAULT  ");
+    fmt_Str(&f, power_GetFaultName(power_GetFault()));
+    bytes += statusDraw(SF_POWER_FAULT, 15, 45, outBfr);
+
+    fmt_Start(&f, outBfr, OUTBFR_SIZE);
+    fmt_Str(&f, "SCAN CHAIN        0x");
+    fmt_Hex(&f, scan_GetWord(0), 8);
+    fmt_Str(&f, "  ");
+    fmt_Uint(&f, scan_GetLength());
+    fmt_Str(&f, (scan_GetSamplePeriod() != 0) ? " bits" : " bits, 'scan watch' is off");
+    bytes += statusDraw(SF_SCAN_CHAIN, 16, 1, outBfr);
+
+    return(bytes);
+}
 
-        CURSOR(7,1);
-        sprintf(outBfr, "AUX_EN            %d", readPin(OCP_AUX_PWR_EN));
-        displayLine(outBfr);      
+/**
+  * @name   statusCmd
+  * @brief  display status screen
+  * @param  argCnt = number of CLI arguments
+  * @retval None
+  * @note   refreshes every 'speriod' msecs until a key is hit;
+  *         shows the field bytes sent per refresh on exit.  The scan
+  *         chain is captured once here; 'scan watch' keeps it current
+  */
+int statusCmd(int arg)
+{
+    uint16_t            period = EEPROMData.status_period_msec;
+    uint32_t            fullBytes;
+    uint32_t            bytes = 0;
+    uint32_t            refreshes = 0;
 
-        CURSOR(7,60);
-        sprintf(outBfr, "PWRBRK_N      %d", readPin(OCP_PWRBRK_N));
-        displayLine(outBfr);
+    if ( isCardPresent() == false )
+    {
+        terminalOut((char *) "NIC card is not present; cannot display status");
+        return(1);
+    }
 
-        CURSOR(8,1);
-        sprintf(outBfr, "MAIN_EN           %d", readPin(OCP_MAIN_PWR_EN));
-        displayLine(outBfr);  
+    if ( period != 0 && period < STATUS_MIN_PERIOD_MSEC )
+        period = STATUS_MIN_PERIOD_MSEC;
 
-        CURSOR(8,62);
-        sprintf(outBfr, "WAKE_N      %d", readPin(OCP_WAKE_N));
-        displayLine(outBfr);
+    // full paint: blank screen, static text and every field
+    memset(statusShadow, 0, sizeof(statusShadow));
 
-        CURSOR(9,1);
-        sprintf(outBfr, "P3_LED_ACT_N      %d", readPin(P3_LED_ACT_N));
-        displayLine(outBfr);  
+    CLR_SCREEN();
+    CURSOR(1, 29);
+    displayLine((char *) "TTF Status Display");
 
-        CURSOR(9,58);
-        sprintf(outBfr, "P3_LINKA_N      %d", readPin(P3_LINKA_N));
-        displayLine(outBfr);
+    if ( scan_GetSamplePeriod() == 0 )
+        (void) scan_Capture();
 
-        CURSOR(10,1);
-        sprintf(outBfr, "P1_LED_ACT_N      %d", readPin(P1_LED_ACT_N));
-        displayLine(outBfr);
+    backgroundPoll();
+    fullBytes = statusRefresh();
 
-        CURSOR(10, 58);
-        sprintf(outBfr, "NCSI_RST_N      %d", readPin(NCSI_RST_N));
-        displayLine(outBfr);
+    if ( period == 0 )
+    {
+        CURSOR(18,1);
+        displayLine((char *) "Status period 0, set speriod to nonzero for this screen to loop.");
+        return(0);
+    }
 
-        if ( oneShot )
-        {
-            CURSOR(12,1);
-            displayLine((char *) "Status delay 0, set sdelay to nonzero for this screen to loop.");
-            return(0);
-        }
+    CURSOR(24, 22);
+    displayLine((char *) "Hit any key to exit this display");
 
-        CURSOR(24, 22);
-        displayLine((char *) "Hit any key to exit this display");
+    while ( 1 )
+    {
+        uint32_t        refreshStart = hal_Millis();
 
-        while ( count-- > 0 )
+        while ( hal_Millis() - refreshStart < period )
         {
-            if ( SerialUSB.available() )
+            if ( hal_SerialAvailable() )
             {
                 // flush any user input and exit
-                (void) SerialUSB.read();
+                (void) hal_SerialRead();
 
-                while ( SerialUSB.available() )
+                while ( hal_SerialAvailable() )
                 {
-                    (void) SerialUSB.read();
+                    (void) hal_SerialRead();
                 }
 
                 CLR_SCREEN();
+                sprintf(outBfr, "%lu bytes of fields on the full screen, %lu refreshes sent %lu bytes, %lu average",
+                        (unsigned long) fullBytes, (unsigned long) refreshes, (unsigned long) bytes,
+                        (unsigned long) ((refreshes) ? bytes / refreshes : 0));
+                SHOW();
                 return(0);
             }
 
-            delay(1000);
+            // this loop runs inside the CLI task; keep the rest going
+            backgroundPoll();
         }
 
-        count = EEPROMData.status_delay_secs;
+        bytes += statusRefresh();
+        refreshes++;
     }
 
     return(0);
@@ -505,30 +861,50 @@ int statusCmd(int arg)
   */
 const char *getPinName(int pinNo)
 {
-    for ( int i = 0; i < static_pin_count; i++ )
-    {
-        if ( pinNo == staticPins[i].pinNo )
-            return(staticPins[i].name);
-    }
+    int8_t          index = (pinNo < 0) ? -1 : getPinIndex(pinNo);
 
-    return("Unknown");
+    return((index < 0) ? "Unknown" : staticPins[index].name);
 }
 
 /**
   * @name   getPinIndex
   * @brief  get index into static/dynamic pin arrays
   * @param  Arduino pin number
-  * @retval None
+  * @retval index or -1 if the pin is not in staticPins[]
   */
 int8_t getPinIndex(uint8_t pinNo)
 {
+    return((pinNo < PINS_COUNT) ? pinIndex[pinNo] : -1);
+}
+
+/**
+  * @name   verifyPinTables
+  * @brief  check the TTF_PINS PORT group/bit against variant.cpp
+  * @param  None
+  * @retval number of mismatched pins
+  * @note   g_APinDescription[] is not constexpr so this can't be
+  *         a static_assert; called once at startup
+  */
+int verifyPinTables(void)
+{
+    uint8_t                 group;
+    uint8_t                 bit;
+    int                     errors = 0;
+
     for ( int i = 0; i < static_pin_count; i++ )
     {
-        if ( staticPins[i].pinNo == pinNo )
-            return(i);
+        hal_PinPort(staticPins[i].pinNo, &group, &bit);
+
+        if ( group != pinPorts[i].group || (1UL << bit) != pinPorts[i].mask )
+        {
+            sprintf(outBfr, "Pin table error: %s (pin %d) is P%c%02u in variant.cpp", staticPins[i].name,
+                    staticPins[i].pinNo, (group == 0) ? 'A' : 'B', bit);
+            SHOW();
+            errors++;
+        }
     }
 
-    return(-1);
+    return(errors);
 }
 
 /**
@@ -540,73 +916,95 @@ int8_t getPinIndex(uint8_t pinNo)
 void set_help(void)
 {
     terminalOut((char *) "FLASH Parameters are:");
-    sprintf(outBfr, "  sdelay <integer> - status display delay in seconds; current: %d", EEPROMData.status_delay_secs);
+    sprintf(outBfr, "  speriod <integer> - status display refresh period in milliseconds, 0 = once; current: %d", EEPROMData.status_period_msec);
     terminalOut(outBfr);
     sprintf(outBfr, "  pdelay <integer> - power up sequence delay in milliseconds; current: %d", EEPROMData.pwr_seq_delay_msec);
     terminalOut(outBfr);
+    sprintf(outBfr, "  mperiod <integer> - power meter sample period in milliseconds, 0 = off; current: %d", EEPROMData.meter_period_msec);
+    terminalOut(outBfr);
     terminalOut((char *) "'set <parameter> <value>' sets a parameter from list above to value");
     terminalOut((char *) "  value can be <integer>, <string> or <float> depending on the parameter");
 
     // TODO add more set command help here
 }
 
+/**
+  * @name   setField
+  * @brief  store a 'set' value in a 16-bit EEPROMData field
+  * @param  field   EEPROMData member
+  * @retval 0=OK 1=value not a number 0..65535
+  * @note   tokens[2] is the value; only a change is written to FLASH
+  */
+static int setField(uint16_t *field)
+{
+    long          n;
+
+    // range check before narrowing so '-1' is not 65535 and '70000'
+    // not 4464
+    if ( parseNumber(tokens[2], UINT16_MAX, &n) == false )
+    {
+        terminalOut((char *) "Invalid value, must be 0..65535");
+        return(1);
+    }
+
+    if ( *field != (uint16_t) n )
+    {
+        *field = (uint16_t) n;
+        EEPROM_Save();
+    }
+
+    return(0);
+}
+
+static int setMperiod(int argCnt)
+{
+    return(setField(&EEPROMData.meter_period_msec));
+}
+
+static int setPdelay(int argCnt)
+{
+    return(setField(&EEPROMData.pwr_seq_delay_msec));
+}
+
+static int setSperiod(int argCnt)
+{
+    return(setField(&EEPROMData.status_period_msec));
+}
+
+static constexpr cli_subcmd_t   setCmds[] = {
+    {"mperiod", setMperiod,     1, 1},
+    {"pdelay",  setPdelay,      1, 1},
+    {"speriod", setSperiod,     1, 1},
+};
+
+CLI_SUBCMDS_SORTED(setCmds);
+
 /**
   * @name   setCmd
   * @brief  Set a parameter (seeing) in FLASH
   * @param  arg 1 = parameter name
-  * @param  arg 2 = value to set
-  * @retval 0
+  * @param  arg 2 = value to set, 0..65535
+  * @retval 0=OK 1=bad parameter name or value
   * @note   no args shows help w/current values
   * @note   simulated EEPROM is called FLASH to the user
   */
 int setCmd(int argCnt)
 {
-    char          *parameter = tokens[1];
-    String        valueEntered = tokens[2];
-//    float         fValue;
-    int           iValue;
-    bool          isDirty = false;
+    int           rc;
 
     if ( argCnt == 0 )
     {
         set_help();
         return(0);
     }
-    else if ( argCnt != 2 )
-    {
-        set_help();
-        return(0);
-    }
 
-    if ( strcmp(parameter, "sdelay") == 0 )
-    {
-        iValue = valueEntered.toInt();
-        if (EEPROMData.status_delay_secs != iValue )
-        {
-          isDirty = true;
-          EEPROMData.status_delay_secs = iValue;
-        }
-    }
-    else if ( strcmp(parameter, "pdelay") == 0 )
-    {
-        iValue = valueEntered.toInt();
-        if (EEPROMData.pwr_seq_delay_msec != iValue )
-        {
-          isDirty = true;
-          EEPROMData.pwr_seq_delay_msec = iValue;
-        }
-    }
-    else
+    if ( (rc = cli_RunSubCmd(setCmds, CLI_TABLE_COUNT(setCmds), 1, argCnt)) == CLI_SUBCMD_ERR )
     {
-        terminalOut((char *) "Invalid parameter name");
         set_help();
         return(1);
     }
 
-    if ( isDirty == true )
-        EEPROM_Save();
-
-    return(0);
+    return(rc);
 
 } // setCmd()
 
@@ -618,34 +1016,43 @@ int setCmd(int argCnt)
   */
 uint32_t queryScanChain(bool displayResults)
 {
-    uint8_t             shift = 31;
-    char                *s = outBfr;
-    const char          fmt[] = "%-20s ... %d    ";
-    unsigned            i = 0;
+    fmt_t               f;
+    char                name[SCAN_BIT_NAME_SZ];
+    uint16_t            bits = scan_GetLength();
 
-    timers_scanChainCapture();
+    scan_Capture();
 
     if ( displayResults == false )
-        return(scanShiftRegister_0);
+        return(scan_GetWord(0));
 
-    sprintf(outBfr, "scan chain shift register 0: %08X", (unsigned int) scanShiftRegister_0);
-    terminalOut(outBfr);
+    for ( uint8_t word = 0; word < (bits + 31) / 32; word++ )
+    {
+        fmt_Start(&f, outBfr, OUTBFR_SIZE);
+        fmt_Str(&f, "scan chain shift register ");
+        fmt_Uint(&f, word);
+        fmt_Str(&f, ": ");
+        fmt_Hex(&f, scan_GetWord(word), 8, true);
+        terminalOut(outBfr);
+    }
 
-    // WARNING: This code below expects the entries in scanBitNames[] to be in order order 31..0
-    // to align with incoming shifted left bits from SCAN_DATA_IN
-    while ( i < 32 )
+    // bits are displayed in the order they were shifted in, two per line
+    // in 30 char columns
+    for ( uint16_t i = 0; i < bits; i++ )
     {
-        sprintf(s, fmt, scanBitNames[i++].bitName, (scanShiftRegister_0 & (1 << shift--)) ? 1 : 0);
-        s += 30;
-        sprintf(s, fmt, scanBitNames[i++].bitName, (scanShiftRegister_0 & (1 << shift--)) ? 1 : 0);
-        s += 30;
-        *s = 0;
+        if ( (i & 1) == 0 )
+            fmt_Start(&f, outBfr, OUTBFR_SIZE);
 
-        terminalOut(outBfr);
-        s = outBfr;
+        scan_GetBitName(i, name);
+        fmt_PadTo(&f, (i & 1) * 30);
+        fmt_Str(&f, name, -20);
+        fmt_Str(&f, " ... ");
+        fmt_Uint(&f, scan_GetBit(i));
+
+        if ( (i & 1) || i + 1 == bits )
+            terminalOut(outBfr);
     }
 
-    return(scanShiftRegister_0);
+    return(scan_GetWord(0));
     
 } // queryScanChain()
 
@@ -657,197 +1064,373 @@ uint32_t queryScanChain(bool displayResults)
   */
 static void pwrCmdHelp(void)
 {
-    terminalOut((char *) "Usage: power <up | down | status> <main | aux | card>");
+    terminalOut((char *) "Usage: power <up | down | status | timing | cycle | meter | burst> <main | aux | card>");
     terminalOut((char *) "  'power status' requires no argument and shows the power status of NIC card");
     terminalOut((char *) "  main = MAIN_EN to NIC card; aux = AUX_EN to NIC card; ");
     terminalOut((char *) "  card = MAIN_EN=1 then pdelay msecs then AUX_EN=1; see 'set' command for pdelay");
+    terminalOut((char *) "  'power up|down card' run in the background; faults on NIC_PWR_GOOD loss or TEMP_CRIT");
+    terminalOut((char *) "  'power timing [clear]' shows usec power up timing of recent cycles");
+    terminalOut((char *) "  'power cycle <count> <on_ms> <off_ms>' repeats up/down; 'power cycle' shows results");
+    terminalOut((char *) "  'power meter [clear]' shows 12V and 3.3V_AUX power and energy; see 'set mperiod'");
+    terminalOut((char *) "  'power burst [arm|off|dump]' captures inrush at MAIN_EN/AUX_EN assertion");
 }
 
 /**
-  * @name   pwrCmd
-  * @brief  Control AUX and MAIN power to NIC 3.0 board
-  * @param  argCnt  number of arguments
-  * @param  tokens[1]  up, down or status
-  * @param  tokens[2]   main, aux or card
-  * @retval 0   OK
-  * @retval 1   error
-  * @note   Delay is changed with 'set pdelay <msec>'
-  * @note   power <up|down|status> <main|aux|board> status has no 2nd arg
+  * @name   pwrCardCheck
+  * @brief  report if the NIC card is missing
+  * @param  None
+  * @retval true if present
   */
-int pwrCmd(int argCnt)
+static bool pwrCardCheck(void)
 {
-    int             rc = 0;
-    bool            isPowered = false;
-    uint8_t         mainPin = readPin(OCP_MAIN_PWR_EN);
-    uint8_t         auxPin = readPin(OCP_AUX_PWR_EN);
-    uint8_t         pwrGoodPin = readPin(NIC_PWR_GOOD_JMP);
+    if ( isCardPresent() )
+        return(true);
 
-    if ( argCnt == 0 )
-    {
-        pwrCmdHelp();
-        return(1);
-    }
+    terminalOut((char *) "NIC card is not present; no power info available");
+    return(false);
+}
 
-    if ( isCardPresent() == false )
+/**
+  * @name   pwrIsPowered
+  * @brief  check MAIN_EN, AUX_EN and NIC_PWR_GOOD
+  * @param  None
+  * @retval true if all are high
+  */
+static bool pwrIsPowered(void)
+{
+    return(readPin(OCP_MAIN_PWR_EN) && readPin(OCP_AUX_PWR_EN) && readPin(NIC_PWR_GOOD_JMP));
+}
+
+/**
+  * @name   pwrSetEnable
+  * @brief  write MAIN_EN or AUX_EN for 'power up|down main|aux'
+  * @param  pinNo   OCP_MAIN_PWR_EN or OCP_AUX_PWR_EN
+  * @param  value   0 or 1
+  * @retval 0
+  */
+static int pwrSetEnable(uint8_t pinNo, uint8_t value)
+{
+    const char      *name = (pinNo == OCP_MAIN_PWR_EN) ? "MAIN_EN" : "AUX_EN";
+
+    if ( readPin(pinNo) == value )
+        sprintf(outBfr, "%s is already %d", name, value);
+    else
     {
-        terminalOut((char *) "NIC card is not present; no power info available");
-        return(1);
+        writePin(pinNo, value);
+        sprintf(outBfr, "Set %s to %d", name, value);
     }
 
-    if (  mainPin == 1 &&  auxPin == 1 && pwrGoodPin )
-        isPowered = true;
+    SHOW();
+    return(0);
+}
 
-    if ( argCnt == 1 )
+static int pwrUpMain(int argCnt)    { return(pwrSetEnable(OCP_MAIN_PWR_EN, 1)); }
+static int pwrUpAux(int argCnt)     { return(pwrSetEnable(OCP_AUX_PWR_EN, 1)); }
+static int pwrDownMain(int argCnt)  { return(pwrSetEnable(OCP_MAIN_PWR_EN, 0)); }
+static int pwrDownAux(int argCnt)   { return(pwrSetEnable(OCP_AUX_PWR_EN, 0)); }
+
+/**
+  * @name   pwrUpCard
+  * @brief  'power up card': start the power up sequence
+  * @param  argCnt  not used
+  * @retval 0=OK 1=sequence already running
+  */
+static int pwrUpCard(int argCnt)
+{
+    if ( pwrIsPowered() )
     {
-        if ( strcmp(tokens[1], "status") == 0 )
-        {
-            sprintf(outBfr, "Status: NIC card is powered %s", (isPowered) ? "up" : "down");
-            SHOW();
-            return(rc);
-        }
-        else
-        {
-            terminalOut((char *) "Incorrect number of command arguments");
-            pwrCmdHelp();
-            return(1);
-        }
+        terminalOut((char *) "Power is already up on NIC card");
+        return(0);
+    }
+
+    if ( power_Up() == false )
+    {
+        sprintf(outBfr, "Power sequence already in progress; state = %s", power_GetStateName(power_GetState()));
+        SHOW();
+        return(1);
+    }
+
+    // power_Poll() completes the sequence from loop()
+    sprintf(outBfr, "Starting NIC power up sequence, delay = %d msec", EEPROMData.pwr_seq_delay_msec);
+    SHOW();
+    return(0);
+}
+
+/**
+  * @name   pwrDownCard
+  * @brief  'power down card': start the power down sequence
+  * @param  argCnt  not used
+  * @retval 0
+  */
+static int pwrDownCard(int argCnt)
+{
+    if ( pwrIsPowered() || power_GetState() != PWR_STATE_OFF )
+    {
+        // power_Poll() reports completion from loop()
+        power_Down();
+        terminalOut((char *) "Starting NIC power down sequence");
     }
-    else if ( argCnt != 2 )
+    else
+    {
+        terminalOut((char *) "Power is already down on NIC card");
+    }
+
+    return(0);
+}
+
+// 'power up|down <target>'
+static constexpr cli_subcmd_t   pwrUpCmds[] = {
+    {"aux",     pwrUpAux,       0, 0},
+    {"card",    pwrUpCard,      0, 0},
+    {"main",    pwrUpMain,      0, 0},
+};
+
+static constexpr cli_subcmd_t   pwrDownCmds[] = {
+    {"aux",     pwrDownAux,     0, 0},
+    {"card",    pwrDownCard,    0, 0},
+    {"main",    pwrDownMain,    0, 0},
+};
+
+CLI_SUBCMDS_SORTED(pwrUpCmds);
+CLI_SUBCMDS_SORTED(pwrDownCmds);
+
+static int pwrUp(int argCnt)
+{
+    return(pwrCardCheck() ? cli_RunSubCmd(pwrUpCmds, CLI_TABLE_COUNT(pwrUpCmds), 2, argCnt) : 1);
+}
+
+static int pwrDown(int argCnt)
+{
+    return(pwrCardCheck() ? cli_RunSubCmd(pwrDownCmds, CLI_TABLE_COUNT(pwrDownCmds), 2, argCnt) : 1);
+}
+
+/**
+  * @name   pwrStatus
+  * @brief  'power status'
+  * @param  argCnt  not used
+  * @retval 0=OK 1=no card
+  */
+static int pwrStatus(int argCnt)
+{
+    if ( pwrCardCheck() == false )
+        return(1);
+
+    sprintf(outBfr, "Status: NIC card is powered %s", (pwrIsPowered()) ? "up" : "down");
+    SHOW();
+    sprintf(outBfr, "Sequencer: %s for %lu msec", power_GetStateName(power_GetState()),
+            (unsigned long) power_GetStateMsecs());
+    SHOW();
+
+    if ( power_GetFault() != PWR_FAULT_NONE )
+    {
+        sprintf(outBfr, "Last fault: %s", power_GetFaultName(power_GetFault()));
+        SHOW();
+    }
+
+    return(0);
+}
+
+static int pwrTimingClear(int argCnt)
+{
+    power_ClearTiming();
+    terminalOut((char *) "Power timing history cleared");
+    return(0);
+}
+
+static constexpr cli_subcmd_t   pwrTimingCmds[] = {
+    {"clear",   pwrTimingClear, 0, 0},
+};
+
+/**
+  * @name   pwrTiming
+  * @brief  'power timing [clear]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int pwrTiming(int argCnt)
+{
+    if ( pwrCardCheck() == false )
+        return(1);
+
+    if ( argCnt == 1 )
+    {
+        power_ShowTiming();
+        return(0);
+    }
+
+    return(cli_RunSubCmd(pwrTimingCmds, CLI_TABLE_COUNT(pwrTimingCmds), 2, argCnt));
+}
+
+/**
+  * @name   pwrCycle
+  * @brief  'power cycle [<count> <on_ms> <off_ms>]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int pwrCycle(int argCnt)
+{
+    uint32_t        count;
+    uint32_t        onMsecs;
+    uint32_t        offMsecs;
+
+    if ( pwrCardCheck() == false )
+        return(1);
+
+    if ( argCnt == 1 )
+    {
+        power_ShowCycle();
+        return(0);
+    }
+
+    if ( argCnt != 4 )
     {
         terminalOut((char *) "Incorrect number of command arguments");
-        pwrCmdHelp();
+        return(CLI_SUBCMD_ERR);
+    }
+
+    count = strtoul(tokens[2], NULL, 10);
+    onMsecs = strtoul(tokens[3], NULL, 10);
+    offMsecs = strtoul(tokens[4], NULL, 10);
+
+    if ( count == 0 )
+    {
+        terminalOut((char *) "Cycle count must be at least 1");
         return(1);
     }
 
-    if ( strcmp(tokens[1], "up") == 0 )
+    if ( power_StartCycle(count, onMsecs, offMsecs) == false )
     {
-        if ( strcmp(tokens[2], "card") == 0 )
-        {
-            if ( isPowered == false )
-            {
-                sprintf(outBfr, "Starting NIC power up sequence, delay = %d msec", EEPROMData.pwr_seq_delay_msec);
-                SHOW();
-                writePin(OCP_MAIN_PWR_EN, 1);
-                delay(EEPROMData.pwr_seq_delay_msec);
-                writePin(OCP_AUX_PWR_EN, 1);
-
-                // NIC card takes a bit of time to power up
-                delay(50);
-                if ( readPin(NIC_PWR_GOOD_JMP) )
-                    terminalOut((char *) "Power up sequence complete");
-                else
-                {
-                    terminalOut((char *) "Power up sequence failed; NIC_PWR_GOOD = 0");
-                    return(1);
-                }
+        terminalOut((char *) "NIC card must be powered down to start a power cycle test");
+        return(1);
+    }
 
-                terminalOut((char *) "Waiting for scan chain data...");
-                delay(2000);
-                queryScanChain(false);
-                queryScanChain(true);
+    sprintf(outBfr, "Starting %lu power cycles, on %lu msec, off %lu msec; press any key to abort",
+            (unsigned long) count, (unsigned long) onMsecs, (unsigned long) offMsecs);
+    SHOW();
+    return(0);
+}
 
-            }
-            else
-            {
-                terminalOut((char *) "Power is already up on NIC card");
-            }
-        }
-        else if ( strcmp(tokens[2], "main") == 0 )
-        {
-            if ( mainPin == 1 )
-            {
-                terminalOut((char *) "MAIN_EN is already 1");
-                return(0);
-            }
-            else
-            {
-                writePin(OCP_MAIN_PWR_EN, 1);
-                terminalOut((char *) "Set MAIN_EN to 1");
-                return(0);
-            }
-        }
-        else if ( strcmp(tokens[2], "aux") == 0 )
-        {
-            if ( auxPin == 1 )
-            {
-                terminalOut((char *) "AUX_EN is already 1");
-                return(0);
-            }
-            else
-            {
-                writePin(OCP_AUX_PWR_EN, 1);
-                terminalOut((char *) "Set AUX_EN to 1");
-                return(0);
-            }
-        }
-        else
-        {
-            terminalOut((char *) "Invalid argument");
-            pwrCmdHelp();
-            return(1);
-        }
+static int pwrMeterClear(int argCnt)
+{
+    meter_Clear();
+    terminalOut((char *) "Power meter statistics cleared");
+    return(0);
+}
+
+static constexpr cli_subcmd_t   pwrMeterCmds[] = {
+    {"clear",   pwrMeterClear,  0, 0},
+};
+
+/**
+  * @name   pwrMeter
+  * @brief  'power meter [clear]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  * @note   also reads the rails with no card installed
+  */
+static int pwrMeter(int argCnt)
+{
+    if ( argCnt == 1 )
+    {
+        meter_Show();
+        return(0);
     }
-    else if ( strcmp(tokens[1], "down") == 0 )
+
+    return(cli_RunSubCmd(pwrMeterCmds, CLI_TABLE_COUNT(pwrMeterCmds), 2, argCnt));
+}
+
+static int pwrBurstArm(int argCnt)
+{
+    if ( meter_BurstArm() == false )
     {
-        if ( strcmp(tokens[2], "card") == 0 )
-        {
-            if ( isPowered == true )
-            {
-                writePin(OCP_MAIN_PWR_EN, 0);
-                writePin(OCP_AUX_PWR_EN, 0);
-                delay(100);
-                if ( readPin(NIC_PWR_GOOD_JMP) == 0 )
-                    terminalOut((char *) "Power down sequence complete");
-                else
-                    terminalOut((char *) "Power down failed; NIC_PWR_GOOD = 1");
-            }
-            else
-            {
-                terminalOut((char *) "Power is already down on NIC card");
-            }
-        }
-        else if ( strcmp(tokens[2], "main") == 0 )
-        {
-            if ( mainPin == 0 )
-            {
-                terminalOut((char *) "MAIN_PWR_EN is already 0");
-                return(0);
-            }
-            else
-            {
-                writePin(OCP_MAIN_PWR_EN, 0);
-                terminalOut((char *) "Set MAIN_PWR_EN to 0");
-                return(0);
-            }
-        }
-        else if ( strcmp(tokens[2], "aux") == 0 )
-        {
-            if ( auxPin == 0 )
-            {
-                terminalOut((char *) "AUX_PWR_EN is already 0");
-                return(0);
-            }
-            else
-            {
-                writePin(OCP_AUX_PWR_EN, 0);
-                terminalOut((char *) "Set AUX_PWR_EN to 0");
-                return(0);
-            }
-        }
-        else
-        {
-            terminalOut((char *) "Invalid argument");
-            pwrCmdHelp();
-            return(1);
-        }
+        terminalOut((char *) "Cannot arm: no INA219 present or not enough free RAM");
+        return(1);
     }
-    else
+
+    meter_BurstShow();
+    terminalOut((char *) "Capture starts on the next MAIN_EN or AUX_EN assertion");
+    return(0);
+}
+
+static int pwrBurstOff(int argCnt)
+{
+    meter_BurstDisarm();
+    meter_BurstShow();
+    return(0);
+}
+
+static int pwrBurstDump(int argCnt)
+{
+    meter_BurstDump();
+    return(0);
+}
+
+static constexpr cli_subcmd_t   pwrBurstCmds[] = {
+    {"arm",     pwrBurstArm,    0, 0},
+    {"dump",    pwrBurstDump,   0, 0},
+    {"off",     pwrBurstOff,    0, 0},
+};
+
+CLI_SUBCMDS_SORTED(pwrBurstCmds);
+
+/**
+  * @name   pwrBurst
+  * @brief  'power burst [arm|off|dump]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  * @note   works with no card installed
+  */
+static int pwrBurst(int argCnt)
+{
+    if ( argCnt == 1 )
     {
-        terminalOut((char *) "Invalid subcommand: use 'up', 'down' or 'status'");
-        rc = 1;
+        meter_BurstShow();
+        return(0);
     }
 
-    return(rc);
+    return(cli_RunSubCmd(pwrBurstCmds, CLI_TABLE_COUNT(pwrBurstCmds), 2, argCnt));
+}
+
+// 'power' subcommands, sorted by name
+static constexpr cli_subcmd_t   pwrCmds[] = {
+    {"burst",   pwrBurst,       0, 1},
+    {"cycle",   pwrCycle,       0, 3},
+    {"down",    pwrDown,        1, 1},
+    {"meter",   pwrMeter,       0, 1},
+    {"status",  pwrStatus,      0, 0},
+    {"timing",  pwrTiming,      0, 1},
+    {"up",      pwrUp,          1, 1},
+};
+
+CLI_SUBCMDS_SORTED(pwrCmds);
+
+/**
+  * @name   pwrCmd
+  * @brief  Control AUX and MAIN power to NIC 3.0 board
+  * @param  argCnt  number of arguments
+  * @param  tokens[1]  subcommand, see pwrCmds[]
+  * @param  tokens[2]  main, aux or card (up, down); clear (timing, meter);
+  *                    arm, off or dump (burst); count (cycle)
+  * @retval 0   OK
+  * @retval 1   error
+  * @note   Delay is changed with 'set pdelay <msec>'
+  */
+int pwrCmd(int argCnt)
+{
+    int             rc;
+
+    if ( argCnt == 0 )
+    {
+        pwrCmdHelp();
+        return(1);
+    }
+
+    rc = cli_RunSubCmd(pwrCmds, CLI_TABLE_COUNT(pwrCmds), 1, argCnt);
+
+    if ( rc == CLI_SUBCMD_ERR )
+        pwrCmdHelp();
+
+    return((rc == 0) ? 0 : 1);
 }
 
 /**
@@ -871,11 +1454,25 @@ int versCmd(int arg)
   */
 bool isCardPresent(void)
 {
-    uint8_t         present = readPin(OCP_PRSNTB0_N);
+    pin_snapshot_t  snap;
 
-    present |= (readPin(OCP_PRSNTB1_N) << 1);
-    present |= (readPin(OCP_PRSNTB2_N) << 2);
-    present |= (readPin(OCP_PRSNTB3_N) << 3);
+    takePinSnapshot(&snap);
+    return(isCardPresentIn(&snap));
+}
+
+/**
+  * @name   isCardPresentIn
+  * @brief  Determine if NIC card is present in a pin snapshot
+  * @param  snap    sample from takePinSnapshot()
+  * @retval true if card present, else false
+  */
+bool isCardPresentIn(const pin_snapshot_t *snap)
+{
+    uint8_t         present = snapshotPin(snap, OCP_PRSNTB0_N);
+
+    present |= (snapshotPin(snap, OCP_PRSNTB1_N) << 1);
+    present |= (snapshotPin(snap, OCP_PRSNTB2_N) << 2);
+    present |= (snapshotPin(snap, OCP_PRSNTB3_N) << 3);
 
     if ( present == 0xF )
         return(false);
@@ -884,22 +1481,310 @@ bool isCardPresent(void)
 }
 
 
+/**
+  * @name   scanCmdHelp
+  * @brief  display help for the scan command
+  * @param  None
+  * @retval None
+  */
+static void scanCmdHelp(void)
+{
+    terminalOut((char *) "Usage: scan [mode [spi | dma | tc5] | length [<bits> | auto] | bench]");
+    terminalOut((char *) "       scan [watch [<msecs> [quiet] | off] | log [clear]]");
+    terminalOut((char *) "  'scan' with no argument captures and displays the scan chain");
+    terminalOut((char *) "  'scan length' shows the chain length, or sets it in bits (1 to 256);");
+    terminalOut((char *) "     'auto' detects it by shifting a pattern out on SCAN_DATA_OUT");
+    terminalOut((char *) "  'scan mode' shows the capture mode, or selects one: spi = SERCOM polled,");
+    terminalOut((char *) "     dma = SERCOM + DMAC, tc5 = legacy TC5 bit-bang");
+    terminalOut((char *) "  'scan watch <msecs> [quiet]' samples in the background and streams changed");
+    terminalOut((char *) "     bits unless quiet; 'scan watch off' stops; 'scan watch' shows counters");
+    terminalOut((char *) "  'scan log' shows logged changes with timestamps; 'scan log clear' empties it");
+    terminalOut((char *) "  'scan bench' times captures in every mode");
+}
+
+/**
+  * @name   scanShowStats
+  * @brief  display capture time measurements for all modes
+  * @param  None
+  * @retval None
+  */
+static void scanShowStats(void)
+{
+    const scan_stats_t  *stats;
+
+    terminalOut((char *) "Mode  Captures  Capture usec (last/max)  CPU usec (last/max)");
+
+    for ( int mode = 0; mode < SCAN_MODE_COUNT; mode++ )
+    {
+        stats = scan_GetStats((SCAN_MODE) mode);
+        sprintf(outBfr, "%-4s %9lu  %10lu / %-10lu %8lu / %-8lu %s", scan_GetModeName((SCAN_MODE) mode),
+                (unsigned long) stats->captures, (unsigned long) stats->captureUsecs,
+                (unsigned long) stats->maxCaptureUsecs, (unsigned long) stats->cpuUsecs,
+                (unsigned long) stats->maxCpuUsecs, (mode == scan_GetMode()) ? "<" : " ");
+        SHOW();
+    }
+}
+
+/**
+  * @name   scanModeSet
+  * @brief  'scan mode spi|dma|tc5'
+  * @param  mode    capture mode to use
+  * @retval 0
+  */
+static int scanModeSet(SCAN_MODE mode)
+{
+    scan_SetMode(mode);
+    sprintf(outBfr, "Scan chain capture mode set to %s", scan_GetModeName(mode));
+    SHOW();
+    return(0);
+}
+
+static int scanModeDma(int argCnt)  { return(scanModeSet(SCAN_MODE_DMA)); }
+static int scanModeSpi(int argCnt)  { return(scanModeSet(SCAN_MODE_SPI)); }
+static int scanModeTc5(int argCnt)  { return(scanModeSet(SCAN_MODE_TC5)); }
+
+static constexpr cli_subcmd_t   scanModeCmds[] = {
+    {"dma",     scanModeDma,    0, 0},
+    {"spi",     scanModeSpi,    0, 0},
+    {"tc5",     scanModeTc5,    0, 0},
+};
+
+CLI_SUBCMDS_SORTED(scanModeCmds);
+
+/**
+  * @name   scanMode
+  * @brief  'scan mode [spi|dma|tc5]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int scanMode(int argCnt)
+{
+    if ( argCnt == 1 )
+    {
+        sprintf(outBfr, "Scan chain capture mode is %s", scan_GetModeName(scan_GetMode()));
+        SHOW();
+        scanShowStats();
+        return(0);
+    }
+
+    return(cli_RunSubCmd(scanModeCmds, CLI_TABLE_COUNT(scanModeCmds), 2, argCnt));
+}
+
+/**
+  * @name   scanLengthAuto
+  * @brief  'scan length auto'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=not detected
+  */
+static int scanLengthAuto(int argCnt)
+{
+    uint16_t        bits = scan_DetectLength();
+
+    if ( bits == 0 )
+    {
+        sprintf(outBfr, "Unable to detect scan chain length, still %d bits", scan_GetLength());
+        SHOW();
+        return(1);
+    }
+
+    scan_SetLength(bits);
+    sprintf(outBfr, "Detected scan chain length of %d bits", bits);
+    SHOW();
+    return(0);
+}
+
+static constexpr cli_subcmd_t   scanLengthCmds[] = {
+    {"auto",    scanLengthAuto, 0, 0},
+};
+
+/**
+  * @name   scanLength
+  * @brief  'scan length [<bits>|auto]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int scanLength(int argCnt)
+{
+    if ( argCnt == 1 )
+    {
+        sprintf(outBfr, "Scan chain length is %d bits", scan_GetLength());
+        SHOW();
+        return(0);
+    }
+
+    if ( isdigit(tokens[2][0]) == 0 )
+        return(cli_RunSubCmd(scanLengthCmds, CLI_TABLE_COUNT(scanLengthCmds), 2, argCnt));
+
+    if ( scan_SetLength(atoi(tokens[2])) == false )
+    {
+        terminalOut((char *) "Invalid length");
+        return(1);
+    }
+
+    sprintf(outBfr, "Scan chain length set to %d bits", scan_GetLength());
+    SHOW();
+    return(0);
+}
+
+/**
+  * @name   scanWatchStart
+  * @brief  'scan watch <msecs> [quiet]'
+  * @param  verbose false for quiet
+  * @retval 0=OK 1=error
+  */
+static int scanWatchStart(bool verbose)
+{
+    if ( scan_SetSamplePeriod(atoi(tokens[2]), verbose) == false )
+    {
+        sprintf(outBfr, "Invalid period, minimum is %d msecs", SCAN_MIN_SAMPLE_MSECS);
+        SHOW();
+        return(1);
+    }
+
+    scan_ShowSampling();
+    return(0);
+}
+
+static int scanWatchQuiet(int argCnt)
+{
+    return(scanWatchStart(false));
+}
+
+static int scanWatchOff(int argCnt)
+{
+    scan_SetSamplePeriod(0, false);
+    terminalOut((char *) "Scan chain sampling stopped, 'scan log' shows the changes");
+    return(0);
+}
+
+static constexpr cli_subcmd_t   scanWatchCmds[] = {
+    {"off",     scanWatchOff,   0, 0},
+};
+
+static constexpr cli_subcmd_t   scanWatchOpts[] = {
+    {"quiet",   scanWatchQuiet, 0, 0},
+};
+
+/**
+  * @name   scanWatch
+  * @brief  'scan watch [<msecs> [quiet] | off]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int scanWatch(int argCnt)
+{
+    if ( argCnt == 1 )
+    {
+        scan_ShowSampling();
+        return(0);
+    }
+
+    if ( isdigit(tokens[2][0]) == 0 )
+        return(cli_RunSubCmd(scanWatchCmds, CLI_TABLE_COUNT(scanWatchCmds), 2, argCnt));
+
+    if ( argCnt == 2 )
+        return(scanWatchStart(true));
+
+    return(cli_RunSubCmd(scanWatchOpts, CLI_TABLE_COUNT(scanWatchOpts), 3, argCnt));
+}
+
+static int scanLogClear(int argCnt)
+{
+    scan_ClearLog();
+    terminalOut((char *) "Scan chain log cleared");
+    return(0);
+}
+
+static constexpr cli_subcmd_t   scanLogCmds[] = {
+    {"clear",   scanLogClear,   0, 0},
+};
+
+/**
+  * @name   scanLog
+  * @brief  'scan log [clear]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int scanLog(int argCnt)
+{
+    if ( argCnt == 1 )
+    {
+        scan_ShowSampling();
+        scan_ShowLog();
+        return(0);
+    }
+
+    return(cli_RunSubCmd(scanLogCmds, CLI_TABLE_COUNT(scanLogCmds), 2, argCnt));
+}
+
+/**
+  * @name   scanBench
+  * @brief  'scan bench' times SCAN_BENCH_CAPTURES captures in every mode
+  * @param  argCnt  number of arguments
+  * @retval 0
+  */
+static int scanBench(int argCnt)
+{
+    SCAN_MODE       savedMode = scan_GetMode();
+
+    scan_ClearStats();
+
+    for ( int i = 0; i < SCAN_MODE_COUNT; i++ )
+    {
+        scan_SetMode((SCAN_MODE) i);
+
+        for ( int j = 0; j < SCAN_BENCH_CAPTURES; j++ )
+            (void) scan_Capture();
+    }
+
+    scan_SetMode(savedMode);
+    scanShowStats();
+    return(0);
+}
+
+static constexpr cli_subcmd_t   scanCmds[] = {
+    {"bench",   scanBench,      0, 0},
+    {"length",  scanLength,     0, 1},
+    {"log",     scanLog,        0, 1},
+    {"mode",    scanMode,       0, 1},
+    {"watch",   scanWatch,      0, 2},
+};
+
+CLI_SUBCMDS_SORTED(scanCmds);
+
 /**
   * @name   scanCmd
   * @brief  implement scan command
-  * @param  argCnt  not used
+  * @param  argCnt  number of arguments
+  * @param  tokens[1]  subcommand, see scanCmds[]
+  * @param  tokens[2]  spi, dma or tc5 (mode); bits or auto (length);
+  *                    msecs or off (watch); clear (log)
+  * @param  tokens[3]  quiet (watch only)
   * @retval int 0=OK, 1=error
   */
 int scanCmd(int argCnt)
 {
-    if ( isCardPresent() )
+    int             rc;
+
+    if ( isCardPresent() == false )
+    {
+        terminalOut((char *) "NIC card is not present; cannot query scan chain");
+        return(0);
+    }
+
+    if ( argCnt == 0 )
     {
         queryScanChain(true);
+        return(0);
     }
-    else
+
+    rc = cli_RunSubCmd(scanCmds, CLI_TABLE_COUNT(scanCmds), 1, argCnt);
+
+    if ( rc == CLI_SUBCMD_ERR )
     {
-        terminalOut((char *) "NIC card is not present; cannot query scan chain");
+        scanCmdHelp();
+        return(1);
     }
 
-    return(0);
-}
\ No newline at end of file
+    return(rc);
+}
@@ -4,61 +4,49 @@
 //===================================================================
 #include <Arduino.h>
 #include "main.hpp"
-#include "Wire.h"
 #include "eeprom.hpp"
+#include "fmt.hpp"
+#include "sched.hpp"
+#include "prof.hpp"
+#include "mem.hpp"
+#include "trace.hpp"
+#include "usbtx.hpp"
+#include "hal.hpp"
 
 extern uint8_t          eepromAddresses[];
 extern EEPROM_data_t    EEPROMData;
-static char             outBfr[OUTBFR_SIZE];
 extern char             *tokens[];
 
 // --------------------------------------------
-// dumpMem() - debug utility to dump memory
+// dumpMem() - debug utility to dump memory,
+// 16 bytes per line + ascii representation
 // --------------------------------------------
 void dumpMem(unsigned char *s, int len)
 {
-    char        lineBfr[100];
-    char        *t = lineBfr;
-    char        ascii[20];
-    char        *a = ascii;
-    int         lc = 0;
-    int         i = 0;
+    fmt_t       f;
+    int         lc;
 
-    while ( i < len )
+    while ( len > 0 )
     {
-        sprintf(t, "%02x ", *s);
-        t += 3;
-        i++;
+        lc = (len < 16) ? len : 16;
+        fmt_Start(&f, outBfr, OUTBFR_SIZE);
 
-        if ( isprint(*s) )
-            *a = *s;
-        else
-            *a = '.';
-
-        s++;
-        a++;
-
-        // 16 bytes per line + ascii representation
-        if ( ++lc == 16 )
+        for ( int i = 0; i < lc; i++ )
         {
-            *t = 0;
-            *a = 0;
-            sprintf(outBfr, "%s | %s |", lineBfr, ascii);
-            terminalOut(outBfr);
-
-            lc = 0;
-            t = lineBfr;
-            a = ascii;
+            fmt_Hex(&f, s[i], 2);
+            fmt_Char(&f, ' ');
         }
-    }
 
-    *t = 0;
-    *a = 0;
+        fmt_Str(&f, " | ");
 
-    if ( lineBfr[0] != 0 )
-    {
-        sprintf(outBfr, "%s | %s |", lineBfr, ascii);
+        for ( int i = 0; i < lc; i++ )
+            fmt_Char(&f, isprint(s[i]) ? s[i] : '.');
+
+        fmt_Str(&f, " |");
         terminalOut(outBfr);
+
+        s += lc;
+        len -= lc;
     }
 
 } // dumpMem()
@@ -74,7 +62,7 @@ void debug_scan(void)
 {
   byte        count = 0;
   int         scanCount = 0;
-  uint32_t    startTime = millis();
+  uint32_t    startTime = hal_Millis();
   const char        *s;
 
   terminalOut ((char *) "Scanning I2C bus...");
@@ -82,8 +70,7 @@ void debug_scan(void)
   for (byte i = 8; i < 120; i++)
   {
     scanCount++;
-    Wire.beginTransmission(i);
-    if (Wire.endTransmission() == 0)
+    if (hal_I2cWrite(i, NULL, 0))
     {
       if ( i == 0x40 )
         s = "U2 INA219";
@@ -106,11 +93,12 @@ void debug_scan(void)
       sprintf(outBfr, "Found device at address %d 0x%2X %s ", i, i, s);
       terminalOut(outBfr);
       count++;
-      delay(10);  
+      hal_Delay(10);  
     } 
   } 
 
-  sprintf(outBfr, "Scan complete, %d addresses scanned in %lu ms", scanCount, millis() - startTime);
+  sprintf(outBfr, "Scan complete, %d addresses scanned in %lu ms", scanCount,
+          (unsigned long) (hal_Millis() - startTime));
   terminalOut(outBfr);
 
   if ( count )
@@ -131,8 +119,9 @@ void debug_reset(void)
 {
     terminalOut((char *) "Board reset will disconnect USB-serial connection now.");
     terminalOut((char *) "Repeat whatever steps you took to connect to the board.");
-    delay(1000);
-    NVIC_SystemReset();
+    term_Flush();
+    hal_Delay(1000);
+    hal_Reset();
 }
 
 // --------------------------------------------
@@ -143,20 +132,366 @@ void debug_dump_eeprom(void)
     terminalOut((char *) "FLASH Contents:");
     sprintf(outBfr, "Signature:                            %08X", (unsigned int) EEPROMData.sig);
     terminalOut(outBfr);
-    sprintf(outBfr, "sdelay - status refresh delay (secs): %d", EEPROMData.status_delay_secs);
+    sprintf(outBfr, "speriod - status refresh (msec):      %d", EEPROMData.status_period_msec);
     SHOW();
     sprintf(outBfr, "pdelay - power delay (msec):          %d", EEPROMData.pwr_seq_delay_msec);
     SHOW();
+    sprintf(outBfr, "mperiod - power meter period (msec):  %d", EEPROMData.meter_period_msec);
+    SHOW();
 
     // TODO add more fields
 }
 
+// --------------------------------------------
+// debug_txbench() - terminal output throughput
+//
+// Queues 'lines' 64 char lines (tokens[2],
+// default 200) through terminalOut() and times
+// them until the last byte is taken by
+// SerialUSB. The old delay() based terminalOut()
+// managed at most 20 lines/s.
+// --------------------------------------------
+void debug_txbench(int arg)
+{
+    const term_stats_t  *stats = term_GetStats();
+    int                 lines = (arg >= 2) ? atoi(tokens[2]) : 200;
+    uint32_t            startTime;
+    uint32_t            elapsed;
+    uint32_t            sent;
+    uint32_t            dropped;
+
+    if ( lines <= 0 )
+    {
+        terminalOut((char *) "Usage: xdebug txbench [lines]");
+        return;
+    }
+
+    term_Flush();
+    sent = stats->sent;
+    dropped = stats->dropped;
+    startTime = hal_Micros();
+
+    for ( int i = 0; i < lines; i++ )
+    {
+        sprintf(outBfr, "txbench %5d ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz", i);
+        outBfr[64] = 0;
+        SHOW();
+    }
+
+    term_Flush();
+    elapsed = hal_Micros() - startTime;
+    sent = stats->sent - sent;
+    dropped = stats->dropped - dropped;
+
+    if ( elapsed == 0 )
+        elapsed = 1;
+
+    sprintf(outBfr, "%d lines, %lu bytes in %lu us: %lu lines/s, %lu bytes/s", lines, (unsigned long) sent,
+            (unsigned long) elapsed, (unsigned long) ((uint64_t) lines * 1000000 / elapsed),
+            (unsigned long) ((uint64_t) sent * 1000000 / elapsed));
+    SHOW();
+    sprintf(outBfr, "dropped %lu, stalls %lu, ring high water %u of %u", (unsigned long) dropped,
+            (unsigned long) stats->stalls, stats->highWater, TERM_TX_BFR_SIZE);
+    SHOW();
+}
+
+// --------------------------------------------
+// debug_usbbench() - raw CDC IN throughput
+//
+// Writes 'bytes' (tokens[2], default 65536) of
+// 64 char lines straight to SerialUSB, past the
+// terminal ring, and times them until the last
+// transmit bank has gone to the host.
+// --------------------------------------------
+static int debug_usbbench(int arg)
+{
+    const usbtx_stats_t *stats = usbtx_GetStats();
+    long                bytes = (arg >= 2) ? atol(tokens[2]) : 65536;
+    char                bfr[4 * 64];
+    uint32_t            startTime;
+    uint32_t            elapsed;
+    uint32_t            sent = 0;
+    uint32_t            transfers;
+    uint32_t            waits;
+    uint32_t            dropped;
+    uint32_t            len;
+
+    if ( bytes <= 0 )
+    {
+        terminalOut((char *) "Usage: xdebug usbbench [bytes]");
+        return(1);
+    }
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        memset(&bfr[i * 64], '0' + i, 62);
+        bfr[i * 64 + 62] = '\r';
+        bfr[i * 64 + 63] = '\n';
+    }
+
+    term_Flush();
+    transfers = stats->transfers;
+    waits = stats->waits;
+    dropped = stats->dropped;
+    startTime = hal_Micros();
+
+    while ( sent < (uint32_t) bytes )
+    {
+        len = (uint32_t) bytes - sent;
+        if ( len > sizeof(bfr) )
+            len = sizeof(bfr);
+
+        if ( hal_SerialWrite((const uint8_t *) bfr, len) != len )
+            break;
+
+        sent += len;
+    }
+
+    // wait for the last transfer, the banks drop data if the host stops
+    while ( usbtx_Pending() != 0 && hal_Micros() - startTime < 10000000UL )
+        ;
+
+    elapsed = hal_Micros() - startTime;
+
+    if ( elapsed == 0 )
+        elapsed = 1;
+
+    terminalOut((char *) " ");
+    sprintf(outBfr, "%lu bytes in %lu us: %lu KB/s", (unsigned long) sent, (unsigned long) elapsed,
+            (unsigned long) ((uint64_t) sent * 1000000 / 1024 / elapsed));
+    SHOW();
+    sprintf(outBfr, "%lu transfers of up to %u bytes, %lu waits for a free bank, %lu bytes dropped",
+            (unsigned long) (stats->transfers - transfers), USBTX_BANK_SIZE, (unsigned long) (stats->waits - waits),
+            (unsigned long) (stats->dropped - dropped));
+    SHOW();
+    sprintf(outBfr, "since boot: %lu requests, %lu rejected, queue high water %u of %u, %lu timeouts",
+            (unsigned long) stats->requests, (unsigned long) stats->rejected, stats->queueHighWater, USBTX_QUEUE_LEN,
+            (unsigned long) stats->timeouts);
+    SHOW();
+    return(0);
+}
+
+// --------------------------------------------
+// debug_fmtbench() - sprintf() vs fmt_xxx()
+//
+// Formats the same status-style line 'count'
+// times (tokens[2], default 1000) each way and
+// shows the time and CPU cycles per line.
+// Flash cost shows in the build's size output
+// with and without -u_printf_float.
+// --------------------------------------------
+static int debug_fmtbench(int arg)
+{
+    int             count = (arg >= 2) ? atoi(tokens[2]) : 1000;
+    char            bfr[2][MAX_LINE_SZ];
+    uint32_t        elapsed[2];
+    uint32_t        startTime;
+    uint32_t        v = hal_Micros();
+    fmt_t           f;
+
+    if ( count <= 0 )
+    {
+        terminalOut((char *) "Usage: xdebug fmtbench [count]");
+        return(1);
+    }
+
+    startTime = hal_Micros();
+
+    for ( int i = 0; i < count; i++ )
+        sprintf(bfr[0], "%-9s %6u mV %6ld mA 0x%08lx %4lu.%06lu Wh", "12V", i, (long) ((int32_t) -i),
+                (unsigned long) v, (unsigned long) (v / 1000000), (unsigned long) (v % 1000000));
+
+    elapsed[0] = hal_Micros() - startTime;
+    startTime = hal_Micros();
+
+    for ( int i = 0; i < count; i++ )
+    {
+        fmt_Start(&f, bfr[1], MAX_LINE_SZ);
+        fmt_Str(&f, "12V", -9);
+        fmt_Char(&f, ' ');
+        fmt_Uint(&f, i, 6);
+        fmt_Str(&f, " mV ");
+        fmt_Int(&f, -i, 6);
+        fmt_Str(&f, " mA 0x");
+        fmt_Hex(&f, v, 8);
+        fmt_Char(&f, ' ');
+        fmt_Fixed(&f, v, 6, 11);
+        fmt_Str(&f, " Wh");
+    }
+
+    elapsed[1] = hal_Micros() - startTime;
+
+    if ( strcmp(bfr[0], bfr[1]) != 0 )
+    {
+        terminalOut((char *) "Output differs:");
+        terminalOut(bfr[0]);
+        terminalOut(bfr[1]);
+        return(1);
+    }
+
+    for ( int j = 0; j < 2; j++ )
+    {
+        sprintf(outBfr, "%-8s %lu us for %d lines, %lu cycles/line", (j == 0) ? "sprintf" : "fmt",
+                (unsigned long) elapsed[j], count, (unsigned long) ((uint64_t) elapsed[j] * (F_CPU / 1000000) / count));
+        SHOW();
+    }
+
+    return(0);
+}
+
+// --------------------------------------------
+// debug_clitest() - check CLI command lookup
+// against a linear scan, tokens[2] random
+// words (default 1000)
+// --------------------------------------------
+static int debug_clitest(int arg)
+{
+    return((cli_SelfTest((arg >= 2) ? atoi(tokens[2]) : 1000) == 0) ? 0 : 1);
+}
+
+// --------------------------------------------
+// debug_tasks() - scheduler task run times,
+// 'xdebug tasks clear' zeroes them
+// --------------------------------------------
+static int debug_tasksClear(int arg)    { sched_ClearStats(); return(0); }
+
+static constexpr cli_subcmd_t   debugTasksCmds[] = {
+    {"clear",   debug_tasksClear,   0, 0},
+};
+
+static int debug_tasks(int arg)
+{
+    const sched_stats_t *stats;
+    uint32_t            window = sched_StatsUsecs();
+
+    if ( arg == 2 )
+    {
+        if ( cli_RunSubCmd(debugTasksCmds, CLI_TABLE_COUNT(debugTasksCmds), 2, arg) != 0 )
+        {
+            terminalOut((char *) "Usage: xdebug tasks [clear]");
+            return(1);
+        }
+
+        return(0);
+    }
+
+    if ( window == 0 )
+        window = 1;
+
+    terminalOut((char *) "task          runs   avg us   max us   late  cpu %");
+
+    for ( uint8_t i = 0; i < sched_TaskCount(); i++ )
+    {
+        stats = sched_GetStats(i);
+        sprintf(outBfr, "%-10s %7lu %8lu %8lu %6lu %6lu", sched_GetTask(i)->name, (unsigned long) stats->runs,
+                (unsigned long) ((stats->runs) ? stats->totalUsecs / stats->runs : 0), (unsigned long) stats->maxUsecs,
+                (unsigned long) stats->late, (unsigned long) ((uint64_t) stats->totalUsecs * 100 / window));
+        SHOW();
+    }
+
+    sprintf(outBfr, "over %lu ms; cli includes the commands it ran and the tasks they waited on",
+            (unsigned long) (window / 1000));
+    SHOW();
+    return(0);
+}
+
+// --------------------------------------------
+// debug_prof() - profiling sites, 'xdebug prof
+// clear' zeroes them
+// --------------------------------------------
+static int debug_profClear(int arg)     { prof_Clear(); return(0); }
+
+static constexpr cli_subcmd_t   debugProfCmds[] = {
+    {"clear",   debug_profClear,    0, 0},
+};
+
+static int debug_prof(int arg)
+{
+    if ( arg == 2 )
+    {
+        if ( cli_RunSubCmd(debugProfCmds, CLI_TABLE_COUNT(debugProfCmds), 2, arg) != 0 )
+        {
+            terminalOut((char *) "Usage: xdebug prof [clear]");
+            return(1);
+        }
+
+        return(0);
+    }
+
+    prof_Show();
+    return(0);
+}
+
+// --------------------------------------------
+// debug_trace() - dump the event trace, or
+// 'xdebug trace on|off|clear'
+// --------------------------------------------
+static int debug_traceClear(int arg)    { trace_Clear(); return(0); }
+static int debug_traceOff(int arg)      { trace_Enable(false); return(0); }
+static int debug_traceOn(int arg)       { trace_Enable(true); return(0); }
+
+static constexpr cli_subcmd_t   debugTraceCmds[] = {
+    {"clear",   debug_traceClear,   0, 0},
+    {"off",     debug_traceOff,     0, 0},
+    {"on",      debug_traceOn,      0, 0},
+};
+
+CLI_SUBCMDS_SORTED(debugTraceCmds);
+
+static int debug_trace(int arg)
+{
+    if ( arg == 2 )
+    {
+        if ( cli_RunSubCmd(debugTraceCmds, CLI_TABLE_COUNT(debugTraceCmds), 2, arg) != 0 )
+        {
+            terminalOut((char *) "Usage: xdebug trace [on|off|clear]");
+            return(1);
+        }
+
+        return(0);
+    }
+
+    trace_Dump();
+    return(0);
+}
+
+static int debug_scanCmd(int arg)       { debug_scan(); return(0); }
+static int debug_memCmd(int arg)        { mem_Show(); return(0); }
+static int debug_resetCmd(int arg)      { debug_reset(); return(0); }
+static int debug_flashCmd(int arg)      { debug_dump_eeprom(); return(0); }
+static int debug_txbenchCmd(int arg)    { debug_txbench(arg); return(0); }
+
+// xdebug subcommands, sorted by name
+static constexpr cli_subcmd_t   debugCmds[] = {
+    {"clitest", debug_clitest,      0, 1},
+    {"flash",   debug_flashCmd,     0, 0},
+    {"fmtbench", debug_fmtbench,    0, 1},
+    {"mem",     debug_memCmd,       0, 0},
+    {"prof",    debug_prof,         0, 1},
+    {"reset",   debug_resetCmd,     0, 0},
+    {"scan",    debug_scanCmd,      0, 0},
+    {"tasks",   debug_tasks,        0, 1},
+    {"trace",   debug_trace,        0, 1},
+    {"txbench", debug_txbenchCmd,   0, 1},
+    {"usbbench", debug_usbbench,    0, 1},
+};
+
+CLI_SUBCMDS_SORTED(debugCmds);
+
 static void debug_help(void)
 {
     terminalOut((char *) "xdebug subcommands are:");
-    terminalOut((char *) "\tscan ..... I2C bus scanner");
-    terminalOut((char *) "\treset .... Reset board, requires reconnection to serial");
+    terminalOut((char *) "\tclitest .. Check CLI command lookup, 'xdebug clitest [words]'");
     terminalOut((char *) "\tflash .... Dump FLASH-simulated EEPROM parameters");
+    terminalOut((char *) "\tfmtbench . Time sprintf() vs fmt formatting, 'xdebug fmtbench [count]'");
+    terminalOut((char *) "\tmem ...... SRAM use: .data, .bss, heap, stack peak, largest free block");
+    terminalOut((char *) "\tprof ..... Cycle timing of commands, ISRs and I2C, 'xdebug prof [clear]'");
+    terminalOut((char *) "\treset .... Reset board, requires reconnection to serial");
+    terminalOut((char *) "\tscan ..... I2C bus scanner");
+    terminalOut((char *) "\ttasks .... Scheduler task run times, 'xdebug tasks [clear]'");
+    terminalOut((char *) "\ttrace .... Event trace kept across reset, 'xdebug trace [on|off|clear]'");
+    terminalOut((char *) "\ttxbench .. Terminal output throughput, 'xdebug txbench [lines]'");
+    terminalOut((char *) "\tusbbench . Raw USB serial throughput in KB/s, 'xdebug usbbench [bytes]'");
 
     // add new command help here
     // NOTE: debug stuff is not part of CLI so
@@ -175,28 +510,23 @@ static void debug_help(void)
 // --------------------------------------------
 int debug(int arg)
 {
+    int         rc;
+
     if ( arg == 0 )
     {
         debug_help();
         return(0);
     }
 
-    // very simplistic 'parser' since debug is not part of the requirements
-    // add new 'else if ...' for a new debug command here, add help above,
-    // then add debug_<function>() function above debug() to avoid having to
-    // prototype that function.
-    if ( strcmp(tokens[1], "scan") == 0 )
-      debug_scan();
-    else if ( strcmp(tokens[1], "reset") == 0 )
-      debug_reset();
-    else if ( strcmp(tokens[1], "flash") == 0 )
-      debug_dump_eeprom();
-    else
+    // add new debug commands to debugCmds[] in name order, add help above,
+    // then add debug_<function>() function above debugCmds[]
+    rc = cli_RunSubCmd(debugCmds, CLI_TABLE_COUNT(debugCmds), 1, arg);
+
+    if ( rc == CLI_SUBCMD_ERR )
     {
-      terminalOut((char *) "Invalid debug command");
       debug_help();
       return(1);
     }
 
-    return(0);
+    return(rc);
 }
@@ -4,26 +4,32 @@
 //===================================================================
 #include <Arduino.h>
 #include "main.hpp"
-#include <Wire.h>
-#include "FlashAsEEPROM_SAMD.h"
 #include <time.h>
 #include "eeprom.hpp"
 #include "cli.hpp"
 #include "commands.hpp"
+#include "meter.hpp"
+#include "macro.hpp"
+#include "fmt.hpp"
+#include "prof.hpp"
+#include "hal.hpp"
 
 // uncomment line below to enable hex dumps of EEPROM regions
 //#define EEPROM_DEBUG 1
 
-extern const uint16_t   static_pin_count;
 extern char             *tokens[];
-static char             outBfr[OUTBFR_SIZE];
-const uint32_t          EEPROM_signature = 0xDE110C03;
+const uint32_t          EEPROM_signature = 0xDE110C05;
 uint8_t                 eepromAddresses[4] = {0x50, 0x52, 0x54, 0x56};      // NOTE: these DO NOT match Table 67
+static uint8_t          eepromI2CAddr = 0x52;                               // set by eepromCmd() for its subcommands
 const uint32_t          jan1996 = 820454400;                                // epoch time (secs) of 1/1/1996 00:00
 
 // FLASH/EEPROM Data buffer
 EEPROM_data_t           EEPROMData;
 
+static_assert(sizeof(EEPROM_data_t) <= EEPROM_USER_ADDR, "settings overlap the macro area");
+static_assert(MACRO_EEPROM_ADDR + sizeof(uint32_t) + MACRO_COUNT * sizeof(macro_t) <= HAL_NVM_SIZE,
+              "macros don't fit in simulated EEPROM");
+
 // FRU EEPROM stuff
 common_hdr_t            commonHeader;
 board_hdr_t             boardHeader;
@@ -52,21 +58,18 @@ byte              EEPROMBuffer[EEPROM_MAX_LEN];
   */
 void readEEPROM(uint8_t i2cAddr, uint32_t eeaddress, uint8_t *dest, uint16_t length)
 {
+  uint64_t      start = prof_Now();
+  uint8_t       addr[2];
+
   if ( length > EEPROM_MAX_LEN )
     length = EEPROM_MAX_LEN;
 
-  Wire.beginTransmission(i2cAddr);
-
-  Wire.write((int)(eeaddress >> 8));      // MSB
-  Wire.write((int)(eeaddress & 0xFF));    // LSB
-  Wire.endTransmission();
+  addr[0] = (uint8_t) (eeaddress >> 8);     // MSB
+  addr[1] = (uint8_t) (eeaddress & 0xFF);   // LSB
+  (void) hal_I2cWrite(i2cAddr, addr, 2);
+  (void) hal_I2cRead(i2cAddr, dest, length);
 
-  Wire.requestFrom(i2cAddr, length);
-
-  while ( Wire.available() && length-- > 0 ) 
-  {
-      *dest++  = Wire.read();
-  }
+  prof_Record(PROF_I2C_FRU, start);
 }
 
 // --------------------------------------------
@@ -83,17 +86,16 @@ void readEEPROM(uint8_t i2cAddr, uint32_t eeaddress, uint8_t *dest, uint16_t len
   */
 void writeEEPROMPage(uint8_t i2cAddr, long eeAddress, byte *buffer)
 {
+  uint64_t      start = prof_Now();
+  uint8_t       data[2 + MAX_I2C_WRITE];
 
-  Wire.beginTransmission(i2cAddr);
-
-  Wire.write((int)(eeAddress >> 8));        // MSB
-  Wire.write((int)(eeAddress & 0xFF));      // LSB
+  data[0] = (uint8_t) (eeAddress >> 8);     // MSB
+  data[1] = (uint8_t) (eeAddress & 0xFF);   // LSB
 
-  // Write bytes to EEPROM
-  for (byte x = 0 ; x < MAX_I2C_WRITE ; x++)
-    Wire.write(buffer[x]);                //Write the data
-
-  Wire.endTransmission();                 //Send stop condition
+  // address then data in one write, stop condition at the end
+  memcpy(&data[2], buffer, MAX_I2C_WRITE);
+  (void) hal_I2cWrite(i2cAddr, data, sizeof(data));
+  prof_Record(PROF_I2C_FRU, start);
 }
 
 // --------------------------------------------
@@ -195,11 +197,13 @@ uint16_t extractField(char *t, uint16_t field_offset)
     else
     {
         // binary or unspecified
-        strcpy(t, "Binary or unspecified format");
-        while ( field_length-- > 0 )
-        {
-            sprintf(t++, "%02X", EEPROMBuffer[field_offset++]);
-        }
+        fmt_t           f;
+
+        // two hex digits per byte
+        fmt_Start(&f, t, field_length * 2 + 1);
+
+        for ( uint16_t i = 0; i < field_length; i++ )
+            fmt_Hex(&f, EEPROMBuffer[field_offset + i], 2, true);
     }
 
     // adjust field offset for caller past field just processed
@@ -207,88 +211,74 @@ uint16_t extractField(char *t, uint16_t field_offset)
 }
 
 // --------------------------------------------
-// eepromCmd() - 'eeprom' command works on FRU
-// EEPROM only; simulated EEPROM is called 
-// FLASH to user.
+// eepromShowNum() - display a labeled number
+// and an optional note
 // --------------------------------------------
-int eepromCmd(int arg)
+static void eepromShowNum(const char *label, uint32_t v, const char *note)
 {
-    uint16_t          eepromAddr = 0;
-    uint8_t           eepromI2CAddr = 0x52;
-    char              tempStr[256];
-    uint16_t          field_offset;
-    uint8_t           slot;
-    uint32_t          deltaTime;
-    time_t            t;
+    fmt_t             f;
 
-    if ( isCardPresent() == false )
-    {
-        terminalOut((char *) "NIC card is not present; cannot query FRU EEPROM");
-        return(1);
-    }
+    fmt_Start(&f, outBfr, OUTBFR_SIZE);
+    fmt_Str(&f, label);
+    fmt_Uint(&f, v);
+    fmt_Str(&f, note);
+    SHOW();
+}
 
-    // read the slot ID, which determines the FRU EEPROM I2C address
-    // NOTE: Slot ID pins are tied to ground on TTF so zero here
-    // TODO: Use slot ID as board rev?
-    slot = 0;
+// --------------------------------------------
+// eepromShowText() - display a labeled string
+// --------------------------------------------
+static void eepromShowText(const char *label, const char *text)
+{
+    fmt_t             f;
 
-    if ( slot >= 0 && slot <= 3 )
-    {
-        eepromI2CAddr = eepromAddresses[slot];
-    }
-    else
+    fmt_Start(&f, outBfr, OUTBFR_SIZE);
+    fmt_Str(&f, label);
+    fmt_Str(&f, text);
+    SHOW();
+}
+
+// --------------------------------------------
+// eepromDump() - 'eeprom dump <offset> <length>'
+// dumps FRU EEPROM at offset for length bytes
+// --------------------------------------------
+static int eepromDump(int arg)
+{
+    uint16_t        offset = atoi(tokens[2]);
+    uint16_t        length = atoi(tokens[3]);
+
+    if ( offset > MAX_EEPROM_ADDR )
     {
-        terminalOut((char *) "Invalid slot ID, cannot determine EEPROM I2C address");
+        sprintf(outBfr, "offset of %d exceeds EEPROM capacity, use a smaller number", offset);
+        SHOW();
         return(1);
     }
 
-    if ( arg == 1 )
-    {
-        if ( strcmp(tokens[1], "show") != 0 )
-        {
-            terminalOut((char *) "Invalid subcommand, use 'show' to display EEPROM contents.");
-            return(1);
-        }
-    }
-    else if ( arg == 3 )
-    {
-        if ( strcmp(tokens[1], "dump") == 0 )
-        {
-            // 'eeprom dump <offset> <length>' command dumps FRU EEPROM at offset for length bytes
-            uint16_t        offset = atoi(tokens[2]);
-            uint16_t        length = atoi(tokens[3]);
-
-            if ( offset > MAX_EEPROM_ADDR )
-            {
-                sprintf(outBfr, "offset of %d exceeds EEPROM capacity, use a smaller number", offset);
-                SHOW();
-                return(1);
-            }
-
-            if ( length > (16 * 20) )
-            {
-                sprintf(outBfr, "length of %d exceeds maximum, use a smaller number", length);
-                SHOW();
-                return(1);
-            }
-
-            readEEPROM(eepromI2CAddr, offset, EEPROMBuffer, length);
-            dumpMem(EEPROMBuffer, length);
-            return(0);
-        }
-        else
-        {
-            sprintf(outBfr, "Invalid eeprom subcommand '%s'", tokens[1]);
-            SHOW();
-            return(1);
-        }
-    }
-    else
+    if ( length > (16 * 20) )
     {
-        showCommandHelp(tokens[0]);
+        sprintf(outBfr, "length of %d exceeds maximum, use a smaller number", length);
+        SHOW();
         return(1);
     }
 
+    readEEPROM(eepromI2CAddr, offset, EEPROMBuffer, length);
+    dumpMem(EEPROMBuffer, length);
+    return(0);
+}
+
+// --------------------------------------------
+// eepromShow() - 'eeprom show' displays the
+// common header and board info area
+// --------------------------------------------
+static int eepromShow(int arg)
+{
+    uint16_t          eepromAddr = 0;
+    char              tempStr[256];
+    uint16_t          field_offset;
+    uint32_t          deltaTime;
+    time_t            t;
+    fmt_t             f;
+
     // the first byte in the EEPROM should be a 1 which is the format version
     // TODO: this may evolve over time and the code below need to be refactored
     readEEPROM(eepromI2CAddr, 0, EEPROMBuffer, 1);
@@ -299,7 +289,9 @@ int eepromCmd(int arg)
         return(0);
     }
 
-    sprintf(outBfr, "FRU EEPROM found at SMB address 0x%02x", eepromI2CAddr);
+    fmt_Start(&f, outBfr, OUTBFR_SIZE);
+    fmt_Str(&f, "FRU EEPROM found at SMB address 0x");
+    fmt_Hex(&f, eepromI2CAddr, 2);
     SHOW();
 
     // read common header
@@ -309,8 +301,7 @@ int eepromCmd(int arg)
     dumpMem((unsigned char *) &commonHeader, sizeof(common_hdr_t));
 #endif
     terminalOut((char *) "--- COMMON HEADER DATA");
-    sprintf(outBfr, "Format version:  %d", commonHeader.format_vers & 0xF);
-    SHOW();
+    eepromShowNum("Format version:  ", commonHeader.format_vers & 0xF, "");
 
     // all area offsets in common area are x8 bytes
     EEPROMDescriptor.internal_area_offset_actual = commonHeader.internal_area_offset * 8;
@@ -319,20 +310,11 @@ int eepromCmd(int arg)
     EEPROMDescriptor.product_area_offset_actual = commonHeader.product_area_offset * 8;
     EEPROMDescriptor.multirecord_area_offset_actual = commonHeader.multirecord_area_offset * 8;
 
-    sprintf(outBfr, "Int Use Area:    %d",  EEPROMDescriptor.internal_area_offset_actual);
-    SHOW();
-
-    sprintf(outBfr, "Chassis Area:    %d", EEPROMDescriptor.chassis_area_offset_actual);
-    SHOW();
-
-    sprintf(outBfr, "Board Area:      %d", EEPROMDescriptor.board_area_offset_actual);
-    SHOW();
-
-    sprintf(outBfr, "Product Area:    %d (not supported)", EEPROMDescriptor.product_area_offset_actual);
-    SHOW();
-
-    sprintf(outBfr, "MRecord Area:    %d (not supported)", EEPROMDescriptor.multirecord_area_offset_actual);
-    SHOW();
+    eepromShowNum("Int Use Area:    ", EEPROMDescriptor.internal_area_offset_actual, "");
+    eepromShowNum("Chassis Area:    ", EEPROMDescriptor.chassis_area_offset_actual, "");
+    eepromShowNum("Board Area:      ", EEPROMDescriptor.board_area_offset_actual, "");
+    eepromShowNum("Product Area:    ", EEPROMDescriptor.product_area_offset_actual, " (not supported)");
+    eepromShowNum("MRecord Area:    ", EEPROMDescriptor.multirecord_area_offset_actual, " (not supported)");
 
     // read first 7 bytes of board info area "header" to determine length
     eepromAddr = EEPROMDescriptor.board_area_offset_actual;
@@ -343,7 +325,9 @@ int eepromCmd(int arg)
     EEPROMDescriptor.board_area_length = boardHeader.board_area_length * 8;
 
     terminalOut((char *) "--- BOARD AREA DATA");
-    sprintf(outBfr, "Language Code:   %02X", boardHeader.language);
+    fmt_Start(&f, outBfr, OUTBFR_SIZE);
+    fmt_Str(&f, "Language Code:   ");
+    fmt_Hex(&f, boardHeader.language, 2, true);
     SHOW();
 
     // format manufacturing date/time
@@ -353,11 +337,8 @@ int eepromCmd(int arg)
     t = deltaTime;
     strcpy(tempStr, asctime(gmtime(&t)));
     tempStr[strcspn(tempStr, "\n")] = 0;
-    sprintf(outBfr, "Mfg Date/Time:   %s", tempStr);
-    SHOW();
-
-    sprintf(outBfr, "Bd Area Length:  %d", EEPROMDescriptor.board_area_length);
-    SHOW();
+    eepromShowText("Mfg Date/Time:   ", tempStr);
+    eepromShowNum("Bd Area Length:  ", EEPROMDescriptor.board_area_length, "");
 
     // read the entire board area
     eepromAddr += sizeof(board_hdr_t);
@@ -369,28 +350,23 @@ int eepromCmd(int arg)
 
     // extract manufacturer name; type/lenth is last item in board header
     field_offset = extractField(tempStr, field_offset);
-    sprintf(outBfr, "Manufacturer:    %s", tempStr);
-    SHOW();
+    eepromShowText("Manufacturer:    ", tempStr);
 
     // extract the next field: product name
     field_offset = extractField(tempStr, field_offset);
-    sprintf(outBfr, "Product Name:    %s", tempStr);
-    SHOW();
+    eepromShowText("Product Name:    ", tempStr);
 
     // extract the next field: serial number
     field_offset = extractField(tempStr, field_offset);
-    sprintf(outBfr, "Serial Number:   %s", tempStr);
-    SHOW();
+    eepromShowText("Serial Number:   ", tempStr);
 
     // extract the next field: part #
     field_offset = extractField(tempStr, field_offset);
-    sprintf(outBfr, "Part Number:     %s", tempStr);
-    SHOW();
+    eepromShowText("Part Number:     ", tempStr);
 
     // FRU File ID
     field_offset = extractField(tempStr, field_offset);
-    sprintf(outBfr, "FRU File ID:     %s", tempStr);
-    SHOW();
+    eepromShowText("FRU File ID:     ", tempStr);
 
     // NOTE: Custom product info area fields are NOT processed
     // nor is the check for the 0xC1 terminator checked
@@ -421,6 +397,61 @@ int eepromCmd(int arg)
     return(0);
 }
 
+static constexpr cli_subcmd_t   eepromCmds[] = {
+    {"dump",    eepromDump,     2, 2},
+    {"show",    eepromShow,     0, 0},
+};
+
+CLI_SUBCMDS_SORTED(eepromCmds);
+
+// --------------------------------------------
+// eepromCmd() - 'eeprom' command works on FRU
+// EEPROM only; simulated EEPROM is called 
+// FLASH to user.
+// --------------------------------------------
+int eepromCmd(int arg)
+{
+    uint8_t           slot;
+    int               rc;
+
+    if ( isCardPresent() == false )
+    {
+        terminalOut((char *) "NIC card is not present; cannot query FRU EEPROM");
+        return(1);
+    }
+
+    // read the slot ID, which determines the FRU EEPROM I2C address
+    // NOTE: Slot ID pins are tied to ground on TTF so zero here
+    // TODO: Use slot ID as board rev?
+    slot = 0;
+
+    if ( slot >= 0 && slot <= 3 )
+    {
+        eepromI2CAddr = eepromAddresses[slot];
+    }
+    else
+    {
+        terminalOut((char *) "Invalid slot ID, cannot determine EEPROM I2C address");
+        return(1);
+    }
+
+    if ( arg == 0 )
+    {
+        showCommandHelp(tokens[0]);
+        return(1);
+    }
+
+    rc = cli_RunSubCmd(eepromCmds, CLI_TABLE_COUNT(eepromCmds), 1, arg);
+
+    if ( rc == CLI_SUBCMD_ERR )
+    {
+        showCommandHelp(tokens[0]);
+        return(1);
+    }
+
+    return(rc);
+}
+
 // --------------------------------------------
 // EEPROM_Save() - write EEPROM structure to
 // the simulated EEPROM
@@ -432,10 +463,44 @@ void EEPROM_Save(void)
 
     for ( int i = 0; i < (int) sizeof(EEPROM_data_t); i++ )
     {
-        EEPROM.write(eepromAddr++, *p++);
+        hal_NvmWrite(eepromAddr++, *p++);
     }
     
-    EEPROM.commit();
+    hal_NvmCommit();
+}
+
+// --------------------------------------------
+// EEPROM_ReadBytes() - Read bytes past the
+// settings struct from simulated EEPROM
+// --------------------------------------------
+void EEPROM_ReadBytes(uint16_t eepromAddr, uint8_t *dest, uint16_t length)
+{
+    while ( length-- > 0 )
+    {
+        *dest++ = hal_NvmRead(eepromAddr++);
+    }
+}
+
+// --------------------------------------------
+// EEPROM_WriteBytes() - Write bytes past the
+// settings struct to simulated EEPROM; they
+// reach FLASH at EEPROM_Commit()
+// --------------------------------------------
+void EEPROM_WriteBytes(uint16_t eepromAddr, const uint8_t *src, uint16_t length)
+{
+    while ( length-- > 0 )
+    {
+        hal_NvmWrite(eepromAddr++, *src++);
+    }
+}
+
+// --------------------------------------------
+// EEPROM_Commit() - Write simulated EEPROM to
+// FLASH after EEPROM_WriteBytes() calls
+// --------------------------------------------
+void EEPROM_Commit(void)
+{
+    hal_NvmCommit();
 }
 
 // --------------------------------------------
@@ -449,7 +514,7 @@ void EEPROM_Read(void)
 
     for ( int i = 0; i < (int) sizeof(EEPROM_data_t); i++ )
     {
-        *p++ = EEPROM.read(eepromAddr++);
+        *p++ = hal_NvmRead(eepromAddr++);
     }
 }
 
@@ -459,8 +524,9 @@ void EEPROM_Read(void)
 void EEPROM_Defaults(void)
 {
     EEPROMData.sig = EEPROM_signature;
-    EEPROMData.status_delay_secs = 3;
+    EEPROMData.status_period_msec = STATUS_DEFAULT_PERIOD_MSEC;
     EEPROMData.pwr_seq_delay_msec = 250;
+    EEPROMData.meter_period_msec = METER_DEFAULT_PERIOD_MSEC;
 
     // TODO add other fields
 }
@@ -0,0 +1,250 @@
+//===================================================================
+// fmt.cpp
+//
+// Integer, hex, fixed point and padded string formatting for the
+// output paths that run all the time (status screen, scan chain,
+// memory dumps, FRU EEPROM display).  newlib sprintf() parses its
+// format at run time and divides with __aeabi_uidiv for every digit;
+// the M0+ has no divide instruction, so decimal digits here are made
+// by subtracting powers of ten instead.  'xdebug fmtbench' compares
+// the two on the board.
+//===================================================================
+#include <Arduino.h>
+#include "fmt.hpp"
+
+#define FMT_DIGITS_MAX          10          // 4294967295
+
+static const uint32_t   pow10[FMT_DIGITS_MAX] = {
+    1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1
+};
+
+/**
+  * @name   fmt_Digits
+  * @brief  convert to decimal digits without dividing
+  * @param  v       value
+  * @param  digits  output, FMT_DIGITS_MAX chars, not terminated
+  * @retval number of digits, at least 1
+  */
+static int fmt_Digits(uint32_t v, char *digits)
+{
+    int             n = 0;
+    char            d;
+
+    for ( int i = 0; i < FMT_DIGITS_MAX; i++ )
+    {
+        d = '0';
+
+        while ( v >= pow10[i] )
+        {
+            v -= pow10[i];
+            d++;
+        }
+
+        if ( d != '0' || n != 0 || i == FMT_DIGITS_MAX - 1 )
+            digits[n++] = d;
+    }
+
+    return(n);
+}
+
+/**
+  * @name   fmt_Fill
+  * @brief  append 'count' copies of a char
+  * @param  f
+  * @param  c
+  * @param  count   nothing if <= 0
+  * @retval None
+  */
+static void fmt_Fill(fmt_t *f, char c, int count)
+{
+    while ( count-- > 0 )
+        fmt_Char(f, c);
+}
+
+/**
+  * @name   fmt_Chars
+  * @brief  append 'len' chars
+  * @param  f
+  * @param  s
+  * @param  len
+  * @retval None
+  */
+static void fmt_Chars(fmt_t *f, const char *s, int len)
+{
+    while ( len-- > 0 )
+        fmt_Char(f, *s++);
+}
+
+/**
+  * @name   fmt_Start
+  * @brief  start a line in a buffer
+  * @param  f
+  * @param  bfr
+  * @param  size    bytes in bfr, including the terminator
+  * @retval bfr
+  */
+char *fmt_Start(fmt_t *f, char *bfr, int size)
+{
+    f->bfr = bfr;
+    f->s = bfr;
+    f->end = bfr + size - 1;
+    *bfr = 0;
+    return(bfr);
+}
+
+/**
+  * @name   fmt_Char
+  * @brief  append a char
+  * @param  f
+  * @param  c
+  * @retval None
+  */
+void fmt_Char(fmt_t *f, char c)
+{
+    if ( f->s < f->end )
+    {
+        *f->s++ = c;
+        *f->s = 0;
+    }
+}
+
+/**
+  * @name   fmt_Str
+  * @brief  append a string, like "%*s"
+  * @param  f
+  * @param  str
+  * @param  width   > 0 pads on the left, < 0 pads on the right
+  * @retval None
+  */
+void fmt_Str(fmt_t *f, const char *str, int width)
+{
+    int             len = strlen(str);
+
+    if ( width > 0 )
+        fmt_Fill(f, ' ', width - len);
+
+    fmt_Chars(f, str, len);
+
+    if ( width < 0 )
+        fmt_Fill(f, ' ', -width - len);
+}
+
+/**
+  * @name   fmt_Uint
+  * @brief  append unsigned decimal, like "%*lu" or "%0*lu"
+  * @param  f
+  * @param  v
+  * @param  width   minimum field width
+  * @param  pad     ' ' or '0'
+  * @retval None
+  */
+void fmt_Uint(fmt_t *f, uint32_t v, int width, char pad)
+{
+    char            digits[FMT_DIGITS_MAX];
+    int             n = fmt_Digits(v, digits);
+
+    fmt_Fill(f, pad, width - n);
+    fmt_Chars(f, digits, n);
+}
+
+/**
+  * @name   fmt_Int
+  * @brief  append signed decimal, like "%*ld"
+  * @param  f
+  * @param  v
+  * @param  width   minimum field width, including the sign
+  * @retval None
+  */
+void fmt_Int(fmt_t *f, int32_t v, int width)
+{
+    char            digits[FMT_DIGITS_MAX];
+    int             n = fmt_Digits((v < 0) ? 0 - (uint32_t) v : (uint32_t) v, digits);
+
+    fmt_Fill(f, ' ', width - n - ((v < 0) ? 1 : 0));
+
+    if ( v < 0 )
+        fmt_Char(f, '-');
+
+    fmt_Chars(f, digits, n);
+}
+
+/**
+  * @name   fmt_Hex
+  * @brief  append hex, like "%0*lx" or "%0*lX"
+  * @param  f
+  * @param  v
+  * @param  digits  minimum digits, zero padded
+  * @param  upper   true for A-F
+  * @retval None
+  */
+void fmt_Hex(fmt_t *f, uint32_t v, int digits, bool upper)
+{
+    const char      *hex = (upper) ? "0123456789ABCDEF" : "0123456789abcdef";
+    int             n = 8;
+
+    // drop leading zero nibbles beyond 'digits'
+    while ( n > 1 && n > digits && (v >> ((n - 1) * 4)) == 0 )
+        n--;
+
+    fmt_Fill(f, '0', digits - 8);
+
+    while ( n-- > 0 )
+        fmt_Char(f, hex[(v >> (n * 4)) & 0xF]);
+}
+
+/**
+  * @name   fmt_Fixed
+  * @brief  append a fixed point value, like "%lu.%0*lu"
+  * @param  f
+  * @param  v         value in units of 10^-decimals
+  * @param  decimals  digits after the point, 1..9
+  * @param  width     minimum field width, including the point
+  * @retval None
+  * @note   fmt_Fixed(&f, 1234567, 6, 11) gives "   1.234567"
+  */
+void fmt_Fixed(fmt_t *f, uint32_t v, int decimals, int width)
+{
+    char            digits[FMT_DIGITS_MAX];
+    int             n = fmt_Digits(v, digits);
+    int             zeros = (decimals + 1 > n) ? decimals + 1 - n : 0;
+
+    fmt_Fill(f, ' ', width - (n + zeros + 1));
+
+    // integer part, which is "0" when v < 10^decimals
+    if ( zeros )
+    {
+        fmt_Char(f, '0');
+        fmt_Char(f, '.');
+        fmt_Fill(f, '0', zeros - 1);
+        fmt_Chars(f, digits, n);
+    }
+    else
+    {
+        fmt_Chars(f, digits, n - decimals);
+        fmt_Char(f, '.');
+        fmt_Chars(f, &digits[n - decimals], decimals);
+    }
+}
+
+/**
+  * @name   fmt_PadTo
+  * @brief  pad with spaces up to a column
+  * @param  f
+  * @param  col     0 based
+  * @retval None
+  */
+void fmt_PadTo(fmt_t *f, int col)
+{
+    fmt_Fill(f, ' ', col - fmt_Len(f));
+}
+
+/**
+  * @name   fmt_Len
+  * @brief  length of the line so far
+  * @param  f
+  * @retval chars
+  */
+int fmt_Len(const fmt_t *f)
+{
+    return(f->s - f->bfr);
+}
@@ -0,0 +1,442 @@
+//===================================================================
+// hal_samd21.cpp
+//
+// Board implementation of hal.hpp on the Arduino SAMD core and the
+// 'ttf' variant.cpp.  The native build leaves this file out and uses
+// lib/ttfsim instead, see [env:native] in platformio.ini.
+//===================================================================
+#include <Arduino.h>
+#include <Wire.h>
+#include "FlashAsEEPROM_SAMD.h"
+#include "hal.hpp"
+
+static_assert(HAL_NVM_SIZE == EEPROM_EMULATION_SIZE, "HAL_NVM_SIZE must match FlashStorage_SAMD");
+static_assert(HAL_EXTINT_NONE == EXTERNAL_INT_NONE, "HAL_EXTINT_NONE must match variant.cpp");
+
+extern "C" char             *sbrk(int incr);
+
+//===================================================================
+//                              PINS
+//===================================================================
+
+/**
+  * @name   hal_PinMode
+  * @brief  set pin direction and pull
+  * @param  pinNo   Arduino pin number
+  * @param  mode    INPUT, OUTPUT, INPUT_PULLUP or INPUT_PULLDOWN
+  * @retval None
+  */
+void hal_PinMode(uint8_t pinNo, uint8_t mode)
+{
+    pinMode(pinNo, mode);
+}
+
+/**
+  * @name   hal_PinWrite
+  * @brief  drive an output pin
+  * @param  pinNo   Arduino pin number
+  * @param  level   0 or 1
+  * @retval None
+  */
+void hal_PinWrite(uint8_t pinNo, uint8_t level)
+{
+    digitalWrite(pinNo, level);
+}
+
+/**
+  * @name   hal_PinRead
+  * @brief  read a pin
+  * @param  pinNo   Arduino pin number
+  * @retval 0 or 1
+  */
+uint8_t hal_PinRead(uint8_t pinNo)
+{
+    return((digitalRead(pinNo) == HIGH) ? 1 : 0);
+}
+
+/**
+  * @name   hal_PortIn
+  * @brief  read a PORT group IN register
+  * @param  group   0 = PA, 1 = PB
+  * @retval pin levels, bit n = Pxn
+  */
+uint32_t hal_PortIn(uint8_t group)
+{
+    return(PORT->Group[group].IN.reg);
+}
+
+/**
+  * @name   hal_PinHighDrive
+  * @brief  set the strong drive (7mA source, 10mA sink) on a pin
+  * @param  pinNo   Arduino pin number
+  * @retval None
+  */
+void hal_PinHighDrive(uint8_t pinNo)
+{
+    PORT->Group[g_APinDescription[pinNo].ulPort].PINCFG[g_APinDescription[pinNo].ulPin].bit.DRVSTR = 1;
+}
+
+/**
+  * @name   hal_PinPort
+  * @brief  PORT group and bit of a pin from variant.cpp
+  * @param  pinNo   Arduino pin number
+  * @param  group   output, 0 = PA, 1 = PB
+  * @param  bit     output, 0..31
+  * @retval None
+  */
+void hal_PinPort(uint8_t pinNo, uint8_t *group, uint8_t *bit)
+{
+    *group = g_APinDescription[pinNo].ulPort;
+    *bit = g_APinDescription[pinNo].ulPin;
+}
+
+/**
+  * @name   hal_PinExtInt
+  * @brief  EIC line of a pin from variant.cpp
+  * @param  pinNo   Arduino pin number
+  * @retval line or HAL_EXTINT_NONE
+  */
+int hal_PinExtInt(uint8_t pinNo)
+{
+    return(g_APinDescription[pinNo].ulExtInt);
+}
+
+/**
+  * @name   hal_PinAttach
+  * @brief  call 'isr' on both edges of a pin
+  * @param  pinNo   Arduino pin number with an EXTINT line
+  * @param  isr     runs in EIC interrupt context
+  * @retval None
+  */
+void hal_PinAttach(uint8_t pinNo, hal_isr_t isr)
+{
+    attachInterrupt(digitalPinToInterrupt(pinNo), isr, CHANGE);
+}
+
+//===================================================================
+//                              TIME
+//===================================================================
+
+/**
+  * @name   hal_Millis
+  * @brief  msecs since reset
+  */
+uint32_t hal_Millis(void)
+{
+    return(millis());
+}
+
+/**
+  * @name   hal_Micros
+  * @brief  usecs since reset
+  */
+uint32_t hal_Micros(void)
+{
+    return(micros());
+}
+
+/**
+  * @name   hal_Cycles
+  * @brief  CPU cycles since reset
+  * @param  None
+  * @retval cycles
+  * @note   the M0+ has no DWT cycle counter.  SysTick counts CPU
+  *         clocks down from LOAD once per millisecond, so millis() *
+  *         (LOAD + 1) plus the clocks elapsed in the current tick is
+  *         the count.  A tick that is pending but not yet counted (read
+  *         from an ISR, or with interrupts off) is detected from
+  *         SCB->ICSR, so this is exact in any context.
+  */
+uint64_t hal_Cycles(void)
+{
+    uint32_t        primask = __get_PRIMASK();
+    uint32_t        load = SysTick->LOAD;
+    uint32_t        msecs;
+    uint32_t        val;
+
+    __disable_irq();
+    msecs = millis();
+    val = SysTick->VAL;
+
+    // counter reloaded but the tick interrupt has not run yet
+    if ( (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) && val > load / 2 )
+        msecs++;
+
+    __set_PRIMASK(primask);
+
+    return((uint64_t) msecs * (load + 1) + (load - val));
+}
+
+/**
+  * @name   hal_Delay
+  * @brief  busy wait
+  * @param  msecs
+  * @retval None
+  */
+void hal_Delay(uint32_t msecs)
+{
+    delay(msecs);
+}
+
+/**
+  * @name   hal_DelayUsecs
+  * @brief  busy wait
+  * @param  usecs
+  * @retval None
+  */
+void hal_DelayUsecs(uint32_t usecs)
+{
+    delayMicroseconds(usecs);
+}
+
+//===================================================================
+//                        INTERRUPT MASKING
+//===================================================================
+
+/**
+  * @name   hal_IrqOff
+  * @brief  disable interrupts, see hal_IrqOn()
+  */
+void hal_IrqOff(void)
+{
+    noInterrupts();
+}
+
+/**
+  * @name   hal_IrqOn
+  * @brief  enable interrupts
+  */
+void hal_IrqOn(void)
+{
+    interrupts();
+}
+
+/**
+  * @name   hal_IrqSave
+  * @brief  disable interrupts, callable with them already off
+  * @param  None
+  * @retval state for hal_IrqRestore()
+  */
+uint32_t hal_IrqSave(void)
+{
+    uint32_t        primask = __get_PRIMASK();
+
+    __disable_irq();
+    return(primask);
+}
+
+/**
+  * @name   hal_IrqRestore
+  * @brief  restore the interrupt state from hal_IrqSave()
+  */
+void hal_IrqRestore(uint32_t state)
+{
+    __set_PRIMASK(state);
+}
+
+/**
+  * @name   hal_Barrier
+  * @brief  complete memory writes before the ones that follow
+  */
+void hal_Barrier(void)
+{
+    __DMB();
+}
+
+//===================================================================
+//                               I2C
+//===================================================================
+
+/**
+  * @name   hal_I2cBegin
+  * @brief  start the I2C master
+  */
+void hal_I2cBegin(void)
+{
+    Wire.begin();
+}
+
+/**
+  * @name   hal_I2cSetClock
+  * @brief  set the I2C clock
+  * @param  hz
+  * @retval None
+  */
+void hal_I2cSetClock(uint32_t hz)
+{
+    Wire.setClock(hz);
+}
+
+/**
+  * @name   hal_I2cWrite
+  * @brief  write bytes to a device, then stop
+  * @param  i2cAddr 7-bit address
+  * @param  data    bytes to write
+  * @param  len     number of bytes, 0 just checks for an ACK
+  * @retval true if the device ACKed everything
+  */
+bool hal_I2cWrite(uint8_t i2cAddr, const uint8_t *data, uint16_t len)
+{
+    Wire.beginTransmission(i2cAddr);
+
+    if ( len )
+        Wire.write(data, len);
+
+    return(Wire.endTransmission() == 0);
+}
+
+/**
+  * @name   hal_I2cRead
+  * @brief  read bytes from a device, then stop
+  * @param  i2cAddr 7-bit address
+  * @param  data    where to put them
+  * @param  len     number of bytes, at most 256
+  * @retval number of bytes read
+  */
+uint16_t hal_I2cRead(uint8_t i2cAddr, uint8_t *data, uint16_t len)
+{
+    uint16_t        count = 0;
+
+    Wire.requestFrom(i2cAddr, (size_t) len);
+
+    while ( Wire.available() && count < len )
+        data[count++] = Wire.read();
+
+    return(count);
+}
+
+//===================================================================
+//                           USB SERIAL
+//===================================================================
+
+/**
+  * @name   hal_SerialBegin
+  * @brief  start the USB CDC port
+  * @note   baud rate does not apply to USB
+  */
+void hal_SerialBegin(void)
+{
+    SerialUSB.begin(115200);
+}
+
+/**
+  * @name   hal_SerialConnected
+  * @brief  check for a host with the port open
+  */
+bool hal_SerialConnected(void)
+{
+    return(SerialUSB);
+}
+
+/**
+  * @name   hal_SerialDtr
+  * @brief  get the host's DTR, low when the port is closed
+  */
+bool hal_SerialDtr(void)
+{
+    return(SerialUSB.dtr());
+}
+
+/**
+  * @name   hal_SerialAvailable
+  * @brief  get the number of received bytes not yet read
+  */
+int hal_SerialAvailable(void)
+{
+    return(SerialUSB.available());
+}
+
+/**
+  * @name   hal_SerialRead
+  * @brief  read a received byte
+  * @retval byte or -1 if none
+  */
+int hal_SerialRead(void)
+{
+    return(SerialUSB.read());
+}
+
+/**
+  * @name   hal_SerialWrite
+  * @brief  send bytes, waiting for room in the transmit banks
+  * @param  data
+  * @param  len
+  * @retval bytes sent, less than len if the host stopped reading
+  */
+uint32_t hal_SerialWrite(const uint8_t *data, uint32_t len)
+{
+    return(SerialUSB.write(data, len));
+}
+
+//===================================================================
+//                      FLASH SIMULATED EEPROM
+//===================================================================
+
+/**
+  * @name   hal_NvmRead
+  * @brief  read a byte
+  * @param  addr    0..HAL_NVM_SIZE-1
+  * @retval byte
+  */
+uint8_t hal_NvmRead(uint16_t addr)
+{
+    return(EEPROM.read(addr));
+}
+
+/**
+  * @name   hal_NvmWrite
+  * @brief  write a byte to the RAM copy
+  * @param  addr    0..HAL_NVM_SIZE-1
+  * @param  value
+  * @retval None
+  */
+void hal_NvmWrite(uint16_t addr, uint8_t value)
+{
+    EEPROM.write(addr, value);
+}
+
+/**
+  * @name   hal_NvmCommit
+  * @brief  write the RAM copy to FLASH if it changed
+  * @note   erases and writes a FLASH row, keep these to a minimum
+  */
+void hal_NvmCommit(void)
+{
+    EEPROM.commit();
+}
+
+//===================================================================
+//                             SYSTEM
+//===================================================================
+
+/**
+  * @name   hal_ResetCause
+  * @brief  get the cause of the last reset
+  * @retval PM->RCAUSE
+  */
+uint8_t hal_ResetCause(void)
+{
+    return(PM->RCAUSE.reg);
+}
+
+/**
+  * @name   hal_FreeRam
+  * @brief  get bytes between top of heap and the stack
+  */
+uint32_t hal_FreeRam(void)
+{
+    char            top;
+
+    return((uint32_t) (&top - sbrk(0)));
+}
+
+/**
+  * @name   hal_Reset
+  * @brief  reset the MCU
+  * @param  None
+  * @retval does not return
+  */
+void hal_Reset(void)
+{
+    NVIC_SystemReset();
+}
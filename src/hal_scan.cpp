@@ -0,0 +1,307 @@
+//===================================================================
+// hal_scan.cpp
+//
+// Scan chain shift engine, hal_ScanInit() and hal_ScanShift() of
+// hal.hpp.  The chain is clocked by SERCOM0 in SPI master mode:
+// SCAN_DATA_OUT (PA08) is PAD[0], SCAN_DATA_IN (PA10) is PAD[2] and
+// SCAN_CLK (PA11) is PAD[3], all on peripheral function C.  SCAN_CLK
+// idles high and data is latched on the falling edge (SPI mode 2),
+// which is the same timing the TC5 bit-bang ISR in timers.cpp uses.
+// The pins are only muxed to SERCOM0 for the duration of a shift so
+// 'pins', 'read' and 'status' see them as normal GPIO.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "scan.hpp"
+#include "prof.hpp"
+#include "hal.hpp"
+
+#define SCAN_DMA_RX_CH            0
+#define SCAN_DMA_TX_CH            1
+#define SCAN_DMA_TIMEOUT_USECS    10000
+#define PORT_PMUX_FUNC_C          2
+
+// DMAC descriptors (one per channel) must be 128-bit aligned
+static DmacDescriptor       scanDmaDesc[2] __attribute__((aligned(16)));
+static DmacDescriptor       scanDmaWriteBack[2] __attribute__((aligned(16)));
+static volatile bool        scanDmaDone;
+static volatile uint32_t    scanDmaIsrUsecs;
+
+/**
+  * @name   scan_SetPinMux
+  * @brief  switch scan chain pins between GPIO and SERCOM0
+  * @param  toSercom  true to mux pins to SERCOM0, false for GPIO
+  * @retval None
+  * @note   with PMUXEN clear the pins fall back to their PORT OUT
+  *         values, which are the idle levels set by configureIOPins()
+  */
+static void scan_SetPinMux(bool toSercom)
+{
+    const uint8_t     pins[] = {OCP_SCAN_DATA_OUT, OCP_SCAN_DATA_IN, OCP_SCAN_CLK};
+    uint8_t           port, pin;
+
+    for ( unsigned i = 0; i < sizeof(pins); i++ )
+    {
+        port = g_APinDescription[pins[i]].ulPort;
+        pin = g_APinDescription[pins[i]].ulPin;
+
+        if ( toSercom )
+        {
+            PORT->Group[port].PMUX[pin >> 1].reg &= ~(0xF << (4 * (pin & 0x01u)));
+            PORT->Group[port].PMUX[pin >> 1].reg |= PORT_PMUX_FUNC_C << (4 * (pin & 0x01u));
+            PORT->Group[port].PINCFG[pin].bit.PMUXEN = 1;
+        }
+        else
+        {
+            PORT->Group[port].PINCFG[pin].bit.PMUXEN = 0;
+        }
+    }
+}
+
+/**
+  * @name   scan_SpiInit
+  * @brief  configure SERCOM0 as SPI master for the scan chain
+  * @param  None
+  * @retval None
+  */
+static void scan_SpiInit(void)
+{
+    PM->APBCMASK.reg |= PM_APBCMASK_SERCOM0;
+
+    GCLK->CLKCTRL.reg = (uint16_t) (GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID(SERCOM0_GCLK_ID_CORE));
+    while (GCLK->STATUS.bit.SYNCBUSY);
+
+    SERCOM0->SPI.CTRLA.bit.SWRST = 1;
+    while (SERCOM0->SPI.CTRLA.bit.SWRST || SERCOM0->SPI.SYNCBUSY.bit.SWRST);
+
+    // DO = PAD[0], SCK = PAD[3], DI = PAD[2]; CPOL = 1, CPHA = 0, MSB first
+    SERCOM0->SPI.CTRLA.reg = SERCOM_SPI_CTRLA_MODE_SPI_MASTER | SERCOM_SPI_CTRLA_DOPO(3) |
+                             SERCOM_SPI_CTRLA_DIPO(2) | SERCOM_SPI_CTRLA_CPOL;
+
+    // 8-bit characters, receiver on
+    SERCOM0->SPI.CTRLB.reg = SERCOM_SPI_CTRLB_CHSIZE(0) | SERCOM_SPI_CTRLB_RXEN;
+    while (SERCOM0->SPI.SYNCBUSY.bit.CTRLB);
+
+    SERCOM0->SPI.BAUD.reg = (uint8_t) (SystemCoreClock / (2 * SCAN_SPI_CLOCK_HZ) - 1);
+
+    SERCOM0->SPI.CTRLA.bit.ENABLE = 1;
+    while (SERCOM0->SPI.SYNCBUSY.bit.ENABLE);
+}
+
+/**
+  * @name   scan_DmaInit
+  * @brief  configure DMAC channels for SERCOM0 RX and TX
+  * @param  None
+  * @retval None
+  * @note   RX channel is enabled first so no received byte is missed
+  */
+static void scan_DmaInit(void)
+{
+    PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+    PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+
+    DMAC->CTRL.bit.DMAENABLE = 0;
+    DMAC->CTRL.bit.SWRST = 1;
+    while (DMAC->CTRL.bit.SWRST);
+
+    memset((void *) scanDmaDesc, 0, sizeof(scanDmaDesc));
+    memset((void *) scanDmaWriteBack, 0, sizeof(scanDmaWriteBack));
+    DMAC->BASEADDR.reg = (uint32_t) scanDmaDesc;
+    DMAC->WRBADDR.reg = (uint32_t) scanDmaWriteBack;
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF);
+
+    // RX: SERCOM0 DATA -> rx buffer, interrupt on transfer complete
+    DMAC->CHID.reg = DMAC_CHID_ID(SCAN_DMA_RX_CH);
+    DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+    DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) | DMAC_CHCTRLB_TRIGSRC(SERCOM0_DMAC_ID_RX) | DMAC_CHCTRLB_TRIGACT_BEAT;
+    DMAC->CHINTENSET.reg = DMAC_CHINTENSET_TCMPL | DMAC_CHINTENSET_TERR;
+
+    // TX: tx buffer -> SERCOM0 DATA, no interrupt
+    DMAC->CHID.reg = DMAC_CHID_ID(SCAN_DMA_TX_CH);
+    DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+    DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) | DMAC_CHCTRLB_TRIGSRC(SERCOM0_DMAC_ID_TX) | DMAC_CHCTRLB_TRIGACT_BEAT;
+
+    NVIC_DisableIRQ(DMAC_IRQn);
+    NVIC_ClearPendingIRQ(DMAC_IRQn);
+    NVIC_SetPriority(DMAC_IRQn, 1);
+    NVIC_EnableIRQ(DMAC_IRQn);
+}
+
+/**
+  * @name   DMAC_Handler
+  * @brief  DMAC ISR, flags completion of the scan chain RX transfer
+  * @param  None
+  * @retval None
+  */
+void DMAC_Handler(void)
+{
+    uint32_t        start = micros();
+    uint64_t        profStart = prof_Now();
+    uint8_t         channel = DMAC->INTPEND.bit.ID;
+    uint8_t         flags;
+
+    DMAC->CHID.reg = DMAC_CHID_ID(channel);
+    flags = DMAC->CHINTFLAG.reg;
+    DMAC->CHINTFLAG.reg = flags;
+
+    if ( channel == SCAN_DMA_RX_CH )
+        scanDmaDone = true;
+
+    scanDmaIsrUsecs += micros() - start;
+    prof_Record(PROF_ISR_DMAC, profStart);
+}
+
+/**
+  * @name   scan_LoadPulse
+  * @brief  pulse SCAN_LD_N low to parallel load the NIC shift registers
+  * @param  None
+  * @retval None
+  */
+static void scan_LoadPulse(void)
+{
+    // SCAN_CLK idles high (CPOL = 1)
+    digitalWrite(OCP_SCAN_CLK, 1);
+
+    digitalWrite(OCP_SCAN_LD_N, 0);
+    delayMicroseconds(SCAN_LD_PULSE_USECS);
+    digitalWrite(OCP_SCAN_LD_N, 1);
+}
+
+/**
+  * @name   scan_FlushRx
+  * @brief  discard stale SERCOM0 receive data and overflow status
+  * @param  None
+  * @retval None
+  */
+static void scan_FlushRx(void)
+{
+    while ( SERCOM0->SPI.INTFLAG.bit.RXC )
+        (void) SERCOM0->SPI.DATA.reg;
+
+    SERCOM0->SPI.STATUS.reg = SERCOM_SPI_STATUS_BUFOVF;
+}
+
+/**
+  * @name   scan_TransferSPI
+  * @brief  shift the chain in by polling SERCOM0
+  * @param  tx   bytes to shift out on SCAN_DATA_OUT
+  * @param  rx   bytes shifted in from SCAN_DATA_IN
+  * @param  len  number of bytes to shift
+  * @retval None
+  */
+static void scan_TransferSPI(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+    for ( uint16_t i = 0; i < len; i++ )
+    {
+        while ( SERCOM0->SPI.INTFLAG.bit.DRE == 0 )
+            ;
+
+        SERCOM0->SPI.DATA.reg = tx[i];
+
+        while ( SERCOM0->SPI.INTFLAG.bit.RXC == 0 )
+            ;
+
+        rx[i] = SERCOM0->SPI.DATA.reg;
+    }
+}
+
+/**
+  * @name   scan_TransferDMA
+  * @brief  shift the chain in using the DMAC
+  * @param  tx   bytes to shift out on SCAN_DATA_OUT
+  * @param  rx   bytes shifted in from SCAN_DATA_IN
+  * @param  len  number of bytes to shift
+  * @retval microseconds spent waiting for DMAC completion
+  */
+static uint32_t scan_TransferDMA(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+    uint32_t        waitStart;
+
+    // NOTE: DMAC address registers point one past the end of an
+    // incrementing buffer
+    scanDmaDesc[SCAN_DMA_RX_CH].BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_BYTE |
+                                             DMAC_BTCTRL_DSTINC | DMAC_BTCTRL_BLOCKACT_NOACT;
+    scanDmaDesc[SCAN_DMA_RX_CH].BTCNT.reg = len;
+    scanDmaDesc[SCAN_DMA_RX_CH].SRCADDR.reg = (uint32_t) &SERCOM0->SPI.DATA.reg;
+    scanDmaDesc[SCAN_DMA_RX_CH].DSTADDR.reg = (uint32_t) &rx[len];
+    scanDmaDesc[SCAN_DMA_RX_CH].DESCADDR.reg = 0;
+
+    scanDmaDesc[SCAN_DMA_TX_CH].BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_BYTE |
+                                             DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_BLOCKACT_NOACT;
+    scanDmaDesc[SCAN_DMA_TX_CH].BTCNT.reg = len;
+    scanDmaDesc[SCAN_DMA_TX_CH].SRCADDR.reg = (uint32_t) &tx[len];
+    scanDmaDesc[SCAN_DMA_TX_CH].DSTADDR.reg = (uint32_t) &SERCOM0->SPI.DATA.reg;
+    scanDmaDesc[SCAN_DMA_TX_CH].DESCADDR.reg = 0;
+
+    scanDmaDone = false;
+
+    DMAC->CHID.reg = DMAC_CHID_ID(SCAN_DMA_RX_CH);
+    DMAC->CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+    DMAC->CHID.reg = DMAC_CHID_ID(SCAN_DMA_TX_CH);
+    DMAC->CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+
+    // CPU is free from here on; a caller that doesn't need the data
+    // right away could return now and check scanDmaDone later
+    waitStart = micros();
+    while ( scanDmaDone == false )
+    {
+        if ( micros() - waitStart > SCAN_DMA_TIMEOUT_USECS )
+        {
+            DMAC->CHID.reg = DMAC_CHID_ID(SCAN_DMA_TX_CH);
+            DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+            DMAC->CHID.reg = DMAC_CHID_ID(SCAN_DMA_RX_CH);
+            DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+            memset(rx, 0, len);
+            break;
+        }
+    }
+
+    return(micros() - waitStart);
+}
+
+/**
+  * @name   hal_ScanShift
+  * @brief  load the chain and shift it in over SERCOM0
+  * @param  tx      bytes to shift out on SCAN_DATA_OUT, first byte first
+  * @param  rx      bytes shifted in, MSB of rx[0] is the first bit
+  * @param  len     number of bytes to shift
+  * @param  useDMA  true to move the bytes with the DMAC
+  * @retval microseconds spent idle waiting for the DMAC
+  */
+uint32_t hal_ScanShift(const uint8_t *tx, uint8_t *rx, uint16_t len, bool useDMA)
+{
+    uint32_t        idle = 0;
+
+    scan_LoadPulse();
+    scan_SetPinMux(true);
+    scan_FlushRx();
+
+    if ( useDMA )
+    {
+        scanDmaIsrUsecs = 0;
+        idle = scan_TransferDMA(tx, rx, len);
+        idle -= scanDmaIsrUsecs;
+    }
+    else
+    {
+        scan_TransferSPI(tx, rx, len);
+    }
+
+    scan_SetPinMux(false);
+    return(idle);
+}
+
+/**
+  * @name   hal_ScanInit
+  * @brief  initialize SERCOM0 and the DMAC for hal_ScanShift()
+  * @param  None
+  * @retval None
+  * @note   call after configureIOPins()
+  */
+void hal_ScanInit(void)
+{
+    scan_SpiInit();
+    scan_DmaInit();
+}
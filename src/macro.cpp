@@ -0,0 +1,383 @@
+//===================================================================
+// macro.cpp
+//
+// Named command macros kept in simulated EEPROM after the settings.
+// A macro body is one or more CLI commands separated by ';' and is
+// run on the board through cli_RunBatch(), optionally in a loop, so a
+// test recipe runs with no USB round trip between commands.  'sleep'
+// waits between commands while the background tasks keep running.
+// Any key stops a running macro.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "eeprom.hpp"
+#include "macro.hpp"
+#include "hal.hpp"
+
+extern char             *tokens[];
+
+#define MACRO_SLOT_ADDR(n)      (MACRO_EEPROM_ADDR + sizeof(uint32_t) + (n) * sizeof(macro_t))
+
+static uint8_t          macroDepth = 0;             // nested 'macro run' level
+
+/**
+  * @name   macro_IsValid
+  * @brief  check for the macro area signature
+  * @param  None
+  * @retval true if the macro area has been initialized
+  */
+static bool macro_IsValid(void)
+{
+    uint32_t        sig;
+
+    EEPROM_ReadBytes(MACRO_EEPROM_ADDR, (uint8_t *) &sig, sizeof(sig));
+    return(sig == MACRO_SIGNATURE);
+}
+
+/**
+  * @name   macro_Load
+  * @brief  read a macro slot
+  * @param  slot    0..MACRO_COUNT-1
+  * @param  m       output; name is empty for a free slot
+  * @retval None
+  */
+static void macro_Load(int slot, macro_t *m)
+{
+    if ( macro_IsValid() == false )
+    {
+        memset(m, 0, sizeof(macro_t));
+        return;
+    }
+
+    EEPROM_ReadBytes(MACRO_SLOT_ADDR(slot), (uint8_t *) m, sizeof(macro_t));
+    m->name[MACRO_NAME_SZ - 1] = 0;
+    m->body[MACRO_BODY_SZ - 1] = 0;
+}
+
+/**
+  * @name   macro_Store
+  * @brief  write a macro slot to FLASH
+  * @param  slot    0..MACRO_COUNT-1
+  * @param  m       macro, empty name frees the slot
+  * @retval None
+  * @note   first write initializes the whole area; one FLASH commit
+  *         for all of it
+  */
+static void macro_Store(int slot, const macro_t *m)
+{
+    uint32_t        sig = MACRO_SIGNATURE;
+    macro_t         empty;
+
+    if ( macro_IsValid() == false )
+    {
+        memset(&empty, 0, sizeof(empty));
+
+        for ( int i = 0; i < MACRO_COUNT; i++ )
+            EEPROM_WriteBytes(MACRO_SLOT_ADDR(i), (const uint8_t *) &empty, sizeof(empty));
+
+        EEPROM_WriteBytes(MACRO_EEPROM_ADDR, (const uint8_t *) &sig, sizeof(sig));
+    }
+
+    EEPROM_WriteBytes(MACRO_SLOT_ADDR(slot), (const uint8_t *) m, sizeof(macro_t));
+    EEPROM_Commit();
+}
+
+/**
+  * @name   macro_Find
+  * @brief  find a macro by name
+  * @param  name
+  * @param  m       output, the macro if found
+  * @retval slot or -1 if not found
+  */
+static int macro_Find(const char *name, macro_t *m)
+{
+    for ( int i = 0; i < MACRO_COUNT; i++ )
+    {
+        macro_Load(i, m);
+
+        if ( m->name[0] && strcmp(m->name, name) == 0 )
+            return(i);
+    }
+
+    return(-1);
+}
+
+/**
+  * @name   macro_Define
+  * @brief  add or replace a macro
+  * @param  name
+  * @param  body    ';' separated commands
+  * @retval 0=OK 1=error
+  */
+static int macro_Define(const char *name, const char *body)
+{
+    macro_t         m;
+    int             slot;
+
+    if ( strlen(name) >= MACRO_NAME_SZ )
+    {
+        sprintf(outBfr, "Macro name is limited to %d chars", MACRO_NAME_SZ - 1);
+        SHOW();
+        return(1);
+    }
+
+    if ( strlen(body) >= MACRO_BODY_SZ )
+    {
+        sprintf(outBfr, "Macro body is limited to %d chars", MACRO_BODY_SZ - 1);
+        SHOW();
+        return(1);
+    }
+
+    slot = macro_Find(name, &m);
+
+    // else the first free slot
+    for ( int i = 0; slot == -1 && i < MACRO_COUNT; i++ )
+    {
+        macro_Load(i, &m);
+
+        if ( m.name[0] == 0 )
+            slot = i;
+    }
+
+    if ( slot == -1 )
+    {
+        sprintf(outBfr, "All %d macros are in use; 'macro del <name>' one first", MACRO_COUNT);
+        SHOW();
+        return(1);
+    }
+
+    memset(&m, 0, sizeof(m));
+    strcpy(m.name, name);
+    strcpy(m.body, body);
+    macro_Store(slot, &m);
+    return(0);
+}
+
+/**
+  * @name   macro_Run
+  * @brief  run a macro 'count' times
+  * @param  name
+  * @param  count   0 = until a key is hit
+  * @retval 0=OK 1=not found, failed or stopped
+  */
+static int macro_Run(const char *name, uint32_t count)
+{
+    macro_t         m;
+    char            line[MACRO_BODY_SZ];
+    uint32_t        pass = 0;
+    bool            ok = true;
+
+    if ( macro_Find(name, &m) == -1 )
+    {
+        terminalOut((char *) "No such macro; 'macro' lists them");
+        return(1);
+    }
+
+    if ( macroDepth >= MACRO_MAX_DEPTH )
+    {
+        terminalOut((char *) "Macros nested too deep");
+        return(1);
+    }
+
+    macroDepth++;
+
+    while ( ok && (count == 0 || pass < count) )
+    {
+        // cli_RunBatch() splits the line in place
+        strcpy(line, m.body);
+        ok = cli_RunBatch(line, true);
+        pass++;
+    }
+
+    macroDepth--;
+
+    if ( ok == false && macroDepth == 0 )
+    {
+        sprintf(outBfr, "Macro '%s' stopped in pass %lu", m.name, (unsigned long) pass);
+        SHOW();
+    }
+
+    return((ok) ? 0 : 1);
+}
+
+/**
+  * @name   macro_List
+  * @brief  display stored macros
+  * @param  None
+  * @retval None
+  */
+static void macro_List(void)
+{
+    macro_t         m;
+    int             count = 0;
+
+    for ( int i = 0; i < MACRO_COUNT; i++ )
+    {
+        macro_Load(i, &m);
+
+        if ( m.name[0] == 0 )
+            continue;
+
+        sprintf(outBfr, "%-*s %s", MACRO_NAME_SZ, m.name, m.body);
+        SHOW();
+        count++;
+    }
+
+    sprintf(outBfr, "%d of %d macros defined", count, MACRO_COUNT);
+    SHOW();
+}
+
+/**
+  * @name   macroCmdHelp
+  * @brief  display help for the macro command
+  * @param  None
+  * @retval None
+  */
+static void macroCmdHelp(void)
+{
+    terminalOut((char *) "Usage: macro [def <name> <cmd>[; <cmd>...] | del <name> | run <name> [<count>]]");
+    terminalOut((char *) "  'macro' lists the macros stored in FLASH");
+    terminalOut((char *) "  'macro def' stores commands separated by ';', replacing a macro of that name");
+    terminalOut((char *) "  'macro run' runs a macro <count> times (default 1, 0 = until a key is hit);");
+    terminalOut((char *) "     any key stops it; use 'sleep <msecs>' in a macro to wait");
+    terminalOut((char *) "  ';' also separates commands typed on one line");
+}
+
+/**
+  * @name   macroDef
+  * @brief  'macro def <name> <cmd>[; <cmd>...]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int macroDef(int argCnt)
+{
+    return(macro_Define(tokens[2], cli_GetArgText(3)));
+}
+
+/**
+  * @name   macroDel
+  * @brief  'macro del <name>'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int macroDel(int argCnt)
+{
+    macro_t         m;
+    int             slot = macro_Find(tokens[2], &m);
+
+    if ( slot == -1 )
+    {
+        terminalOut((char *) "No such macro; 'macro' lists them");
+        return(1);
+    }
+
+    memset(&m, 0, sizeof(m));
+    macro_Store(slot, &m);
+    return(0);
+}
+
+/**
+  * @name   macroHelp
+  * @brief  'macro help'
+  * @param  argCnt  number of arguments
+  * @retval 0
+  */
+static int macroHelp(int argCnt)
+{
+    macroCmdHelp();
+    return(0);
+}
+
+/**
+  * @name   macroRun
+  * @brief  'macro run <name> [<count>]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int macroRun(int argCnt)
+{
+    char            name[MACRO_NAME_SZ];
+
+    // tokens[] is reused by the commands the macro runs
+    strncpy(name, tokens[2], MACRO_NAME_SZ - 1);
+    name[MACRO_NAME_SZ - 1] = 0;
+    return(macro_Run(name, (argCnt == 3) ? strtoul(tokens[3], NULL, 10) : 1));
+}
+
+static constexpr cli_subcmd_t   macroCmds[] = {
+    {"def",     macroDef,       2, MAX_TOKENS},
+    {"del",     macroDel,       1, 1},
+    {"help",    macroHelp,      0, 0},
+    {"run",     macroRun,       1, 2},
+};
+
+CLI_SUBCMDS_SORTED(macroCmds);
+
+/**
+  * @name   macro_IsDefine
+  * @brief  check if a word selects 'macro def'
+  * @param  word    subcommand as typed, may be a prefix
+  * @retval true if it does
+  * @note   cli_RunLine() keeps the ';'s of a 'macro def' line
+  */
+bool macro_IsDefine(const char *word)
+{
+    int             i = cli_Lookup(macroCmds, CLI_TABLE_COUNT(macroCmds), &cli_subcmd_t::name, word);
+
+    return(i >= 0 && macroCmds[i].func == macroDef);
+}
+
+/**
+  * @name   macroCmd
+  * @brief  implement macro command
+  * @param  argCnt  number of arguments
+  * @param  tokens[1]  def, del, help or run
+  * @param  tokens[2]  macro name
+  * @param  tokens[3]  commands (def); count (run)
+  * @retval int 0=OK, 1=error
+  */
+int macroCmd(int argCnt)
+{
+    int             rc;
+
+    if ( argCnt == 0 )
+    {
+        macro_List();
+        return(0);
+    }
+
+    rc = cli_RunSubCmd(macroCmds, CLI_TABLE_COUNT(macroCmds), 1, argCnt);
+
+    if ( rc == CLI_SUBCMD_ERR )
+    {
+        macroCmdHelp();
+        return(1);
+    }
+
+    return(rc);
+}
+
+/**
+  * @name   sleepCmd
+  * @brief  wait, running background tasks
+  * @param  argCnt  number of arguments
+  * @param  tokens[1]  msecs
+  * @retval int 0=OK, 1=stopped by a key
+  * @note   the key is left for the caller, which lets a macro stop too
+  */
+int sleepCmd(int argCnt)
+{
+    uint32_t        msecs = strtoul(tokens[1], NULL, 10);
+    uint32_t        start = hal_Millis();
+
+    while ( hal_Millis() - start < msecs )
+    {
+        if ( hal_SerialAvailable() )
+            return(1);
+
+        backgroundPoll();
+    }
+
+    return(0);
+}
@@ -13,11 +13,15 @@
 #include "commands.hpp"
 #include "eeprom.hpp"
 #include "cli.hpp"
-#include <Wire.h>
-#include "main.hpp"
-
-// timers
-void timers_Init(void);
+#include "scan.hpp"
+#include "power.hpp"
+#include "meter.hpp"
+#include "monitor.hpp"
+#include "stream.hpp"
+#include "sched.hpp"
+#include "mem.hpp"
+#include "trace.hpp"
+#include "hal.hpp"
 
 // heartbeat LED blink delays in ms (approx)
 #define FAST_BLINK_DELAY            200
@@ -26,6 +30,25 @@ void timers_Init(void);
 uint8_t         boardIDpins;        // or'd BOARD_ID_bits 2..1
 uint8_t         boardIDReal;        // adjusted to align with X06 =  6, X07 = 6 etc
 
+static void cliTask(void);
+static void termTask(void);
+static void heartbeatTask(void);
+
+// scheduler tasks, run in this order on each pass; see sched.cpp
+static const sched_task_t   tasks[] = {
+    {"scan",      scan_Poll,      0},
+    {"power",     power_Poll,     0},
+    {"meter",     meter_Poll,     0},
+    {"monitor",   monitor_Poll,   0},
+    {"stream",    stream_Poll,    0},
+    {"term",      termTask,       0},
+    {"heartbeat", heartbeatTask,  SLOW_BLINK_DELAY},
+    {"mem",       mem_Check,      MEM_CHECK_MSEC},
+    {"cli",       cliTask,        0},
+};
+
+static const sched_clock_t  boardClock = {hal_Millis, hal_Micros};
+
 /**
   * @name   setup
   * @brief  system initialization
@@ -34,12 +57,18 @@ uint8_t         boardIDReal;        // adjusted to align with X06 =  6, X07 = 6
   */
 void setup() 
 {
+  // mark free SRAM for the stack high-water mark, see 'xdebug mem'
+  mem_PaintStack();
+
+  // keep events from before a reset, see 'xdebug trace'
+  trace_Init();
+
   // configure I/O pins and read all inputs
   // into pinStates[]
   // NOTE: Output pins will be 0 initially
   // then updated on any writePin()
   configureIOPins();
-  digitalWrite(OCP_HEARTBEAT_LED, LOW);
+  hal_PinWrite(OCP_HEARTBEAT_LED, LOW);
   readAllPins();
 
   // disable main & aux power to NIC 3.0 card
@@ -56,70 +85,97 @@ void setup()
   // initialize timer used for scan chain clock
   timers_Init();
 
+  // scan chain capture engine (SERCOM0 SPI + DMAC)
+  scan_Init();
+
+  // timestamp input pin edges, also feeds power timing
+  monitorsInit();
+
   // Start serial interface
   // NOTE: Baud rate isn't applicable to USB...
   // NOTE: No wait here, loop() does that
-  SerialUSB.begin(115200);
+  hal_SerialBegin();
 
   // start I2C interface
-  Wire.begin();
+  hal_I2cBegin();
+
+  // INA219 power telemetry on the I2C bus
+  meter_Init();
+
+  sched_Init(tasks, sizeof(tasks) / sizeof(tasks[0]), &boardClock);
 
 } // setup()
 
 /**
-  * @name   loop
-  * @brief  main program loop
+  * @name   backgroundPoll
+  * @brief  run the background tasks once
   * @param  None
   * @retval None
-  * @note   blink heartbeat LED & handle incoming characters over SerialUSB connection
+  * @note   called by commands that wait, e.g. 'sleep'; the CLI task
+  *         running the command is skipped and the tasks' messages are
+  *         held until the next prompt, see term_Hold()
   */
-void loop() 
+void backgroundPoll(void)
+{
+  bool            held = term_Hold(true);
+
+  sched_Run();
+  (void) term_Hold(held);
+}
+
+/**
+  * @name   termTask
+  * @brief  send queued terminal output
+  * @param  None
+  * @retval None
+  */
+static void termTask(void)
+{
+  (void) term_Poll();
+}
+
+/**
+  * @name   heartbeatTask
+  * @brief  toggle the heartbeat LED, every SLOW_BLINK_DELAY msecs
+  * @param  None
+  * @retval None
+  */
+static void heartbeatTask(void)
+{
+  static bool     LEDstate = false;
+
+  LEDstate = LEDstate ? 0 : 1;
+  hal_PinWrite(OCP_HEARTBEAT_LED, LEDstate);
+}
+
+/**
+  * @name   cliTask
+  * @brief  handle one incoming character over SerialUSB
+  * @param  None
+  * @retval None
+  * @note   runs commands, which may take a while
+  */
+static void cliTask(void)
 {
   int             byteIn;
   static char     inBfr[MAX_LINE_SZ];
   static int      inCharCount = 0;
   static char     lastCmd[80] = "help";
   const char      bs[4] = {0x1b, '[', '1', 'D'};  // terminal: backspace seq
-  static bool     LEDstate = false;
-  static uint32_t time = millis();
-  static bool     isFirstTime = true;
-
-  if ( isFirstTime )
-  {
-    if ( SerialUSB )
-    {
-        doHello();
-        EEPROM_InitLocal();
-        terminalOut((char *) "Press ENTER if prompt is not shown");
-        doPrompt();
-        isFirstTime = false;
-    }
-    else
-    {
-        delay(1000);
-        return;
-    }
-  }
-  else
-  {
-        // blink heartbeat LED
-        if ( millis() - time >= SLOW_BLINK_DELAY )
-        {
-            time = millis();
-            LEDstate = LEDstate ? 0 : 1;
-            digitalWrite(OCP_HEARTBEAT_LED, LEDstate);
-        }
-  }
 
   // process incoming serial over USB characters
-  if ( SerialUSB.available() )
+  if ( hal_SerialAvailable() )
   {
-      byteIn = SerialUSB.read();
+      byteIn = hal_SerialRead();
+
+      // any key aborts a running 'power cycle' test and is consumed
+      if ( power_AbortCycle() )
+          return;
+
       if ( byteIn == 0x0a )
       {
           // line feed - echo it
-          SerialUSB.write(0x0a);
-          SerialUSB.flush();
+          term_Write("\n", 1);
       }
       else if ( byteIn == 0x0d )
       {
@@ -130,27 +186,26 @@ void loop()
           inBfr[inCharCount] = 0;
           inCharCount = 0;
           strcpy(lastCmd, inBfr);
-          cli(inBfr);
-          SerialUSB.flush();
+          cli_RunLine(inBfr);
       }
       else if ( byteIn == 0x1b )
       {
           // handle ANSI escape sequence - only UP arrow is supported
-          if ( SerialUSB.available() )
+          if ( hal_SerialAvailable() )
           {
-              byteIn = SerialUSB.read();
+              byteIn = hal_SerialRead();
               if ( byteIn == '[' )
               {
-                if ( SerialUSB.available() )
+                if ( hal_SerialAvailable() )
                 {
-                    byteIn = SerialUSB.read();
+                    byteIn = hal_SerialRead();
                     if ( byteIn == 'A' )
                     {
                         // up arrow: echo last command entered then execute in CLI
+                        // run a copy, ';' batches are split in place
                         terminalOut(lastCmd);
-                        SerialUSB.flush();
-                        cli(lastCmd);
-                        SerialUSB.flush();
+                        strcpy(inBfr, lastCmd);
+                        cli_RunLine(inBfr);
                     }
                 }
             }
@@ -163,18 +218,16 @@ void loop()
         if ( inCharCount )
         {
             inBfr[inCharCount--] = 0;
-            SerialUSB.write(bs, 4);
-            SerialUSB.write(' ');
-            SerialUSB.write(bs, 4);
-            SerialUSB.flush();
+            term_Write(bs, 4);
+            term_Write(" ", 1);
+            term_Write(bs, 4);
         }
     }
     else
     {
         // all other keys get echoed & stored in buffer
-        SerialUSB.write((char) byteIn);
-        SerialUSB.flush();
         inBfr[inCharCount] = byteIn;
+        term_Write(&inBfr[inCharCount], 1);
         if ( inCharCount < (MAX_LINE_SZ-1) )
         {
             inCharCount++;
@@ -187,6 +240,42 @@ void loop()
     }
   }
 
+} // cliTask()
+
+/**
+  * @name   loop
+  * @brief  main program loop
+  * @param  None
+  * @retval None
+  * @note   waits for the SerialUSB connection, then runs the tasks
+  */
+void loop() 
+{
+  static bool     isFirstTime = true;
+
+  if ( isFirstTime )
+  {
+    if ( hal_SerialConnected() )
+    {
+        doHello();
+        EEPROM_InitLocal();
+        (void) verifyPinTables();
+        if ( trace_IsHeld() )
+            terminalOut((char *) "Trace from before the reset is held, see 'xdebug trace'");
+        terminalOut((char *) "Press ENTER if prompt is not shown");
+        doPrompt();
+        isFirstTime = false;
+    }
+    else
+    {
+        hal_Delay(1000);
+    }
+
+    return;
+  }
+
+  sched_Run();
+
 } // loop()
 
 /**
@@ -0,0 +1,182 @@
+//===================================================================
+// mem.cpp
+//
+// SRAM use from the linker script symbols, the heap break and a
+// painted stack.  SRAM from the bottom up is .data, .bss, .noinit
+// (the trace ring, see trace.cpp), the heap
+// (grown by sbrk(), never given back by newlib-nano's malloc), free
+// space, and the stack growing down from __StackTop.
+//
+// mem_PaintStack() fills the free space with MEM_PAINT at boot, so
+// the lowest word no longer holding it is the deepest the stack has
+// been.  mem_Check() runs from the scheduler and watches the
+// MEM_GUARD_WORDS just above the heap; the stack reaching them is
+// reported as an overflow while the board still runs.
+//===================================================================
+#include <Arduino.h>
+#include <malloc.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "mem.hpp"
+
+extern "C" char         *sbrk(int incr);
+
+// from the linker script
+extern uint32_t         __data_start__;
+extern uint32_t         __data_end__;
+extern uint32_t         __bss_start__;
+extern uint32_t         __bss_end__;
+extern uint32_t         __noinit_start__;
+extern uint32_t         __noinit_end__;
+extern uint32_t         __end__;                // heap start
+extern uint32_t         __StackTop;
+
+#define MEM_SP_MARGIN_WORDS     16          // not painted below SP
+
+static bool             memPainted = false;
+static bool             memGuardBroken = false;
+static uint32_t         memOverflows = 0;
+
+/**
+  * @name   mem_HeapEnd
+  * @brief  first word above the heap
+  * @param  None
+  * @retval address
+  */
+static uint32_t *mem_HeapEnd(void)
+{
+    return((uint32_t *) (((uint32_t) sbrk(0) + 3) & ~3UL));
+}
+
+/**
+  * @name   mem_PaintStack
+  * @brief  fill free SRAM between the heap and the stack with MEM_PAINT
+  * @param  None
+  * @retval None
+  * @note   call first thing in setup()
+  */
+void mem_PaintStack(void)
+{
+    uint32_t        *p = mem_HeapEnd();
+    uint32_t        *stop = (uint32_t *) __get_MSP() - MEM_SP_MARGIN_WORDS;
+
+    while ( p < stop )
+        *p++ = MEM_PAINT;
+
+    memPainted = true;
+}
+
+/**
+  * @name   mem_GetUsage
+  * @brief  measure SRAM use
+  * @param  usage   output
+  * @retval None
+  * @note   stackPeak and largestFree are 0 before mem_PaintStack()
+  */
+void mem_GetUsage(mem_usage_t *usage)
+{
+    uint32_t        *heapEnd = mem_HeapEnd();
+    uint32_t        *top = &__StackTop;
+    uint32_t        *p = heapEnd;
+    struct mallinfo info = mallinfo();
+
+    usage->data = (uint32_t) &__data_end__ - (uint32_t) &__data_start__;
+    usage->bss = (uint32_t) &__bss_end__ - (uint32_t) &__bss_start__;
+    usage->noinit = (uint32_t) &__noinit_end__ - (uint32_t) &__noinit_start__;
+    usage->heap = (uint32_t) heapEnd - (uint32_t) &__end__;
+    usage->heapFree = info.fordblks;
+    usage->stackNow = (uint32_t) top - __get_MSP();
+    usage->stackPeak = 0;
+    usage->largestFree = 0;
+    usage->total = HMCRAMC0_SIZE;
+
+    if ( memPainted == false )
+        return;
+
+    // lowest word the stack has written
+    while ( p < top && *p == MEM_PAINT )
+        p++;
+
+    usage->stackPeak = (uint32_t) top - (uint32_t) p;
+    usage->largestFree = (uint32_t) p - (uint32_t) heapEnd;
+}
+
+/**
+  * @name   mem_Check
+  * @brief  check the guard words above the heap
+  * @param  None
+  * @retval None
+  * @note   scheduler task; reports each time the stack reaches the
+  *         heap, then repaints the guard if the stack has moved off it
+  */
+void mem_Check(void)
+{
+    uint32_t        *guard = mem_HeapEnd();
+    uint32_t        *sp = (uint32_t *) __get_MSP();
+    bool            broken = false;
+
+    if ( memPainted == false )
+        return;
+
+    for ( int i = 0; i < MEM_GUARD_WORDS; i++ )
+    {
+        if ( guard[i] != MEM_PAINT )
+            broken = true;
+    }
+
+    if ( broken && memGuardBroken == false )
+    {
+        memOverflows++;
+        sprintf(outBfr, "*** Stack overflow: stack reached the heap at 0x%08lx, free RAM is gone", (uint32_t) guard);
+        SHOW();
+    }
+
+    memGuardBroken = broken;
+
+    if ( broken && guard + MEM_GUARD_WORDS < sp - MEM_SP_MARGIN_WORDS )
+    {
+        for ( int i = 0; i < MEM_GUARD_WORDS; i++ )
+            guard[i] = MEM_PAINT;
+
+        memGuardBroken = false;
+    }
+}
+
+/**
+  * @name   mem_GetOverflows
+  * @brief  stack overflows seen by mem_Check()
+  */
+uint32_t mem_GetOverflows(void)
+{
+    return(memOverflows);
+}
+
+/**
+  * @name   mem_Show
+  * @brief  display 'xdebug mem' report
+  * @param  None
+  * @retval None
+  */
+void mem_Show(void)
+{
+    mem_usage_t     usage;
+
+    mem_GetUsage(&usage);
+
+    sprintf(outBfr, ".data          %6lu", usage.data);
+    SHOW();
+    sprintf(outBfr, ".bss           %6lu", usage.bss);
+    SHOW();
+    sprintf(outBfr, ".noinit        %6lu  (trace, kept across reset)", usage.noinit);
+    SHOW();
+    sprintf(outBfr, "heap           %6lu  (%lu of it free after free())", usage.heap, usage.heapFree);
+    SHOW();
+    sprintf(outBfr, "stack now      %6lu", usage.stackNow);
+    SHOW();
+    sprintf(outBfr, "stack peak     %6lu", usage.stackPeak);
+    SHOW();
+    sprintf(outBfr, "largest free   %6lu  between heap and deepest stack", usage.largestFree);
+    SHOW();
+    sprintf(outBfr, "SRAM           %6lu, %lu stack overflows detected", usage.total, memOverflows);
+    SHOW();
+}
@@ -0,0 +1,539 @@
+//===================================================================
+// meter.cpp
+//
+// Power telemetry for the NIC 3.0 card rails.  U2 (12V) and U3
+// (3.3V_AUX) INA219s run in continuous conversion mode; meter_Poll(),
+// called from loop(), reads shunt and bus voltage of both every
+// 'mperiod' msecs and keeps min/max/avg power and energy per rail.
+// Current and power are computed from the shunt voltage and
+// METER_xxx_SHUNT_MOHMS, so the calibration register is not used.
+//
+// Burst capture ('power burst arm') switches both INA219s to 9-bit
+// conversions and I2C to 400 kHz.  writePin() of MAIN_EN or AUX_EN
+// triggers it; meter_Poll() then fills a buffer with samples of both
+// rails every METER_BURST_PERIOD_USECS, each at the first conversion
+// (CNVR) after it is due, until it is full.  The buffer is allocated on
+// the first arm from free RAM and kept.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "eeprom.hpp"
+#include "meter.hpp"
+#include "fmt.hpp"
+#include "prof.hpp"
+#include "hal.hpp"
+
+extern EEPROM_data_t        EEPROMData;
+
+static meter_rail_t         meterRails[METER_RAIL_COUNT] = {
+    {"12V",      METER_12V_I2C_ADDR, METER_12V_SHUNT_MOHMS},
+    {"3.3V_AUX", METER_3V3_I2C_ADDR, METER_3V3_SHUNT_MOHMS}
+};
+
+static uint32_t             meterLastPoll = 0;
+
+static volatile METER_BURST meterBurstState = METER_BURST_IDLE;
+static meter_burst_t        *meterBurstBfr = NULL;
+static uint16_t             meterBurstSize = 0;     // entries in meterBurstBfr
+static uint16_t             meterBurstCount = 0;    // entries captured
+static uint32_t             meterBurstStart = 0;    // hal_Micros() at trigger
+static uint32_t             meterBurstDue = 0;      // usecs since trigger of the next sample
+static uint32_t             meterBurstMissed = 0;   // periods skipped, loop() was late
+
+/**
+  * @name   ina219_ReadReg
+  * @brief  read a 16-bit INA219 register
+  * @param  i2cAddr  INA219 address
+  * @param  reg      register number
+  * @param  value    where to put register value
+  * @retval true if OK, false on I2C error
+  */
+bool ina219_ReadReg(uint8_t i2cAddr, uint8_t reg, uint16_t *value)
+{
+    uint64_t        start = prof_Now();
+    uint8_t         data[2];
+    bool            ok = false;
+
+    if ( hal_I2cWrite(i2cAddr, &reg, 1) && hal_I2cRead(i2cAddr, data, 2) == 2 )
+    {
+        *value = (data[0] << 8) | data[1];  // MSB first
+        ok = true;
+    }
+
+    prof_Record(PROF_I2C_INA219, start);
+    return(ok);
+}
+
+/**
+  * @name   ina219_WriteReg
+  * @brief  write a 16-bit INA219 register
+  * @param  i2cAddr  INA219 address
+  * @param  reg      register number
+  * @param  value    value to write
+  * @retval true if OK, false on I2C error
+  */
+bool ina219_WriteReg(uint8_t i2cAddr, uint8_t reg, uint16_t value)
+{
+    uint64_t        start = prof_Now();
+    uint8_t         data[3] = {reg, (uint8_t) (value >> 8), (uint8_t) (value & 0xFF)};    // MSB first
+    bool            ok;
+
+    ok = hal_I2cWrite(i2cAddr, data, sizeof(data));
+
+    prof_Record(PROF_I2C_INA219, start);
+    return(ok);
+}
+
+/**
+  * @name   meter_Init
+  * @brief  reset both INA219s and start continuous conversions
+  * @param  None
+  * @retval None
+  * @note   call after hal_I2cBegin()
+  */
+void meter_Init(void)
+{
+    meter_rail_t    *r;
+
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+    {
+        r = &meterRails[i];
+        r->present = ina219_WriteReg(r->i2cAddr, INA219_REG_CONFIG, INA219_CONFIG_RESET) &&
+                     ina219_WriteReg(r->i2cAddr, INA219_REG_CONFIG, INA219_CONFIG_CONTINUOUS);
+    }
+
+    meter_Clear();
+}
+
+/**
+  * @name   meter_Sample
+  * @brief  read one rail and update its statistics
+  * @param  rail
+  * @retval true if OK, false if INA219 not present or I2C error
+  */
+bool meter_Sample(METER_RAIL rail)
+{
+    meter_rail_t    *r = &meterRails[rail];
+    uint16_t        shunt, bus;
+    uint32_t        now;
+
+    if ( r->present == false )
+        return(false);
+
+    if ( ina219_ReadReg(r->i2cAddr, INA219_REG_SHUNT, &shunt) == false ||
+         ina219_ReadReg(r->i2cAddr, INA219_REG_BUS, &bus) == false )
+    {
+        r->errors++;
+        return(false);
+    }
+
+    now = hal_Millis();
+
+    // shunt LSB is 10 uV; uV / mohms = mA
+    r->busMv = INA219_BUS_MV(bus);
+    r->currentMa = ((int32_t) (int16_t) shunt * 10) / r->shuntMohms;
+    r->powerMw = ((int32_t) r->busMv * r->currentMa) / 1000;
+
+    if ( r->samples == 0 || r->powerMw < r->minMw )
+        r->minMw = r->powerMw;
+
+    if ( r->samples == 0 || r->powerMw > r->maxMw )
+        r->maxMw = r->powerMw;
+
+    // energy from the previous sample to this one, mW * msecs = uJ
+    if ( r->samples && r->powerMw > 0 )
+        r->energyUj += (int64_t) r->powerMw * (now - r->lastMsecs);
+
+    r->sumMw += r->powerMw;
+    r->samples++;
+    r->lastMsecs = now;
+    return(true);
+}
+
+/**
+  * @name   meter_BurstEnd
+  * @brief  restore normal conversions and I2C clock after a burst
+  * @param  state  METER_BURST_IDLE or METER_BURST_DONE
+  * @retval None
+  */
+static void meter_BurstEnd(METER_BURST state)
+{
+    meterBurstState = state;
+
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+    {
+        if ( meterRails[i].present )
+            (void) ina219_WriteReg(meterRails[i].i2cAddr, INA219_REG_CONFIG, INA219_CONFIG_CONTINUOUS);
+    }
+
+    hal_I2cSetClock(METER_NORMAL_I2C_HZ);
+}
+
+/**
+  * @name   meter_BurstSample
+  * @brief  add one sample of both rails to the burst buffer
+  * @param  None
+  * @retval None
+  * @note   meter_Poll() calls it when the sample is due.  Reading POWER
+  *         of the first present INA219 clears CNVR, then the sample is
+  *         taken when the next conversion sets it, so it is never a
+  *         conversion from before it was due.
+  */
+static void meter_BurstSample(void)
+{
+    meter_burst_t   *b = &meterBurstBfr[meterBurstCount];
+    int             pace = (meterRails[METER_RAIL_12V].present) ? METER_RAIL_12V : METER_RAIL_3V3_AUX;
+    uint8_t         paceAddr = meterRails[pace].i2cAddr;
+    uint16_t        shunt, bus = 0, power;
+    uint32_t        start;
+
+    // a conversion that finished while loop() was elsewhere is stale
+    if ( ina219_ReadReg(paceAddr, INA219_REG_POWER, &power) == false )
+        return;
+
+    start = hal_Micros();
+
+    while ( (bus & INA219_BUS_CNVR) == 0 )
+    {
+        if ( ina219_ReadReg(paceAddr, INA219_REG_BUS, &bus) == false ||
+             hal_Micros() - start > METER_BURST_CNVR_USECS )
+            return;
+    }
+
+    b->usecs = hal_Micros() - meterBurstStart;
+
+    // the schedule does not slip when loop() is late, periods are dropped
+    meterBurstDue += METER_BURST_PERIOD_USECS;
+
+    while ( b->usecs >= meterBurstDue )
+    {
+        meterBurstDue += METER_BURST_PERIOD_USECS;
+        meterBurstMissed++;
+    }
+
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+    {
+        shunt = 0;
+        b->bus[i] = 0;
+
+        if ( i == pace )
+        {
+            b->bus[i] = bus;
+            (void) ina219_ReadReg(paceAddr, INA219_REG_SHUNT, &shunt);
+        }
+        else if ( meterRails[i].present )
+        {
+            (void) ina219_ReadReg(meterRails[i].i2cAddr, INA219_REG_SHUNT, &shunt);
+            (void) ina219_ReadReg(meterRails[i].i2cAddr, INA219_REG_BUS, &b->bus[i]);
+        }
+
+        b->shunt[i] = (int16_t) shunt;
+    }
+
+    if ( ++meterBurstCount >= meterBurstSize )
+        meter_BurstEnd(METER_BURST_DONE);
+}
+
+/**
+  * @name   meter_Poll
+  * @brief  sample both rails every 'mperiod' msecs, or every
+  *         METER_BURST_PERIOD_USECS during a burst capture
+  * @param  None
+  * @retval None
+  * @note   called from loop()
+  */
+void meter_Poll(void)
+{
+    if ( meterBurstState == METER_BURST_RUNNING )
+    {
+        if ( hal_Micros() - meterBurstStart >= meterBurstDue )
+            meter_BurstSample();
+
+        return;
+    }
+
+    // normal sampling would read burst mode conversions
+    if ( meterBurstState == METER_BURST_ARMED )
+        return;
+
+    if ( EEPROMData.meter_period_msec == 0 || hal_Millis() - meterLastPoll < EEPROMData.meter_period_msec )
+        return;
+
+    meterLastPoll = hal_Millis();
+
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+        (void) meter_Sample((METER_RAIL) i);
+}
+
+/**
+  * @name   meter_GetRail
+  * @brief  get last sample and statistics of a rail
+  * @param  rail
+  * @retval pointer to rail data
+  */
+const meter_rail_t *meter_GetRail(METER_RAIL rail)
+{
+    return(&meterRails[rail]);
+}
+
+/**
+  * @name   meter_Clear
+  * @brief  clear statistics and energy of both rails
+  * @param  None
+  * @retval None
+  */
+void meter_Clear(void)
+{
+    meter_rail_t    *r;
+
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+    {
+        r = &meterRails[i];
+        r->minMw = r->maxMw = 0;
+        r->sumMw = 0;
+        r->samples = 0;
+        r->errors = 0;
+        r->energyUj = 0;
+    }
+}
+
+/**
+  * @name   meter_FormatRail
+  * @brief  format last sample and energy of a rail on one line
+  * @param  rail
+  * @param  bfr   output, at least METER_LINE_SZ chars
+  * @retval None
+  */
+void meter_FormatRail(METER_RAIL rail, char *bfr)
+{
+    const meter_rail_t  *r = &meterRails[rail];
+    fmt_t               f;
+
+    // called for every status refresh, so no sprintf()
+    fmt_Start(&f, bfr, METER_LINE_SZ);
+    fmt_Str(&f, r->name, -9);
+
+    if ( r->present == false )
+    {
+        fmt_Str(&f, " not present");
+        return;
+    }
+
+    fmt_Char(&f, ' ');
+    fmt_Uint(&f, r->busMv, 6);
+    fmt_Str(&f, " mV ");
+    fmt_Int(&f, r->currentMa, 6);
+    fmt_Str(&f, " mA ");
+    fmt_Int(&f, r->powerMw, 7);
+    fmt_Str(&f, " mW ");
+    fmt_Fixed(&f, (uint32_t) (r->energyUj / 3600), 6, 11);
+    fmt_Str(&f, " Wh");
+}
+
+/**
+  * @name   meter_Show
+  * @brief  display 'power meter' table
+  * @param  None
+  * @retval None
+  */
+void meter_Show(void)
+{
+    const meter_rail_t  *r;
+    uint32_t            uWh;
+
+    if ( EEPROMData.meter_period_msec == 0 )
+        terminalOut((char *) "Sampling is off; 'set mperiod <msec>' to enable");
+    else
+    {
+        sprintf(outBfr, "Sampling every %d msec", EEPROMData.meter_period_msec);
+        SHOW();
+    }
+
+    sprintf(outBfr, "%-9s %6s %6s %7s %7s %7s %7s %12s %7s", "Rail", "mV", "mA", "mW",
+            "min mW", "max mW", "avg mW", "Wh", "samples");
+    SHOW();
+
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+    {
+        r = &meterRails[i];
+
+        if ( r->present == false )
+        {
+            sprintf(outBfr, "%-9s INA219 at 0x%02X not present", r->name, r->i2cAddr);
+            SHOW();
+            continue;
+        }
+
+        uWh = (uint32_t) (r->energyUj / 3600);
+        sprintf(outBfr, "%-9s %6u %6ld %7ld %7ld %7ld %7ld %5lu.%06lu %7lu", r->name, r->busMv,
+                (long) r->currentMa, (long) r->powerMw, (long) r->minMw, (long) r->maxMw,
+                (long) ((r->samples) ? (int32_t) (r->sumMw / r->samples) : 0),
+                (unsigned long) (uWh / 1000000), (unsigned long) (uWh % 1000000), (unsigned long) r->samples);
+        SHOW();
+
+        if ( r->errors )
+        {
+            sprintf(outBfr, "%-9s %lu I2C errors", "", (unsigned long) r->errors);
+            SHOW();
+        }
+    }
+}
+
+/**
+  * @name   meter_FreeRam
+  * @brief  get bytes between top of heap and the stack
+  * @param  None
+  * @retval free bytes
+  */
+uint32_t meter_FreeRam(void)
+{
+    return(hal_FreeRam());
+}
+
+/**
+  * @name   meter_BurstArm
+  * @brief  arm burst capture for the next MAIN_EN/AUX_EN write
+  * @param  None
+  * @retval true if armed, false if no buffer or no INA219
+  * @note   buffer is allocated on first arm and reused
+  */
+bool meter_BurstArm(void)
+{
+    uint32_t        entries;
+
+    if ( meterRails[METER_RAIL_12V].present == false && meterRails[METER_RAIL_3V3_AUX].present == false )
+        return(false);
+
+    if ( meterBurstBfr == NULL )
+    {
+        entries = meter_FreeRam();
+        entries = (entries > METER_BURST_RAM_RESERVE) ? (entries - METER_BURST_RAM_RESERVE) / sizeof(meter_burst_t) : 0;
+
+        if ( entries > METER_BURST_MAX_SAMPLES )
+            entries = METER_BURST_MAX_SAMPLES;
+
+        if ( entries == 0 )
+            return(false);
+
+        meterBurstBfr = (meter_burst_t *) malloc(entries * sizeof(meter_burst_t));
+
+        if ( meterBurstBfr == NULL )
+            return(false);
+
+        meterBurstSize = entries;
+    }
+
+    // conversions must already be fast when the trigger comes
+    hal_I2cSetClock(METER_BURST_I2C_HZ);
+
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+    {
+        if ( meterRails[i].present )
+            (void) ina219_WriteReg(meterRails[i].i2cAddr, INA219_REG_CONFIG, INA219_CONFIG_FAST);
+    }
+
+    meterBurstCount = 0;
+    meterBurstState = METER_BURST_ARMED;
+    return(true);
+}
+
+/**
+  * @name   meter_BurstDisarm
+  * @brief  stop an armed or running burst capture
+  * @param  None
+  * @retval None
+  * @note   samples already captured are kept
+  */
+void meter_BurstDisarm(void)
+{
+    if ( meterBurstState == METER_BURST_ARMED || meterBurstState == METER_BURST_RUNNING )
+        meter_BurstEnd((meterBurstCount) ? METER_BURST_DONE : METER_BURST_IDLE);
+}
+
+/**
+  * @name   meter_BurstTrigger
+  * @brief  start an armed burst capture
+  * @param  None
+  * @retval None
+  * @note   called by writePin() when MAIN_EN or AUX_EN is asserted;
+  *         takes the first sample at the next conversion, meter_Poll()
+  *         the rest on schedule
+  */
+void meter_BurstTrigger(void)
+{
+    if ( meterBurstState != METER_BURST_ARMED )
+        return;
+
+    meterBurstStart = hal_Micros();
+    meterBurstDue = 0;
+    meterBurstMissed = 0;
+    meterBurstState = METER_BURST_RUNNING;
+    meter_BurstSample();
+}
+
+/**
+  * @name   meter_BurstShow
+  * @brief  display burst capture state
+  * @param  None
+  * @retval None
+  */
+void meter_BurstShow(void)
+{
+    static const char   *states[] = {"idle", "armed", "running", "done"};
+    uint32_t            total, gap, minGap = UINT32_MAX, maxGap = 0;
+
+    sprintf(outBfr, "Burst capture %s: %u of %u samples, %u bytes per sample, %lu bytes free RAM",
+            states[meterBurstState], meterBurstCount, meterBurstSize, (unsigned) sizeof(meter_burst_t),
+            (unsigned long) meter_FreeRam());
+    SHOW();
+
+    if ( meterBurstCount > 1 )
+    {
+        total = meterBurstBfr[meterBurstCount - 1].usecs;
+
+        for ( int i = 1; i < meterBurstCount; i++ )
+        {
+            gap = meterBurstBfr[i].usecs - meterBurstBfr[i - 1].usecs;
+            minGap = (gap < minGap) ? gap : minGap;
+            maxGap = (gap > maxGap) ? gap : maxGap;
+        }
+
+        sprintf(outBfr, "Captured %lu usecs, %lu usecs per sample (%lu to %lu), %lu samples/sec, %lu periods missed",
+                (unsigned long) total, (unsigned long) (total / (meterBurstCount - 1)), (unsigned long) minGap,
+                (unsigned long) maxGap,
+                (unsigned long) ((total) ? (uint64_t) (meterBurstCount - 1) * 1000000 / total : 0),
+                (unsigned long) meterBurstMissed);
+        SHOW();
+    }
+}
+
+/**
+  * @name   meter_BurstDump
+  * @brief  dump the burst capture as CSV lines
+  * @param  None
+  * @retval None
+  */
+void meter_BurstDump(void)
+{
+    const meter_burst_t *b;
+
+    if ( meterBurstCount == 0 )
+    {
+        terminalOut((char *) "No burst samples; 'power burst arm' then power up the card");
+        return;
+    }
+
+    terminalOut((char *) "usecs,12V_mV,12V_mA,AUX_mV,AUX_mA");
+
+    for ( int i = 0; i < meterBurstCount; i++ )
+    {
+        b = &meterBurstBfr[i];
+        sprintf(outBfr, "%lu,%u,%ld,%u,%ld", (unsigned long) b->usecs,
+                INA219_BUS_MV(b->bus[METER_RAIL_12V]),
+                (long) (((int32_t) b->shunt[METER_RAIL_12V] * 10) / meterRails[METER_RAIL_12V].shuntMohms),
+                INA219_BUS_MV(b->bus[METER_RAIL_3V3_AUX]),
+                (long) (((int32_t) b->shunt[METER_RAIL_3V3_AUX] * 10) / meterRails[METER_RAIL_3V3_AUX].shuntMohms));
+        SHOW();
+    }
+}
@@ -0,0 +1,252 @@
+//===================================================================
+// monitor.cpp
+//
+// Edge monitor for the input pins in staticPins[].  Each input gets
+// an EIC callback if variant.cpp gives it an EXTINT line that no other
+// monitored pin already uses; the rest are compared against their last
+// level by monitor_Poll() from loop().  Every edge is counted per pin
+// and timestamped into a single producer/single consumer ring buffer
+// that 'pins log' drains.  Edges are also passed to power_PinEdge()
+// for power up timing.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "commands.hpp"
+#include "power.hpp"
+#include "monitor.hpp"
+#include "hal.hpp"
+#include "prof.hpp"
+
+// a monitored pin
+typedef struct {
+  uint8_t         pinNo;
+  bool            useEIC;
+  volatile uint8_t level;                 // last level seen
+  volatile uint32_t edges;
+} monitor_pin_t;
+
+static monitor_pin_t        monitorPins[MONITOR_MAX_PINS];
+static uint8_t              monitorPinCount = 0;
+static int8_t               monitorLineSlot[MONITOR_EXTINT_LINES];     // EXTINT line -> monitorPins[] index
+
+// ring buffer: ISR and monitor_Poll() write head, the consumer tail
+static volatile monitor_edge_t monitorLog[MONITOR_LOG_SIZE];
+static volatile uint8_t     monitorHead = 0;
+static volatile uint8_t     monitorTail = 0;
+static volatile uint32_t    monitorDropped = 0;
+
+
+/**
+  * @name   monitor_Edge
+  * @brief  count, log and forward an edge of a monitored pin
+  * @param  slot    index into monitorPins[]
+  * @param  level   pin level after the edge
+  * @param  usecs   hal_Micros() of the edge
+  * @param  polled  true if seen by monitor_Poll()
+  * @retval None
+  * @note   runs in EIC interrupt context, or with interrupts off
+  */
+static void monitor_Edge(uint8_t slot, uint8_t level, uint32_t usecs, bool polled)
+{
+    monitor_pin_t   *p = &monitorPins[slot];
+    uint8_t         head = monitorHead;
+    uint8_t         next = (head + 1) & (MONITOR_LOG_SIZE - 1);
+
+    p->level = level;
+    p->edges++;
+
+    power_PinEdge(p->pinNo, p->level, usecs);
+
+    if ( next == monitorTail )
+    {
+        monitorDropped++;
+        return;
+    }
+
+    monitorLog[head].usecs = usecs;
+    monitorLog[head].pinNo = p->pinNo;
+    monitorLog[head].level = p->level;
+    monitorLog[head].polled = polled;
+
+    // entry must be complete before the consumer can see it
+    hal_Barrier();
+    monitorHead = next;
+}
+
+/**
+  * @name   monitor_ExtIntISR
+  * @brief  EIC callback, one instance per EXTINT line
+  * @param  None
+  * @retval None
+  */
+template <uint8_t LINE>
+static void monitor_ExtIntISR(void)
+{
+    uint64_t        start = prof_Now();
+    uint32_t        now = hal_Micros();
+    uint8_t         slot = monitorLineSlot[LINE];
+
+    monitor_Edge(slot, hal_PinRead(monitorPins[slot].pinNo), now, false);
+    prof_Record(PROF_ISR_EIC, start);
+}
+
+static const hal_isr_t      monitorISRs[MONITOR_EXTINT_LINES] = {
+    monitor_ExtIntISR<0>,  monitor_ExtIntISR<1>,  monitor_ExtIntISR<2>,  monitor_ExtIntISR<3>,
+    monitor_ExtIntISR<4>,  monitor_ExtIntISR<5>,  monitor_ExtIntISR<6>,  monitor_ExtIntISR<7>,
+    monitor_ExtIntISR<8>,  monitor_ExtIntISR<9>,  monitor_ExtIntISR<10>, monitor_ExtIntISR<11>,
+    monitor_ExtIntISR<12>, monitor_ExtIntISR<13>, monitor_ExtIntISR<14>, monitor_ExtIntISR<15>
+};
+
+/**
+  * @name   monitorsInit
+  * @brief  start monitoring the input pins in staticPins[]
+  * @param  None
+  * @retval None
+  * @note   call after configureIOPins(); SCAN_DATA_IN is not monitored
+  *         and INPUT_PULLDOWN straps (BOARD_ID) are not inputs here
+  */
+void monitorsInit(void)
+{
+    monitor_pin_t   *p;
+    int             line;
+
+    memset(monitorLineSlot, -1, sizeof(monitorLineSlot));
+
+    for ( int i = 0; i < static_pin_count && monitorPinCount < MONITOR_MAX_PINS; i++ )
+    {
+        if ( staticPins[i].pinFunc != INPUT || staticPins[i].pinNo == OCP_SCAN_DATA_IN )
+            continue;
+
+        p = &monitorPins[monitorPinCount];
+        p->pinNo = staticPins[i].pinNo;
+        p->level = hal_PinRead(p->pinNo);
+        p->edges = 0;
+        p->useEIC = false;
+
+        // first pin on an EXTINT line gets it, the others are polled
+        line = hal_PinExtInt(p->pinNo);
+
+        if ( line != HAL_EXTINT_NONE && line < MONITOR_EXTINT_LINES && monitorLineSlot[line] == -1 )
+        {
+            monitorLineSlot[line] = monitorPinCount;
+            p->useEIC = true;
+            hal_PinAttach(p->pinNo, monitorISRs[line]);
+        }
+
+        monitorPinCount++;
+    }
+}
+
+/**
+  * @name   monitor_Poll
+  * @brief  check the monitored pins that have no EXTINT line
+  * @param  None
+  * @retval None
+  * @note   called from loop(); edges shorter than a loop() pass are missed
+  */
+void monitor_Poll(void)
+{
+    monitor_pin_t   *p;
+    pin_snapshot_t  snap;
+    uint8_t         level;
+
+    takePinSnapshot(&snap);
+
+    for ( int i = 0; i < monitorPinCount; i++ )
+    {
+        p = &monitorPins[i];
+        level = snapshotPin(&snap, p->pinNo);
+
+        if ( p->useEIC || level == p->level )
+            continue;
+
+        // the EIC callbacks also write the ring head
+        hal_IrqOff();
+        monitor_Edge(i, level, snap.usecs, true);
+        hal_IrqOn();
+    }
+}
+
+/**
+  * @name   monitor_GetEdge
+  * @brief  take the oldest edge from the ring buffer
+  * @param  edge  where to put it
+  * @retval true if an edge was returned, false if empty
+  */
+bool monitor_GetEdge(monitor_edge_t *edge)
+{
+    uint8_t         tail = monitorTail;
+
+    if ( tail == monitorHead )
+        return(false);
+
+    edge->usecs = monitorLog[tail].usecs;
+    edge->pinNo = monitorLog[tail].pinNo;
+    edge->level = monitorLog[tail].level;
+    edge->polled = monitorLog[tail].polled;
+
+    // entry must be read before the producer can reuse it
+    hal_Barrier();
+    monitorTail = (tail + 1) & (MONITOR_LOG_SIZE - 1);
+    return(true);
+}
+
+/**
+  * @name   monitor_ShowLog
+  * @brief  display and drain logged edges, then per pin counters
+  * @param  None
+  * @retval None
+  */
+void monitor_ShowLog(void)
+{
+    monitor_edge_t  edge;
+    monitor_pin_t   *p;
+    int             count = 0;
+
+    while ( monitor_GetEdge(&edge) )
+    {
+        sprintf(outBfr, "%10lu us  %2d %-16s -> %d%s", (unsigned long) edge.usecs, edge.pinNo, getPinName(edge.pinNo),
+                edge.level, (edge.polled) ? "  (polled)" : "");
+        SHOW();
+        count++;
+    }
+
+    if ( count == 0 )
+        terminalOut((char *) "No new edges");
+
+    if ( monitorDropped )
+    {
+        sprintf(outBfr, "%lu edges dropped, log full", (unsigned long) monitorDropped);
+        SHOW();
+    }
+
+    terminalOut((char *) " ");
+    terminalOut((char *) " #        Pin Name  Mode   State      Edges");
+
+    for ( int i = 0; i < monitorPinCount; i++ )
+    {
+        p = &monitorPins[i];
+        sprintf(outBfr, "%2d %16s  %-5s  %5d %10lu", p->pinNo, getPinName(p->pinNo),
+                (p->useEIC) ? "EIC" : "poll", p->level, (unsigned long) p->edges);
+        SHOW();
+    }
+}
+
+/**
+  * @name   monitor_Clear
+  * @brief  empty the edge log and zero the per pin counters
+  * @param  None
+  * @retval None
+  */
+void monitor_Clear(void)
+{
+    hal_IrqOff();
+    monitorTail = monitorHead;
+    monitorDropped = 0;
+
+    for ( int i = 0; i < monitorPinCount; i++ )
+        monitorPins[i].edges = 0;
+
+    hal_IrqOn();
+}
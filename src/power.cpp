@@ -0,0 +1,857 @@
+//===================================================================
+// power.cpp
+//
+// NIC 3.0 card power sequencer.  'power up card' and 'power down card'
+// only start a sequence; power_Poll(), called from loop(), steps the
+// state machine so the CLI, heartbeat and background sampling keep
+// running while the card powers up:
+//
+//   OFF -> MAIN_EN -> AUX_EN -> WAIT_PWRGOOD -> SCAN -> ON
+//
+// Removal of the card, loss of NIC_PWR_GOOD or assertion of TEMP_CRIT
+// while powered removes both enables and enters FAULT, which is left
+// with 'power down card' or another 'power up card'.
+//
+// Each cycle is timestamped with hal_Micros(): the enables from the state
+// machine, NIC_PWR_GOOD and PRSNTB edges from the pin monitor, and the
+// first valid scan chain sample from polling in the SCAN state.  A
+// cycle is committed to the 'power timing' history when it ends in OFF
+// or FAULT.
+//
+// 'power cycle' drives the same sequencer unattended: up, hold on_ms
+// in ON, down, hold off_ms in OFF, repeat.  Sequencer messages are
+// suppressed while it runs; each cycle prints one progress line and
+// is kept in a small RAM log.  Any keypress aborts it.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "commands.hpp"
+#include "eeprom.hpp"
+#include "scan.hpp"
+#include "power.hpp"
+#include "hal.hpp"
+
+extern EEPROM_data_t        EEPROMData;
+
+// timestamped events within one cycle
+typedef enum {
+  PWR_EVT_MAIN_EN = 0,
+  PWR_EVT_AUX_EN,
+  PWR_EVT_PWRGOOD_RISE,
+  PWR_EVT_PRSNT,
+  PWR_EVT_SCAN_VALID,
+  PWR_EVT_OFF,
+  PWR_EVT_PWRGOOD_FALL,
+  PWR_EVT_COUNT
+} PWR_EVT;
+
+#define PWR_EVT_BIT(e)      (1 << (e))
+
+typedef struct {
+  uint32_t        usecs[PWR_EVT_COUNT];
+  uint8_t         seen;                       // PWR_EVT_BIT() of each recorded event
+} pwr_events_t;
+
+static PWR_STATE            pwrState = PWR_STATE_OFF;
+static PWR_FAULT            pwrFault = PWR_FAULT_NONE;
+static uint32_t             pwrStateStart = 0;      // hal_Millis() at state entry
+static uint32_t             pwrScanPollStart = 0;   // hal_Millis() of last SCAN state sample
+
+// cycle in progress, also written by power_PinEdge() while armed
+static volatile pwr_events_t pwrEvents;
+static volatile bool        pwrTimingArmed = false;
+
+// completed cycles
+static power_timing_t       pwrTimingHistory[PWR_TIMING_HISTORY];
+static uint8_t              pwrTimingHead = 0;      // next entry to write
+static uint8_t              pwrTimingCount = 0;
+
+// start and end event of each PWR_DELTA
+static const PWR_EVT        pwrDeltaEvents[PWR_DELTA_COUNT][2] = {
+    {PWR_EVT_MAIN_EN, PWR_EVT_AUX_EN},
+    {PWR_EVT_MAIN_EN, PWR_EVT_PWRGOOD_RISE},
+    {PWR_EVT_AUX_EN,  PWR_EVT_PWRGOOD_RISE},
+    {PWR_EVT_MAIN_EN, PWR_EVT_PRSNT},
+    {PWR_EVT_MAIN_EN, PWR_EVT_SCAN_VALID},
+    {PWR_EVT_OFF,     PWR_EVT_PWRGOOD_FALL}
+};
+
+// 'power cycle' test phases
+typedef enum {
+  PWR_CYC_IDLE = 0,
+  PWR_CYC_UP,                                 // waiting for ON or FAULT
+  PWR_CYC_ON,                                 // holding on_ms
+  PWR_CYC_DOWN,                               // waiting for OFF or FAULT
+  PWR_CYC_OFF                                 // holding off_ms
+} PWR_CYC;
+
+static PWR_CYC              pwrCycPhase = PWR_CYC_IDLE;
+static uint32_t             pwrCycPhaseStart = 0;   // hal_Millis() at phase entry
+static uint32_t             pwrCycOnMsecs = 0;
+static uint32_t             pwrCycOffMsecs = 0;
+static power_cycle_log_t    pwrCycCur;              // cycle in progress
+
+// 'power cycle' results since the last start
+static power_cycle_log_t    pwrCycLog[PWR_CYCLE_LOG_SIZE];
+static uint8_t              pwrCycLogHead = 0;
+static uint8_t              pwrCycLogCount = 0;
+static power_cycle_stats_t  pwrCycStats;
+static uint32_t             pwrCycRefScan = 0;
+static bool                 pwrCycRefValid = false;
+
+static const char           *pwrDeltaNames[PWR_DELTA_COUNT] = {
+    "MAIN_EN -> AUX_EN", "MAIN_EN -> PWR_GOOD", "AUX_EN -> PWR_GOOD",
+    "MAIN_EN -> PRSNTB edge", "MAIN_EN -> scan valid", "EN off -> PWR_GOOD low"
+};
+
+static const char           *pwrStateNames[PWR_STATE_COUNT] = {
+    "OFF", "MAIN_EN", "AUX_EN", "WAIT_PWRGOOD", "SCAN", "ON", "POWER_DOWN", "FAULT"
+};
+
+static const char           *pwrFaultNames[PWR_FAULT_COUNT] = {
+    "none", "NIC_PWR_GOOD timeout", "NIC_PWR_GOOD lost", "TEMP_CRIT asserted", "NIC_PWR_GOOD stuck high",
+    "card removed"
+};
+
+/**
+  * @name   power_SetEvent
+  * @brief  timestamp an event of the cycle in progress
+  * @param  evt   event
+  * @param  now   hal_Micros() when it happened
+  * @retval None
+  * @note   first occurrence wins; caller must hold off the pin monitor
+  */
+static void power_SetEvent(PWR_EVT evt, uint32_t now)
+{
+    if ( (pwrEvents.seen & PWR_EVT_BIT(evt)) == 0 )
+    {
+        pwrEvents.usecs[evt] = now;
+        pwrEvents.seen |= PWR_EVT_BIT(evt);
+    }
+}
+
+/**
+  * @name   power_MarkEvent
+  * @brief  timestamp an event from the main loop
+  * @param  evt   event
+  * @retval None
+  */
+static void power_MarkEvent(PWR_EVT evt)
+{
+    uint32_t        now = hal_Micros();
+
+    if ( pwrTimingArmed == false )
+        return;
+
+    hal_IrqOff();
+    power_SetEvent(evt, now);
+    hal_IrqOn();
+}
+
+/**
+  * @name   power_StartTiming
+  * @brief  start timestamping a new cycle at MAIN_EN assertion
+  * @param  None
+  * @retval None
+  */
+static void power_StartTiming(void)
+{
+    hal_IrqOff();
+    pwrEvents.seen = 0;
+    pwrTimingArmed = true;
+    hal_IrqOn();
+
+    power_MarkEvent(PWR_EVT_MAIN_EN);
+}
+
+/**
+  * @name   power_CommitTiming
+  * @brief  stop timestamping and add the cycle to the history
+  * @param  None
+  * @retval None
+  */
+static void power_CommitTiming(void)
+{
+    power_timing_t  *entry = &pwrTimingHistory[pwrTimingHead];
+    PWR_EVT         from, to;
+
+    if ( pwrTimingArmed == false )
+        return;
+
+    pwrTimingArmed = false;
+
+    for ( int i = 0; i < PWR_DELTA_COUNT; i++ )
+    {
+        from = pwrDeltaEvents[i][0];
+        to = pwrDeltaEvents[i][1];
+
+        if ( (pwrEvents.seen & PWR_EVT_BIT(from)) && (pwrEvents.seen & PWR_EVT_BIT(to)) )
+            entry->delta[i] = pwrEvents.usecs[to] - pwrEvents.usecs[from];
+        else
+            entry->delta[i] = PWR_DELTA_NONE;
+    }
+
+    pwrTimingHead = (pwrTimingHead + 1) % PWR_TIMING_HISTORY;
+
+    if ( pwrTimingCount < PWR_TIMING_HISTORY )
+        pwrTimingCount++;
+}
+
+/**
+  * @name   power_EnterState
+  * @brief  change sequencer state and drive the enables for it
+  * @param  state  new state
+  * @retval None
+  */
+static void power_EnterState(PWR_STATE state)
+{
+    pwrState = state;
+    pwrStateStart = hal_Millis();
+
+    switch ( state )
+    {
+        case PWR_STATE_MAIN_EN:
+            writePin(OCP_MAIN_PWR_EN, 1);
+            power_StartTiming();
+            break;
+
+        case PWR_STATE_AUX_EN:
+            writePin(OCP_AUX_PWR_EN, 1);
+            power_MarkEvent(PWR_EVT_AUX_EN);
+            break;
+
+        case PWR_STATE_SCAN:
+            pwrScanPollStart = pwrStateStart;
+            break;
+
+        case PWR_STATE_POWER_DOWN:
+            writePin(OCP_MAIN_PWR_EN, 0);
+            writePin(OCP_AUX_PWR_EN, 0);
+            power_MarkEvent(PWR_EVT_OFF);
+            break;
+
+        case PWR_STATE_FAULT:
+            writePin(OCP_MAIN_PWR_EN, 0);
+            writePin(OCP_AUX_PWR_EN, 0);
+            power_CommitTiming();
+            break;
+
+        case PWR_STATE_OFF:
+            power_CommitTiming();
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+  * @name   power_EnterFault
+  * @brief  remove power and report a fault
+  * @param  fault  reason
+  * @retval None
+  */
+static void power_EnterFault(PWR_FAULT fault)
+{
+    pwrFault = fault;
+    power_EnterState(PWR_STATE_FAULT);
+
+    // 'power cycle' reports faults in its progress lines
+    if ( pwrCycPhase != PWR_CYC_IDLE )
+        return;
+
+    sprintf(outBfr, "Power fault: %s; NIC power removed", pwrFaultNames[fault]);
+    terminalOut(outBfr);
+    doPrompt();
+}
+
+/**
+  * @name   power_Up
+  * @brief  start NIC power up sequence
+  * @param  None
+  * @retval true if started, false if sequence already running or card up
+  */
+bool power_Up(void)
+{
+    if ( pwrState != PWR_STATE_OFF && pwrState != PWR_STATE_FAULT )
+        return(false);
+
+    pwrFault = PWR_FAULT_NONE;
+    power_EnterState(PWR_STATE_MAIN_EN);
+    return(true);
+}
+
+/**
+  * @name   power_Down
+  * @brief  start NIC power down sequence
+  * @param  None
+  * @retval None
+  * @note   also aborts a power up sequence in progress
+  */
+void power_Down(void)
+{
+    pwrFault = PWR_FAULT_NONE;
+    power_EnterState(PWR_STATE_POWER_DOWN);
+}
+
+/**
+  * @name   power_CycleEnd
+  * @brief  log the 'power cycle' cycle just finished and report it
+  * @param  None
+  * @retval None
+  */
+static void power_CycleEnd(void)
+{
+    power_cycle_log_t   *c = &pwrCycCur;
+    int                 len;
+
+    if ( c->fault == PWR_FAULT_NONE )
+    {
+        if ( pwrCycRefValid == false )
+        {
+            pwrCycRefScan = c->scanWord;
+            pwrCycRefValid = true;
+        }
+        else if ( c->scanWord != pwrCycRefScan )
+        {
+            c->scanMismatch = true;
+            pwrCycStats.mismatches++;
+        }
+
+        if ( c->scanMismatch == false )
+            pwrCycStats.pass++;
+    }
+    else
+    {
+        pwrCycStats.faults[c->fault]++;
+    }
+
+    if ( c->pwrGoodUsecs != PWR_DELTA_NONE )
+    {
+        if ( pwrCycStats.pwrGoodCount == 0 || c->pwrGoodUsecs < pwrCycStats.pwrGoodMin )
+            pwrCycStats.pwrGoodMin = c->pwrGoodUsecs;
+
+        if ( c->pwrGoodUsecs > pwrCycStats.pwrGoodMax )
+            pwrCycStats.pwrGoodMax = c->pwrGoodUsecs;
+
+        pwrCycStats.pwrGoodSum += c->pwrGoodUsecs;
+        pwrCycStats.pwrGoodCount++;
+    }
+
+    pwrCycLog[pwrCycLogHead] = *c;
+    pwrCycLogHead = (pwrCycLogHead + 1) % PWR_CYCLE_LOG_SIZE;
+
+    if ( pwrCycLogCount < PWR_CYCLE_LOG_SIZE )
+        pwrCycLogCount++;
+
+    pwrCycStats.done++;
+
+    len = sprintf(outBfr, "Cycle %lu/%lu: PWR_GOOD ", (unsigned long) c->cycle, (unsigned long) pwrCycStats.count);
+
+    if ( c->pwrGoodUsecs == PWR_DELTA_NONE )
+        len += sprintf(&outBfr[len], "- usecs");
+    else
+        len += sprintf(&outBfr[len], "%lu usecs", (unsigned long) c->pwrGoodUsecs);
+
+    sprintf(&outBfr[len], ", scan %08lX, %s", (unsigned long) c->scanWord,
+            (c->fault != PWR_FAULT_NONE) ? pwrFaultNames[c->fault] :
+            (c->scanMismatch) ? "scan mismatch" : "OK");
+    SHOW();
+}
+
+/**
+  * @name   power_CycleStep
+  * @brief  step the 'power cycle' test around the sequencer
+  * @param  None
+  * @retval None
+  */
+static void power_CycleStep(void)
+{
+    uint32_t        elapsed = hal_Millis() - pwrCycPhaseStart;
+
+    switch ( pwrCycPhase )
+    {
+        case PWR_CYC_UP:
+            if ( pwrState == PWR_STATE_ON )
+            {
+                pwrCycCur.scanWord = scan_GetWord(0);
+                pwrCycPhase = PWR_CYC_ON;
+                pwrCycPhaseStart = hal_Millis();
+                break;
+            }
+            // fall through; a fault while powering up is handled like one while on
+
+        case PWR_CYC_ON:
+            if ( pwrState == PWR_STATE_FAULT )
+            {
+                // power down anyway so NIC_PWR_GOOD is low before the next cycle
+                pwrCycCur.fault = pwrFault;
+                pwrCycPhase = PWR_CYC_DOWN;
+                power_Down();
+            }
+            else if ( pwrCycPhase == PWR_CYC_ON && elapsed >= pwrCycOnMsecs )
+            {
+                pwrCycPhase = PWR_CYC_DOWN;
+                power_Down();
+            }
+            break;
+
+        case PWR_CYC_DOWN:
+            if ( pwrState == PWR_STATE_OFF || pwrState == PWR_STATE_FAULT )
+            {
+                if ( pwrState == PWR_STATE_FAULT && pwrCycCur.fault == PWR_FAULT_NONE )
+                    pwrCycCur.fault = pwrFault;
+
+                power_CycleEnd();
+
+                if ( pwrCycStats.done >= pwrCycStats.count )
+                {
+                    pwrCycPhase = PWR_CYC_IDLE;
+                    terminalOut((char *) "Power cycle test complete");
+                    power_ShowCycle();
+                    doPrompt();
+                    break;
+                }
+
+                pwrCycPhase = PWR_CYC_OFF;
+                pwrCycPhaseStart = hal_Millis();
+            }
+            break;
+
+        case PWR_CYC_OFF:
+            if ( elapsed >= pwrCycOffMsecs )
+            {
+                memset(&pwrCycCur, 0, sizeof(pwrCycCur));
+                pwrCycCur.cycle = pwrCycStats.done + 1;
+                pwrCycCur.pwrGoodUsecs = PWR_DELTA_NONE;
+                pwrCycPhase = PWR_CYC_UP;
+                power_Up();
+            }
+            break;
+
+        case PWR_CYC_IDLE:
+        default:
+            break;
+    }
+
+    // MAIN_EN -> NIC_PWR_GOOD of the cycle in progress, once seen
+    if ( pwrCycPhase == PWR_CYC_UP && pwrCycCur.pwrGoodUsecs == PWR_DELTA_NONE &&
+         (pwrEvents.seen & PWR_EVT_BIT(PWR_EVT_PWRGOOD_RISE)) )
+    {
+        pwrCycCur.pwrGoodUsecs = pwrEvents.usecs[PWR_EVT_PWRGOOD_RISE] - pwrEvents.usecs[PWR_EVT_MAIN_EN];
+    }
+}
+
+/**
+  * @name   power_Poll
+  * @brief  step the power sequencer
+  * @param  None
+  * @retval None
+  * @note   called from loop(), never blocks except for the scan
+  *         chain capture at the end of the SCAN state
+  */
+void power_Poll(void)
+{
+    uint32_t        elapsed;
+
+    // may start a new power up, so the state time is taken after it
+    power_CycleStep();
+    elapsed = hal_Millis() - pwrStateStart;
+
+    // fault monitoring while any enable is asserted by the sequencer;
+    // a pulled card also drops NIC_PWR_GOOD, so it is checked first
+    if ( pwrState >= PWR_STATE_MAIN_EN && pwrState <= PWR_STATE_ON )
+    {
+        if ( isCardPresent() == false )
+        {
+            power_EnterFault(PWR_FAULT_CARD_REMOVED);
+            return;
+        }
+
+        if ( readPin(TEMP_CRIT) )
+        {
+            power_EnterFault(PWR_FAULT_TEMP_CRIT);
+            return;
+        }
+
+        if ( pwrState >= PWR_STATE_SCAN && readPin(NIC_PWR_GOOD_JMP) == 0 )
+        {
+            power_EnterFault(PWR_FAULT_PWRGOOD_LOST);
+            return;
+        }
+    }
+
+    switch ( pwrState )
+    {
+        case PWR_STATE_MAIN_EN:
+            if ( elapsed >= EEPROMData.pwr_seq_delay_msec )
+                power_EnterState(PWR_STATE_AUX_EN);
+            break;
+
+        case PWR_STATE_AUX_EN:
+            power_EnterState(PWR_STATE_WAIT_PWRGOOD);
+            break;
+
+        case PWR_STATE_WAIT_PWRGOOD:
+            if ( readPin(NIC_PWR_GOOD_JMP) )
+            {
+                if ( pwrCycPhase == PWR_CYC_IDLE )
+                {
+                    terminalOut((char *) "Power up sequence complete");
+                    terminalOut((char *) "Waiting for scan chain data...");
+                }
+
+                power_EnterState(PWR_STATE_SCAN);
+            }
+            else if ( elapsed >= PWR_PWRGOOD_TIMEOUT_MSEC )
+            {
+                power_EnterFault(PWR_FAULT_PWRGOOD_TIMEOUT);
+            }
+            break;
+
+        case PWR_STATE_SCAN:
+            // timestamp the first sample that is not all 0s or all 1s
+            if ( (pwrEvents.seen & PWR_EVT_BIT(PWR_EVT_SCAN_VALID)) == 0 &&
+                 hal_Millis() - pwrScanPollStart >= PWR_SCAN_POLL_MSEC )
+            {
+                uint32_t    word = scan_Capture();
+
+                pwrScanPollStart = hal_Millis();
+
+                if ( word != 0 && word != 0xFFFFFFFF )
+                    power_MarkEvent(PWR_EVT_SCAN_VALID);
+            }
+
+            if ( elapsed >= PWR_SCAN_DELAY_MSEC )
+            {
+                queryScanChain(false);
+
+                if ( pwrCycPhase == PWR_CYC_IDLE )
+                {
+                    queryScanChain(true);
+                    doPrompt();
+                }
+
+                power_EnterState(PWR_STATE_ON);
+            }
+            break;
+
+        case PWR_STATE_POWER_DOWN:
+            if ( readPin(NIC_PWR_GOOD_JMP) == 0 )
+            {
+                power_EnterState(PWR_STATE_OFF);
+
+                if ( pwrCycPhase == PWR_CYC_IDLE )
+                {
+                    terminalOut((char *) "Power down sequence complete");
+                    doPrompt();
+                }
+            }
+            else if ( elapsed >= PWR_DOWN_TIMEOUT_MSEC )
+            {
+                power_EnterFault(PWR_FAULT_POWER_DOWN);
+            }
+            break;
+
+        case PWR_STATE_OFF:
+        case PWR_STATE_ON:
+        case PWR_STATE_FAULT:
+        default:
+            break;
+    }
+}
+
+/**
+  * @name   power_GetState
+  * @brief  get current sequencer state
+  * @param  None
+  * @retval state
+  */
+PWR_STATE power_GetState(void)
+{
+    return(pwrState);
+}
+
+/**
+  * @name   power_GetStateMsecs
+  * @brief  get time spent in the current state
+  * @param  None
+  * @retval msecs since state was entered
+  */
+uint32_t power_GetStateMsecs(void)
+{
+    return(hal_Millis() - pwrStateStart);
+}
+
+/**
+  * @name   power_GetStateName
+  * @brief  get printable name of a sequencer state
+  * @param  state
+  * @retval pointer to name or 'unknown'
+  */
+const char *power_GetStateName(PWR_STATE state)
+{
+    if ( state >= PWR_STATE_COUNT )
+        return("unknown");
+
+    return(pwrStateNames[state]);
+}
+
+/**
+  * @name   power_GetFault
+  * @brief  get reason for the last fault
+  * @param  None
+  * @retval fault, PWR_FAULT_NONE if none since last power up/down
+  */
+PWR_FAULT power_GetFault(void)
+{
+    return(pwrFault);
+}
+
+/**
+  * @name   power_GetFaultName
+  * @brief  get printable fault reason
+  * @param  fault
+  * @retval pointer to name or 'unknown'
+  */
+const char *power_GetFaultName(PWR_FAULT fault)
+{
+    if ( fault >= PWR_FAULT_COUNT )
+        return("unknown");
+
+    return(pwrFaultNames[fault]);
+}
+
+/**
+  * @name   power_ShowTiming
+  * @brief  display last cycle timing and min/max/mean over the history
+  * @param  None
+  * @retval None
+  */
+void power_ShowTiming(void)
+{
+    const power_timing_t    *last;
+    uint32_t                delta, min, max, sum;
+    uint8_t                 cnt;
+    int                     len;
+
+    if ( pwrTimingCount == 0 )
+    {
+        terminalOut((char *) "No power cycles recorded; use 'power up card' then 'power down card'");
+        return;
+    }
+
+    if ( pwrTimingArmed )
+        terminalOut((char *) "Cycle in progress; 'last' is the previous completed cycle");
+
+    last = &pwrTimingHistory[(pwrTimingHead + PWR_TIMING_HISTORY - 1) % PWR_TIMING_HISTORY];
+
+    sprintf(outBfr, "Power timing in usecs over last %d cycles:", pwrTimingCount);
+    SHOW();
+    sprintf(outBfr, "%-24s %10s %10s %10s %10s %5s", "Interval", "last", "min", "max", "mean", "count");
+    SHOW();
+
+    for ( int i = 0; i < PWR_DELTA_COUNT; i++ )
+    {
+        min = PWR_DELTA_NONE;
+        max = sum = 0;
+        cnt = 0;
+
+        for ( int j = 0; j < pwrTimingCount; j++ )
+        {
+            delta = pwrTimingHistory[j].delta[i];
+
+            if ( delta == PWR_DELTA_NONE )
+                continue;
+
+            min = (delta < min) ? delta : min;
+            max = (delta > max) ? delta : max;
+            sum += delta;
+            cnt++;
+        }
+
+        len = sprintf(outBfr, "%-24s ", pwrDeltaNames[i]);
+
+        if ( last->delta[i] == PWR_DELTA_NONE )
+            len += sprintf(&outBfr[len], "%10s ", "-");
+        else
+            len += sprintf(&outBfr[len], "%10lu ", (unsigned long) last->delta[i]);
+
+        if ( cnt == 0 )
+            sprintf(&outBfr[len], "%10s %10s %10s %5d", "-", "-", "-", cnt);
+        else
+            sprintf(&outBfr[len], "%10lu %10lu %10lu %5d", (unsigned long) min, (unsigned long) max,
+                    (unsigned long) (sum / cnt), cnt);
+
+        SHOW();
+    }
+}
+
+/**
+  * @name   power_ClearTiming
+  * @brief  clear the power up timing history
+  * @param  None
+  * @retval None
+  */
+void power_ClearTiming(void)
+{
+    pwrTimingHead = 0;
+    pwrTimingCount = 0;
+}
+
+/**
+  * @name   power_StartCycle
+  * @brief  start a 'power cycle' stress test
+  * @param  count     number of cycles
+  * @param  onMsecs   time to stay in ON each cycle
+  * @param  offMsecs  time to stay in OFF between cycles
+  * @retval true if started, false if the card is not powered down
+  */
+bool power_StartCycle(uint32_t count, uint32_t onMsecs, uint32_t offMsecs)
+{
+    if ( pwrCycPhase != PWR_CYC_IDLE || (pwrState != PWR_STATE_OFF && pwrState != PWR_STATE_FAULT) )
+        return(false);
+
+    pwrCycOnMsecs = onMsecs;
+    pwrCycOffMsecs = offMsecs;
+
+    pwrCycLogHead = pwrCycLogCount = 0;
+    memset(&pwrCycStats, 0, sizeof(pwrCycStats));
+    pwrCycStats.count = count;
+    pwrCycRefValid = false;
+
+    // first cycle starts without the off time
+    pwrCycPhase = PWR_CYC_OFF;
+    pwrCycPhaseStart = hal_Millis() - offMsecs;
+    return(true);
+}
+
+/**
+  * @name   power_AbortCycle
+  * @brief  stop a running 'power cycle' test and power the card down
+  * @param  None
+  * @retval true if a test was running
+  * @note   called from loop() on any keypress
+  */
+bool power_AbortCycle(void)
+{
+    if ( pwrCycPhase == PWR_CYC_IDLE )
+        return(false);
+
+    pwrCycPhase = PWR_CYC_IDLE;
+    power_Down();
+
+    sprintf(outBfr, "Power cycle test aborted after %lu cycles; powering down", (unsigned long) pwrCycStats.done);
+    SHOW();
+    power_ShowCycle();
+    doPrompt();
+    return(true);
+}
+
+/**
+  * @name   power_GetCycleStats
+  * @brief  get 'power cycle' totals since the last start
+  * @param  None
+  * @retval pointer to totals, running until done == count
+  */
+const power_cycle_stats_t *power_GetCycleStats(void)
+{
+    return(&pwrCycStats);
+}
+
+/**
+  * @name   power_ShowCycle
+  * @brief  display 'power cycle' totals and log
+  * @param  None
+  * @retval None
+  */
+void power_ShowCycle(void)
+{
+    const power_cycle_log_t *c;
+    int                     len;
+
+    if ( pwrCycStats.done == 0 )
+    {
+        terminalOut((char *) "No power cycle test results");
+        return;
+    }
+
+    sprintf(outBfr, "Cycles: %lu of %lu  passed: %lu  scan mismatches: %lu", (unsigned long) pwrCycStats.done,
+            (unsigned long) pwrCycStats.count, (unsigned long) pwrCycStats.pass, (unsigned long) pwrCycStats.mismatches);
+    SHOW();
+
+    if ( pwrCycStats.pwrGoodCount )
+    {
+        sprintf(outBfr, "MAIN_EN -> PWR_GOOD usecs: min %lu  max %lu  mean %lu",
+                (unsigned long) pwrCycStats.pwrGoodMin, (unsigned long) pwrCycStats.pwrGoodMax,
+                (unsigned long) (pwrCycStats.pwrGoodSum / pwrCycStats.pwrGoodCount));
+        SHOW();
+    }
+
+    for ( int i = PWR_FAULT_NONE + 1; i < PWR_FAULT_COUNT; i++ )
+    {
+        if ( pwrCycStats.faults[i] == 0 )
+            continue;
+
+        sprintf(outBfr, "  %-24s %lu", pwrFaultNames[i], (unsigned long) pwrCycStats.faults[i]);
+        SHOW();
+    }
+
+    sprintf(outBfr, "Last %d cycles:", pwrCycLogCount);
+    SHOW();
+
+    for ( int i = 0; i < pwrCycLogCount; i++ )
+    {
+        c = &pwrCycLog[(pwrCycLogHead + PWR_CYCLE_LOG_SIZE - pwrCycLogCount + i) % PWR_CYCLE_LOG_SIZE];
+
+        len = sprintf(outBfr, "%8lu  ", (unsigned long) c->cycle);
+
+        if ( c->pwrGoodUsecs == PWR_DELTA_NONE )
+            len += sprintf(&outBfr[len], "%10s  ", "-");
+        else
+            len += sprintf(&outBfr[len], "%10lu  ", (unsigned long) c->pwrGoodUsecs);
+
+        sprintf(&outBfr[len], "%08lX  %s", (unsigned long) c->scanWord,
+                (c->fault != PWR_FAULT_NONE) ? pwrFaultNames[c->fault] :
+                (c->scanMismatch) ? "scan mismatch" : "OK");
+        SHOW();
+    }
+}
+
+/**
+  * @name   power_PinEdge
+  * @brief  timestamp NIC_PWR_GOOD and PRSNTBx_N edges of the cycle in progress
+  * @param  pinNo   Arduino pin # that changed
+  * @param  level   pin level after the edge
+  * @param  usecs   hal_Micros() of the edge
+  * @retval None
+  * @note   called by the pin monitor from EIC interrupt context or with
+  *         interrupts off; the NIC_PWR_GOOD falling edge is only of
+  *         interest after the enables are removed
+  */
+void power_PinEdge(uint8_t pinNo, bool level, uint32_t usecs)
+{
+    if ( pwrTimingArmed == false )
+        return;
+
+    switch ( pinNo )
+    {
+        case NIC_PWR_GOOD_JMP:
+            if ( level )
+                power_SetEvent(PWR_EVT_PWRGOOD_RISE, usecs);
+            else if ( pwrEvents.seen & PWR_EVT_BIT(PWR_EVT_OFF) )
+                power_SetEvent(PWR_EVT_PWRGOOD_FALL, usecs);
+            break;
+
+        case OCP_PRSNTB0_N:
+        case OCP_PRSNTB1_N:
+        case OCP_PRSNTB2_N:
+        case OCP_PRSNTB3_N:
+            power_SetEvent(PWR_EVT_PRSNT, usecs);
+            break;
+
+        default:
+            break;
+    }
+}
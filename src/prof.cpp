@@ -0,0 +1,136 @@
+//===================================================================
+// prof.cpp
+//
+// Cycle-resolution timing from hal_Cycles(), a 64-bit CPU cycle
+// count built from SysTick on the M0+ (see hal_samd21.cpp), exact in
+// any context.
+//
+// Each site keeps count, min, max, total and a log4 histogram.  The
+// sites are the CLI command dispatches in cli(), the TC5, USB, DMAC
+// and EXTINT interrupts and the INA219 and FRU EEPROM I2C
+// transactions.  'xdebug prof [clear]' shows or zeroes them.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "prof.hpp"
+#include "hal.hpp"
+
+static prof_site_t      profSites[PROF_SITE_COUNT];
+
+static const char       *profNames[PROF_CMD_FIRST] = {
+    "isr tc5", "isr usb", "isr dmac", "isr eic", "i2c ina219", "i2c fru"
+};
+
+// bucket upper limits for display, 4^(n+1) cycles; the last bucket
+// is everything from 1G on
+static const char       *profBucketNames[PROF_BUCKETS] = {
+    "4", "16", "64", "256", "1K", "4K", "16K", "64K",
+    "256K", "1M", "4M", "16M", "64M", "256M", "1G", "1G"
+};
+
+/**
+  * @name   prof_Now
+  * @brief  CPU cycles since reset
+  * @param  None
+  * @retval cycles
+  * @note   may be called from an ISR
+  */
+uint64_t prof_Now(void)
+{
+    return(hal_Cycles());
+}
+
+/**
+  * @name   prof_Record
+  * @brief  add the time since 'start' to a site
+  * @param  site
+  * @param  start   prof_Now() at the start of the timed code
+  * @retval None
+  * @note   a site must be recorded from one context only, an ISR
+  *         or the foreground
+  */
+void prof_Record(PROF_SITE site, uint64_t start)
+{
+    uint64_t        elapsed = prof_Now() - start;
+    uint32_t        cycles = (elapsed > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) elapsed;
+    prof_site_t     *p = &profSites[site];
+    uint8_t         bucket = 0;
+
+    for ( uint32_t c = cycles >> 2; c != 0 && bucket < PROF_BUCKETS - 1; c >>= 2 )
+        bucket++;
+
+    if ( p->count == 0 || cycles < p->minCycles )
+        p->minCycles = cycles;
+
+    if ( cycles > p->maxCycles )
+        p->maxCycles = cycles;
+
+    p->count++;
+    p->totalCycles += cycles;
+    p->buckets[bucket]++;
+}
+
+/**
+  * @name   prof_Show
+  * @brief  display sites that have run, with their histograms
+  * @param  None
+  * @retval None
+  */
+void prof_Show(void)
+{
+    prof_site_t     site;
+    uint64_t        start;
+    uint32_t        overhead;
+    char            *s;
+
+    // cost of the timing itself, included in every figure below
+    start = prof_Now();
+    overhead = (uint32_t) (prof_Now() - start);
+
+    sprintf(outBfr, "cycles at %lu MHz, timing overhead about %lu cycles", (unsigned long) (F_CPU / 1000000),
+            (unsigned long) overhead);
+    SHOW();
+    terminalOut((char *) "site          count        min       mean        max");
+
+    for ( int i = 0; i < PROF_SITE_COUNT; i++ )
+    {
+        // ISRs update their sites, take a consistent copy
+        hal_IrqOff();
+        site = profSites[i];
+        hal_IrqOn();
+
+        if ( site.count == 0 )
+            continue;
+
+        sprintf(outBfr, "%-10s %8lu %10lu %10lu %10lu", (i < PROF_CMD_FIRST) ? profNames[i] : cli_CommandName(i - PROF_CMD_FIRST),
+                (unsigned long) site.count, (unsigned long) site.minCycles,
+                (unsigned long) (site.totalCycles / site.count), (unsigned long) site.maxCycles);
+        SHOW();
+
+        // histogram, non-empty buckets as <limit:count
+        s = outBfr + sprintf(outBfr, "   ");
+
+        for ( int b = 0; b < PROF_BUCKETS; b++ )
+        {
+            if ( site.buckets[b] != 0 && s < outBfr + OUTBFR_SIZE - 24 )
+                s += sprintf(s, " %s%s:%lu", (b == PROF_BUCKETS - 1) ? ">=" : "<", profBucketNames[b],
+                        (unsigned long) site.buckets[b]);
+        }
+
+        SHOW();
+    }
+}
+
+/**
+  * @name   prof_Clear
+  * @brief  zero all sites
+  * @param  None
+  * @retval None
+  */
+void prof_Clear(void)
+{
+    hal_IrqOff();
+    memset(profSites, 0, sizeof(profSites));
+    hal_IrqOn();
+}
@@ -0,0 +1,608 @@
+//===================================================================
+// scan.cpp
+//
+// NIC 3.0 scan chain capture engine.  The chain is shifted by
+// SERCOM0 in SPI master mode, polled or by the DMAC (hal_ScanShift()
+// in hal_scan.cpp), or by the legacy TC5 bit-bang ISR in timers.cpp,
+// which is kept as a fallback mode.
+//
+// Chain length is a runtime setting (8..SCAN_MAX_BITS in whole bytes)
+// and can be detected by shifting a marker in on SCAN_DATA_OUT and
+// counting the bytes until it comes back out on SCAN_DATA_IN.
+//
+// Background sampling captures the chain from loop() every N msecs and
+// keeps only samples that differ from the previous one (first 32 bits)
+// in a ring buffer, optionally streaming the changed bits as they occur.
+// Nothing is shifted while no card is present, and the first sample
+// after a card is inserted is always logged.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "scan.hpp"
+#include "commands.hpp"
+#include "hal.hpp"
+
+#define SCAN_MARKER_BYTES         2
+#define SCAN_BUFFER_BYTES         (SCAN_MAX_BYTES + SCAN_MARKER_BYTES)
+
+// last capture, 1st bit in is bit 31 of word 0; the TC5 ISR in
+// timers.cpp writes it directly
+volatile uint32_t           scanShiftRegister[SCAN_MAX_WORDS];
+
+typedef struct {
+    uint8_t     bitNo;
+    char        bitName[SCAN_BIT_NAME_SZ];
+} scan_data_t;
+
+// NOTE: This table is in the order bits are shifted in, which is
+// byte 0 bit 7 first.  The bitNo entry is NOT used.  Bytes 4..6 carry
+// ports 8..15 on extended chains, continuing the LINK_SPDA, LINK_SPDB,
+// ACT per-port pattern of bytes 1..3.  Bytes past the table are shown
+// as reserved.
+static const scan_data_t    scanBitNames[] = {
+    // Byte 0
+    {7, "0.7 FAN_ON_AUX"},
+    {6, "0.6 TEMP_CRIT_N"},
+    {5, "0.5 TEMP_WARN_N"},
+    {4, "0.4 WAKE_N"},
+    {3, "0.3 PRSNTB[3]_P#"},
+    {2, "0.2 PRSNTB[2]_P#"},
+    {1, "0.1 PRSNTB[1]_P#"},
+    {0, "0.0 PRSNTB[0]_P#"},
+
+    // Byte 1
+    {15, "1.7 LINK_SPDB_P2#"},
+    {14, "1.6 LINK_SPDA_P2#"},
+    {13, "1.5 ACT_P1#"},
+    {12, "1.4 LINK_SPDB_P1#"},
+    {11, "1.3 LINK_SPDA_P1#"},
+    {10, "1.2 ACT_PO#"},
+    {9, "1.1 LINK_SPDB_PO#"},
+    {8, "1.0 LINK_SPDA_PO#"},
+
+    // Byte 2
+    {23, "2.7 LINK_SPDA_P5#"},
+    {22, "2.6 ACT_P4#"},
+    {21, "2.5 LINK_SPDB_P4#"},
+    {20, "2.4 LINK_SPDA_P4#"},
+    {19, "2.3 ACT_P3#"},
+    {18, "2.2 LINK_SPDB_P3#"},
+    {17, "2.1 LINK_SPDA_P3#"},
+    {16, "2.0 ACT_P2#"},
+
+    // Byte 3
+    {31, "3.7 ACT_P7#"},
+    {30, "3.6 LINK_SPDB_P7#"},
+    {29, "3.5 LINK_SPDA_P7#"},
+    {28, "3.4 ACT_P6#"},
+    {27, "3.3 LINK_SPDB_P6#"},
+    {26, "3.2 LINK_SPDA_P6#"},
+    {25, "3.1 ACT_P5#"},
+    {24, "3.0 LINK_SPDB_P5#"},
+
+    // Byte 4
+    {39, "4.7 LINK_SPDB_P10#"},
+    {38, "4.6 LINK_SPDA_P10#"},
+    {37, "4.5 ACT_P9#"},
+    {36, "4.4 LINK_SPDB_P9#"},
+    {35, "4.3 LINK_SPDA_P9#"},
+    {34, "4.2 ACT_P8#"},
+    {33, "4.1 LINK_SPDB_P8#"},
+    {32, "4.0 LINK_SPDA_P8#"},
+
+    // Byte 5
+    {47, "5.7 LINK_SPDA_P13#"},
+    {46, "5.6 ACT_P12#"},
+    {45, "5.5 LINK_SPDB_P12#"},
+    {44, "5.4 LINK_SPDA_P12#"},
+    {43, "5.3 ACT_P11#"},
+    {42, "5.2 LINK_SPDB_P11#"},
+    {41, "5.1 LINK_SPDA_P11#"},
+    {40, "5.0 ACT_P10#"},
+
+    // Byte 6
+    {55, "6.7 ACT_P15#"},
+    {54, "6.6 LINK_SPDB_P15#"},
+    {53, "6.5 LINK_SPDA_P15#"},
+    {52, "6.4 ACT_P14#"},
+    {51, "6.3 LINK_SPDB_P14#"},
+    {50, "6.2 LINK_SPDA_P14#"},
+    {49, "6.1 ACT_P13#"},
+    {48, "6.0 LINK_SPDB_P13#"},
+};
+
+static const uint16_t       scanBitNameCount = sizeof(scanBitNames) / sizeof(scan_data_t);
+
+static SCAN_MODE            scanMode = SCAN_MODE_SPI;
+static uint16_t             scanChainBits = SCAN_DEFAULT_BITS;
+static scan_stats_t         scanStats[SCAN_MODE_COUNT];
+static const char           *scanModeNames[SCAN_MODE_COUNT] = {"spi", "dma", "tc5"};
+
+// SCAN_DATA_OUT is driven low while the chain is shifted except
+// during length detection
+static uint8_t              scanTxBuffer[SCAN_BUFFER_BYTES] = {0};
+static uint8_t              scanRxBuffer[SCAN_BUFFER_BYTES];
+
+// background sampling log entry
+typedef struct {
+    uint32_t    msecs;                  // hal_Millis() at capture
+    uint32_t    word;                   // scan chain bits 0..31 (word 0)
+} scan_log_t;
+
+static scan_log_t           scanLog[SCAN_LOG_SIZE];
+static uint16_t             scanLogHead = 0;        // next entry to write
+static uint16_t             scanLogCount = 0;
+static uint32_t             scanSamplePeriod = 0;   // msecs, 0 = off
+static uint32_t             scanLastSample;
+static bool                 scanStream = false;
+static uint32_t             scanSamples = 0;
+static uint32_t             scanDuplicates = 0;
+static uint32_t             scanNoCard = 0;         // samples skipped, no card
+static bool                 scanHavePrev = false;   // false = next sample is logged
+
+/**
+  * @name   scan_Capture
+  * @brief  capture the scan chain using the current mode
+  * @param  None
+  * @retval uint32_t  first 32 bits of scan chain data
+  * @note   all bits are in scanShiftRegister[], 1st bit in is bit 31
+  *         of word 0
+  */
+uint32_t scan_Capture(void)
+{
+    scan_stats_t    *stats = &scanStats[scanMode];
+    uint32_t        start = hal_Micros();
+    uint32_t        idle = 0;
+    uint16_t        len = (scanChainBits + 7) / 8;
+
+    if ( scanMode == SCAN_MODE_TC5 )
+    {
+        // foreground spins until the ISR has clocked in all bits
+        timers_scanChainCapture(scanChainBits);
+    }
+    else
+    {
+        idle = hal_ScanShift(scanTxBuffer, scanRxBuffer, len, (scanMode == SCAN_MODE_DMA));
+
+        // a chain that is not whole bytes is followed by SCAN_DATA_OUT
+        // bits, which are not chain data
+        if ( scanChainBits & 7 )
+            scanRxBuffer[len - 1] &= 0xFF << (8 - (scanChainBits & 7));
+
+        // first byte shifted in is byte 0 which lands in bits 31..24
+        memset((void *) scanShiftRegister, 0, SCAN_MAX_BYTES);
+        for ( uint16_t i = 0; i < len; i++ )
+        {
+            scanShiftRegister[i >> 2] |= (uint32_t) scanRxBuffer[i] << (24 - 8 * (i & 3));
+        }
+    }
+
+    stats->captures++;
+    stats->captureUsecs = hal_Micros() - start;
+    stats->cpuUsecs = stats->captureUsecs - idle;
+
+    if ( stats->captureUsecs > stats->maxCaptureUsecs )
+        stats->maxCaptureUsecs = stats->captureUsecs;
+
+    if ( stats->cpuUsecs > stats->maxCpuUsecs )
+        stats->maxCpuUsecs = stats->cpuUsecs;
+
+    return(scanShiftRegister[0]);
+}
+
+/**
+  * @name   scan_RxMarkerAt
+  * @brief  check for a marker in the received bits
+  * @param  bit     offset in scanRxBuffer[], MSB of byte 0 is bit 0
+  * @param  marker  SCAN_MARKER_BYTES bytes
+  * @retval true if all marker bits are there
+  */
+static bool scan_RxMarkerAt(uint16_t bit, const uint8_t *marker)
+{
+    uint16_t        rx;
+
+    for ( uint16_t i = 0; i < SCAN_MARKER_BYTES * 8; i++, bit++ )
+    {
+        rx = (scanRxBuffer[bit >> 3] >> (7 - (bit & 7))) & 1;
+
+        if ( rx != ((marker[i >> 3] >> (7 - (i & 7))) & 1) )
+            return(false);
+    }
+
+    return(true);
+}
+
+/**
+  * @name   scan_DetectLength
+  * @brief  detect scan chain length by shifting a marker through it
+  * @param  None
+  * @retval length in bits, 0 if the marker never came back
+  * @note   two passes with complementary markers must agree so that
+  *         captured data can't be mistaken for the marker
+  * @note   the marker is followed by 0s, so the search starts at the
+  *         longest chain: the last match is the marker, earlier ones
+  *         can only be chain data
+  */
+uint16_t scan_DetectLength(void)
+{
+    const uint8_t     markers[2][SCAN_MARKER_BYTES] = {{0xA5, 0x3C}, {0x5A, 0xC3}};
+    uint16_t          found = 0;
+    uint16_t          bits;
+
+    for ( int pass = 0; pass < 2; pass++ )
+    {
+        memset(scanTxBuffer, 0, sizeof(scanTxBuffer));
+        memcpy(scanTxBuffer, markers[pass], SCAN_MARKER_BYTES);
+
+        // the marker enters the chain behind the loaded data and
+        // comes out on SCAN_DATA_IN after 'chain length' bits
+        (void) hal_ScanShift(scanTxBuffer, scanRxBuffer, SCAN_BUFFER_BYTES, false);
+
+        for ( bits = SCAN_MAX_BITS; bits > 0; bits-- )
+        {
+            if ( scan_RxMarkerAt(bits, markers[pass]) )
+                break;
+        }
+
+        if ( bits == 0 || (pass == 1 && bits != found) )
+        {
+            found = 0;
+            break;
+        }
+
+        found = bits;
+    }
+
+    memset(scanTxBuffer, 0, sizeof(scanTxBuffer));
+    return(found);
+}
+
+/**
+  * @name   scan_SetLength
+  * @brief  set scan chain length
+  * @param  bits  length in bits, 1..SCAN_MAX_BITS
+  * @retval true if OK, false if invalid length
+  */
+bool scan_SetLength(uint16_t bits)
+{
+    if ( bits == 0 || bits > SCAN_MAX_BITS )
+        return(false);
+
+    scanChainBits = bits;
+    return(true);
+}
+
+/**
+  * @name   scan_GetLength
+  * @brief  get scan chain length
+  * @param  None
+  * @retval length in bits
+  */
+uint16_t scan_GetLength(void)
+{
+    return(scanChainBits);
+}
+
+/**
+  * @name   scan_GetBit
+  * @brief  get a bit from the last capture
+  * @param  bitNo  bit number in shift order (0 = byte 0 bit 7)
+  * @retval bit value
+  */
+bool scan_GetBit(uint16_t bitNo)
+{
+    if ( bitNo >= SCAN_MAX_BITS )
+        return(false);
+
+    return((scanShiftRegister[bitNo >> 5] >> (31 - (bitNo & 31))) & 1);
+}
+
+/**
+  * @name   scan_GetWord
+  * @brief  get a 32-bit word from the last capture
+  * @param  wordNo  0 holds bytes 0..3, 1 holds bytes 4..7 etc
+  * @retval word, 0 if out of range
+  */
+uint32_t scan_GetWord(uint8_t wordNo)
+{
+    if ( wordNo >= SCAN_MAX_WORDS )
+        return(0);
+
+    return(scanShiftRegister[wordNo]);
+}
+
+/**
+  * @name   scan_GetBitName
+  * @brief  get the name of a scan chain bit
+  * @param  bitNo  bit number in shift order (0 = byte 0 bit 7)
+  * @param  name   buffer of at least SCAN_BIT_NAME_SZ chars
+  * @retval None
+  */
+void scan_GetBitName(uint16_t bitNo, char *name)
+{
+    if ( bitNo < scanBitNameCount )
+    {
+        strcpy(name, scanBitNames[bitNo].bitName);
+    }
+    else
+    {
+        sprintf(name, "%u.%u RSVD", bitNo / 8, 7 - (bitNo % 8));
+    }
+}
+
+/**
+  * @name   scan_SetMode
+  * @brief  select scan chain capture mode
+  * @param  mode  new mode
+  * @retval true if OK, false if invalid mode
+  */
+bool scan_SetMode(SCAN_MODE mode)
+{
+    if ( mode >= SCAN_MODE_COUNT )
+        return(false);
+
+    scanMode = mode;
+    return(true);
+}
+
+/**
+  * @name   scan_GetMode
+  * @brief  get scan chain capture mode
+  * @param  None
+  * @retval current mode
+  */
+SCAN_MODE scan_GetMode(void)
+{
+    return(scanMode);
+}
+
+/**
+  * @name   scan_GetModeName
+  * @brief  get printable name of a capture mode
+  * @param  mode
+  * @retval pointer to name or 'unknown'
+  */
+const char *scan_GetModeName(SCAN_MODE mode)
+{
+    if ( mode >= SCAN_MODE_COUNT )
+        return("unknown");
+
+    return(scanModeNames[mode]);
+}
+
+/**
+  * @name   scan_GetStats
+  * @brief  get capture time measurements for a mode
+  * @param  mode
+  * @retval pointer to stats or NULL if invalid mode
+  */
+const scan_stats_t *scan_GetStats(SCAN_MODE mode)
+{
+    if ( mode >= SCAN_MODE_COUNT )
+        return(NULL);
+
+    return(&scanStats[mode]);
+}
+
+/**
+  * @name   scan_ClearStats
+  * @brief  reset capture time measurements for all modes
+  * @param  None
+  * @retval None
+  */
+void scan_ClearStats(void)
+{
+    memset((void *) scanStats, 0, sizeof(scanStats));
+}
+
+/**
+  * @name   scan_Init
+  * @brief  initialize scan chain capture engine
+  * @param  None
+  * @retval None
+  * @note   call after configureIOPins() and timers_Init()
+  */
+void scan_Init(void)
+{
+    hal_ScanInit();
+    scan_ClearStats();
+}
+
+//===================================================================
+//                      Background Sampling
+//===================================================================
+
+/**
+  * @name   scan_ShowChanges
+  * @brief  display the bits that differ between two samples
+  * @param  msecs  timestamp of the new sample
+  * @param  prev   previous sample
+  * @param  word   new sample
+  * @retval None
+  */
+static void scan_ShowChanges(uint32_t msecs, uint32_t prev, uint32_t word)
+{
+    char            name[SCAN_BIT_NAME_SZ];
+    uint32_t        changed = prev ^ word;
+    uint32_t        mask;
+
+    for ( uint16_t i = 0; i < 32; i++ )
+    {
+        mask = 1ul << (31 - i);
+        if ( (changed & mask) == 0 )
+            continue;
+
+        scan_GetBitName(i, name);
+        sprintf(outBfr, "%10lu ms  %08lX  %-20s %d -> %d", (unsigned long) msecs, (unsigned long) word, name,
+                (prev & mask) ? 1 : 0, (word & mask) ? 1 : 0);
+        terminalOut(outBfr);
+    }
+}
+
+/**
+  * @name   scan_SetSamplePeriod
+  * @brief  start or stop background sampling
+  * @param  msecs   sample period, 0 stops sampling
+  * @param  stream  true to display changes as they are captured
+  * @retval true if OK, false if period too short
+  * @note   the log is kept when sampling is stopped or restarted
+  */
+bool scan_SetSamplePeriod(uint32_t msecs, bool stream)
+{
+    if ( msecs != 0 && msecs < SCAN_MIN_SAMPLE_MSECS )
+        return(false);
+
+    scanSamplePeriod = msecs;
+    scanStream = (msecs != 0) ? stream : false;
+    scanLastSample = hal_Millis() - msecs;
+    return(true);
+}
+
+/**
+  * @name   scan_GetSamplePeriod
+  * @brief  get background sample period
+  * @param  None
+  * @retval period in msecs, 0 if not sampling
+  */
+uint32_t scan_GetSamplePeriod(void)
+{
+    return(scanSamplePeriod);
+}
+
+/**
+  * @name   scan_Poll
+  * @brief  take a background sample if one is due
+  * @param  None
+  * @retval None
+  * @note   called from loop(); consecutive identical samples are
+  *         counted but not logged.  Without a card the chain reads the
+  *         SCAN_DATA_IN pull-up, so it is not shifted.
+  */
+void scan_Poll(void)
+{
+    uint32_t        now = hal_Millis();
+    uint32_t        word;
+    uint32_t        prev;
+    scan_log_t      *entry;
+    pin_snapshot_t  snap;
+
+    if ( scanSamplePeriod == 0 || (now - scanLastSample) < scanSamplePeriod )
+        return;
+
+    scanLastSample = now;
+    takePinSnapshot(&snap);
+
+    // a card inserted later starts a new run of samples
+    if ( isCardPresentIn(&snap) == false )
+    {
+        scanNoCard++;
+        scanHavePrev = false;
+        return;
+    }
+
+    word = scan_Capture();
+    scanSamples++;
+
+    if ( scanHavePrev == false )
+    {
+        prev = word;
+    }
+    else
+    {
+        prev = scanLog[(scanLogHead + SCAN_LOG_SIZE - 1) % SCAN_LOG_SIZE].word;
+        if ( word == prev )
+        {
+            scanDuplicates++;
+            return;
+        }
+    }
+
+    entry = &scanLog[scanLogHead];
+    entry->msecs = now;
+    entry->word = word;
+    scanLogHead = (scanLogHead + 1) % SCAN_LOG_SIZE;
+
+    if ( scanLogCount < SCAN_LOG_SIZE )
+        scanLogCount++;
+
+    if ( scanStream )
+    {
+        if ( scanHavePrev == false )
+        {
+            sprintf(outBfr, "%10lu ms  %08lX  first sample", (unsigned long) now, (unsigned long) word);
+            terminalOut(outBfr);
+        }
+        else
+        {
+            scan_ShowChanges(now, prev, word);
+        }
+    }
+
+    scanHavePrev = true;
+}
+
+/**
+  * @name   scan_ShowLog
+  * @brief  display the sample log, oldest first, as bit changes
+  * @param  None
+  * @retval None
+  */
+void scan_ShowLog(void)
+{
+    uint16_t        index = (scanLogHead + SCAN_LOG_SIZE - scanLogCount) % SCAN_LOG_SIZE;
+    uint32_t        prev = scanLog[index].word;
+
+    if ( scanLogCount == 0 )
+    {
+        terminalOut((char *) "Scan chain log is empty");
+        return;
+    }
+
+    sprintf(outBfr, "%10lu ms  %08lX  oldest sample in log", (unsigned long) scanLog[index].msecs,
+            (unsigned long) prev);
+    terminalOut(outBfr);
+
+    for ( uint16_t i = 1; i < scanLogCount; i++ )
+    {
+        index = (index + 1) % SCAN_LOG_SIZE;
+        scan_ShowChanges(scanLog[index].msecs, prev, scanLog[index].word);
+        prev = scanLog[index].word;
+    }
+}
+
+/**
+  * @name   scan_ClearLog
+  * @brief  empty the sample log and reset counters
+  * @param  None
+  * @retval None
+  */
+void scan_ClearLog(void)
+{
+    scanLogHead = 0;
+    scanLogCount = 0;
+    scanSamples = 0;
+    scanDuplicates = 0;
+    scanNoCard = 0;
+    scanHavePrev = false;
+}
+
+/**
+  * @name   scan_ShowSampling
+  * @brief  display background sampling state and counters
+  * @param  None
+  * @retval None
+  */
+void scan_ShowSampling(void)
+{
+    if ( scanSamplePeriod )
+        sprintf(outBfr, "Sampling every %lu ms%s", (unsigned long) scanSamplePeriod,
+                scanStream ? ", streaming changes" : "");
+    else
+        sprintf(outBfr, "Sampling is off");
+    terminalOut(outBfr);
+
+    sprintf(outBfr, "Samples: %lu  Duplicates: %lu  No card: %lu  Logged: %u of %u", (unsigned long) scanSamples,
+            (unsigned long) scanDuplicates, (unsigned long) scanNoCard, scanLogCount, SCAN_LOG_SIZE);
+    terminalOut(outBfr);
+}
@@ -0,0 +1,165 @@
+//===================================================================
+// sched.cpp
+//
+// Cooperative run-to-completion scheduler.  sched_Run() makes one
+// pass over the task table and runs every task that is due: a task
+// with periodMsec 0 runs on every pass, others when the msecs clock
+// reaches their next deadline, so there is no timer tick driving it.
+//
+// A command that waits (status screen, 'sleep', macros) calls
+// backgroundPoll(), which is sched_Run() again.  A task is never
+// entered twice, so the CLI task that is running the command is
+// skipped and the other tasks keep going; their terminal output is
+// held until the next prompt so it does not land inside the command's.
+//
+// Nothing here touches the hardware; the clock comes in through
+// sched_Init() so the scheduler can run on a host with a fake clock.
+//===================================================================
+#include <stddef.h>
+#include "sched.hpp"
+
+static const sched_task_t   *schedTasks = NULL;
+static uint8_t              schedCount = 0;
+static sched_clock_t        schedClock;
+static uint32_t             schedNext[SCHED_MAX_TASKS];     // msecs due
+static bool                 schedRunning[SCHED_MAX_TASKS];
+static sched_stats_t        schedStats[SCHED_MAX_TASKS];
+static uint32_t             schedStatsStart;                // usecs
+
+/**
+  * @name   sched_Init
+  * @brief  set the task table and clock
+  * @param  tasks   table, must stay valid
+  * @param  count   number of tasks, at most SCHED_MAX_TASKS
+  * @param  clock   msecs and usecs sources
+  * @retval None
+  * @note   periodic tasks first run one period from now
+  */
+void sched_Init(const sched_task_t *tasks, uint8_t count, const sched_clock_t *clock)
+{
+    schedTasks = tasks;
+    schedCount = (count > SCHED_MAX_TASKS) ? SCHED_MAX_TASKS : count;
+    schedClock = *clock;
+
+    for ( uint8_t i = 0; i < schedCount; i++ )
+    {
+        schedNext[i] = schedClock.msecs() + tasks[i].periodMsec;
+        schedRunning[i] = false;
+    }
+
+    sched_ClearStats();
+}
+
+/**
+  * @name   sched_Run
+  * @brief  run each due task once
+  * @param  None
+  * @retval None
+  */
+void sched_Run(void)
+{
+    const sched_task_t  *task;
+    sched_stats_t       *stats;
+    uint32_t            now;
+    uint32_t            start;
+    uint32_t            elapsed;
+
+    for ( uint8_t i = 0; i < schedCount; i++ )
+    {
+        task = &schedTasks[i];
+
+        if ( schedRunning[i] )
+            continue;
+
+        if ( task->periodMsec != 0 )
+        {
+            now = schedClock.msecs();
+
+            if ( (int32_t) (now - schedNext[i]) < 0 )
+                continue;
+
+            // keep the phase unless a whole period was missed
+            schedNext[i] += task->periodMsec;
+
+            if ( (int32_t) (now - schedNext[i]) >= 0 )
+            {
+                schedStats[i].late++;
+                schedNext[i] = now + task->periodMsec;
+            }
+        }
+
+        stats = &schedStats[i];
+        schedRunning[i] = true;
+        start = schedClock.usecs();
+
+        task->func();
+
+        elapsed = schedClock.usecs() - start;
+        schedRunning[i] = false;
+
+        stats->runs++;
+        stats->totalUsecs += elapsed;
+
+        if ( elapsed > stats->maxUsecs )
+            stats->maxUsecs = elapsed;
+    }
+}
+
+/**
+  * @name   sched_TaskCount
+  * @brief  number of tasks
+  */
+uint8_t sched_TaskCount(void)
+{
+    return(schedCount);
+}
+
+/**
+  * @name   sched_GetTask
+  * @brief  task table entry
+  * @param  task    0..sched_TaskCount()-1
+  * @retval entry
+  */
+const sched_task_t *sched_GetTask(uint8_t task)
+{
+    return(&schedTasks[task]);
+}
+
+/**
+  * @name   sched_GetStats
+  * @brief  run time of a task
+  * @param  task    0..sched_TaskCount()-1
+  * @retval stats
+  */
+const sched_stats_t *sched_GetStats(uint8_t task)
+{
+    return(&schedStats[task]);
+}
+
+/**
+  * @name   sched_StatsUsecs
+  * @brief  usecs since the stats were cleared
+  */
+uint32_t sched_StatsUsecs(void)
+{
+    return(schedClock.usecs() - schedStatsStart);
+}
+
+/**
+  * @name   sched_ClearStats
+  * @brief  zero the run time of all tasks
+  * @param  None
+  * @retval None
+  */
+void sched_ClearStats(void)
+{
+    for ( uint8_t i = 0; i < SCHED_MAX_TASKS; i++ )
+    {
+        schedStats[i].runs = 0;
+        schedStats[i].totalUsecs = 0;
+        schedStats[i].maxUsecs = 0;
+        schedStats[i].late = 0;
+    }
+
+    schedStatsStart = schedClock.usecs();
+}
@@ -0,0 +1,502 @@
+//===================================================================
+// stream.cpp
+//
+// Telemetry stream for host automation.  While enabled, stream_Poll()
+// builds a record every N msecs from one pin snapshot, the first word
+// of the last scan chain capture ('scan watch' keeps it fresh), the
+// power sequencer state and both INA219 rails, and
+// queues it as either a COBS framed binary record with a CRC or a
+// line of JSON (see stream.hpp for the layout).  A record is skipped
+// and counted, never waited on, when the terminal ring has no room,
+// so the CLI stays usable while streaming.  Text output from commands
+// can land between records; a binary decoder drops that as a frame
+// with a bad CRC and resyncs on the next 0x00.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "commands.hpp"
+#include "scan.hpp"
+#include "power.hpp"
+#include "meter.hpp"
+#include "stream.hpp"
+#include "usbtx.hpp"
+#include "hal.hpp"
+
+extern char             *tokens[];
+
+#define STREAM_TEST_RECORDS     100
+
+static STREAM_FORMAT    streamFormat = STREAM_OFF;
+static uint32_t         streamPeriod = 0;
+static uint32_t         streamLast = 0;             // hal_Millis() of last record
+static uint32_t         streamSeq = 0;
+static uint32_t         streamSent = 0;
+static uint32_t         streamSkipped = 0;          // no room in terminal ring
+static uint32_t         streamMaxUsecs = 0;         // longest record build + queue
+
+
+//===================================================================
+//                    ENCODING
+//
+// Kept free of Arduino calls so host tools can compile this section
+// as is to decode the stream.
+//===================================================================
+
+/**
+  * @name   stream_Crc16
+  * @brief  CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+  * @param  data
+  * @param  len   bytes
+  * @retval crc
+  */
+uint16_t stream_Crc16(const uint8_t *data, int len)
+{
+    uint16_t        crc = 0xFFFF;
+
+    while ( len-- > 0 )
+    {
+        crc ^= (uint16_t) (*data++) << 8;
+
+        for ( int bit = 0; bit < 8; bit++ )
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+
+    return(crc);
+}
+
+/**
+  * @name   stream_CobsEncode
+  * @brief  COBS encode a buffer
+  * @param  src   bytes to encode
+  * @param  len   number of bytes, less than 254
+  * @param  dst   output, at least len + 1 bytes
+  * @retval encoded length, not including the 0x00 delimiter
+  */
+int stream_CobsEncode(const uint8_t *src, int len, uint8_t *dst)
+{
+    int             code = 0;                   // index of current code byte
+    int             out = 1;
+
+    for ( int i = 0; i < len; i++ )
+    {
+        if ( src[i] == 0 )
+        {
+            dst[code] = out - code;
+            code = out++;
+        }
+        else
+            dst[out++] = src[i];
+    }
+
+    dst[code] = out - code;
+    return(out);
+}
+
+/**
+  * @name   stream_CobsDecode
+  * @brief  COBS decode one frame
+  * @param  src   frame without the 0x00 delimiter
+  * @param  len   frame length
+  * @param  dst   output, at least len bytes
+  * @retval decoded length, -1 if the frame is malformed
+  */
+int stream_CobsDecode(const uint8_t *src, int len, uint8_t *dst)
+{
+    int             in = 0;
+    int             out = 0;
+    uint8_t         code;
+
+    while ( in < len )
+    {
+        code = src[in++];
+
+        if ( code == 0 || in + code - 1 > len )
+            return(-1);
+
+        for ( int i = 1; i < code; i++ )
+            dst[out++] = src[in++];
+
+        if ( code != 0xFF && in < len )
+            dst[out++] = 0;
+    }
+
+    return(out);
+}
+
+static void putU16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint16_t getU16(const uint8_t *p)
+{
+    return(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+    return(p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24));
+}
+
+/**
+  * @name   stream_Pack
+  * @brief  serialize a record and add its CRC
+  * @param  rec   record
+  * @param  raw   output, STREAM_RECORD_SIZE bytes
+  * @retval None
+  */
+void stream_Pack(const stream_record_t *rec, uint8_t *raw)
+{
+    raw[0] = STREAM_RECORD_TYPE;
+    raw[1] = rec->pwrState;
+    raw[2] = rec->pwrFault;
+    raw[3] = 0;
+    putU32(&raw[4], rec->seq);
+    putU32(&raw[8], rec->msecs);
+    putU32(&raw[12], rec->usecs);
+    putU32(&raw[16], rec->portIn[0]);
+    putU32(&raw[20], rec->portIn[1]);
+    putU32(&raw[24], rec->pins);
+    putU32(&raw[28], rec->scanWord);
+    putU16(&raw[32], rec->scanBits);
+    putU32(&raw[34], (uint32_t) rec->mw12v);
+    putU32(&raw[38], (uint32_t) rec->mw3v3);
+    putU16(&raw[STREAM_CRC_OFFSET], stream_Crc16(raw, STREAM_CRC_OFFSET));
+}
+
+/**
+  * @name   stream_Unpack
+  * @brief  check and deserialize a decoded record
+  * @param  raw   decoded frame
+  * @param  len   decoded length
+  * @param  rec   output
+  * @retval true if length, type and CRC are good
+  */
+bool stream_Unpack(const uint8_t *raw, int len, stream_record_t *rec)
+{
+    if ( len != STREAM_RECORD_SIZE || raw[0] != STREAM_RECORD_TYPE )
+        return(false);
+
+    if ( getU16(&raw[STREAM_CRC_OFFSET]) != stream_Crc16(raw, STREAM_CRC_OFFSET) )
+        return(false);
+
+    rec->pwrState = raw[1];
+    rec->pwrFault = raw[2];
+    rec->seq = getU32(&raw[4]);
+    rec->msecs = getU32(&raw[8]);
+    rec->usecs = getU32(&raw[12]);
+    rec->portIn[0] = getU32(&raw[16]);
+    rec->portIn[1] = getU32(&raw[20]);
+    rec->pins = getU32(&raw[24]);
+    rec->scanWord = getU32(&raw[28]);
+    rec->scanBits = getU16(&raw[32]);
+    rec->mw12v = (int32_t) getU32(&raw[34]);
+    rec->mw3v3 = (int32_t) getU32(&raw[38]);
+    return(true);
+}
+
+//===================================================================
+//                    STREAMING
+//===================================================================
+
+/**
+  * @name   stream_Sample
+  * @brief  fill a record from the current board state
+  * @param  rec   output
+  * @retval None
+  */
+static void stream_Sample(stream_record_t *rec)
+{
+    pin_snapshot_t  snap;
+
+    takePinSnapshot(&snap);
+
+    rec->seq = streamSeq;
+    rec->msecs = hal_Millis();
+    rec->usecs = snap.usecs;
+    rec->portIn[0] = snap.in[0];
+    rec->portIn[1] = snap.in[1];
+    rec->pins = snapshotPinBits(&snap);
+
+    // no capture of our own; one takes longer than the rest of the record
+    rec->scanWord = isCardPresentIn(&snap) ? scan_GetWord(0) : 0;
+    rec->scanBits = scan_GetLength();
+    rec->pwrState = power_GetState();
+    rec->pwrFault = power_GetFault();
+    rec->mw12v = meter_GetRail(METER_RAIL_12V)->powerMw;
+    rec->mw3v3 = meter_GetRail(METER_RAIL_3V3_AUX)->powerMw;
+}
+
+/**
+  * @name   stream_FormatJson
+  * @brief  format a record as one line of JSON
+  * @param  rec   record
+  * @param  bfr   output, at least STREAM_JSON_MAX chars
+  * @retval None
+  */
+static void stream_FormatJson(const stream_record_t *rec, char *bfr)
+{
+    sprintf(bfr, "{\"seq\":%lu,\"ms\":%lu,\"us\":%lu,\"pa\":%lu,\"pb\":%lu,\"pins\":%lu,"
+            "\"scan\":%lu,\"bits\":%u,\"pwr\":\"%s\",\"fault\":\"%s\",\"mw12v\":%ld,\"mw3v3\":%ld}",
+            (unsigned long) rec->seq, (unsigned long) rec->msecs, (unsigned long) rec->usecs,
+            (unsigned long) rec->portIn[0], (unsigned long) rec->portIn[1], (unsigned long) rec->pins,
+            (unsigned long) rec->scanWord, rec->scanBits, power_GetStateName((PWR_STATE) rec->pwrState),
+            power_GetFaultName((PWR_FAULT) rec->pwrFault), (long) rec->mw12v, (long) rec->mw3v3);
+}
+
+/**
+  * @name   stream_Poll
+  * @brief  queue a record if one is due
+  * @param  None
+  * @retval None
+  * @note   called from loop()
+  */
+void stream_Poll(void)
+{
+    stream_record_t     rec;
+    uint8_t             raw[STREAM_RECORD_SIZE];
+    uint8_t             frame[STREAM_FRAME_MAX];
+    uint32_t            now = hal_Millis();
+    uint32_t            start;
+    int                 len;
+
+    if ( streamFormat == STREAM_OFF || now - streamLast < streamPeriod )
+        return;
+
+    streamLast = now;
+
+    // don't wait on the host; skip the record if it won't fit
+    if ( term_TxFree() < ((streamFormat == STREAM_JSON) ? STREAM_JSON_MAX + 2 : STREAM_FRAME_MAX) )
+    {
+        streamSkipped++;
+        return;
+    }
+
+    start = hal_Micros();
+    stream_Sample(&rec);
+
+    if ( streamFormat == STREAM_BINARY )
+    {
+        stream_Pack(&rec, raw);
+        len = stream_CobsEncode(raw, STREAM_RECORD_SIZE, frame);
+        frame[len++] = 0;
+        term_Write((const char *) frame, len);
+    }
+    else
+    {
+        // outBfr[] may be half built by the command this task interrupted
+        char        json[STREAM_JSON_MAX];
+
+        stream_FormatJson(&rec, json);
+        term_Write(json, strlen(json));
+        term_Write("\r\n", 2);
+    }
+
+    streamSeq++;
+    streamSent++;
+
+    if ( hal_Micros() - start > streamMaxUsecs )
+        streamMaxUsecs = hal_Micros() - start;
+}
+
+/**
+  * @name   stream_Start
+  * @brief  start streaming records
+  * @param  format  STREAM_BINARY or STREAM_JSON
+  * @param  msecs   record period, at least STREAM_MIN_PERIOD_MSEC
+  * @retval false if an argument is out of range
+  */
+bool stream_Start(STREAM_FORMAT format, uint32_t msecs)
+{
+    if ( format == STREAM_OFF || msecs < STREAM_MIN_PERIOD_MSEC )
+        return(false);
+
+    streamSeq = 0;
+    streamSent = 0;
+    streamSkipped = 0;
+    streamMaxUsecs = 0;
+    streamPeriod = msecs;
+    streamLast = hal_Millis() - msecs;
+    streamFormat = format;
+    return(true);
+}
+
+/**
+  * @name   stream_Stop
+  * @brief  stop streaming
+  * @param  None
+  * @retval None
+  */
+void stream_Stop(void)
+{
+    streamFormat = STREAM_OFF;
+}
+
+/**
+  * @name   stream_Test
+  * @brief  encode and decode records, report sizes and times
+  * @param  count   records to run
+  * @retval number of records that failed the round trip
+  */
+static int stream_Test(int count)
+{
+    stream_record_t     rec;
+    stream_record_t     back;
+    uint8_t             raw[STREAM_RECORD_SIZE];
+    uint8_t             frame[STREAM_FRAME_MAX];
+    uint8_t             decoded[STREAM_FRAME_MAX];
+    uint32_t            sampleUsecs = 0;
+    uint32_t            encodeUsecs = 0;
+    uint32_t            decodeUsecs = 0;
+    uint32_t            start;
+    int                 frameLen = 0;
+    int                 len;
+    int                 failed = 0;
+
+    for ( int i = 0; i < count; i++ )
+    {
+        start = hal_Micros();
+        stream_Sample(&rec);
+        sampleUsecs += hal_Micros() - start;
+
+        // vary every field so all byte positions get exercised
+        rec.seq = i * 0x01010101UL;
+        rec.mw12v = -i;
+
+        start = hal_Micros();
+        stream_Pack(&rec, raw);
+        frameLen = stream_CobsEncode(raw, STREAM_RECORD_SIZE, frame);
+        encodeUsecs += hal_Micros() - start;
+
+        start = hal_Micros();
+        len = stream_CobsDecode(frame, frameLen, decoded);
+        decodeUsecs += hal_Micros() - start;
+
+        if ( memchr(frame, 0, frameLen) != NULL || stream_Unpack(decoded, len, &back) == false ||
+             back.seq != rec.seq || back.mw12v != rec.mw12v || back.pins != rec.pins ||
+             back.scanWord != rec.scanWord || back.portIn[1] != rec.portIn[1] )
+            failed++;
+    }
+
+    // a corrupted frame must be rejected
+    raw[5] ^= 0x40;
+    if ( stream_Unpack(raw, STREAM_RECORD_SIZE, &back) )
+        failed++;
+
+    stream_FormatJson(&rec, outBfr);
+    len = strlen(outBfr);
+
+    sprintf(outBfr, "%d records, %d failed", count, failed);
+    SHOW();
+    sprintf(outBfr, "binary %d bytes/record, JSON %d bytes/record", frameLen + 1, len + 2);
+    SHOW();
+    sprintf(outBfr, "usecs/record: sample %lu, encode %lu, decode %lu", (unsigned long) (sampleUsecs / count),
+            (unsigned long) (encodeUsecs / count), (unsigned long) (decodeUsecs / count));
+    SHOW();
+    return(failed);
+}
+
+/**
+  * @name   streamStart
+  * @brief  'stream bin|json [<msecs>]'
+  * @param  format  STREAM_BINARY or STREAM_JSON
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error
+  */
+static int streamStart(STREAM_FORMAT format, int argCnt)
+{
+    uint32_t        msecs = (argCnt >= 2) ? atoi(tokens[2]) : 100;
+
+    if ( stream_Start(format, msecs) == false )
+    {
+        sprintf(outBfr, "Period must be at least %d msec", STREAM_MIN_PERIOD_MSEC);
+        SHOW();
+        return(1);
+    }
+
+    return(0);
+}
+
+static int streamBin(int argCnt)    { return(streamStart(STREAM_BINARY, argCnt)); }
+static int streamJson(int argCnt)   { return(streamStart(STREAM_JSON, argCnt)); }
+static int streamOff(int argCnt)    { stream_Stop(); return(0); }
+
+/**
+  * @name   streamTest
+  * @brief  'stream test [<count>]'
+  * @param  argCnt  number of arguments
+  * @retval 0=OK 1=error or failed records
+  */
+static int streamTest(int argCnt)
+{
+    int             count = (argCnt >= 2) ? atoi(tokens[2]) : STREAM_TEST_RECORDS;
+
+    return((count > 0 && stream_Test(count) == 0) ? 0 : 1);
+}
+
+static constexpr cli_subcmd_t   streamCmds[] = {
+    {"bin",     streamBin,      0, 1},
+    {"json",    streamJson,     0, 1},
+    {"off",     streamOff,      0, 0},
+    {"test",    streamTest,     0, 1},
+};
+
+CLI_SUBCMDS_SORTED(streamCmds);
+
+/**
+  * @name   streamCmd
+  * @brief  implement stream command
+  * @param  argCnt  number of arguments
+  * @param  tokens[1]  subcommand, see streamCmds[]
+  * @param  tokens[2]  msecs (bin, json); record count (test)
+  * @retval int 0=OK, 1=error
+  */
+int streamCmd(int argCnt)
+{
+    const usbtx_stats_t *usb;
+    int             rc;
+
+    if ( argCnt == 0 )
+    {
+        if ( streamFormat == STREAM_OFF )
+            terminalOut((char *) "Streaming is off");
+        else
+        {
+            sprintf(outBfr, "Streaming %s every %lu msec", (streamFormat == STREAM_JSON) ? "JSON" : "binary",
+                    (unsigned long) streamPeriod);
+            SHOW();
+        }
+
+        sprintf(outBfr, "%lu records sent, %lu skipped (output full), longest %lu usec", (unsigned long) streamSent,
+                (unsigned long) streamSkipped, (unsigned long) streamMaxUsecs);
+        SHOW();
+
+        // USB side of the output path, see usbtx.hpp
+        usb = usbtx_GetStats();
+        sprintf(outBfr, "USB out: %lu of %lu requests sent, %lu rejected (queue full), %lu timeouts, %lu bytes dropped",
+                (unsigned long) usb->completed, (unsigned long) usb->requests, (unsigned long) usb->rejected,
+                (unsigned long) usb->timeouts, (unsigned long) usb->dropped);
+        SHOW();
+        return(0);
+    }
+
+    rc = cli_RunSubCmd(streamCmds, CLI_TABLE_COUNT(streamCmds), 1, argCnt);
+
+    if ( rc == CLI_SUBCMD_ERR )
+    {
+        terminalOut((char *) "Usage: stream [bin|json [<msecs>] | off | test [<count>]]");
+        return(1);
+    }
+
+    return(rc);
+}
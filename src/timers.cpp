@@ -1,12 +1,16 @@
 #include <Arduino.h>
 #include "main.hpp"
+#include "scan.hpp"
+#include "prof.hpp"
+#include "trace.hpp"
+#include "hal.hpp"
 
 uint32_t                sampleRate = 4096;              // Mhz = this % 2
 
 volatile uint32_t       scanClockPulseCounter;
 volatile bool           enableScanClk = false;
-volatile uint32_t       scanShiftRegister_0;
-uint8_t                 shift;
+extern volatile uint32_t scanShiftRegister[SCAN_MAX_WORDS]; // see scan.cpp
+uint16_t                scanBitNo;
 
 // this must align with staticPins active state inactive value
 static uint8_t          scanClockState = 1;
@@ -14,34 +18,36 @@ static uint8_t          scanClockState = 1;
 /**
   * @name   timers_scanChainCapture
   * @brief  capture scan chain data & control CLK
-  * @param  None
+  * @param  bits  scan chain length in bits
   * @retval None
+  * @note   1st bit in goes to bit 31 of scanShiftRegister[0]
   */
-void timers_scanChainCapture(void)
+void timers_scanChainCapture(uint16_t bits)
 {
     // initialize vars used by timer handler
     scanClockPulseCounter = 0;
-    scanShiftRegister_0 = 0;
-    shift = 31;
+    memset((void *) scanShiftRegister, 0, sizeof(scanShiftRegister));
+    scanBitNo = 0;
 
     // SCAN_CLK high
     digitalWrite(OCP_SCAN_CLK, scanClockState);
 
     // SCAN_LD_N low briefly
     digitalWrite(OCP_SCAN_LD_N, 0);
-    delayMicroseconds(200);
+    delayMicroseconds(SCAN_LD_PULSE_USECS);
     digitalWrite(OCP_SCAN_LD_N, 1);
 
     // start capture (when CLK falls)
     enableScanClk = true;
 
-    while ( scanClockPulseCounter < 32 )
+    while ( scanClockPulseCounter < bits )
     {
         // wait for shifted data in
         ;
     }
 
     enableScanClk = false;
+    trace_Event(TRACE_TC5_END, scanBitNo, scanClockPulseCounter);
 }
 
 /**
@@ -52,15 +58,27 @@ void timers_scanChainCapture(void)
   */
 void TC5_Handler(void) 
 {
+    uint64_t        start;
+
+    // profile only the ticks that clock the chain; the idle ticks
+    // between captures would swamp the average
     if ( enableScanClk )
     {      
+        start = prof_Now();
+
         if ( scanClockState == 1 )
         {
             // latch bit on falling edge of clock + 10 usec Figure 97
             scanClockState = 0;
             digitalWrite(OCP_SCAN_CLK, scanClockState);
+            if ( scanBitNo == 0 )
+                trace_Event(TRACE_TC5_START, 0, 0);
             delayMicroseconds(10);
-            scanShiftRegister_0 |= (digitalRead(OCP_SCAN_DATA_IN) << shift--);
+            if ( scanBitNo < SCAN_MAX_BITS )
+            {
+                scanShiftRegister[scanBitNo >> 5] |= (digitalRead(OCP_SCAN_DATA_IN) << (31 - (scanBitNo & 31)));
+                scanBitNo++;
+            }
         }
         else
         {
@@ -68,6 +86,8 @@ void TC5_Handler(void)
             scanClockPulseCounter++;
             digitalWrite(OCP_SCAN_CLK, scanClockState);
         }
+
+        prof_Record(PROF_ISR_TC5, start);
     }
 
     TC5->COUNT16.INTFLAG.bit.MC0 = 1; 
@@ -0,0 +1,164 @@
+//===================================================================
+// trace.cpp
+//
+// Binary event trace for post-mortem debugging of USB lockups and
+// ISR timing.  Fixed size records go into a ring in the .noinit
+// section (see the linker scripts in platformio/variants/ttf), which
+// the startup code does not clear, so the events before a reset
+// button press or NVIC_SystemReset() are still there afterwards.
+//
+// The M0+ has no exclusive load/store, so a record slot is claimed
+// with interrupts off for the few instructions of the index update;
+// the record is then filled with interrupts on.  Any context, ISR or
+// foreground, can call trace_Event().
+//
+// If the ring holds events from before the reset, trace_Init() adds
+// a TRACE_BOOT record and then holds the trace, so USB enumeration
+// does not overwrite them, until 'xdebug trace' dumps them or
+// 'xdebug trace on' restarts it.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "trace.hpp"
+#include "hal.hpp"
+
+typedef struct {
+  uint32_t        magic;
+  uint32_t        count;                  // records written since clear
+  uint32_t        boots;
+  trace_rec_t     rec[TRACE_RECORDS];
+} trace_buf_t;
+
+static trace_buf_t      traceBuf __attribute__ ((section(".noinit")));
+static volatile bool    traceOn = false;
+static bool             traceHeld = false;
+
+static const char       *traceNames[TRACE_EVENT_COUNT] = {
+    "boot", "usb isr", "usb send", "usb tx timeout", "usb tx drop", "usb recv",
+    "cmd start", "cmd end", "tc5 start", "tc5 end"
+};
+
+/**
+  * @name   trace_Init
+  * @brief  keep or reset the trace ring after a reset
+  * @param  None
+  * @retval None
+  * @note   call early in setup()
+  */
+void trace_Init(void)
+{
+    if ( traceBuf.magic != TRACE_MAGIC )
+    {
+        memset(&traceBuf, 0, sizeof(traceBuf));
+        traceBuf.magic = TRACE_MAGIC;
+    }
+
+    traceHeld = (traceBuf.count != 0);
+    traceBuf.boots++;
+
+    traceOn = true;
+    trace_Event(TRACE_BOOT, hal_ResetCause(), traceBuf.boots);
+    traceOn = !traceHeld;
+}
+
+/**
+  * @name   trace_Event
+  * @brief  add a record
+  * @param  event
+  * @param  arg1
+  * @param  arg2
+  * @retval None
+  * @note   may be called from an ISR
+  */
+void trace_Event(TRACE_EVENT event, uint16_t arg1, uint32_t arg2)
+{
+    uint32_t        primask;
+    trace_rec_t     *r;
+
+    if ( traceOn == false )
+        return;
+
+    primask = hal_IrqSave();
+    r = &traceBuf.rec[traceBuf.count++ & (TRACE_RECORDS - 1)];
+    hal_IrqRestore(primask);
+
+    r->usecs = hal_Micros();
+    r->event = event;
+    r->arg1 = arg1;
+    r->arg2 = arg2;
+}
+
+/**
+  * @name   trace_IsHeld
+  * @brief  check for events held from before the last reset
+  */
+bool trace_IsHeld(void)
+{
+    return(traceHeld);
+}
+
+/**
+  * @name   trace_Enable
+  * @brief  start or stop tracing
+  * @param  on
+  * @retval None
+  * @note   starting releases held events to be overwritten
+  */
+void trace_Enable(bool on)
+{
+    traceHeld = false;
+    traceOn = on;
+}
+
+/**
+  * @name   trace_Clear
+  * @brief  empty the ring
+  * @param  None
+  * @retval None
+  */
+void trace_Clear(void)
+{
+    hal_IrqOff();
+    traceBuf.count = 0;
+    traceHeld = false;
+    hal_IrqOn();
+}
+
+/**
+  * @name   trace_Dump
+  * @brief  display the ring oldest first, then empty it and restart
+  * @param  None
+  * @retval None
+  * @note   tracing is paused while dumping so the dump's own USB
+  *         traffic does not overwrite what it is showing
+  */
+void trace_Dump(void)
+{
+    uint32_t        count = traceBuf.count;
+    uint32_t        first = (count > TRACE_RECORDS) ? count - TRACE_RECORDS : 0;
+    trace_rec_t     *r;
+
+    traceOn = false;
+
+    sprintf(outBfr, "%lu events, %lu shown, boot %lu%s", (unsigned long) count, (unsigned long) (count - first),
+            (unsigned long) traceBuf.boots, (traceHeld) ? ", held from before the last reset" : "");
+    SHOW();
+    terminalOut((char *) "      #      usecs  event             arg1    arg2");
+
+    for ( uint32_t n = first; n < count; n++ )
+    {
+        r = &traceBuf.rec[n & (TRACE_RECORDS - 1)];
+
+        sprintf(outBfr, "%7lu %10lu  %-16s  0x%04x  0x%08lx", (unsigned long) n, (unsigned long) r->usecs,
+                (r->event < TRACE_EVENT_COUNT) ? traceNames[r->event] : "?", r->arg1, (unsigned long) r->arg2);
+        SHOW();
+
+        // keep the terminal ring from dropping lines
+        if ( term_TxFree() < OUTBFR_SIZE )
+            term_Flush();
+    }
+
+    trace_Clear();
+    traceOn = true;
+}
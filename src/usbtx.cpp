@@ -0,0 +1,371 @@
+//===================================================================
+// usbtx.cpp
+//
+// CDC IN transmit banks.  usbtx_Send(), USBDeviceClass::send() for
+// the CDC IN endpoint, copies into the bank not on the bus and
+// returns.  A bank filled while the endpoint is idle is armed at once
+// as one multi-packet transfer, which the USB module sends packet by
+// packet from RAM, and the transfer complete interrupt arms the other
+// bank if it has data by then.  usbtx_Send() only waits, up to
+// USBTX_TIMEOUT_MSEC, when both banks are full.
+//
+// usbtx_Write() requests queue in usbTxReqs[] and are copied into the
+// banks as they free up, by the interrupt or the next usbtx_Write();
+// they never wait.  A request is done when the last bank holding its
+// bytes has gone to the host; usbtx_Poll() times out requests when a
+// transfer has not gone for USBTX_TIMEOUT_MSEC.  usbtx_Send() copies
+// only once the queued requests are in the banks, so the two keep
+// their order.
+//
+// A byte is counted as dropped once, when it leaves the banks or the
+// queue without going to the host: what usbtx_Send() could not copy,
+// the filling bank and the request bytes not yet copied at a timeout,
+// both banks at a reset.  The bank on the bus at a timeout is not
+// dropped; it goes if the host comes back, else the next reset counts
+// it.
+//
+// The endpoint registers are behind usbtx_EpXxx(), in USBCore.cpp on
+// the board and in the sim natively.
+//===================================================================
+#include <Arduino.h>
+#include "usbtx.hpp"
+#include "trace.hpp"
+#include "hal.hpp"
+
+#define USBTX_IDLE          0xFF
+#define USBTX_QUEUE_MASK    (USBTX_QUEUE_LEN - 1)
+
+static uint8_t          usbTxBank[2][USBTX_BANK_SIZE] __attribute__ ((aligned (4)));
+
+static volatile uint16_t usbTxCount[2];                 // bytes in each bank
+static volatile uint8_t usbTxActive = USBTX_IDLE;      // bank on the bus
+static volatile uint8_t usbTxFilling = 0;              // bank being copied into
+static volatile uint32_t usbTxArmedAt;                  // hal_Millis() bank went on the bus
+static volatile bool    usbTxHostGone = false;          // timed out, not read since
+static uint8_t          usbTxEp;                        // for trace records
+static usbtx_stats_t    usbTxStats;
+
+// free running indexes; tail..copy are in the banks, copy..head wait
+static usbtx_req_t      *usbTxReqs[USBTX_QUEUE_LEN];
+static volatile uint8_t usbTxReqHead = 0;              // next free
+static volatile uint8_t usbTxReqCopy = 0;              // next to copy into a bank
+static volatile uint8_t usbTxReqTail = 0;              // oldest not done
+static uint8_t          usbTxBankReqs[2];               // usbTxReqCopy when armed
+
+/**
+  * @name   usbTxRetire
+  * @brief  finish requests up to 'upTo'
+  * @param  upTo    usbTxReqs[] index, may be behind the tail after a
+  *                 timeout
+  * @param  status  USBTX_DONE or why they were not sent
+  * @retval None
+  * @note   interrupts off; the bytes of a request not sent that are
+  *         in a bank are the bank's, only those never copied are
+  *         dropped here
+  */
+static void usbTxRetire(uint8_t upTo, uint8_t status)
+{
+    usbtx_req_t     *req;
+
+    while ( (int8_t) (upTo - usbTxReqTail) > 0 )
+    {
+        req = usbTxReqs[usbTxReqTail & USBTX_QUEUE_MASK];
+        usbTxReqTail++;
+
+        if ( status == USBTX_DONE )
+            usbTxStats.completed++;
+        else
+            usbTxStats.dropped += req->len - req->copied;
+
+        req->status = status;
+
+        if ( req->done )
+            req->done(req);
+    }
+}
+
+/**
+  * @name   usbTxFill
+  * @brief  copy queued requests into the filling bank, interrupts off
+  */
+static void usbTxFill(void)
+{
+    uint8_t         bank = usbTxFilling;
+    usbtx_req_t     *req;
+    uint32_t        length;
+    uint32_t        room;
+
+    while ( usbTxReqCopy != usbTxReqHead && usbTxCount[bank] < USBTX_BANK_SIZE )
+    {
+        req = usbTxReqs[usbTxReqCopy & USBTX_QUEUE_MASK];
+        length = req->len - req->copied;
+        room = USBTX_BANK_SIZE - usbTxCount[bank];
+
+        if ( length > room )
+            length = room;
+
+        memcpy(&usbTxBank[bank][usbTxCount[bank]], req->data + req->copied, length);
+        usbTxCount[bank] += length;
+        usbTxStats.queued += length;
+        req->copied += length;
+
+        if ( req->copied == req->len )
+            usbTxReqCopy++;
+    }
+}
+
+/**
+  * @name   usbTxArm
+  * @brief  put a bank on the bus, interrupts off
+  */
+static void usbTxArm(uint8_t bank)
+{
+    usbTxActive = bank;
+    usbTxFilling = bank ^ 1;
+    usbTxBankReqs[bank] = usbTxReqCopy;
+    usbTxArmedAt = hal_Millis();
+    usbTxStats.transfers++;
+    usbtx_EpArm(usbTxBank[bank], usbTxCount[bank]);
+}
+
+/**
+  * @name   usbTxStart
+  * @brief  arm the filling bank if the endpoint is free, interrupts off
+  */
+static void usbTxStart(void)
+{
+    if ( usbTxActive == USBTX_IDLE && usbTxCount[usbTxFilling] != 0 )
+    {
+        usbTxArm(usbTxFilling);
+        usbTxFill();
+    }
+}
+
+/**
+  * @name   usbtx_Reset
+  * @brief  the endpoint was configured or the bus reset; drop everything
+  * @param  ep      endpoint number, for trace records
+  * @retval None
+  * @note   interrupts off
+  */
+void usbtx_Reset(uint8_t ep)
+{
+    usbTxEp = ep;
+    usbTxStats.dropped += usbTxCount[0] + usbTxCount[1];
+    usbTxCount[0] = 0;
+    usbTxCount[1] = 0;
+    usbTxReqCopy = usbTxReqHead;
+    usbTxRetire(usbTxReqHead, USBTX_DROPPED);
+    usbTxActive = USBTX_IDLE;
+    usbTxFilling = 0;
+    usbTxHostGone = false;
+}
+
+/**
+  * @name   usbtx_Done
+  * @brief  the bank on the bus has gone, from the transfer complete
+  *         interrupt
+  * @param  None
+  * @retval None
+  * @note   interrupts off
+  */
+void usbtx_Done(void)
+{
+    uint8_t         bank = usbTxActive;
+
+    usbtx_EpAckComplete();
+
+    if ( bank == USBTX_IDLE )
+        return;
+
+    usbTxCount[bank] = 0;
+    usbTxActive = USBTX_IDLE;
+    usbTxHostGone = false;
+
+    usbTxRetire(usbTxBankReqs[bank], USBTX_DONE);
+    usbTxFill();
+    usbTxStart();
+}
+
+/**
+  * @name   usbtx_Send
+  * @brief  copy bytes into the banks, waiting only while both are full
+  * @param  data
+  * @param  len
+  * @retval bytes copied, or (uint32_t) -1 if the host stopped reading
+  */
+uint32_t usbtx_Send(const uint8_t *data, uint32_t len)
+{
+    uint32_t        written = 0;
+    uint32_t        primask;
+    uint32_t        length;
+    uint32_t        startTime;
+    uint8_t         bank;
+
+    while ( len != 0 )
+    {
+        // copy a packet's worth at a time so the interrupt is held off
+        // for ~1 us, not a whole bank
+        primask = hal_IrqSave();
+        usbTxFill();
+        usbTxStart();
+        bank = usbTxFilling;
+        length = (usbTxReqCopy == usbTxReqHead) ? USBTX_BANK_SIZE - usbTxCount[bank] : 0;
+
+        if ( length != 0 )
+        {
+            if ( length > USBTX_PACKET_SIZE )
+                length = USBTX_PACKET_SIZE;
+
+            if ( length > len )
+                length = len;
+
+            memcpy(&usbTxBank[bank][usbTxCount[bank]], data, length);
+            usbTxCount[bank] += length;
+            usbTxStats.queued += length;
+            usbTxStart();
+            hal_IrqRestore(primask);
+
+            written += length;
+            len -= length;
+            data += length;
+            continue;
+        }
+
+        hal_IrqRestore(primask);
+
+        // both banks full; once the host has stopped reading, drop at once
+        // rather than wait USBTX_TIMEOUT_MSEC on every call
+        usbTxStats.waits++;
+        startTime = hal_Millis();
+
+        while ( usbTxFilling == bank )
+        {
+            if ( usbTxHostGone || hal_Millis() - startTime >= USBTX_TIMEOUT_MSEC )
+            {
+                trace_Event(usbTxHostGone ? TRACE_USB_TX_DROP : TRACE_USB_TX_TIMEOUT, usbTxEp, len);
+
+                if ( usbTxHostGone == false )
+                    usbTxStats.timeouts++;
+
+                usbTxHostGone = true;
+                usbTxStats.dropped += len;
+                return((uint32_t) -1);
+            }
+
+            // also completes with interrupts off
+            primask = hal_IrqSave();
+
+            if ( usbtx_EpTransferComplete() )
+                usbtx_Done();
+
+            hal_IrqRestore(primask);
+        }
+    }
+
+    return(written);
+}
+
+/**
+  * @name   usbtx_Write
+  * @brief  queue a request
+  * @param  req     len != 0; owned by usbtx.cpp until status leaves
+  *                 USBTX_PENDING
+  * @retval false if the queue is full or the port not configured
+  */
+bool usbtx_Write(usbtx_req_t *req)
+{
+    uint32_t        primask;
+    uint8_t         queued;
+
+    if ( usbtx_EpConfigured() == false || req->len == 0 )
+    {
+        usbTxStats.rejected++;
+        return(false);
+    }
+
+    primask = hal_IrqSave();
+    queued = usbTxReqHead - usbTxReqTail;
+
+    if ( queued >= USBTX_QUEUE_LEN )
+    {
+        usbTxStats.rejected++;
+        hal_IrqRestore(primask);
+        return(false);
+    }
+
+    req->copied = 0;
+    req->status = USBTX_PENDING;
+    usbTxReqs[usbTxReqHead & USBTX_QUEUE_MASK] = req;
+    usbTxReqHead++;
+    usbTxStats.requests++;
+
+    if ( queued + 1 > usbTxStats.queueHighWater )
+        usbTxStats.queueHighWater = queued + 1;
+
+    // host already gone, don't hold the request for another timeout
+    if ( usbTxHostGone )
+    {
+        trace_Event(TRACE_USB_TX_DROP, usbTxEp, req->len);
+        usbTxReqCopy = usbTxReqHead;
+        usbTxRetire(usbTxReqHead, USBTX_DROPPED);
+    }
+    else
+    {
+        usbTxFill();
+        usbTxStart();
+    }
+
+    hal_IrqRestore(primask);
+    return(true);
+}
+
+/**
+  * @name   usbtx_Poll
+  * @brief  time out requests when the host has stopped reading
+  * @param  None
+  * @retval None
+  * @note   call regularly from the foreground, term_Poll() does
+  */
+void usbtx_Poll(void)
+{
+    hal_IrqOff();
+
+    if ( usbTxActive != USBTX_IDLE && usbTxReqTail != usbTxReqHead &&
+         hal_Millis() - usbTxArmedAt >= USBTX_TIMEOUT_MSEC )
+    {
+        trace_Event(TRACE_USB_TX_TIMEOUT, usbTxEp, usbTxCount[usbTxFilling]);
+
+        if ( usbTxHostGone == false )
+            usbTxStats.timeouts++;
+
+        usbTxHostGone = true;
+
+        // the bank on the bus goes if the host comes back; the filling
+        // bank and what was never copied are dropped
+        usbTxStats.dropped += usbTxCount[usbTxFilling];
+        usbTxCount[usbTxFilling] = 0;
+        usbTxReqCopy = usbTxReqHead;
+        usbTxRetire(usbTxReqHead, USBTX_TIMEOUT);
+    }
+
+    hal_IrqOn();
+}
+
+/**
+  * @name   usbtx_Pending
+  * @brief  bytes in the banks, not yet read by the host
+  */
+uint32_t usbtx_Pending(void)
+{
+    return(usbTxCount[0] + usbTxCount[1]);
+}
+
+/**
+  * @name   usbtx_GetStats
+  * @brief  transmit counters
+  */
+const usbtx_stats_t *usbtx_GetStats(void)
+{
+    return(&usbTxStats);
+}
@@ -0,0 +1,275 @@
+#!/usr/bin/env python3
+#
+# CLI benchmark for the TTF project
+#
+# Drives the CLI the way a host script does, one command at a time,
+# and reports the round trip from sending the command's ENTER to the
+# next "ttf> " prompt, plus terminal output throughput from
+# 'xdebug txbench'.  Runs against the native build over a pty:
+#
+#   pio run -e native
+#   test/pty_bench.py .pio/build/native/program
+#
+# or against a fixture on a serial port:
+#
+#   test/pty_bench.py /dev/ttyACM0
+#
+# Round trips on the native build are host scheduling plus the
+# simulated I2C and scan chain time of each command; compare them
+# between builds, not with the fixture.
+#
+# --mode stream runs 'stream bin <msecs>' instead and decodes the
+# records as a host tool would (COBS, CRC, see stream.hpp): records/s,
+# bad frames, sequence gaps, and latency from each record's millis()
+# to its arrival.  The two clocks are not synchronized, so latency is
+# over the quickest record of the run, which also absorbs clock drift
+# over short runs.
+#
+import argparse
+import os
+import pty
+import select
+import signal
+import stat
+import statistics
+import struct
+import sys
+import termios
+import time
+import tty
+
+PROMPT = b"ttf> "
+
+# stream.hpp binary record
+STREAM_RECORD_TYPE = 0x01
+STREAM_RECORD_SIZE = 44
+STREAM_CRC_OFFSET = 42
+
+# commands with no lasting effect on the fixture that end by themselves
+COMMANDS = [
+    "vers",
+    "read 24",
+    "pins",
+    "power status",
+    "power meter",
+    "scan length",
+    "eeprom show",
+]
+
+
+class Target:
+    def __init__(self, path):
+        self.pid = None
+
+        if stat.S_ISCHR(os.stat(path).st_mode):
+            self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+            tty.setraw(self.fd)
+        else:
+            self.pid, self.fd = pty.fork()
+            if self.pid == 0:
+                os.execv(path, [path])
+
+    def close(self):
+        if self.pid:
+            os.kill(self.pid, signal.SIGTERM)
+            os.waitpid(self.pid, 0)
+        os.close(self.fd)
+
+    def send(self, text):
+        os.write(self.fd, text.encode())
+
+    def read_until(self, marker, timeout):
+        # returns (bytes read, seconds to the marker), None on timeout
+        data = b""
+        start = time.monotonic()
+        end = start + timeout
+
+        while True:
+            left = end - time.monotonic()
+            if left <= 0:
+                return data, None
+            ready, _, _ = select.select([self.fd], [], [], left)
+            if not ready:
+                continue
+            try:
+                chunk = os.read(self.fd, 4096)
+            except OSError:
+                return data, None
+            if not chunk:
+                return data, None
+            data += chunk
+            if data.endswith(marker):
+                return data, time.monotonic() - start
+
+    def sync(self):
+        # empty line until a bare prompt comes back
+        for _ in range(5):
+            self.send("\r")
+            _, secs = self.read_until(PROMPT, 2.0)
+            if secs is not None:
+                termios.tcflush(self.fd, termios.TCIFLUSH)
+                return True
+        return False
+
+
+def round_trips(target, repeat):
+    print("%-14s %6s %8s %8s %8s %8s" % ("command", "runs", "min ms", "mean ms", "max ms", "bytes"))
+
+    for cmd in COMMANDS:
+        times = []
+        size = 0
+
+        for _ in range(repeat):
+            # the CLI echoes each character; wait for the echo so only
+            # the ENTER to prompt time is measured
+            target.send(cmd)
+            target.read_until(cmd.encode(), 2.0)
+            target.send("\r")
+            data, secs = target.read_until(PROMPT, 10.0)
+            if secs is None:
+                print("%-14s no prompt" % cmd)
+                return False
+            times.append(secs * 1000.0)
+            size = len(data)
+
+        print("%-14s %6d %8.2f %8.2f %8.2f %8d" % (cmd, repeat, min(times),
+              statistics.mean(times), max(times), size))
+
+    return True
+
+
+def throughput(target, lines):
+    cmd = "xdebug txbench %d" % lines
+    target.send(cmd)
+    target.read_until(cmd.encode(), 2.0)
+    target.send("\r")
+    data, secs = target.read_until(PROMPT, 60.0)
+    if secs is None:
+        print("txbench: no prompt")
+        return False
+    print("txbench %d lines: %d bytes in %.3f s, %.1f KB/s" % (lines, len(data), secs,
+          len(data) / secs / 1024.0))
+    return True
+
+
+def crc16(data):
+    # CRC-16/CCITT-FALSE, stream_Crc16()
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(frame):
+    # stream_CobsDecode(), None if malformed
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(frame):
+            return None
+        out += frame[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def unpack(frame):
+    # stream_Unpack(): (seq, msecs) of a good record, None otherwise
+    raw = cobs_decode(frame)
+    if raw is None or len(raw) != STREAM_RECORD_SIZE or raw[0] != STREAM_RECORD_TYPE:
+        return None
+    if struct.unpack_from("<H", raw, STREAM_CRC_OFFSET)[0] != crc16(raw[:STREAM_CRC_OFFSET]):
+        return None
+    return struct.unpack_from("<II", raw, 4)
+
+
+def stream(target, msecs, seconds):
+    cmd = "stream bin %d" % msecs
+    target.send(cmd)
+    target.read_until(cmd.encode(), 2.0)
+    target.send("\r")
+
+    # frames as they arrive, with the host time of their 0x00
+    records = []
+    bad = 0
+    partial = b""
+    start = time.monotonic()
+    end = start + seconds
+
+    while time.monotonic() < end:
+        ready, _, _ = select.select([target.fd], [], [], end - time.monotonic())
+        if not ready:
+            continue
+        try:
+            chunk = os.read(target.fd, 4096)
+        except OSError:
+            break
+        now = time.monotonic()
+        frames = (partial + chunk).split(b"\x00")
+        partial = frames.pop()
+        for frame in frames:
+            rec = unpack(frame)
+            if rec is None:
+                bad += 1
+            else:
+                records.append((rec[0], rec[1], now))
+
+    target.send("stream off\r")
+    target.read_until(PROMPT, 2.0)
+    time.sleep(0.2)
+    termios.tcflush(target.fd, termios.TCIFLUSH)
+
+    # the first frame carries the command's echo and prompt
+    if len(records) < 2:
+        print("stream: %d records, %d bad frames" % (len(records), bad))
+        return False
+
+    secs = records[-1][2] - records[0][2]
+    gaps = sum(b[0] - a[0] - 1 for a, b in zip(records, records[1:]))
+    offsets = [now * 1000.0 - ms for _, ms, now in records]
+    latency = [o - min(offsets) for o in offsets]
+
+    print("stream bin %d: %d records in %.2f s, %.1f records/s (%.1f expected)" % (msecs, len(records), secs,
+          (len(records) - 1) / secs, 1000.0 / msecs))
+    print("  %d bad frames, %d records missing from the sequence" % (bad - 1 if bad else 0, gaps))
+    print("  latency over the quickest record: mean %.2f ms, max %.2f ms" % (statistics.mean(latency),
+          max(latency)))
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="TTF CLI round trip and throughput benchmark")
+    parser.add_argument("target", help="native program or serial device")
+    parser.add_argument("-n", "--repeat", type=int, default=20, help="runs of each command")
+    parser.add_argument("-l", "--lines", type=int, default=1000, help="txbench lines")
+    parser.add_argument("-m", "--mode", choices=["cli", "stream"], default="cli",
+                        help="round trips and txbench, or 'stream bin'")
+    parser.add_argument("-p", "--period", type=int, default=10, help="stream record period, msecs")
+    parser.add_argument("-s", "--seconds", type=float, default=5.0, help="time to stream for")
+    args = parser.parse_args()
+
+    target = Target(args.target)
+    try:
+        if not target.sync():
+            print("no 'ttf> ' prompt from %s" % args.target)
+            return 1
+        if args.mode == "stream":
+            return 0 if stream(target, args.period, args.seconds) else 1
+        if not round_trips(target, args.repeat):
+            return 1
+        if not throughput(target, args.lines):
+            return 1
+    finally:
+        target.close()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
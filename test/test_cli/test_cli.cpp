@@ -0,0 +1,355 @@
+//===================================================================
+// test_cli.cpp
+//
+// The CLI parser against random lines: words from the command and
+// subcommand tables, abbreviations of them, numbers out of range and
+// junk, with runs of spaces.  cli() must return for all of them, say
+// why an unknown or ambiguous command failed, and cli_RunBatch() must
+// stop at the first command that fails.  Subcommand dispatch is
+// checked with a few lines of known outcome, and a line longer than
+// cli() copies is cut short.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "eeprom.hpp"
+#include "hal.hpp"
+#include "sim.hpp"
+
+#define FUZZ_SEED           0x7F4A7C15
+#define FUZZ_LINES          4000
+#define FUZZ_BATCHES        1500
+
+extern EEPROM_data_t        EEPROMData;
+
+// first word of each cmdTable[] entry, in table order
+static const char           *commands[] = {
+    "eeprom", "help", "macro", "pins", "power", "read", "scan", "set", "sleep",
+    "status", "stream", "vers", "write", "xdebug"
+};
+
+// subcommands and their arguments; no "vers", which marks the end of a
+// batch, and none that reset the board or run for long
+static const char           *words[] = {
+    "show", "dump", "def", "del", "run", "help", "log", "clear", "up", "down", "status",
+    "timing", "cycle", "meter", "burst", "arm", "off", "main", "aux", "card", "mode", "spi",
+    "dma", "tc5", "length", "auto", "watch", "quiet", "bench", "speriod", "pdelay", "mperiod",
+    "bin", "json", "test", "clitest", "flash", "mem", "prof", "tasks", "trace", "on",
+    "eeprom", "macro", "pins", "power", "read", "scan", "set", "sleep", "stream", "write"
+};
+
+static const char           *numbers[] = {
+    "0", "1", "2", "7", "24", "80", "255", "256", "65535", "65536", "-1", "99999999999",
+    "0x10", "1e3", "12x", "+3"
+};
+
+// tokens that could pick 'xdebug reset', a bench, the status screen or
+// 'vers'; a fuzz line holding one is not run
+static const char           *avoid[] = {"reset", "txbench", "usbbench", "fmtbench", "status", "vers"};
+
+static char                 out[8192];
+static uint32_t             seed;
+
+/**
+  * @name   rnd
+  * @brief  0..n-1 from a fixed-seed LCG, the same lines every run
+  */
+static int rnd(int n)
+{
+    seed = seed * 1664525 + 1013904223;
+    return((seed >> 8) % n);
+}
+
+/**
+  * @name   pick
+  * @brief  random entry of a word list
+  */
+static const char *pick(const char **list, int count)
+{
+    return(list[rnd(count)]);
+}
+
+/**
+  * @name   addWord
+  * @brief  append a random word, abbreviated at times, and spaces
+  * @param  line    line so far
+  * @param  max     size of line
+  * @param  first   true for the command word
+  */
+static void addWord(char *line, int max, bool first)
+{
+    static const char   junk[] = "abcdefghijklmnopqrstuvwxyz0123456789-_.;/<>%";
+    char                word[24];
+    int                 len;
+    int                 r = rnd(10);
+
+    if ( first && r < 7 )
+        strcpy(word, pick(commands, sizeof(commands) / sizeof(commands[0])));
+    else if ( r < 6 )
+        strcpy(word, pick(words, sizeof(words) / sizeof(words[0])));
+    else if ( r < 8 )
+        strcpy(word, pick(numbers, sizeof(numbers) / sizeof(numbers[0])));
+    else
+    {
+        len = 1 + rnd(12);
+
+        for ( int i = 0; i < len; i++ )
+            word[i] = junk[rnd(sizeof(junk) - 1)];
+
+        word[len] = 0;
+    }
+
+    // abbreviate; ';' is a batch separator, not part of a cli() line
+    if ( rnd(4) == 0 && strlen(word) > 1 )
+        word[1 + rnd(strlen(word) - 1)] = 0;
+
+    for ( char *p = word; *p; p++ )
+    {
+        if ( *p == ';' )
+            *p = ' ';
+    }
+
+    len = strlen(line);
+    snprintf(line + len, max - len, "%s%s", word, (rnd(4) == 0) ? "   " : " ");
+}
+
+/**
+  * @name   isAvoided
+  * @brief  true if a word of the line is a prefix of an avoided word
+  */
+static bool isAvoided(const char *line)
+{
+    char            copy[MAX_LINE_SZ];
+    char            *word;
+
+    strcpy(copy, line);
+
+    for ( word = strtok(copy, " ;"); word; word = strtok(NULL, " ;") )
+    {
+        for ( unsigned i = 0; i < sizeof(avoid) / sizeof(avoid[0]); i++ )
+        {
+            if ( strncmp(avoid[i], word, strlen(word)) == 0 )
+                return(true);
+        }
+    }
+
+    return(false);
+}
+
+/**
+  * @name   randomLine
+  * @brief  random command line of up to MAX_LINE_SZ - 1 characters
+  */
+static void randomLine(char *line, int max)
+{
+    int             words = rnd(6);
+
+    line[0] = 0;
+
+    if ( rnd(8) == 0 )
+        strcpy(line, "  ");
+
+    for ( int i = 0; i <= words && (int) strlen(line) < max - 1; i++ )
+        addWord(line, max, i == 0);
+}
+
+/**
+  * @name   lookup
+  * @brief  commands[] entry a first word selects, by linear scan
+  * @retval index, CLI_LOOKUP_NONE or CLI_LOOKUP_AMBIGUOUS
+  */
+static int lookup(const char *word)
+{
+    int             found = CLI_LOOKUP_NONE;
+
+    for ( unsigned i = 0; i < sizeof(commands) / sizeof(commands[0]); i++ )
+    {
+        if ( strcmp(commands[i], word) == 0 )
+            return(i);
+
+        if ( strncmp(commands[i], word, strlen(word)) == 0 )
+            found = (found == CLI_LOOKUP_NONE) ? i : CLI_LOOKUP_AMBIGUOUS;
+    }
+
+    return(found);
+}
+
+/**
+  * @name   run
+  * @brief  run a line through cli() or cli_RunBatch() and keep its output
+  * @param  line    copied, the CLI splits it in place
+  * @param  batch   true for cli_RunBatch()
+  * @retval what cli() or cli_RunBatch() returned
+  * @note   a key is waiting, so 'sleep', 'macro run' and friends end
+  *         at once instead of holding the test
+  */
+static bool run(const char *line, bool batch)
+{
+    char            copy[MAX_LINE_SZ];
+    bool            rc;
+
+    strcpy(copy, line);
+    sim_OutputClear();
+    sim_Input("k");
+
+    rc = (batch) ? cli_RunBatch(copy, false) : cli(copy);
+    term_Flush();
+
+    while ( hal_SerialAvailable() )
+        (void) hal_SerialRead();
+
+    strncpy(out, sim_Output(), sizeof(out) - 1);
+    out[sizeof(out) - 1] = 0;
+    return(rc);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+    (void) run("stream off", false);
+    (void) run("power down card", false);
+    (void) run("scan watch off", false);
+}
+
+static void test_command_table(void)
+{
+    for ( unsigned i = 0; i < sizeof(commands) / sizeof(commands[0]); i++ )
+        TEST_ASSERT_EQUAL_STRING(commands[i], cli_CommandName(i));
+}
+
+static void test_fuzz_cli(void)
+{
+    char            line[MAX_LINE_SZ];
+    char            first[MAX_LINE_SZ];
+    bool            rc;
+    int             cmd;
+
+    seed = FUZZ_SEED;
+
+    for ( int n = 0; n < FUZZ_LINES; n++ )
+    {
+        randomLine(line, sizeof(line));
+
+        if ( isAvoided(line) )
+            continue;
+
+        rc = run(line, false);
+
+        if ( sscanf(line, "%s", first) != 1 )
+        {
+            TEST_ASSERT_TRUE_MESSAGE(rc, line);
+            continue;
+        }
+
+        // a first word that selects no command, or more than one
+        cmd = lookup(first);
+
+        if ( cmd == CLI_LOOKUP_NONE )
+        {
+            TEST_ASSERT_FALSE_MESSAGE(rc, line);
+            TEST_ASSERT_NOT_NULL_MESSAGE(strstr(out, "Invalid command"), line);
+        }
+        else if ( cmd == CLI_LOOKUP_AMBIGUOUS )
+        {
+            TEST_ASSERT_FALSE_MESSAGE(rc, line);
+            TEST_ASSERT_NOT_NULL_MESSAGE(strstr(out, "Ambiguous command"), line);
+        }
+    }
+}
+
+static void test_fuzz_batch(void)
+{
+    char            line[MAX_LINE_SZ];
+    char            part[MAX_LINE_SZ];
+    int             parts;
+    bool            rc;
+
+    seed = FUZZ_SEED + 1;
+
+    for ( int n = 0; n < FUZZ_BATCHES; n++ )
+    {
+        // a few commands, empty ones too, then 'vers' to show the batch
+        // ran to its end
+        line[0] = 0;
+        parts = 1 + rnd(3);
+
+        for ( int i = 0; i < parts; i++ )
+        {
+            if ( rnd(6) == 0 )
+                part[0] = 0;
+            else
+                randomLine(part, 20);
+
+            strcat(line, part);
+            strcat(line, (rnd(3) == 0) ? " ; " : ";");
+        }
+
+        if ( isAvoided(line) )
+            continue;
+
+        strcat(line, "vers");
+        rc = run(line, true);
+
+        TEST_ASSERT_EQUAL_MESSAGE(rc, strstr(out, "Firmware version") != NULL, line);
+    }
+}
+
+static void test_long_line(void)
+{
+    char            line[4 * MAX_LINE_SZ];
+
+    // longer than cli() copies, it must be cut short, not overrun
+    memset(line, 'x', sizeof(line) - 1);
+    line[sizeof(line) - 1] = 0;
+    memcpy(line, "vers ", 5);
+
+    sim_OutputClear();
+    TEST_ASSERT_FALSE(cli(line));
+    term_Flush();
+    TEST_ASSERT_NOT_NULL(strstr(sim_Output(), "Too many arguments for this command"));
+}
+
+static void test_subcmd_dispatch(void)
+{
+    uint16_t        saved = EEPROMData.meter_period_msec;
+
+    // unknown and ambiguous subcommands fail and say so
+    TEST_ASSERT_FALSE(run("set bogus 5", false));
+    TEST_ASSERT_NOT_NULL(strstr(out, "Invalid subcommand 'bogus'"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "FLASH Parameters are:"));
+
+    TEST_ASSERT_FALSE(run("pins lo x", false));
+    TEST_ASSERT_NOT_NULL(strstr(out, "Invalid subcommand 'x'"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "Usage: pins [log [clear]]"));
+
+    TEST_ASSERT_FALSE(run("power d", false));
+    TEST_ASSERT_FALSE(run("set speriod", false));
+    TEST_ASSERT_NOT_NULL(strstr(out, "Incorrect number of arguments for 'speriod'"));
+
+    // abbreviations reach the subcommand
+    TEST_ASSERT_TRUE(run("set mp 250", false));
+    TEST_ASSERT_EQUAL_UINT16(250, EEPROMData.meter_period_msec);
+    TEST_ASSERT_TRUE(run("pi l c", false));
+    TEST_ASSERT_NOT_NULL(strstr(out, "Pin edge log and counters cleared"));
+    TEST_ASSERT_TRUE(run("pins log", false));
+
+    sprintf(out, "set mperiod %u", saved);
+    TEST_ASSERT_TRUE(run(out, false));
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_command_table);
+    RUN_TEST(test_long_line);
+    RUN_TEST(test_subcmd_dispatch);
+    RUN_TEST(test_fuzz_cli);
+    RUN_TEST(test_fuzz_batch);
+    return(UNITY_END());
+}
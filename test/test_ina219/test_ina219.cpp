@@ -0,0 +1,223 @@
+//===================================================================
+// test_ina219.cpp
+//
+// meter.cpp against the INA219 register model: calibration and the
+// CURRENT register, the signed shunt register and negative current,
+// INA219_BUS_MV() scaling, the PGA limit and reset.  With a 10 mohm
+// shunt CAL = 4096 gives a 1 mA CURRENT LSB, so the register must
+// agree with the mA meter_Sample() works out from the shunt voltage.
+// Burst capture keeps to its sample period with CNVR.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "main.hpp"
+#include "meter.hpp"
+#include "sim.hpp"
+
+#define CAL_1MA             4096        // 0.04096 / (1 mA * 10 mohms)
+
+static const uint8_t        railAddrs[METER_RAIL_COUNT] = {METER_12V_I2C_ADDR, METER_3V3_I2C_ADDR};
+
+/**
+  * @name   readReg
+  * @brief  read an INA219 register, failing the test on an I2C error
+  */
+static uint16_t readReg(uint8_t i2cAddr, uint8_t reg)
+{
+    uint16_t        value = 0;
+
+    TEST_ASSERT_TRUE(ina219_ReadReg(i2cAddr, reg, &value));
+    return(value);
+}
+
+/**
+  * @name   sample
+  * @brief  set what a rail's INA219 measures and sample it
+  * @param  rail
+  * @param  ma      shunt current
+  * @param  busMv   bus voltage
+  * @retval the rail
+  */
+static const meter_rail_t *sample(METER_RAIL rail, int32_t ma, uint32_t busMv)
+{
+    sim_Ina219Set(railAddrs[rail], ma, busMv);
+    TEST_ASSERT_TRUE(meter_Sample(rail));
+    return(meter_GetRail(rail));
+}
+
+void setUp(void)
+{
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+        TEST_ASSERT_TRUE(ina219_WriteReg(railAddrs[i], INA219_REG_CALIBRATION, CAL_1MA));
+}
+
+void tearDown(void)
+{
+    for ( int i = 0; i < METER_RAIL_COUNT; i++ )
+    {
+        (void) ina219_WriteReg(railAddrs[i], INA219_REG_CALIBRATION, 0);
+        sim_Ina219Unset(railAddrs[i]);
+    }
+}
+
+static void test_calibration(void)
+{
+    const meter_rail_t  *r;
+    const int32_t       currents[] = {0, 1, 350, 1800, 12345, 31999};
+
+    // bit 0 of CALIBRATION is not used
+    TEST_ASSERT_TRUE(ina219_WriteReg(METER_12V_I2C_ADDR, INA219_REG_CALIBRATION, CAL_1MA + 1));
+    TEST_ASSERT_EQUAL_HEX16(CAL_1MA, readReg(METER_12V_I2C_ADDR, INA219_REG_CALIBRATION));
+
+    for ( unsigned i = 0; i < sizeof(currents) / sizeof(currents[0]); i++ )
+    {
+        r = sample(METER_RAIL_12V, currents[i], 12000);
+        TEST_ASSERT_EQUAL_INT32(currents[i], r->currentMa);
+        TEST_ASSERT_EQUAL_INT16(r->currentMa, readReg(METER_12V_I2C_ADDR, INA219_REG_CURRENT));
+    }
+
+    // twice the CAL, half the CURRENT LSB
+    TEST_ASSERT_TRUE(ina219_WriteReg(METER_12V_I2C_ADDR, INA219_REG_CALIBRATION, 2 * CAL_1MA));
+    r = sample(METER_RAIL_12V, 1800, 12000);
+    TEST_ASSERT_EQUAL_INT16(2 * r->currentMa, readReg(METER_12V_I2C_ADDR, INA219_REG_CURRENT));
+
+    // POWER LSB is 20 CURRENT LSBs
+    TEST_ASSERT_TRUE(ina219_WriteReg(METER_12V_I2C_ADDR, INA219_REG_CALIBRATION, CAL_1MA));
+    r = sample(METER_RAIL_12V, 1800, 12000);
+    TEST_ASSERT_INT32_WITHIN(20, r->powerMw, readReg(METER_12V_I2C_ADDR, INA219_REG_POWER) * 20);
+}
+
+static void test_negative_current(void)
+{
+    const meter_rail_t  *r;
+    const int32_t       currents[] = {-1, -350, -1800, -31999};
+
+    for ( unsigned i = 0; i < sizeof(currents) / sizeof(currents[0]); i++ )
+    {
+        r = sample(METER_RAIL_3V3_AUX, currents[i], 3300);
+
+        // SHUNT is two's complement, 10 uV per LSB
+        TEST_ASSERT_EQUAL_INT16(currents[i] * METER_3V3_SHUNT_MOHMS / 10,
+                                readReg(METER_3V3_I2C_ADDR, INA219_REG_SHUNT));
+        TEST_ASSERT_EQUAL_INT32(currents[i], r->currentMa);
+        TEST_ASSERT_EQUAL_INT16(r->currentMa, readReg(METER_3V3_I2C_ADDR, INA219_REG_CURRENT));
+        TEST_ASSERT_EQUAL_INT32((int32_t) r->busMv * currents[i] / 1000, r->powerMw);
+        TEST_ASSERT_TRUE(r->powerMw <= 0);
+    }
+}
+
+static void test_bus_scaling(void)
+{
+    const meter_rail_t  *r;
+    const uint32_t      mv[] = {0, 4, 3300, 3301, 3303, 11996, 12000, 32000};
+    uint16_t            raw;
+
+    for ( unsigned i = 0; i < sizeof(mv) / sizeof(mv[0]); i++ )
+    {
+        r = sample(METER_RAIL_12V, 100, mv[i]);
+        raw = readReg(METER_12V_I2C_ADDR, INA219_REG_BUS);
+
+        // 4 mV LSB from bit 3, CNVR and OVF below it
+        TEST_ASSERT_EQUAL_UINT32(mv[i] / 4 * 4, INA219_BUS_MV(raw));
+        TEST_ASSERT_EQUAL_UINT32(mv[i] / 4, raw >> 3);
+        TEST_ASSERT_EQUAL_UINT16(INA219_BUS_MV(raw), r->busMv);
+    }
+
+    // 32V range tops out at 32 V
+    r = sample(METER_RAIL_12V, 100, 40000);
+    TEST_ASSERT_EQUAL_UINT16(32000, r->busMv);
+}
+
+static void test_pga_limit(void)
+{
+    const meter_rail_t  *r;
+
+    // PGA /8 is +-320 mV, 32 A through 10 mohms
+    r = sample(METER_RAIL_12V, 40000, 12000);
+    TEST_ASSERT_EQUAL_HEX16(32000, readReg(METER_12V_I2C_ADDR, INA219_REG_SHUNT));
+    TEST_ASSERT_EQUAL_INT32(32000, r->currentMa);
+
+    r = sample(METER_RAIL_12V, -40000, 12000);
+    TEST_ASSERT_EQUAL_INT32(-32000, r->currentMa);
+}
+
+static void test_reset(void)
+{
+    const meter_rail_t  *r;
+
+    TEST_ASSERT_TRUE(ina219_WriteReg(METER_12V_I2C_ADDR, INA219_REG_CONFIG, INA219_CONFIG_RESET));
+    TEST_ASSERT_EQUAL_HEX16(INA219_CONFIG_CONTINUOUS, readReg(METER_12V_I2C_ADDR, INA219_REG_CONFIG));
+    TEST_ASSERT_EQUAL_HEX16(0, readReg(METER_12V_I2C_ADDR, INA219_REG_CALIBRATION));
+
+    // no CURRENT without a calibration, the shunt still reads
+    sim_Advance(2000);
+    r = sample(METER_RAIL_12V, 1800, 12000);
+    TEST_ASSERT_EQUAL_INT32(1800, r->currentMa);
+    TEST_ASSERT_EQUAL_HEX16(0, readReg(METER_12V_I2C_ADDR, INA219_REG_CURRENT));
+}
+
+static void test_burst_pacing(void)
+{
+    const char      *line;
+    char            *end;
+    uint64_t        start;
+    uint32_t        usecs, elapsed, last = 0, n = 0;
+
+    TEST_ASSERT_TRUE(meter_BurstArm());
+    sim_Advance(1000);
+    start = sim_Now();
+    meter_BurstTrigger();
+
+    // loop() passes of uneven length must not show in the spacing
+    for ( int i = 0; i < 400; i++ )
+    {
+        sim_Advance((i % 3) ? 10 : 250);
+        meter_Poll();
+    }
+
+    elapsed = (uint32_t) (sim_Now() - start);
+    meter_BurstDisarm();
+    sim_OutputClear();
+    meter_BurstDump();
+    sim_Run(100000, SIM_LOOP_USECS);
+
+    line = strstr(sim_Output(), "AUX_mA");
+    TEST_ASSERT_NOT_NULL(line);
+
+    while ( (line = strchr(line, '\n')) != NULL )
+    {
+        usecs = strtoul(line + 1, &end, 10);
+
+        if ( end == line + 1 )
+            break;
+
+        // each sample is at the first conversion after it is due: a
+        // late loop() pass, the CNVR clear and waiting for a conversion
+        TEST_ASSERT_UINT32_WITHIN(350, n * METER_BURST_PERIOD_USECS + 350, usecs);
+        TEST_ASSERT_TRUE(n == 0 || usecs - last > METER_BURST_PERIOD_USECS / 2);
+        last = usecs;
+        line = end;
+        n++;
+    }
+
+    TEST_ASSERT_UINT32_WITHIN(1, elapsed / METER_BURST_PERIOD_USECS, n);
+
+    sim_OutputClear();
+    meter_BurstShow();
+    sim_Run(100000, SIM_LOOP_USECS);
+    TEST_ASSERT_NOT_NULL(strstr(sim_Output(), "0 periods missed"));
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_calibration);
+    RUN_TEST(test_negative_current);
+    RUN_TEST(test_bus_scaling);
+    RUN_TEST(test_pga_limit);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_burst_pacing);
+    return(UNITY_END());
+}
@@ -0,0 +1,114 @@
+//===================================================================
+// test_macro.cpp
+//
+// Macros and ';' batches through the CLI: 'macro def' found from
+// abbreviations, one FLASH commit per macro change, and a failing
+// command stopping a batch or a macro.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "main.hpp"
+#include "sim.hpp"
+
+#define CMD_USECS           2000000
+
+/**
+  * @name   count
+  * @brief  number of times 'text' appears in 's'
+  */
+static int count(const char *s, const char *text)
+{
+    int             n = 0;
+
+    while ( (s = strstr(s, text)) != NULL )
+    {
+        n++;
+        s += strlen(text);
+    }
+
+    return(n);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+    (void) sim_Command("macro del m1", CMD_USECS);
+}
+
+static void test_def_abbreviated(void)
+{
+    const char      *abbrevs[] = {"macro def", "mac def", "m def", " macro   def"};
+    char            line[MAX_LINE_SZ];
+    const char      *out;
+    uint32_t        commits;
+
+    for ( unsigned i = 0; i < sizeof(abbrevs) / sizeof(abbrevs[0]); i++ )
+    {
+        sprintf(line, "%s m1 vers; vers", abbrevs[i]);
+        commits = sim_NvmCommits();
+        out = sim_Command(line, CMD_USECS);
+
+        // stored, not run
+        TEST_ASSERT_EQUAL_MESSAGE(0, count(out, "Firmware version"), line);
+        TEST_ASSERT_EQUAL_MESSAGE(commits + 1, sim_NvmCommits(), line);
+
+        out = sim_Command("macro", CMD_USECS);
+        TEST_ASSERT_NOT_NULL_MESSAGE(strstr(out, "m1           vers; vers"), line);
+
+        out = sim_Command("macro run m1", CMD_USECS);
+        TEST_ASSERT_EQUAL_MESSAGE(2, count(out, "Firmware version"), line);
+    }
+
+    // 'd' is def or del: an error, and the rest of the batch is not run
+    out = sim_Command("macro d m1 vers; vers", CMD_USECS);
+    TEST_ASSERT_NOT_NULL(strstr(out, "Ambiguous subcommand 'd'"));
+    TEST_ASSERT_EQUAL(0, count(out, "Firmware version"));
+}
+
+static void test_del_commits_once(void)
+{
+    uint32_t        commits;
+
+    (void) sim_Command("macro def m1 vers", CMD_USECS);
+    commits = sim_NvmCommits();
+    (void) sim_Command("macro del m1", CMD_USECS);
+    TEST_ASSERT_EQUAL(commits + 1, sim_NvmCommits());
+    TEST_ASSERT_NULL(strstr(sim_Command("macro", CMD_USECS), "m1"));
+}
+
+static void test_batch_stops_on_failure(void)
+{
+    const char      *out;
+
+    out = sim_Command("vers; read 200; vers", CMD_USECS);
+    TEST_ASSERT_EQUAL(1, count(out, "Firmware version"));
+
+    out = sim_Command("vers; macro run nosuch; vers", CMD_USECS);
+    TEST_ASSERT_EQUAL(1, count(out, "Firmware version"));
+}
+
+static void test_macro_stops_on_failure(void)
+{
+    const char      *out;
+
+    (void) sim_Command("macro def m1 vers; power bogus; vers", CMD_USECS);
+    out = sim_Command("macro run m1 3", CMD_USECS);
+
+    TEST_ASSERT_EQUAL(1, count(out, "Firmware version"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "Macro 'm1' stopped in pass 1"));
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_def_abbreviated);
+    RUN_TEST(test_del_commits_once);
+    RUN_TEST(test_batch_stops_on_failure);
+    RUN_TEST(test_macro_stops_on_failure);
+    return(UNITY_END());
+}
@@ -0,0 +1,141 @@
+//===================================================================
+// test_pins.cpp
+//
+// commands.cpp's TTF_PINS tables against the board's own
+// g_APinDescription[], compiled natively from variant_pins.h, the
+// rows variant.cpp includes.  Every PORT bit is one pin's, the EXTINT
+// lines the sim reports are the variant's, verifyPinTables() finds
+// nothing, each pin name maps to its own entry, and an input driven
+// alone at the PORT bit variant.cpp gives it is the only input
+// readAllPins() decodes as set.
+//===================================================================
+#include <Arduino.h>
+#include <WVariant.h>
+#include <unity.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "commands.hpp"
+#include "hal.hpp"
+#include "sim.hpp"
+
+extern uint8_t              pinStates[PINS_COUNT];
+
+void setUp(void)
+{
+    term_Flush();
+    sim_OutputClear();
+}
+
+void tearDown(void)
+{
+}
+
+static void test_variant_rows(void)
+{
+    uint32_t        used[2] = {0, 0};
+    uint32_t        mask;
+
+    // PA or PB, and no PORT bit given to two pin numbers
+    for ( int i = 0; i < PINS_COUNT; i++ )
+    {
+        TEST_ASSERT_TRUE(g_APinDescription[i].ulPort == PORTA || g_APinDescription[i].ulPort == PORTB);
+        TEST_ASSERT_TRUE(g_APinDescription[i].ulPin < 32);
+
+        mask = 1UL << g_APinDescription[i].ulPin;
+        TEST_ASSERT_EQUAL_UINT32(0, used[g_APinDescription[i].ulPort] & mask);
+        used[g_APinDescription[i].ulPort] |= mask;
+    }
+}
+
+static void test_hal_uses_variant(void)
+{
+    uint8_t         group;
+    uint8_t         bit;
+
+    for ( int i = 0; i < PINS_COUNT; i++ )
+    {
+        hal_PinPort(i, &group, &bit);
+        TEST_ASSERT_EQUAL(g_APinDescription[i].ulPort, group);
+        TEST_ASSERT_EQUAL(g_APinDescription[i].ulPin, bit);
+        TEST_ASSERT_EQUAL(g_APinDescription[i].ulExtInt, hal_PinExtInt(i));
+    }
+}
+
+static void test_ttf_pins_match_variant(void)
+{
+    TEST_ASSERT_EQUAL(0, verifyPinTables());
+    term_Flush();
+    TEST_ASSERT_NULL(strstr(sim_Output(), "Pin table error"));
+}
+
+static void test_pin_names(void)
+{
+    int             listed = 0;
+
+    for ( int i = 0; i < static_pin_count; i++ )
+    {
+        TEST_ASSERT_EQUAL(i, getPinIndex(staticPins[i].pinNo));
+        TEST_ASSERT_EQUAL_STRING(staticPins[i].name, getPinName(staticPins[i].pinNo));
+
+        for ( int j = 0; j < i; j++ )
+            TEST_ASSERT_TRUE_MESSAGE(strcmp(staticPins[i].name, staticPins[j].name) != 0, staticPins[i].name);
+    }
+
+    // pin numbers not in TTF_PINS have no entry
+    for ( int pinNo = 0; pinNo < PINS_COUNT; pinNo++ )
+    {
+        if ( getPinIndex(pinNo) >= 0 )
+            listed++;
+    }
+
+    TEST_ASSERT_EQUAL(static_pin_count, listed);
+    TEST_ASSERT_EQUAL(-1, getPinIndex(PINS_COUNT));
+}
+
+static void test_inputs_decode(void)
+{
+    uint8_t         levels[PINS_COUNT];
+
+    for ( int i = 0; i < PINS_COUNT; i++ )
+        levels[i] = sim_PinLevel(i);
+
+    // drive one input high at a time, the rest low
+    for ( int i = 0; i < static_pin_count; i++ )
+    {
+        if ( staticPins[i].pinFunc == OUTPUT )
+            continue;
+
+        for ( int j = 0; j < static_pin_count; j++ )
+        {
+            if ( staticPins[j].pinFunc != OUTPUT )
+                sim_PinSet(staticPins[j].pinNo, (i == j) ? 1 : 0);
+        }
+
+        readAllPins();
+
+        for ( int j = 0; j < static_pin_count; j++ )
+        {
+            if ( staticPins[j].pinFunc != OUTPUT )
+                TEST_ASSERT_EQUAL_MESSAGE((i == j) ? 1 : 0, pinStates[j], staticPins[j].name);
+        }
+    }
+
+    for ( int i = 0; i < static_pin_count; i++ )
+    {
+        if ( staticPins[i].pinFunc != OUTPUT )
+            sim_PinSet(staticPins[i].pinNo, levels[staticPins[i].pinNo]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_variant_rows);
+    RUN_TEST(test_hal_uses_variant);
+    RUN_TEST(test_ttf_pins_match_variant);
+    RUN_TEST(test_pin_names);
+    RUN_TEST(test_inputs_decode);
+    return(UNITY_END());
+}
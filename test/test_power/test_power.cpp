@@ -0,0 +1,205 @@
+//===================================================================
+// test_power.cpp
+//
+// power_Poll() sequencing against the simulated card: the state order
+// of a good power up and down, the NIC_PWR_GOOD timeout, the card
+// being pulled at each step of the sequence, and sequencer messages
+// held while a command waits.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "main.hpp"
+#include "eeprom.hpp"
+#include "power.hpp"
+#include "hal.hpp"
+#include "sim.hpp"
+
+#define STEP_USECS          100
+#define MAX_TRANSITIONS     16
+
+extern EEPROM_data_t        EEPROMData;
+
+// states seen by runUntil() and when they were entered
+static PWR_STATE            seen[MAX_TRANSITIONS];
+static uint64_t             seenAt[MAX_TRANSITIONS];
+static int                  seenCount;
+
+/**
+  * @name   runUntil
+  * @brief  run loop() until the sequencer is in a state, logging states
+  * @param  state       state to stop in
+  * @param  maxUsecs    give up after this long
+  * @retval true if the state was reached
+  */
+static bool runUntil(PWR_STATE state, uint32_t maxUsecs)
+{
+    uint64_t        end = sim_Now() + maxUsecs;
+
+    while ( sim_Now() < end )
+    {
+        if ( seenCount == 0 || seen[seenCount - 1] != power_GetState() )
+        {
+            if ( seenCount < MAX_TRANSITIONS )
+            {
+                seen[seenCount] = power_GetState();
+                seenAt[seenCount++] = sim_Now();
+            }
+        }
+
+        if ( power_GetState() == state )
+            return(true);
+
+        loop();
+        sim_Advance(STEP_USECS);
+    }
+
+    return(false);
+}
+
+/**
+  * @name   msecsIn
+  * @brief  time between entering a logged state and leaving it
+  */
+static uint32_t msecsIn(PWR_STATE state)
+{
+    for ( int i = 0; i + 1 < seenCount; i++ )
+    {
+        if ( seen[i] == state )
+            return((uint32_t) ((seenAt[i + 1] - seenAt[i]) / 1000));
+    }
+
+    return(0);
+}
+
+void setUp(void)
+{
+    seenCount = 0;
+}
+
+void tearDown(void)
+{
+    power_Down();
+    runUntil(PWR_STATE_OFF, 1000000);
+    sim_CardInsert(0x0);
+    sim_CardSetPwrGood(true, SIM_PWRGOOD_USECS);
+    sim_Run(10000, 1000);
+}
+
+static void test_power_up_down(void)
+{
+    const PWR_STATE     expectUp[] = {PWR_STATE_MAIN_EN, PWR_STATE_AUX_EN, PWR_STATE_WAIT_PWRGOOD,
+                                      PWR_STATE_SCAN, PWR_STATE_ON};
+
+    TEST_ASSERT_EQUAL(PWR_STATE_OFF, power_GetState());
+    TEST_ASSERT_TRUE(power_Up());
+    TEST_ASSERT_FALSE(power_Up());
+    TEST_ASSERT_TRUE(runUntil(PWR_STATE_ON, 5000000));
+
+    TEST_ASSERT_EQUAL(sizeof(expectUp) / sizeof(expectUp[0]), seenCount);
+    for ( int i = 0; i < seenCount; i++ )
+        TEST_ASSERT_EQUAL(expectUp[i], seen[i]);
+
+    // MAIN_EN is held for 'pdelay', SCAN for PWR_SCAN_DELAY_MSEC
+    TEST_ASSERT_UINT_WITHIN(2, EEPROMData.pwr_seq_delay_msec, msecsIn(PWR_STATE_MAIN_EN));
+    TEST_ASSERT_UINT_WITHIN(2, PWR_SCAN_DELAY_MSEC, msecsIn(PWR_STATE_SCAN));
+    TEST_ASSERT_EQUAL(PWR_FAULT_NONE, power_GetFault());
+    TEST_ASSERT_EQUAL(1, sim_PinLevel(OCP_MAIN_PWR_EN));
+    TEST_ASSERT_EQUAL(1, sim_PinLevel(OCP_AUX_PWR_EN));
+    TEST_ASSERT_NOT_NULL(strstr(sim_Output(), "Power up sequence complete"));
+
+    seenCount = 0;
+    power_Down();
+    TEST_ASSERT_TRUE(runUntil(PWR_STATE_OFF, 1000000));
+    TEST_ASSERT_EQUAL(PWR_STATE_POWER_DOWN, seen[0]);
+    TEST_ASSERT_EQUAL(0, sim_PinLevel(OCP_MAIN_PWR_EN));
+    TEST_ASSERT_EQUAL(0, sim_PinLevel(OCP_AUX_PWR_EN));
+    TEST_ASSERT_EQUAL(PWR_FAULT_NONE, power_GetFault());
+}
+
+static void test_pwrgood_timeout(void)
+{
+    sim_CardSetPwrGood(false, 0);
+
+    TEST_ASSERT_TRUE(power_Up());
+    TEST_ASSERT_TRUE(runUntil(PWR_STATE_FAULT, 5000000));
+
+    TEST_ASSERT_EQUAL(PWR_FAULT_PWRGOOD_TIMEOUT, power_GetFault());
+    TEST_ASSERT_EQUAL(PWR_STATE_WAIT_PWRGOOD, seen[seenCount - 2]);
+    TEST_ASSERT_UINT_WITHIN(2, PWR_PWRGOOD_TIMEOUT_MSEC, msecsIn(PWR_STATE_WAIT_PWRGOOD));
+    TEST_ASSERT_EQUAL(0, sim_PinLevel(OCP_MAIN_PWR_EN));
+    TEST_ASSERT_EQUAL(0, sim_PinLevel(OCP_AUX_PWR_EN));
+
+    // the message goes out on the next terminal task run
+    sim_Run(1000, STEP_USECS);
+    TEST_ASSERT_NOT_NULL(strstr(sim_Output(), "Power fault: NIC_PWR_GOOD timeout"));
+}
+
+static void test_slow_pwrgood(void)
+{
+    // just inside the timeout
+    sim_CardSetPwrGood(true, (PWR_PWRGOOD_TIMEOUT_MSEC - 2) * 1000);
+
+    TEST_ASSERT_TRUE(power_Up());
+    TEST_ASSERT_TRUE(runUntil(PWR_STATE_ON, 5000000));
+    TEST_ASSERT_EQUAL(PWR_FAULT_NONE, power_GetFault());
+}
+
+static void test_card_removed(void)
+{
+    const PWR_STATE     pullIn[] = {PWR_STATE_MAIN_EN, PWR_STATE_WAIT_PWRGOOD, PWR_STATE_SCAN, PWR_STATE_ON};
+    char                msg[40];
+
+    for ( unsigned i = 0; i < sizeof(pullIn) / sizeof(pullIn[0]); i++ )
+    {
+        sprintf(msg, "pulled in %s", power_GetStateName(pullIn[i]));
+        seenCount = 0;
+        sim_OutputClear();
+
+        // long enough to pull the card while waiting for it
+        sim_CardSetPwrGood(true, (PWR_PWRGOOD_TIMEOUT_MSEC - 10) * 1000);
+
+        TEST_ASSERT_TRUE_MESSAGE(power_Up(), msg);
+        TEST_ASSERT_TRUE_MESSAGE(runUntil(pullIn[i], 5000000), msg);
+
+        // well inside the state, before any timeout could end it
+        sim_Run(5000, STEP_USECS);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(pullIn[i], power_GetState(), msg);
+
+        sim_CardRemove();
+        TEST_ASSERT_TRUE_MESSAGE(runUntil(PWR_STATE_FAULT, 10000), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(PWR_FAULT_CARD_REMOVED, power_GetFault(), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, sim_PinLevel(OCP_MAIN_PWR_EN), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, sim_PinLevel(OCP_AUX_PWR_EN), msg);
+        sim_Run(1000, STEP_USECS);
+        TEST_ASSERT_NOT_NULL_MESSAGE(strstr(sim_Output(), "Power fault: card removed"), msg);
+
+        tearDown();
+    }
+}
+
+static void test_messages_held(void)
+{
+    const char          *out = sim_Command("power up card; sleep 1000; vers", 5000000);
+    const char          *vers = strstr(out, "Firmware version");
+    const char          *done = strstr(out, "Power up sequence complete");
+
+    // the sequence completes during 'sleep'; its message and prompt wait
+    // for the end of the batch
+    TEST_ASSERT_NOT_NULL(vers);
+    TEST_ASSERT_NOT_NULL(done);
+    TEST_ASSERT_TRUE(done > vers);
+    TEST_ASSERT_EQUAL_PTR(out + strlen(out) - strlen(SIM_PROMPT), strstr(out, SIM_PROMPT));
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_power_up_down);
+    RUN_TEST(test_pwrgood_timeout);
+    RUN_TEST(test_slow_pwrgood);
+    RUN_TEST(test_card_removed);
+    RUN_TEST(test_messages_held);
+    return(UNITY_END());
+}
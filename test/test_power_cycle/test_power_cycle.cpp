@@ -0,0 +1,140 @@
+//===================================================================
+// test_power_cycle.cpp
+//
+// 10000 cycles of 'power cycle' against the simulated card, which is
+// made to fail every so often from its power up hook: TEMP_CRIT,
+// NIC_PWR_GOOD never rising, and NIC_PWR_GOOD dropping in the SCAN
+// state.  Checks the fault counts and MAIN_EN -> NIC_PWR_GOOD stats.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "main.hpp"
+#include "power.hpp"
+#include "sim.hpp"
+
+#define CYCLES              10000
+#define ON_MSECS            10
+#define OFF_MSECS           10
+#define PDELAY_MSECS        10
+#define STEP_USECS          5000
+
+// faults injected, in this order of precedence
+#define TEMP_CRIT_EVERY     83
+#define TIMEOUT_EVERY       97
+#define LOST_EVERY          89
+#define LOST_AFTER_USECS    500000
+
+// NIC_PWR_GOOD latency after AUX_EN varies over LATENCY_STEPS values
+#define LATENCY_USECS       1000
+#define LATENCY_STEP_USECS  100
+#define LATENCY_STEPS       5
+
+#define LATENCY_MAX_USECS   (LATENCY_USECS + (LATENCY_STEPS - 1) * LATENCY_STEP_USECS)
+#define LATENCY_MEAN_USECS  (LATENCY_USECS + (LATENCY_STEPS - 1) * LATENCY_STEP_USECS / 2)
+
+// MAIN_EN -> AUX_EN is 'pdelay' rounded up to the next power_Poll(),
+// which is one step plus the I2C and scan time of a loop() pass away
+#define PDELAY_USECS        (PDELAY_MSECS * 1000)
+#define POLL_SLACK_USECS    (STEP_USECS + 2000)
+
+static uint32_t             powerUps;
+
+/**
+  * @name   cardPowerUp
+  * @brief  sim_CardOnPowerUp() hook, sets up the card for this cycle
+  * @param  n   not used, powerUps counts the cycles of this test
+  */
+static void cardPowerUp(uint32_t n)
+{
+    uint32_t        cycle = ++powerUps;
+
+    sim_CardSetTempCrit(false);
+    sim_CardSetPwrGood(true, LATENCY_USECS + (cycle % LATENCY_STEPS) * LATENCY_STEP_USECS);
+
+    if ( cycle % TEMP_CRIT_EVERY == 0 )
+        sim_CardSetTempCrit(true);
+    else if ( cycle % TIMEOUT_EVERY == 0 )
+        sim_CardSetPwrGood(false, 0);
+    else if ( cycle % LOST_EVERY == 0 )
+        sim_CardDropPwrGood(LOST_AFTER_USECS);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+    sim_CardOnPowerUp(NULL);
+    sim_CardSetTempCrit(false);
+    sim_CardSetPwrGood(true, SIM_PWRGOOD_USECS);
+}
+
+static void test_power_cycle_10k(void)
+{
+    const power_cycle_stats_t   *stats = power_GetCycleStats();
+    uint32_t                    tempCrit = 0, timeout = 0, lost = 0;
+    uint32_t                    mean;
+    char                        cmd[40];
+
+    for ( uint32_t cycle = 1; cycle <= CYCLES; cycle++ )
+    {
+        if ( cycle % TEMP_CRIT_EVERY == 0 )
+            tempCrit++;
+        else if ( cycle % TIMEOUT_EVERY == 0 )
+            timeout++;
+        else if ( cycle % LOST_EVERY == 0 )
+            lost++;
+    }
+
+    sprintf(cmd, "set pdelay %d", PDELAY_MSECS);
+    (void) sim_Command(cmd, 1000000);
+
+    powerUps = 0;
+    sim_CardOnPowerUp(cardPowerUp);
+
+    sprintf(cmd, "power cycle %d %d %d", CYCLES, ON_MSECS, OFF_MSECS);
+    TEST_ASSERT_NOT_NULL(strstr(sim_Command(cmd, 1000000), "Starting"));
+
+    // each cycle is at most pdelay + PWR_SCAN_DELAY_MSEC + on + off
+    for ( uint32_t secs = 0; stats->done < CYCLES && secs < CYCLES * 3; secs++ )
+    {
+        sim_OutputClear();
+        sim_Run(1000000, STEP_USECS);
+    }
+
+    sim_Run(100000, STEP_USECS);
+
+    TEST_ASSERT_EQUAL_UINT32(CYCLES, stats->done);
+    TEST_ASSERT_EQUAL_UINT32(CYCLES, powerUps);
+    TEST_ASSERT_EQUAL(PWR_STATE_OFF, power_GetState());
+    TEST_ASSERT_TRUE(strstr(sim_Output(), "Power cycle test complete") != NULL);
+
+    TEST_ASSERT_EQUAL_UINT32(tempCrit, stats->faults[PWR_FAULT_TEMP_CRIT]);
+    TEST_ASSERT_EQUAL_UINT32(timeout, stats->faults[PWR_FAULT_PWRGOOD_TIMEOUT]);
+    TEST_ASSERT_EQUAL_UINT32(lost, stats->faults[PWR_FAULT_PWRGOOD_LOST]);
+    TEST_ASSERT_EQUAL_UINT32(0, stats->faults[PWR_FAULT_POWER_DOWN]);
+    TEST_ASSERT_EQUAL_UINT32(0, stats->faults[PWR_FAULT_CARD_REMOVED]);
+    TEST_ASSERT_EQUAL_UINT32(0, stats->mismatches);
+    TEST_ASSERT_EQUAL_UINT32(CYCLES - tempCrit - timeout - lost, stats->pass);
+
+    // NIC_PWR_GOOD rose in every cycle but the TEMP_CRIT and timeout ones
+    TEST_ASSERT_EQUAL_UINT32(CYCLES - tempCrit - timeout, stats->pwrGoodCount);
+    mean = (uint32_t) (stats->pwrGoodSum / stats->pwrGoodCount);
+
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(PDELAY_USECS + LATENCY_USECS, stats->pwrGoodMin);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PDELAY_USECS + LATENCY_USECS + POLL_SLACK_USECS, stats->pwrGoodMin);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(PDELAY_USECS + LATENCY_MAX_USECS, stats->pwrGoodMax);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PDELAY_USECS + LATENCY_MAX_USECS + POLL_SLACK_USECS, stats->pwrGoodMax);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(PDELAY_USECS + LATENCY_MEAN_USECS, mean);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PDELAY_USECS + LATENCY_MEAN_USECS + POLL_SLACK_USECS, mean);
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_power_cycle_10k);
+    return(UNITY_END());
+}
@@ -0,0 +1,159 @@
+//===================================================================
+// test_scan.cpp
+//
+// Scan chain length detection and capture against the simulated card:
+// chains of 8, 32, 33, 255 and 256 bits, an open chain and no card.
+// Background sampling across a card removal and insertion.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "main.hpp"
+#include "scan.hpp"
+#include "hal.hpp"
+#include "sim.hpp"
+
+// card data holding the detection markers, so only the marker that
+// went through the chain may count
+static const uint8_t        markerData[SIM_SCAN_MAX_BITS / 8] = {
+    0xA5, 0x3C, 0x5A, 0xC3, 0xA5, 0x3C, 0x5A, 0xC3, 0xA5, 0x3C, 0x5A, 0xC3,
+    0xA5, 0x3C, 0x5A, 0xC3, 0xA5, 0x3C, 0x5A, 0xC3, 0xA5, 0x3C, 0x5A, 0xC3,
+    0xA5, 0x3C, 0x5A, 0xC3, 0xA5, 0x3C, 0x5A, 0xC3,
+};
+
+void setUp(void)
+{
+    sim_CardInsert(0x0);
+}
+
+void tearDown(void)
+{
+    hal_PinWrite(OCP_MAIN_PWR_EN, 0);
+    hal_PinWrite(OCP_AUX_PWR_EN, 0);
+    sim_Advance(SIM_PWRGOOD_FALL_USECS);
+    scan_SetLength(SCAN_DEFAULT_BITS);
+}
+
+/**
+  * @name   cardPowerUp
+  * @brief  enable the rails and wait for valid scan chain data
+  */
+static void cardPowerUp(void)
+{
+    hal_PinWrite(OCP_AUX_PWR_EN, 1);
+    hal_PinWrite(OCP_MAIN_PWR_EN, 1);
+    sim_Advance(SIM_PWRGOOD_USECS + SIM_SCAN_VALID_USECS);
+}
+
+static void test_detect_lengths(void)
+{
+    const uint16_t      lengths[] = {8, 32, 33, 255, 256};
+    char                msg[32];
+
+    for ( unsigned i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++ )
+    {
+        sprintf(msg, "chain of %u bits", lengths[i]);
+        sim_ScanSetChain(lengths[i], NULL);
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(lengths[i], scan_DetectLength(), msg);
+    }
+}
+
+static void test_detect_lengths_marker_data(void)
+{
+    const uint16_t      lengths[] = {8, 32, 33, 255, 256};
+    char                msg[32];
+
+    cardPowerUp();
+
+    for ( unsigned i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++ )
+    {
+        sprintf(msg, "chain of %u bits", lengths[i]);
+        sim_ScanSetChain(lengths[i], markerData);
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(lengths[i], scan_DetectLength(), msg);
+    }
+}
+
+static void test_open_chain(void)
+{
+    sim_ScanSetChain(0, NULL);
+    TEST_ASSERT_EQUAL_UINT(0, scan_DetectLength());
+}
+
+static void test_no_card(void)
+{
+    sim_ScanSetChain(32, NULL);
+    sim_CardRemove();
+    TEST_ASSERT_EQUAL_UINT(0, scan_DetectLength());
+}
+
+static void test_too_long(void)
+{
+    // the marker comes back after the last bit scan_DetectLength() checks
+    sim_ScanSetChain(SCAN_MAX_BITS + 8, NULL);
+    TEST_ASSERT_EQUAL_UINT(0, scan_DetectLength());
+}
+
+static void test_capture_odd_length(void)
+{
+    const uint8_t       data[5] = {0xF0, 0xFE, 0xFF, 0xFF, 0x80};
+
+    sim_ScanSetChain(33, data);
+    cardPowerUp();
+
+    TEST_ASSERT_TRUE(scan_SetLength(33));
+    TEST_ASSERT_EQUAL_HEX32(0xF0FEFFFF, scan_Capture());
+    TEST_ASSERT_TRUE(scan_GetBit(32));
+
+    // the clocks after bit 32 are not chain data
+    TEST_ASSERT_EQUAL_HEX32(0x80000000, scan_GetWord(1));
+}
+
+static void test_watch_card_removal(void)
+{
+    const char      *out;
+    uint32_t        loads, noCard;
+    int             firsts = 0;
+
+    // unpowered, the chain reads the same 0s before and after
+    scan_ClearLog();
+    sim_OutputClear();
+    TEST_ASSERT_TRUE(scan_SetSamplePeriod(10, true));
+    sim_Run(50000, SIM_LOOP_USECS);
+
+    // no shifting without a card
+    sim_CardRemove();
+    loads = sim_ScanLoads();
+    sim_Run(50000, SIM_LOOP_USECS);
+    TEST_ASSERT_EQUAL_UINT32(loads, sim_ScanLoads());
+
+    // the first sample after insertion is logged though it repeats
+    sim_CardInsert(0x0);
+    sim_Run(50000, SIM_LOOP_USECS);
+    TEST_ASSERT_TRUE(scan_SetSamplePeriod(0, false));
+    scan_ShowSampling();
+    sim_Run(10000, SIM_LOOP_USECS);
+
+    out = sim_Output();
+    for ( const char *p = out; (p = strstr(p, "first sample")) != NULL; p++ )
+        firsts++;
+
+    TEST_ASSERT_EQUAL_INT(2, firsts);
+    TEST_ASSERT_NOT_NULL(strstr(out, "Logged: 2 of"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "No card: "));
+    noCard = strtoul(strstr(out, "No card: ") + 9, NULL, 10);
+    TEST_ASSERT_UINT32_WITHIN(1, 5, noCard);
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_detect_lengths);
+    RUN_TEST(test_detect_lengths_marker_data);
+    RUN_TEST(test_open_chain);
+    RUN_TEST(test_no_card);
+    RUN_TEST(test_too_long);
+    RUN_TEST(test_capture_odd_length);
+    RUN_TEST(test_watch_card_removal);
+    return(UNITY_END());
+}
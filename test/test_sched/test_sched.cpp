@@ -0,0 +1,237 @@
+//===================================================================
+// test_sched.cpp
+//
+// sched.cpp on a fake clock passed to sched_Init(): when periodic
+// tasks come due, also across the msecs wrap, a task running a nested
+// pass (a command that waits) is skipped while the others run, late
+// starts are counted and the phase kept unless a period was missed,
+// and run time statistics.  No firmware tasks or fixture are used.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "sched.hpp"
+
+#define MAX_RUNS            128
+
+// fake clock, moved by the test and by tasks that take time
+static uint32_t             fakeMsecs;
+static uint32_t             fakeUsecs;
+
+static uint32_t fakeMsecsNow(void) { return(fakeMsecs); }
+static uint32_t fakeUsecsNow(void) { return(fakeUsecs); }
+
+static const sched_clock_t  fakeClock = {fakeMsecsNow, fakeUsecsNow};
+
+// when each task ran, in fake msecs
+static uint32_t             runsA[MAX_RUNS];
+static uint32_t             runsB[MAX_RUNS];
+static uint32_t             runsC[MAX_RUNS];
+static int                  countA;
+static int                  countB;
+static int                  countC;
+
+// usecs taken by each run of taskTimed(), in turn
+static const uint32_t       timedUsecs[] = {100, 700, 300};
+static int                  timedRuns;
+static int                  nestDepth;
+
+static void taskA(void) { if ( countA < MAX_RUNS ) runsA[countA++] = fakeMsecs; }
+static void taskB(void) { if ( countB < MAX_RUNS ) runsB[countB++] = fakeMsecs; }
+static void taskC(void) { if ( countC < MAX_RUNS ) runsC[countC++] = fakeMsecs; }
+
+static void taskTimed(void)
+{
+    fakeUsecs += timedUsecs[timedRuns++ % 3];
+}
+
+/**
+  * @name   taskWaits
+  * @brief  a command that waits: runs passes of its own, as
+  *         backgroundPoll() does, taking time between them
+  */
+static void taskWaits(void)
+{
+    nestDepth++;
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        fakeUsecs += 50;
+        sched_Run();
+    }
+
+    nestDepth--;
+}
+
+/**
+  * @name   runTo
+  * @brief  one pass on each msec up to and including 'msecs'
+  */
+static void runTo(uint32_t msecs)
+{
+    while ( fakeMsecs != msecs )
+    {
+        fakeMsecs++;
+        fakeUsecs += 1000;
+        sched_Run();
+    }
+}
+
+void setUp(void)
+{
+    fakeMsecs = 1000;
+    fakeUsecs = 1000000;
+    countA = countB = countC = 0;
+    timedRuns = 0;
+    nestDepth = 0;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_due_times(void)
+{
+    static const sched_task_t   tasks[] = {
+        {"a",   taskA,  0},
+        {"b",   taskB,  10},
+        {"c",   taskC,  25},
+    };
+
+    sched_Init(tasks, 3, &fakeClock);
+    TEST_ASSERT_EQUAL(3, sched_TaskCount());
+    TEST_ASSERT_EQUAL_STRING("c", sched_GetTask(2)->name);
+
+    // periodic tasks first come due one period after sched_Init()
+    sched_Run();
+    TEST_ASSERT_EQUAL(1, countA);
+    TEST_ASSERT_EQUAL(0, countB);
+
+    runTo(1100);
+    TEST_ASSERT_EQUAL(101, countA);
+    TEST_ASSERT_EQUAL(10, countB);
+    TEST_ASSERT_EQUAL(4, countC);
+
+    for ( int i = 0; i < countB; i++ )
+        TEST_ASSERT_EQUAL_UINT32(1010 + 10 * i, runsB[i]);
+
+    for ( int i = 0; i < countC; i++ )
+        TEST_ASSERT_EQUAL_UINT32(1025 + 25 * i, runsC[i]);
+
+    TEST_ASSERT_EQUAL_UINT32(101, sched_GetStats(0)->runs);
+    TEST_ASSERT_EQUAL_UINT32(0, sched_GetStats(1)->late);
+}
+
+static void test_due_times_wrap(void)
+{
+    static const sched_task_t   tasks[] = {
+        {"b",   taskB,  10},
+    };
+
+    // msecs wraps 6 msecs after the first run
+    fakeMsecs = 0xFFFFFFF0;
+    sched_Init(tasks, 1, &fakeClock);
+    runTo(0x1C);
+
+    TEST_ASSERT_EQUAL(4, countB);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFA, runsB[0]);
+    TEST_ASSERT_EQUAL_UINT32(0x04, runsB[1]);
+    TEST_ASSERT_EQUAL_UINT32(0x0E, runsB[2]);
+    TEST_ASSERT_EQUAL_UINT32(0x18, runsB[3]);
+    TEST_ASSERT_EQUAL_UINT32(0, sched_GetStats(0)->late);
+}
+
+static void test_running_task_skipped(void)
+{
+    static const sched_task_t   tasks[] = {
+        {"a",       taskA,      0},
+        {"waits",   taskWaits,  0},
+        {"b",       taskB,      0},
+    };
+
+    sched_Init(tasks, 3, &fakeClock);
+    sched_Run();
+
+    // one outer pass and three nested ones run 'a' and 'b'; the task
+    // that is waiting is not entered again
+    TEST_ASSERT_EQUAL(4, countA);
+    TEST_ASSERT_EQUAL(4, countB);
+    TEST_ASSERT_EQUAL_UINT32(1, sched_GetStats(1)->runs);
+    TEST_ASSERT_EQUAL(0, nestDepth);
+
+    // and runs again on the next pass
+    sched_Run();
+    TEST_ASSERT_EQUAL_UINT32(2, sched_GetStats(1)->runs);
+    TEST_ASSERT_EQUAL(8, countA);
+}
+
+static void test_late_counts(void)
+{
+    static const sched_task_t   tasks[] = {
+        {"b",   taskB,  10},
+    };
+
+    sched_Init(tasks, 1, &fakeClock);
+
+    // on time
+    runTo(1010);
+    TEST_ASSERT_EQUAL(1, countB);
+
+    // 9 msecs late: not counted, the phase is kept (due at 1030)
+    fakeMsecs = 1029;
+    sched_Run();
+    TEST_ASSERT_EQUAL(2, countB);
+    TEST_ASSERT_EQUAL_UINT32(0, sched_GetStats(0)->late);
+    runTo(1030);
+    TEST_ASSERT_EQUAL(3, countB);
+    TEST_ASSERT_EQUAL_UINT32(1030, runsB[2]);
+
+    // a whole period missed: one run, counted late, due a period on
+    fakeMsecs = 1065;
+    sched_Run();
+    TEST_ASSERT_EQUAL(4, countB);
+    TEST_ASSERT_EQUAL_UINT32(1, sched_GetStats(0)->late);
+    runTo(1074);
+    TEST_ASSERT_EQUAL(4, countB);
+    runTo(1075);
+    TEST_ASSERT_EQUAL(5, countB);
+    TEST_ASSERT_EQUAL_UINT32(1, sched_GetStats(0)->late);
+    TEST_ASSERT_EQUAL_UINT32(5, sched_GetStats(0)->runs);
+}
+
+static void test_max_usecs(void)
+{
+    static const sched_task_t   tasks[] = {
+        {"timed",   taskTimed,  0},
+        {"waits",   taskWaits,  0},
+    };
+
+    sched_Init(tasks, 2, &fakeClock);
+
+    // 'timed' takes 100 usecs in the outer pass, then 700, 300 and 100
+    // in the three nested ones; 'waits' includes those plus its own
+    // 3 x 50
+    sched_Run();
+    TEST_ASSERT_EQUAL_UINT32(4, sched_GetStats(0)->runs);
+    TEST_ASSERT_EQUAL_UINT32(700, sched_GetStats(0)->maxUsecs);
+    TEST_ASSERT_EQUAL_UINT32(1200, sched_GetStats(0)->totalUsecs);
+    TEST_ASSERT_EQUAL_UINT32(150 + 700 + 300 + 100, sched_GetStats(1)->maxUsecs);
+    TEST_ASSERT_EQUAL_UINT32(100 + 1250, sched_StatsUsecs());
+
+    // cleared, and the window restarts
+    sched_ClearStats();
+    TEST_ASSERT_EQUAL_UINT32(0, sched_GetStats(0)->runs);
+    TEST_ASSERT_EQUAL_UINT32(0, sched_GetStats(0)->maxUsecs);
+    TEST_ASSERT_EQUAL_UINT32(0, sched_GetStats(1)->totalUsecs);
+    TEST_ASSERT_EQUAL_UINT32(0, sched_StatsUsecs());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_due_times);
+    RUN_TEST(test_due_times_wrap);
+    RUN_TEST(test_running_task_skipped);
+    RUN_TEST(test_late_counts);
+    RUN_TEST(test_max_usecs);
+    return(UNITY_END());
+}
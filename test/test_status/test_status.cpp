@@ -0,0 +1,168 @@
+//===================================================================
+// test_status.cpp
+//
+// The status screen's byte count against what reaches the host: the
+// full paint, an idle refresh that sends nothing, and one changed pin
+// that sends a cursor move and the one character that changed.  The
+// byte counts 'status' reports on exit must match what was sent.
+// 'set speriod' and 'set mperiod' range check the 16-bit fields.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "main.hpp"
+#include "eeprom.hpp"
+#include "commands.hpp"
+#include "sim.hpp"
+
+#define PERIOD_USECS        (STATUS_MIN_PERIOD_MSEC * 1000)
+
+extern EEPROM_data_t        EEPROMData;
+
+// screen text outside the fields, see statusCmd()
+static const char           *statusFixed[] = {
+    "\x1b[2J\r\n", "\x1b[1;29f", "TTF Status Display", "\x1b[24;22f", "Hit any key to exit this display"
+};
+
+// taken by the events while 'status' runs; its loop only returns to
+// the test at a key, so the test acts through fixture events
+static uint32_t             paintBytes;
+static uint32_t             settleBytes;
+static uint32_t             idleBytes;
+static char                 changeOut[32];
+
+/**
+  * @name   atPainted
+  * @brief  full paint is out, before the first refresh
+  */
+static void atPainted(uint32_t arg)
+{
+    const char      *out = strstr(sim_Output(), "\x1b[2J");
+
+    paintBytes = (out) ? strlen(out) : 0;
+    sim_OutputClear();
+}
+
+/**
+  * @name   atSettled
+  * @brief  the first meter samples have been drawn
+  */
+static void atSettled(uint32_t arg)
+{
+    settleBytes = strlen(sim_Output());
+    sim_OutputClear();
+}
+
+/**
+  * @name   atIdle
+  * @brief  refreshes with nothing changed, then change TEMP WARN
+  */
+static void atIdle(uint32_t arg)
+{
+    idleBytes = strlen(sim_Output());
+    sim_PinSet(TEMP_WARN, 1);
+}
+
+/**
+  * @name   atChanged
+  * @brief  keep what the change sent and hit a key
+  */
+static void atChanged(uint32_t arg)
+{
+    strncpy(changeOut, sim_Output(), sizeof(changeOut) - 1);
+    sim_Input("x");
+}
+
+void setUp(void)
+{
+    EEPROMData.status_period_msec = STATUS_MIN_PERIOD_MSEC;
+}
+
+void tearDown(void)
+{
+    sim_PinSet(TEMP_WARN, 0);
+}
+
+static void test_refresh_bytes(void)
+{
+    const char      *out;
+    uint32_t        fixed = 0;
+    unsigned long   fullBytes;
+    unsigned long   refreshes;
+    unsigned long   bytes;
+    unsigned long   average;
+
+    for ( unsigned i = 0; i < sizeof(statusFixed) / sizeof(statusFixed[0]); i++ )
+        fixed += strlen(statusFixed[i]);
+
+    (void) sim_Command("", 1000000);
+    sim_OutputClear();
+
+    sim_At(sim_Now() + PERIOD_USECS / 2, atPainted, 0);
+    sim_At(sim_Now() + 5 * PERIOD_USECS / 2, atSettled, 0);
+    sim_At(sim_Now() + 15 * PERIOD_USECS / 2, atIdle, 0);
+    sim_At(sim_Now() + 19 * PERIOD_USECS / 2, atChanged, 0);
+
+    // 'status' until the key; then the summary and prompt
+    out = sim_Command("status", 2000000);
+    TEST_ASSERT_NOT_NULL(out = strstr(out, " bytes of fields"));
+    while ( out[-1] != '\n' )
+        out--;
+
+    TEST_ASSERT_EQUAL(4, sscanf(out, "%lu bytes of fields on the full screen, %lu refreshes sent %lu bytes, %lu average",
+                                &fullBytes, &refreshes, &bytes, &average));
+
+    // 5 refreshes with no change sent nothing; TEMP WARN is row 3 and
+    // its level column 19
+    TEST_ASSERT_EQUAL(paintBytes - fixed, fullBytes);
+    TEST_ASSERT_EQUAL(0, idleBytes);
+    TEST_ASSERT_EQUAL_STRING("\x1b[3;19f1", changeOut);
+    TEST_ASSERT_UINT_WITHIN(1, 9, refreshes);
+    TEST_ASSERT_EQUAL(settleBytes + strlen(changeOut), bytes);
+    TEST_ASSERT_EQUAL(bytes / refreshes, average);
+}
+
+static void test_set_period_range(void)
+{
+    const char      *bad[] = {"-1", "65536", "70000", "12x", "x"};
+    const char      *names[] = {"speriod", "mperiod"};
+    uint16_t        *fields[] = {&EEPROMData.status_period_msec, &EEPROMData.meter_period_msec};
+    uint16_t        saved[2];
+    uint32_t        commits = sim_NvmCommits();
+    char            line[32];
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        saved[i] = *fields[i];
+
+        // rejected before it is narrowed, and FLASH is left alone
+        for ( unsigned j = 0; j < sizeof(bad) / sizeof(bad[0]); j++ )
+        {
+            sprintf(line, "set %s %s", names[i], bad[j]);
+            TEST_ASSERT_NOT_NULL_MESSAGE(strstr(sim_Command(line, 1000000), "must be 0..65535"), line);
+            TEST_ASSERT_EQUAL_UINT16(saved[i], *fields[i]);
+            TEST_ASSERT_EQUAL_UINT32(commits, sim_NvmCommits());
+        }
+
+        // the top of the range, written once
+        sprintf(line, "set %s 65535", names[i]);
+        (void) sim_Command(line, 1000000);
+        (void) sim_Command(line, 1000000);
+        TEST_ASSERT_EQUAL_UINT16(65535, *fields[i]);
+        TEST_ASSERT_EQUAL_UINT32(++commits, sim_NvmCommits());
+
+        sprintf(line, "set %s %u", names[i], saved[i]);
+        (void) sim_Command(line, 1000000);
+        TEST_ASSERT_EQUAL_UINT16(saved[i], *fields[i]);
+        commits = sim_NvmCommits();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_refresh_bytes);
+    RUN_TEST(test_set_period_range);
+    return(UNITY_END());
+}
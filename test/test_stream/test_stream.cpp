@@ -0,0 +1,193 @@
+//===================================================================
+// test_stream.cpp
+//
+// 'stream bin' as a host tool sees it: the sim's output split at the
+// 0x00 delimiters, each frame COBS decoded and CRC checked with the
+// encoding half of stream.cpp.  Records must come in sequence at the
+// period asked for, the command's echo before the first record must
+// fail as a frame, and every single bit error in a record must be
+// rejected.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "main.hpp"
+#include "power.hpp"
+#include "stream.hpp"
+#include "sim.hpp"
+
+#define STEP_USECS          100
+#define PERIOD_MSEC         20
+#define RUN_USECS           500000
+#define MIN_RECORDS         (RUN_USECS / 1000 / PERIOD_MSEC - 2)
+#define MAX_FRAMES          64
+#define CAPTURE_MAX         4096
+
+static uint8_t              captured[CAPTURE_MAX];
+static uint32_t             capturedLen;
+
+// frames of the capture, as offsets and lengths without the 0x00
+static uint32_t             frameAt[MAX_FRAMES];
+static int                  frameLen[MAX_FRAMES];
+static int                  frameCount;
+
+/**
+  * @name   captureStream
+  * @brief  run 'stream bin' for RUN_USECS and keep what was sent
+  */
+static void captureStream(void)
+{
+    char            cmd[32];
+    uint32_t        start = 0;
+
+    sprintf(cmd, "stream bin %d\r", PERIOD_MSEC);
+    (void) sim_Command("", 100000);
+    sim_OutputClear();
+    sim_Input(cmd);
+    sim_Run(RUN_USECS, STEP_USECS);
+
+    capturedLen = sim_OutputLength();
+    TEST_ASSERT_TRUE(capturedLen <= CAPTURE_MAX);
+    memcpy(captured, sim_Output(), capturedLen);
+
+    (void) sim_Command("stream off", 100000);
+
+    // a frame ends at each 0x00; anything after the last is partial
+    frameCount = 0;
+
+    for ( uint32_t i = 0; i < capturedLen && frameCount < MAX_FRAMES; i++ )
+    {
+        if ( captured[i] != 0 )
+            continue;
+
+        frameAt[frameCount] = start;
+        frameLen[frameCount] = i - start;
+        frameCount++;
+        start = i + 1;
+    }
+}
+
+/**
+  * @name   decodeFrame
+  * @brief  COBS decode and unpack a frame
+  * @retval true if it is a good record
+  */
+static bool decodeFrame(const uint8_t *frame, int len, stream_record_t *rec)
+{
+    uint8_t         raw[CAPTURE_MAX];
+    int             rawLen = stream_CobsDecode(frame, len, raw);
+
+    return(rawLen >= 0 && stream_Unpack(raw, rawLen, rec));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+    stream_Stop();
+}
+
+static void test_stream_bin_records(void)
+{
+    stream_record_t rec;
+    stream_record_t prev;
+    int             good = 0;
+
+    captureStream();
+    TEST_ASSERT_TRUE(frameCount >= MIN_RECORDS);
+
+    // the echo and prompt run into the first record
+    TEST_ASSERT_FALSE(decodeFrame(&captured[frameAt[0]], frameLen[0], &rec));
+
+    for ( int i = 1; i < frameCount; i++ )
+    {
+        TEST_ASSERT_EQUAL(STREAM_FRAME_MAX - 1, frameLen[i]);
+        TEST_ASSERT_TRUE_MESSAGE(decodeFrame(&captured[frameAt[i]], frameLen[i], &rec), "bad frame");
+
+        if ( good > 0 )
+        {
+            TEST_ASSERT_EQUAL_UINT32(prev.seq + 1, rec.seq);
+            TEST_ASSERT_UINT32_WITHIN(1, PERIOD_MSEC, rec.msecs - prev.msecs);
+        }
+
+        // the pin sample is taken while the record is built
+        TEST_ASSERT_UINT32_WITHIN(1, rec.msecs, rec.usecs / 1000);
+        TEST_ASSERT_EQUAL(power_GetState(), rec.pwrState);
+        TEST_ASSERT_EQUAL(power_GetFault(), rec.pwrFault);
+
+        prev = rec;
+        good++;
+    }
+
+    TEST_ASSERT_TRUE(good >= MIN_RECORDS - 1);
+}
+
+static void test_stream_bit_errors_rejected(void)
+{
+    uint8_t         frame[STREAM_FRAME_MAX];
+    stream_record_t rec;
+    int             len;
+
+    captureStream();
+    TEST_ASSERT_TRUE(frameCount >= 3);
+
+    len = frameLen[1];
+    TEST_ASSERT_TRUE(decodeFrame(&captured[frameAt[1]], len, &rec));
+
+    for ( int i = 0; i < len; i++ )
+    {
+        for ( int bit = 0; bit < 8; bit++ )
+        {
+            memcpy(frame, &captured[frameAt[1]], len);
+            frame[i] ^= 1 << bit;
+
+            // a new 0x00 is a delimiter to the host, two short frames
+            if ( frame[i] == 0 )
+            {
+                TEST_ASSERT_FALSE(decodeFrame(frame, i, &rec));
+                TEST_ASSERT_FALSE(decodeFrame(frame + i + 1, len - i - 1, &rec));
+                continue;
+            }
+
+            TEST_ASSERT_FALSE(decodeFrame(frame, len, &rec));
+        }
+    }
+
+    // cut short, and two records with the delimiter lost
+    TEST_ASSERT_FALSE(decodeFrame(&captured[frameAt[1]], len - 1, &rec));
+    TEST_ASSERT_FALSE(decodeFrame(&captured[frameAt[1]], frameLen[1] + 1 + frameLen[2], &rec));
+}
+
+static void test_cobs_round_trip(void)
+{
+    uint8_t         raw[STREAM_RECORD_SIZE];
+    uint8_t         frame[STREAM_FRAME_MAX];
+    uint8_t         back[STREAM_FRAME_MAX];
+    uint8_t         bad[] = {0x05, 0x11, 0x22};
+    int             len;
+
+    // all zeros but the type, every byte a COBS code
+    memset(raw, 0, sizeof(raw));
+    raw[0] = STREAM_RECORD_TYPE;
+
+    len = stream_CobsEncode(raw, sizeof(raw), frame);
+    TEST_ASSERT_EQUAL(STREAM_FRAME_MAX - 1, len);
+    TEST_ASSERT_NULL(memchr(frame, 0, len));
+    TEST_ASSERT_EQUAL(STREAM_RECORD_SIZE, stream_CobsDecode(frame, len, back));
+    TEST_ASSERT_EQUAL_MEMORY(raw, back, STREAM_RECORD_SIZE);
+
+    // a code byte past the end of the frame
+    TEST_ASSERT_EQUAL(-1, stream_CobsDecode(bad, sizeof(bad), back));
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_stream_bin_records);
+    RUN_TEST(test_stream_bit_errors_rejected);
+    RUN_TEST(test_cobs_round_trip);
+    return(UNITY_END());
+}
@@ -0,0 +1,197 @@
+//===================================================================
+// test_usbtx.cpp
+//
+// usbtx.cpp's transmit banks on the sim's CDC IN endpoint.  A request
+// goes to the host whole; with the host's port closed a timeout drops
+// each byte once: the filling bank and what was never copied, not
+// the bank on the bus, which goes when the port opens again.  Later
+// requests drop at once, and a reset drops a bank still on the bus.
+//===================================================================
+#include <Arduino.h>
+#include <unity.h>
+#include "main.hpp"
+#include "cli.hpp"
+#include "usbtx.hpp"
+#include "hal.hpp"
+#include "sim.hpp"
+
+// request sizes: A alone on the bus, B and the start of C fill the
+// other bank, the rest of C is never copied
+#define REQ_A_LEN           300
+#define REQ_B_LEN           400
+#define REQ_C_LEN           600
+#define REQ_C_COPIED        (USBTX_BANK_SIZE - REQ_B_LEN)
+
+#define CDC_EP              3       // the sim's CDC_ENDPOINT_IN
+
+static uint8_t              data[REQ_C_LEN];
+static usbtx_req_t          reqA;
+static usbtx_req_t          reqB;
+static usbtx_req_t          reqC;
+static uint32_t             doneCalls;
+
+static void reqDone(usbtx_req_t *req)
+{
+    doneCalls++;
+}
+
+static void setReq(usbtx_req_t *req, uint16_t len)
+{
+    memset(req, 0, sizeof(*req));
+    req->data = data;
+    req->len = len;
+    req->done = reqDone;
+}
+
+/**
+  * @name   queueStalled
+  * @brief  close the port and queue A, B and C
+  */
+static void queueStalled(void)
+{
+    sim_SetDtr(false);
+    setReq(&reqA, REQ_A_LEN);
+    setReq(&reqB, REQ_B_LEN);
+    setReq(&reqC, REQ_C_LEN);
+
+    TEST_ASSERT_TRUE(usbtx_Write(&reqA));
+    TEST_ASSERT_TRUE(usbtx_Write(&reqB));
+    TEST_ASSERT_TRUE(usbtx_Write(&reqC));
+    TEST_ASSERT_EQUAL_UINT32(REQ_A_LEN + USBTX_BANK_SIZE, usbtx_Pending());
+}
+
+/**
+  * @name   timeOut
+  * @brief  let USBTX_TIMEOUT_MSEC pass with the port closed
+  */
+static void timeOut(void)
+{
+    sim_Advance(USBTX_TIMEOUT_MSEC * 1000);
+    usbtx_Poll();
+}
+
+void setUp(void)
+{
+    // terminal output from earlier tests out of the way
+    term_Flush();
+    sim_OutputClear();
+    doneCalls = 0;
+
+    for ( int i = 0; i < REQ_C_LEN; i++ )
+        data[i] = 'a' + (i % 26);
+}
+
+void tearDown(void)
+{
+    sim_SetDtr(true);
+}
+
+static void test_request_done(void)
+{
+    usbtx_stats_t   before = *usbtx_GetStats();
+
+    setReq(&reqA, REQ_A_LEN);
+    TEST_ASSERT_TRUE(usbtx_Write(&reqA));
+
+    TEST_ASSERT_EQUAL(USBTX_DONE, reqA.status);
+    TEST_ASSERT_EQUAL_UINT32(1, doneCalls);
+    TEST_ASSERT_EQUAL_UINT32(REQ_A_LEN, strlen(sim_Output()));
+    TEST_ASSERT_EQUAL_MEMORY(data, sim_Output(), REQ_A_LEN);
+    TEST_ASSERT_EQUAL_UINT32(0, usbtx_Pending());
+    TEST_ASSERT_EQUAL_UINT32(before.completed + 1, usbtx_GetStats()->completed);
+    TEST_ASSERT_EQUAL_UINT32(before.dropped, usbtx_GetStats()->dropped);
+}
+
+static void test_timeout_drops_once(void)
+{
+    usbtx_stats_t   before = *usbtx_GetStats();
+
+    queueStalled();
+
+    // not yet: the bank on the bus is younger than the timeout
+    sim_Advance(USBTX_TIMEOUT_MSEC * 1000 / 2);
+    usbtx_Poll();
+    TEST_ASSERT_EQUAL(USBTX_PENDING, reqA.status);
+    TEST_ASSERT_EQUAL_UINT32(0, doneCalls);
+
+    timeOut();
+    TEST_ASSERT_EQUAL(USBTX_TIMEOUT, reqA.status);
+    TEST_ASSERT_EQUAL(USBTX_TIMEOUT, reqB.status);
+    TEST_ASSERT_EQUAL(USBTX_TIMEOUT, reqC.status);
+    TEST_ASSERT_EQUAL_UINT32(3, doneCalls);
+    TEST_ASSERT_EQUAL_UINT32(before.timeouts + 1, usbtx_GetStats()->timeouts);
+
+    // the filling bank (B and the start of C) and the rest of C; A's
+    // bytes are still on the bus
+    TEST_ASSERT_EQUAL_UINT32(before.dropped + USBTX_BANK_SIZE + (REQ_C_LEN - REQ_C_COPIED),
+            usbtx_GetStats()->dropped);
+    TEST_ASSERT_EQUAL_UINT32(REQ_A_LEN, usbtx_Pending());
+
+    // another poll counts nothing more
+    timeOut();
+    TEST_ASSERT_EQUAL_UINT32(before.dropped + USBTX_BANK_SIZE + (REQ_C_LEN - REQ_C_COPIED),
+            usbtx_GetStats()->dropped);
+
+    // the host comes back and reads A, which was never dropped
+    sim_SetDtr(true);
+    TEST_ASSERT_EQUAL_UINT32(0, usbtx_Pending());
+    TEST_ASSERT_EQUAL_UINT32(REQ_A_LEN, strlen(sim_Output()));
+    TEST_ASSERT_EQUAL_UINT32(before.dropped + REQ_B_LEN + REQ_C_LEN, usbtx_GetStats()->dropped);
+    TEST_ASSERT_EQUAL_UINT32(before.queued + REQ_A_LEN + USBTX_BANK_SIZE, usbtx_GetStats()->queued);
+}
+
+static void test_host_gone_drops_at_once(void)
+{
+    usbtx_stats_t   before;
+
+    queueStalled();
+    timeOut();
+    before = *usbtx_GetStats();
+
+    // timed out and not read since, a new request is dropped whole
+    setReq(&reqB, REQ_B_LEN);
+    TEST_ASSERT_TRUE(usbtx_Write(&reqB));
+    TEST_ASSERT_EQUAL(USBTX_DROPPED, reqB.status);
+    TEST_ASSERT_EQUAL_UINT32(before.dropped + REQ_B_LEN, usbtx_GetStats()->dropped);
+    TEST_ASSERT_EQUAL_UINT32(before.timeouts, usbtx_GetStats()->timeouts);
+
+    sim_SetDtr(true);
+    TEST_ASSERT_EQUAL_UINT32(REQ_A_LEN, strlen(sim_Output()));
+}
+
+static void test_reset_drops_bus_bank(void)
+{
+    usbtx_stats_t   before;
+
+    queueStalled();
+    timeOut();
+    before = *usbtx_GetStats();
+
+    // a bus reset discards A, still on the bus; counted now, once
+    hal_IrqOff();
+    usbtx_Reset(CDC_EP);
+    hal_IrqOn();
+
+    TEST_ASSERT_EQUAL_UINT32(before.dropped + REQ_A_LEN, usbtx_GetStats()->dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, usbtx_Pending());
+
+    // and the port works again
+    sim_SetDtr(true);
+    sim_OutputClear();
+    setReq(&reqA, REQ_A_LEN);
+    TEST_ASSERT_TRUE(usbtx_Write(&reqA));
+    TEST_ASSERT_EQUAL(USBTX_DONE, reqA.status);
+    TEST_ASSERT_EQUAL_UINT32(REQ_A_LEN, strlen(sim_Output()));
+}
+
+int main(int argc, char **argv)
+{
+    sim_Setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_request_done);
+    RUN_TEST(test_timeout_drops_once);
+    RUN_TEST(test_host_gone_drops_at_once);
+    RUN_TEST(test_reset_drops_bus_bank);
+    return(UNITY_END());
+}